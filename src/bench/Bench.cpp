@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace bench
+{
+    namespace
+    {
+        struct ReportEntry
+        {
+            std::string suite;
+            std::string name;
+            std::string unit;
+            bool isTiming;
+            u64 iterations;
+            f64 seconds;
+            f64 value; // Throughput for timings
+        };
+
+        std::string currentSuite;
+        std::vector<ReportEntry> reportEntries;
+
+        void write_json_string(std::ostream& output, const std::string& string)
+        {
+            output << '"';
+
+            for (char c : string)
+            {
+                if (c == '"' || c == '\\')
+                    output << '\\' << c;
+                else if (static_cast<u8>(c) >= 0x20)
+                    output << c;
+            }
+
+            output << '"';
+        }
+    }
+
+    void begin_suite(const char* name)
+    {
+        currentSuite = name;
+    }
+
+    void report_result(const BenchResult& result, const char* unit)
+    {
+        const f64 throughput = static_cast<f64>(result.iterations) / result.seconds;
+        const f64 nanosecondsPerIteration = result.seconds * 1e9 / static_cast<f64>(result.iterations);
+
+        std::cout << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(16) << throughput << ' ' << unit << "/s" << std::setw(12) << nanosecondsPerIteration
+                  << " ns" << std::endl;
+
+        reportEntries.push_back({currentSuite, result.name, unit, true, result.iterations, result.seconds, throughput});
+    }
+
+    void report_value(const std::string& name, f64 value, const char* unit)
+    {
+        std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(16) << value << ' ' << unit << std::endl;
+
+        reportEntries.push_back({currentSuite, name, unit, false, 0, 0.0, value});
+    }
+
+    bool write_json_report(const char* path)
+    {
+        std::ofstream file(path);
+
+        if (!file)
+            return false;
+
+        file << "{\"results\":[" << std::setprecision(6) << std::scientific;
+
+        for (size_t entryIndex = 0; entryIndex < reportEntries.size(); entryIndex++)
+        {
+            const ReportEntry& entry = reportEntries[entryIndex];
+
+            file << (entryIndex > 0 ? "," : "") << "\n{\"suite\":";
+            write_json_string(file, entry.suite);
+            file << ",\"name\":";
+            write_json_string(file, entry.name);
+            file << ",\"unit\":";
+            write_json_string(file, entry.unit);
+
+            if (entry.isTiming)
+            {
+                file << ",\"iterations\":" << entry.iterations << ",\"seconds\":" << entry.seconds
+                     << ",\"per_second\":" << entry.value
+                     << ",\"ns_per_iteration\":" << entry.seconds * 1e9 / static_cast<f64>(entry.iterations);
+            }
+            else
+                file << ",\"value\":" << entry.value;
+
+            file << "}";
+        }
+
+        file << "\n]}\n";
+
+        return static_cast<bool>(file);
+    }
+}
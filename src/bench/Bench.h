@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "core/Types.h"
+
+#include <chrono>
+#include <string>
+
+namespace bench
+{
+    struct BenchResult
+    {
+        std::string name;
+        u64 iterations;
+        f64 seconds;
+    };
+
+    static const f64 MinBenchDurationSeconds = 0.25;
+
+    // Runs the function in growing batches until enough time has elapsed to get
+    // a stable measurement.
+    template <typename Function>
+    BenchResult run_benchmark(const std::string& name, Function&& function)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        u64 batchSize = 1;
+        u64 iterations = 0;
+        f64 seconds = 0.0;
+
+        function(); // Warmup
+
+        while (seconds < MinBenchDurationSeconds)
+        {
+            const Clock::time_point start = Clock::now();
+
+            for (u64 i = 0; i < batchSize; i++)
+                function();
+
+            const std::chrono::duration<f64> elapsed = Clock::now() - start;
+
+            seconds += elapsed.count();
+            iterations += batchSize;
+            batchSize *= 2;
+        }
+
+        return {name, iterations, seconds};
+    }
+
+    // Printed results are also kept for write_json_report(), tagged with the current suite name.
+    void begin_suite(const char* name);
+
+    void report_result(const BenchResult& result, const char* unit);
+
+    // For measurements that are not timings, like memory usage.
+    void report_value(const std::string& name, f64 value, const char* unit);
+
+    // Machine-readable version of everything reported so far, meant to be diffed between runs.
+    // Returns false if the file could not be written.
+    bool write_json_report(const char* path);
+}
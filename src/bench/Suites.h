@@ -0,0 +1,23 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+namespace bench
+{
+    void run_batchenv_benchmarks();
+    void run_core_benchmarks();
+    void run_coverage_benchmarks();
+    void run_display_benchmarks();
+    void run_expansion_benchmarks();
+    void run_fork_benchmarks();
+    void run_profiler_benchmarks();
+    void run_rewind_benchmarks();
+    void run_savestate_benchmarks();
+    void run_transposition_benchmarks();
+    void run_workload_benchmarks();
+}
@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/BatchEnv.h"
+
+#include <vector>
+
+namespace bench
+{
+    namespace
+    {
+        // Draws a random glyph at a random position forever.
+        const u8 BatchEnvProgram[] = {
+            0xC0, 0x3F, // RND V0, 0x3F
+            0xC1, 0x1F, // RND V1, 0x1F
+            0xC2, 0x0F, // RND V2, 0x0F
+            0xF2, 0x29, // LD F, V2
+            0xD0, 0x15, // DRW V0, V1, 5
+            0x12, 0x00, // JP 0x200
+        };
+
+        static const u32 EnvCount = 256;
+    }
+
+    void run_batchenv_benchmarks()
+    {
+        const chip8::EmuConfig config = {};
+        chip8::BatchEnv* env = chip8::createBatchEnv(EnvCount, config, BatchEnvProgram, sizeof(BatchEnvProgram));
+
+        std::vector<u16> actions(EnvCount, 0);
+        std::vector<u8> observations(EnvCount * chip8::ObservationSizeInBytes);
+        std::vector<f32> rewards(EnvCount);
+        std::vector<u8> dones(EnvCount);
+
+        chip8::bind_batch_env_buffers(*env, {actions.data(), observations.data(), rewards.data(), dones.data()});
+        chip8::reset_batch_env(*env);
+
+        const BenchResult result = run_benchmark("step_256_envs", [&] { chip8::step_batch_env(*env); });
+
+        report_result(result, "steps");
+        report_value("env_frames_per_second", static_cast<f64>(result.iterations * EnvCount) / result.seconds, "frames/s");
+
+        // Action repeat, with flicker removal.
+        chip8::set_batch_env_frame_skip(*env, 4, chip8::ScreenPooling::Or);
+
+        const BenchResult skipResult = run_benchmark("step_256_envs_skip_4_or", [&] { chip8::step_batch_env(*env); });
+
+        report_result(skipResult, "steps");
+        report_value("env_frames_per_second_skip_4_or", static_cast<f64>(skipResult.iterations * EnvCount * 4) / skipResult.seconds,
+                     "frames/s");
+
+        chip8::destroyBatchEnv(env);
+    }
+}
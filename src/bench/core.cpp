@@ -0,0 +1,240 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/Execution.h"
+#include "chip8/Opcode.h"
+#include "chip8/Quirks.h"
+#include "chip8/Verifier.h"
+
+#include "core/Assert.h"
+
+#include <cstring>
+#include <string>
+
+namespace bench
+{
+    namespace
+    {
+        // One instruction per opcode class, chosen so that it can be executed over and over
+        // from the same starting registers.
+        const u16 DispatchInstructions[] = {
+            0x00E0, // CLS
+            0x00EE, // RET
+            0x0123, // SYS 0x123
+            0x1200, // JP 0x200
+            0x2200, // CALL 0x200
+            0x3001, // SE V0, 1
+            0x4001, // SNE V0, 1
+            0x5010, // SE V0, V1
+            0x6012, // LD V0, 0x12
+            0x7001, // ADD V0, 1
+            0x8010, // LD V0, V1
+            0x8011, // OR V0, V1
+            0x8012, // AND V0, V1
+            0x8013, // XOR V0, V1
+            0x8014, // ADD V0, V1
+            0x8015, // SUB V0, V1
+            0x8016, // SHR V0
+            0x8017, // SUBN V0, V1
+            0x801E, // SHL V0
+            0x9010, // SNE V0, V1
+            0xA300, // LD I, 0x300
+            0xB200, // JP V0, 0x200
+            0xC0FF, // RND V0, 0xFF
+            0xD015, // DRW V0, V1, 5
+            0xE09E, // SKP V0
+            0xE0A1, // SKNP V0
+            0xF007, // LD V0, DT
+            0xF00A, // LD V0, K
+            0xF015, // LD DT, V0
+            0xF018, // LD ST, V0
+            0xF01E, // ADD I, V0
+            0xF029, // LD F, V0
+            0xF033, // LD B, V0
+            0xF355, // LD [I], V3
+            0xF365, // LD V3, [I]
+        };
+
+        static_assert(sizeof(DispatchInstructions) / sizeof(DispatchInstructions[0])
+                          == static_cast<u32>(chip8::OpcodeClass::Invalid),
+                      "every valid opcode class needs a dispatch benchmark");
+
+        // Small even values keep JP V0 aligned and LD F in the font table.
+        const u8 DispatchRegisters[chip8::VRegisterCount] = {2, 4, 6, 8};
+
+        struct DrawCase
+        {
+            const char* name;
+            u8 x;
+            u8 y;
+            u8 size;
+        };
+
+        const DrawCase DrawCases[] = {
+            {"drw_1_aligned", 8, 8, 1},
+            {"drw_5_aligned", 8, 8, 5},
+            {"drw_15_aligned", 8, 8, 15},
+            {"drw_5_unaligned", 11, 8, 5},
+            {"drw_15_unaligned", 11, 8, 15},
+            {"drw_5_wrap_x", 61, 8, 5},
+            {"drw_15_wrap_y", 8, 24, 15},
+            {"drw_15_wrap_xy", 61, 24, 15},
+        };
+
+        // Mix of draws, calls and arithmetic, loosely shaped like a game loop.
+        const u8 MixedProgram[] = {
+            0x60, 0x00, // 0x200: LD V0, 0
+            0x61, 0x00, // 0x202: LD V1, 0
+            0xA2, 0x20, // 0x204: LD I, 0x220
+            0xD0, 0x15, // 0x206: DRW V0, V1, 5
+            0x22, 0x16, // 0x208: CALL 0x216
+            0x70, 0x01, // 0x20A: ADD V0, 1
+            0x30, 0x40, // 0x20C: SE V0, 64
+            0x12, 0x04, // 0x20E: JP 0x204
+            0x60, 0x00, // 0x210: LD V0, 0
+            0x71, 0x01, // 0x212: ADD V1, 1
+            0x12, 0x04, // 0x214: JP 0x204
+            0x82, 0x04, // 0x216: ADD V2, V0
+            0x83, 0x02, // 0x218: AND V3, V0
+            0x84, 0x26, // 0x21A: SHR V4, V2
+            0xC5, 0xFF, // 0x21C: RND V5, 0xFF
+            0x00, 0xEE, // 0x21E: RET
+            0xF0, 0x90, // 0x220: sprite
+            0xF0, 0x90,
+            0xF0, 0x00,
+        };
+
+        // One second of emulated time.
+        static const unsigned int StepTimeMs = 1000;
+        static const u32 InstructionsPerStep = StepTimeMs / chip8::InstructionExecutionPeriodMs;
+
+        void reset_dispatch_state(chip8::CPUState& state)
+        {
+            state.pc = chip8::MinProgramAddress;
+            state.sp = 1;
+            state.stack[1] = chip8::MinProgramAddress;
+            state.i = 0x300;
+            std::memcpy(state.vRegisters, DispatchRegisters, chip8::VRegisterCount);
+        }
+
+        void run_dispatch_benchmarks(const chip8::EmuConfig& config, chip8::CPUState& state)
+        {
+            for (u16 instruction : DispatchInstructions)
+            {
+                const chip8::OpcodeClass opcodeClass = chip8::get_opcode_class(instruction);
+                const std::string name = std::string("dispatch ") + chip8::get_opcode_class_name(opcodeClass);
+
+                // The reset is a handful of stores, it is part of every measurement.
+                report_result(run_benchmark(name, [&] {
+                                  reset_dispatch_state(state);
+                                  chip8::execute_instruction(config, state, instruction);
+                              }), "instructions");
+            }
+        }
+
+        void run_draw_benchmarks(const chip8::EmuConfig& config, chip8::CPUState& state)
+        {
+            for (const DrawCase& drawCase : DrawCases)
+            {
+                const u16 instruction = static_cast<u16>(0xD010 | drawCase.size);
+
+                state.vRegisters[chip8::V0] = drawCase.x;
+                state.vRegisters[chip8::V1] = drawCase.y;
+                state.i = chip8::MinProgramAddress; // The program bytes make a busy enough sprite
+
+                report_result(run_benchmark(drawCase.name, [&] { chip8::execute_instruction(config, state, instruction); }),
+                              "draws");
+            }
+
+            report_result(run_benchmark("cls", [&] { chip8::execute_instruction(config, state, 0x00E0); }), "clears");
+        }
+    }
+
+    void run_core_benchmarks()
+    {
+        const chip8::EmuConfig config = {};
+        chip8::CPUState state = chip8::createCPUState();
+
+        chip8::load_program(state, MixedProgram, sizeof(MixedProgram));
+
+        run_dispatch_benchmarks(config, state);
+        run_draw_benchmarks(config, state);
+
+        // Whole program through execute_step(), with timers and fetch.
+        chip8::initCPUState(state);
+
+        const BenchResult result = run_benchmark("mixed_program_step_1s", [&] {
+            chip8::execute_step(config, state, StepTimeMs);
+        });
+
+        Assert(state.sp <= 1); // Still looping
+
+        report_result(result, "steps");
+        report_value("mixed_program_instructions_per_second",
+                     static_cast<f64>(result.iterations * InstructionsPerStep) / result.seconds, "instructions/s");
+
+        // Every quirk profile runs its own instantiation of the interpreter, they should all match the default one.
+        for (u32 profileIndex = 1; profileIndex < chip8::QuirkProfileCount; profileIndex++)
+        {
+            chip8::EmuConfig quirkConfig = config;
+            quirkConfig.quirkProfile = static_cast<chip8::QuirkProfile>(profileIndex);
+
+            const std::string name =
+                std::string("mixed_program_step_1s_") + chip8::get_quirk_profile_name(quirkConfig.quirkProfile);
+
+            chip8::initCPUState(state);
+
+            report_result(run_benchmark(name, [&] { chip8::execute_step(quirkConfig, state, StepTimeMs); }), "steps");
+        }
+
+        // Same program without the Asserts and bound checks.
+        chip8::EmuConfig uncheckedConfig = config;
+        uncheckedConfig.executionPolicy = chip8::ExecutionPolicy::Unchecked;
+
+        chip8::initCPUState(state);
+
+        const BenchResult uncheckedResult = run_benchmark("mixed_program_step_1s_unchecked", [&] {
+            chip8::execute_step(uncheckedConfig, state, StepTimeMs);
+        });
+
+        Assert(state.sp <= 1); // Still looping
+
+        report_result(uncheckedResult, "steps");
+        report_value("unchecked_speedup",
+                     (static_cast<f64>(uncheckedResult.iterations) / uncheckedResult.seconds)
+                         / (static_cast<f64>(result.iterations) / result.seconds),
+                     "x");
+
+        // Checked again, minus the checks the verifier proved at load time. The whole program verifies.
+        chip8::ProgramVerification verification;
+        chip8::verify_program(state, config.quirkProfile, verification);
+
+        Assert(verification.verifiedInstructionCount == verification.codeInstructionCount);
+
+        chip8::EmuConfig verifiedConfig = config;
+        verifiedConfig.verification = &verification;
+
+        chip8::initCPUState(state);
+
+        const BenchResult verifiedResult = run_benchmark("mixed_program_step_1s_verified", [&] {
+            chip8::execute_step(verifiedConfig, state, StepTimeMs);
+        });
+
+        Assert(state.sp <= 1); // Still looping
+
+        report_result(verifiedResult, "steps");
+        report_value("verified_speedup",
+                     (static_cast<f64>(verifiedResult.iterations) / verifiedResult.seconds)
+                         / (static_cast<f64>(result.iterations) / result.seconds),
+                     "x");
+
+        chip8::destroyCPUState(state);
+    }
+}
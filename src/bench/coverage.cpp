@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/Coverage.h"
+#include "chip8/Execution.h"
+
+namespace bench
+{
+    namespace
+    {
+        // Tight loop with both skip outcomes, every instruction is cheap so the recording shows.
+        const u8 CoverageProgram[] = {
+            0x70, 0x01, // ADD V0, 1
+            0x30, 0x00, // SE V0, 0x00
+            0x12, 0x00, // JP 0x200
+            0x71, 0x01, // ADD V1, 1
+            0x12, 0x00, // JP 0x200
+        };
+
+        // One second of emulated time.
+        static const unsigned int StepTimeMs = 1000;
+    }
+
+    void run_coverage_benchmarks()
+    {
+        chip8::EmuConfig config = {};
+        chip8::CPUState state = chip8::createCPUState();
+
+        chip8::load_program(state, CoverageProgram, sizeof(CoverageProgram));
+
+        const BenchResult baseResult = run_benchmark("step_1s", [&] { chip8::execute_step(config, state, StepTimeMs); });
+
+        chip8::CodeCoverage coverage;
+        chip8::clear_code_coverage(coverage);
+        config.coverage = &coverage;
+
+        const BenchResult coveredResult =
+            run_benchmark("step_1s_coverage", [&] { chip8::execute_step(config, state, StepTimeMs); });
+
+        chip8::CodeCoverage mergedCoverage;
+        chip8::clear_code_coverage(mergedCoverage);
+
+        const BenchResult mergeResult =
+            run_benchmark("coverage_merge", [&] { chip8::merge_code_coverage(mergedCoverage, coverage); });
+
+        report_result(baseResult, "steps");
+        report_result(coveredResult, "steps");
+        report_result(mergeResult, "merges");
+        report_value("coverage_overhead", 100.0 * ((coveredResult.seconds / static_cast<f64>(coveredResult.iterations))
+                                                   / (baseResult.seconds / static_cast<f64>(baseResult.iterations)) - 1.0),
+                     "%");
+
+        chip8::destroyCPUState(state);
+    }
+}
@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/Config.h"
+#include "chip8/Cpu.h"
+#include "chip8/Display.h"
+
+#include <string>
+#include <vector>
+
+namespace bench
+{
+    namespace
+    {
+        const unsigned int ImageScales[] = {1, 4, 8, 16};
+    }
+
+    void run_display_benchmarks()
+    {
+        chip8::CPUState state = chip8::createCPUState();
+        const chip8::Palette palette = {{1.f, 1.f, 1.f}, {0.14f, 0.14f, 0.14f}};
+
+        // Checkerboard, so that both colors get written.
+        for (u32 y = 0; y < chip8::ScreenHeight; y++)
+        {
+            for (u32 x = 0; x < chip8::ScreenWidth; x++)
+                chip8::write_screen_pixel(state, x, y, static_cast<u8>((x + y) & 1));
+        }
+
+        for (unsigned int scale : ImageScales)
+        {
+            std::vector<u8> image(chip8::ScreenWidth * chip8::ScreenHeight * scale * scale * 4);
+
+            report_result(run_benchmark("fill_image_buffer_x" + std::to_string(scale),
+                                        [&] { chip8::fill_image_buffer(image.data(), state, palette, scale); }),
+                          "frames");
+        }
+
+        chip8::destroyCPUState(state);
+    }
+}
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/Execution.h"
+#include "chip8/Expansion.h"
+#include "chip8/ThreadPool.h"
+
+#include <vector>
+
+namespace bench
+{
+    namespace
+    {
+        // Moves a glyph around with the keys, like most games do.
+        const u8 ExpansionProgram[] = {
+            0x63, 0x04, // LD V3, 4
+            0xE3, 0xA1, // SKNP V3
+            0x70, 0xFF, // ADD V0, -1
+            0x63, 0x06, // LD V3, 6
+            0xE3, 0xA1, // SKNP V3
+            0x70, 0x01, // ADD V0, 1
+            0x00, 0xE0, // CLS
+            0xD0, 0x15, // DRW V0, V1, 5
+            0xA3, 0x00, // LD I, 0x300
+            0xF0, 0x55, // LD [I], V0
+            0x12, 0x00, // JP 0x200
+        };
+
+        static const u32 ParentCount = 64;
+        static const unsigned int FrameTimeMs = 16;
+    }
+
+    void run_expansion_benchmarks()
+    {
+        const chip8::EmuConfig config = {};
+        const u32 childCount = ParentCount * chip8::SingleKeyActionCount;
+
+        std::vector<chip8::CPUState> parents(ParentCount);
+
+        for (u32 parentIndex = 0; parentIndex < ParentCount; parentIndex++)
+        {
+            parents[parentIndex] = chip8::createCPUState();
+            chip8::load_program(parents[parentIndex], ExpansionProgram, sizeof(ExpansionProgram));
+
+            for (u32 frame = 0; frame < parentIndex; frame++)
+                chip8::execute_step(config, parents[parentIndex], FrameTimeMs);
+        }
+
+        u16 actions[chip8::SingleKeyActionCount];
+
+        for (u32 actionIndex = 0; actionIndex < chip8::SingleKeyActionCount; actionIndex++)
+            actions[actionIndex] = chip8::get_single_key_action(actionIndex);
+
+        std::vector<chip8::CPUState> children(childCount);
+        std::vector<u64> childHashes(childCount);
+
+        chip8::ThreadPool* pool = chip8::createThreadPool(0);
+
+        const auto expand = [&](chip8::ThreadPool* expansionPool) {
+            chip8::expand_states(expansionPool, config, parents.data(), ParentCount, actions, chip8::SingleKeyActionCount,
+                                 FrameTimeMs, children.data(), childHashes.data());
+
+            for (chip8::CPUState& child : children)
+                chip8::destroyCPUState(child);
+        };
+
+        const BenchResult serialResult = run_benchmark("expand_64x17_serial", [&] { expand(nullptr); });
+        const BenchResult poolResult = run_benchmark("expand_64x17_pool", [&] { expand(pool); });
+
+        report_result(serialResult, "expansions");
+        report_result(poolResult, "expansions");
+        report_value("expansion_workers", chip8::get_thread_pool_worker_count(*pool), "threads");
+        report_value("expansion_speedup", (serialResult.seconds / static_cast<f64>(serialResult.iterations))
+                                              / (poolResult.seconds / static_cast<f64>(poolResult.iterations)), "x");
+
+        chip8::destroyThreadPool(pool);
+
+        for (chip8::CPUState& parent : parents)
+            chip8::destroyCPUState(parent);
+    }
+}
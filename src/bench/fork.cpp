@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/CpuPool.h"
+#include "chip8/Execution.h"
+#include "chip8/SaveState.h"
+
+namespace bench
+{
+    void run_fork_benchmarks()
+    {
+        const chip8::EmuConfig config = {};
+        chip8::CPUState state = chip8::createCPUState();
+
+        state.i = chip8::MinProgramAddress;
+
+        report_result(run_benchmark("fork", [&] {
+                          chip8::CPUState child = chip8::forkCPUState(state);
+                          chip8::destroyCPUState(child);
+                      }), "forks");
+
+        // Typical search branch: a single BCD store before the child gets thrown away.
+        report_result(run_benchmark("fork_ldb", [&] {
+                          chip8::CPUState child = chip8::forkCPUState(state);
+                          chip8::execute_instruction(config, child, 0xF033);
+                          chip8::destroyCPUState(child);
+                      }), "forks");
+
+        // Same thing with pages coming from a pool instead of the heap.
+        chip8::CPUStatePool* pool = chip8::createCPUStatePool(2, false);
+
+        report_result(run_benchmark("pool_fork_ldb", [&] {
+                          chip8::CPUState* child = chip8::acquire_cpu_state(*pool);
+                          child->i = chip8::MinProgramAddress;
+                          chip8::execute_instruction(config, *child, 0xF033);
+                          chip8::release_cpu_state(*pool, child);
+                      }), "forks");
+
+        // Full copy of the machine for comparison.
+        chip8::SaveStatePayload payload;
+        chip8::CPUState copy = chip8::createCPUState();
+
+        report_result(run_benchmark("deep_copy_ldb", [&] {
+                          chip8::write_save_state_payload(state, payload);
+                          chip8::read_save_state_payload(copy, payload);
+                          chip8::execute_instruction(config, copy, 0xF033);
+                      }), "copies");
+
+        chip8::destroyCPUState(copy);
+        chip8::destroyCPUStatePool(pool);
+        chip8::destroyCPUState(state);
+    }
+}
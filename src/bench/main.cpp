@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/OpcodeStats.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    struct BenchSuite
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const BenchSuite Suites[] = {
+        {"batchenv", &bench::run_batchenv_benchmarks},
+        {"core", &bench::run_core_benchmarks},
+        {"coverage", &bench::run_coverage_benchmarks},
+        {"display", &bench::run_display_benchmarks},
+        {"expansion", &bench::run_expansion_benchmarks},
+        {"fork", &bench::run_fork_benchmarks},
+        {"profiler", &bench::run_profiler_benchmarks},
+        {"rewind", &bench::run_rewind_benchmarks},
+        {"savestate", &bench::run_savestate_benchmarks},
+        {"transposition", &bench::run_transposition_benchmarks},
+        {"workload", &bench::run_workload_benchmarks},
+    };
+}
+
+// Usage: chip8emu_bench [--json <path>] [suite]
+// The JSON report holds every result of the run, compare two of them to spot regressions.
+int main(int ac, char** av)
+{
+    const char* suiteFilter = nullptr;
+    const char* jsonPath = nullptr;
+    bool hasRunSuite = false;
+
+    for (int argIndex = 1; argIndex < ac; argIndex++)
+    {
+        if (std::strcmp(av[argIndex], "--json") == 0 && argIndex + 1 < ac)
+            jsonPath = av[++argIndex];
+        else
+            suiteFilter = av[argIndex];
+    }
+
+    for (const BenchSuite& suite : Suites)
+    {
+        if (suiteFilter != nullptr && std::strcmp(suiteFilter, suite.name) != 0)
+            continue;
+
+        std::cout << "[" << suite.name << "]" << std::endl;
+        bench::begin_suite(suite.name);
+        suite.run();
+        hasRunSuite = true;
+    }
+
+    if (!hasRunSuite)
+    {
+        std::cerr << "error: unknown suite '" << suiteFilter << "'" << std::endl;
+        return 1;
+    }
+
+    // Timings above are skewed by the instrumentation, but this tells where the time goes.
+    if (chip8::areOpcodeStatsEnabled())
+        chip8::print_opcode_stats(std::cout);
+
+    if (jsonPath != nullptr && !bench::write_json_report(jsonPath))
+    {
+        std::cerr << "error: could not write " << jsonPath << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
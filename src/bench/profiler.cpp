@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/Execution.h"
+#include "chip8/Profiler.h"
+
+namespace bench
+{
+    namespace
+    {
+        // Nested calls around cheap arithmetic, the worst case for the call graph.
+        const u8 ProfilerProgram[] = {
+            0x22, 0x06, // CALL 0x206
+            0x70, 0x01, // ADD V0, 1
+            0x12, 0x00, // JP 0x200
+            0x22, 0x0C, // CALL 0x20C
+            0x71, 0x01, // ADD V1, 1
+            0x00, 0xEE, // RET
+            0x72, 0x01, // ADD V2, 1
+            0x00, 0xEE, // RET
+        };
+
+        // One second of emulated time.
+        static const unsigned int StepTimeMs = 1000;
+    }
+
+    void run_profiler_benchmarks()
+    {
+        chip8::EmuConfig config = {};
+        chip8::CPUState state = chip8::createCPUState();
+
+        chip8::load_program(state, ProfilerProgram, sizeof(ProfilerProgram));
+
+        const BenchResult baseResult = run_benchmark("step_1s", [&] { chip8::execute_step(config, state, StepTimeMs); });
+
+        config.profiler = chip8::createProfiler();
+
+        const BenchResult profiledResult =
+            run_benchmark("step_1s_profiled", [&] { chip8::execute_step(config, state, StepTimeMs); });
+
+        report_result(baseResult, "steps");
+        report_result(profiledResult, "steps");
+        report_value("profiler_overhead", 100.0 * ((profiledResult.seconds / static_cast<f64>(profiledResult.iterations))
+                                                   / (baseResult.seconds / static_cast<f64>(baseResult.iterations)) - 1.0),
+                     "%");
+
+        chip8::destroyProfiler(config.profiler);
+        chip8::destroyCPUState(state);
+    }
+}
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/Execution.h"
+#include "chip8/Memory.h"
+#include "chip8/Rewind.h"
+
+#include <vector>
+
+namespace bench
+{
+    namespace
+    {
+        // Counts in V0, writes its BCD value to memory and draws a glyph every iteration.
+        const u8 RewindProgram[] = {
+            0x60, 0x00, // LD V0, 0
+            0x61, 0x00, // LD V1, 0
+            0x70, 0x01, // ADD V0, 1
+            0xA3, 0x00, // LD I, 0x300
+            0xF0, 0x33, // LD B, V0
+            0xA0, 0x00, // LD I, 0x000
+            0xD1, 0x15, // DRW V1, V1, 5
+            0x71, 0x01, // ADD V1, 1
+            0x12, 0x04, // JP 0x204
+            0x00, 0x00,
+        };
+
+        static const u32 FramesPerSecond = chip8::DelayTimerFrequency;
+        static const u32 HistoryFrameCount = 60 * FramesPerSecond;
+    }
+
+    void run_rewind_benchmarks()
+    {
+        const chip8::EmuConfig config = {};
+        chip8::CPUState state = chip8::createCPUState();
+
+        const std::vector<u8> zeroes(chip8::MemorySizeInBytes - chip8::MinProgramAddress, 0);
+
+        chip8::write_memory_range(state, chip8::MinProgramAddress, zeroes.data(), static_cast<u16>(zeroes.size()));
+        chip8::load_program(state, RewindProgram, sizeof(RewindProgram));
+
+        chip8::RewindBuffer* buffer = chip8::createRewindBuffer(chip8::DefaultRewindFrameCapacity,
+                                                                chip8::DefaultRewindKeyframeInterval,
+                                                                chip8::DefaultRewindDataCapacityInBytes);
+
+        // Fill 60 seconds of history
+        for (u32 frame = 0; frame < HistoryFrameCount; frame++)
+        {
+            chip8::execute_step(config, state, chip8::DelayTimerPeriodMs);
+            chip8::push_rewind_frame(*buffer, state);
+        }
+
+        report_value("history_60s_frames", buffer->frameCount, "frames");
+        report_value("history_60s_data", static_cast<f64>(chip8::get_rewind_data_usage(*buffer)) / 1024.0, "KiB");
+        report_value("history_60s_footprint", static_cast<f64>(chip8::get_rewind_memory_footprint(*buffer)) / 1024.0, "KiB");
+        report_value("history_60s_uncompressed",
+                     static_cast<f64>(HistoryFrameCount) * sizeof(chip8::SaveStatePayload) / 1024.0, "KiB");
+
+        // Full buffer, so this measures the steady state with evictions.
+        report_result(run_benchmark("push_frame", [&] {
+                          chip8::execute_step(config, state, chip8::DelayTimerPeriodMs);
+                          chip8::push_rewind_frame(*buffer, state);
+                      }), "frames");
+
+        // Rewind one frame at a time, refilling when empty.
+        report_result(run_benchmark("rewind_frame", [&] {
+                          if (chip8::rewind_frames(*buffer, state, 1) == 0)
+                          {
+                              for (u32 frame = 0; frame < HistoryFrameCount; frame++)
+                                  chip8::push_rewind_frame(*buffer, state);
+                          }
+                      }), "frames");
+
+        chip8::destroyRewindBuffer(buffer);
+        chip8::destroyCPUState(state);
+    }
+}
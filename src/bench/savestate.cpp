@@ -0,0 +1,39 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/SaveState.h"
+
+#include "core/Assert.h"
+
+namespace bench
+{
+    void run_savestate_benchmarks()
+    {
+        chip8::CPUState state = chip8::createCPUState();
+        chip8::SaveState saveState;
+
+        chip8::save_state(state, saveState);
+
+        report_result(run_benchmark("save_state", [&] { chip8::save_state(state, saveState); }), "states");
+
+        report_result(run_benchmark("load_state", [&] {
+                          const chip8::SaveStateError error = chip8::load_state(state, &saveState, sizeof(saveState));
+                          Assert(error == chip8::SaveStateError::None);
+                      }), "states");
+
+        // Raw payload round trip, no checksum involved.
+        report_result(run_benchmark("payload_round_trip", [&] {
+                          chip8::write_save_state_payload(state, saveState.payload);
+                          chip8::read_save_state_payload(state, saveState.payload);
+                      }), "states");
+
+        chip8::destroyCPUState(state);
+    }
+}
@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/Execution.h"
+#include "chip8/Keyboard.h"
+#include "chip8/StateHash.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace bench
+{
+    namespace
+    {
+        // Moves a glyph around with keys 2, 4, 6 and 8, once per frame.
+        // Many input sequences lead to the same position, which is what makes
+        // a transposition table worth it.
+        const u8 TranspositionProgram[] = {
+            0x60, 0x0A, // LD V0, 10
+            0x61, 0x0A, // LD V1, 10
+            0x62, 0x00, // LD V2, 0
+            0xF2, 0x29, // LD F, V2
+            0x00, 0xE0, // CLS
+            0xD0, 0x15, // DRW V0, V1, 5
+            0x63, 0x02, // LD V3, 2
+            0xE3, 0xA1, // SKNP V3
+            0x71, 0xFF, // ADD V1, -1
+            0x63, 0x08, // LD V3, 8
+            0xE3, 0xA1, // SKNP V3
+            0x71, 0x01, // ADD V1, 1
+            0x63, 0x04, // LD V3, 4
+            0xE3, 0xA1, // SKNP V3
+            0x70, 0xFF, // ADD V0, -1
+            0x63, 0x06, // LD V3, 6
+            0xE3, 0xA1, // SKNP V3
+            0x70, 0x01, // ADD V0, 1
+            0x64, 0x01, // LD V4, 1
+            0xF4, 0x15, // LD DT, V4
+            0xF4, 0x07, // LD V4, DT
+            0x34, 0x00, // SE V4, 0
+            0x12, 0x28, // JP 0x228
+            0x12, 0x08, // JP 0x208
+        };
+
+        const u16 SearchActions[] = {0, 1 << 0x2, 1 << 0x4, 1 << 0x6, 1 << 0x8};
+
+        static const u32 SearchDepth = 8;
+
+        struct SearchStats
+        {
+            u64 generatedNodeCount;
+            u64 transpositionCount;
+        };
+
+        // Breadth-first expansion of every input sequence, one frame per input.
+        // Children that hash to a state we already reached are dropped right away.
+        SearchStats search(const chip8::EmuConfig& config, const chip8::CPUState& root)
+        {
+            std::unordered_map<u64, u32> transpositionTable; // State hash -> depth it was first reached at
+            std::vector<chip8::CPUState> frontier;
+            std::vector<chip8::CPUState> nextFrontier;
+            SearchStats stats = {};
+
+            transpositionTable.emplace(chip8::get_state_hash(root), 0);
+            frontier.push_back(chip8::forkCPUState(root));
+
+            for (u32 depth = 1; depth <= SearchDepth; depth++)
+            {
+                for (const chip8::CPUState& node : frontier)
+                {
+                    for (u16 action : SearchActions)
+                    {
+                        chip8::CPUState child = chip8::forkCPUState(node);
+
+                        chip8::set_key_state(child, action);
+                        chip8::execute_step(config, child, chip8::DelayTimerPeriodMs);
+
+                        stats.generatedNodeCount++;
+
+                        if (transpositionTable.emplace(chip8::get_state_hash(child), depth).second)
+                            nextFrontier.push_back(child);
+                        else
+                        {
+                            stats.transpositionCount++;
+                            chip8::destroyCPUState(child);
+                        }
+                    }
+                }
+
+                for (chip8::CPUState& node : frontier)
+                    chip8::destroyCPUState(node);
+
+                frontier.swap(nextFrontier);
+                nextFrontier.clear();
+            }
+
+            for (chip8::CPUState& node : frontier)
+                chip8::destroyCPUState(node);
+
+            return stats;
+        }
+    }
+
+    void run_transposition_benchmarks()
+    {
+        const chip8::EmuConfig config = {};
+        chip8::CPUState root = chip8::createCPUState();
+
+        chip8::load_program(root, TranspositionProgram, sizeof(TranspositionProgram));
+
+        // Let the program settle in its main loop.
+        for (u32 frame = 0; frame < 4; frame++)
+            chip8::execute_step(config, root, chip8::DelayTimerPeriodMs);
+
+        SearchStats stats = {};
+
+        const BenchResult result = run_benchmark("search_depth_8", [&] { stats = search(config, root); });
+
+        report_result(result, "searches");
+        report_value("generated_nodes", static_cast<f64>(stats.generatedNodeCount), "nodes");
+        report_value("transposition_hit_rate", 100.0 * static_cast<f64>(stats.transpositionCount) / static_cast<f64>(stats.generatedNodeCount), "%");
+        report_value("nodes_per_second", static_cast<f64>(stats.generatedNodeCount * result.iterations) / result.seconds, "nodes/s");
+
+        chip8::destroyCPUState(root);
+    }
+}
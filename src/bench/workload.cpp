@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Bench.h"
+#include "Suites.h"
+
+#include "chip8/Execution.h"
+#include "chip8/Workload.h"
+
+#include <string>
+
+namespace bench
+{
+    namespace
+    {
+        static const u32 IterationCount = 4096;
+
+        // One frame at 60 Hz, like the frontend does.
+        static const unsigned int StepTimeMs = 16;
+
+        void run_workload(const chip8::EmuConfig& config, chip8::CPUState& state, const chip8::Workload& workload)
+        {
+            chip8::load_workload(state, workload);
+
+            while (!chip8::has_workload_halted(state, workload))
+                chip8::execute_step(config, state, StepTimeMs);
+        }
+    }
+
+    void run_workload_benchmarks()
+    {
+        const chip8::EmuConfig config = {};
+        chip8::CPUState state = chip8::createCPUState();
+        chip8::Workload workload;
+
+        for (u32 kindIndex = 0; kindIndex < chip8::WorkloadKindCount; kindIndex++)
+        {
+            const std::string name = chip8::get_workload_kind_name(static_cast<chip8::WorkloadKind>(kindIndex));
+
+            chip8::generate_workload(static_cast<chip8::WorkloadKind>(kindIndex), IterationCount, workload);
+
+            // Runs are deterministic, count the instructions once.
+            run_workload(config, state, workload);
+
+            const u64 instructionsPerRun = state.instructionCount;
+            const BenchResult result = run_benchmark(name, [&] { run_workload(config, state, workload); });
+
+            report_result(result, "runs");
+            report_value(name + "_instructions_per_second",
+                         static_cast<f64>(result.iterations * instructionsPerRun) / result.seconds, "instructions/s");
+        }
+
+        chip8::destroyCPUState(state);
+    }
+}
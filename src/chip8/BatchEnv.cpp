@@ -0,0 +1,300 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BatchEnv.h"
+
+#include "CpuPool.h"
+#include "Execution.h"
+#include "Trace.h"
+
+#include "core/Assert.h"
+#include "core/Platform.h"
+
+#include <cstring>
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+
+namespace chip8
+{
+    namespace
+    {
+        static const u64 SharedArrayAlignment = 64;
+
+        u64 align_up(u64 value, u64 alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // Keeps the random generator running across episodes, otherwise every episode
+        // of a given environment would play out the same way.
+        void reset_env(BatchEnv& env, u32 envIndex)
+        {
+            CPUState& state = *env.states[envIndex];
+            const u64 randomState = state.randomState;
+
+            reset_cpu_state(*env.pool, state);
+
+            state.randomState = randomState;
+            env.isPendingReset[envIndex] = false;
+        }
+
+        u8* get_observation(BatchEnv& env, u32 envIndex)
+        {
+            return &env.buffers.observations[envIndex * ObservationSizeInBytes];
+        }
+
+        // The observation is written separately.
+        void write_outputs(BatchEnv& env, u32 envIndex, bool hasStepped)
+        {
+            const CPUState& state = *env.states[envIndex];
+            const BatchEnvBuffers& buffers = env.buffers;
+            const BatchEnvHooks& hooks = env.hooks;
+
+            const bool isDone = hasStepped && hooks.isDone && hooks.isDone(state, envIndex, hooks.userData);
+
+            buffers.rewards[envIndex] = (hasStepped && hooks.computeReward) ? hooks.computeReward(state, envIndex, hooks.userData) : 0.f;
+            buffers.dones[envIndex] = isDone ? 1 : 0;
+
+            env.isPendingReset[envIndex] = isDone;
+        }
+
+        void signal_step_completion(BatchEnv& env)
+        {
+            if (!env.sharedHeader)
+                return;
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+            // Pairs with the acquire load in load_batch_env_step_count(), the outputs are visible
+            // before the new step count. We are the only writer, so the plain read is fine.
+            __atomic_store_n(&env.sharedHeader->stepCount, env.sharedHeader->stepCount + 1, __ATOMIC_RELEASE);
+#endif
+        }
+
+        void free_shared_buffers(BatchEnv& env)
+        {
+            if (!env.sharedHeader)
+                return;
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+            munmap(env.sharedHeader, env.sharedSizeInBytes);
+
+            if (env.sharedName != nullptr)
+                shm_unlink(env.sharedName);
+#endif
+
+            delete[] env.sharedName;
+
+            env.sharedHeader = nullptr;
+            env.sharedSizeInBytes = 0;
+            env.sharedName = nullptr;
+            env.buffers = {};
+        }
+    }
+
+    BatchEnv* createBatchEnv(u32 envCount, const EmuConfig& config, const u8* program, u16 programSize)
+    {
+        Assert(envCount > 0);
+        Assert(program != nullptr);
+
+        BatchEnv* env = new BatchEnv;
+
+        env->config = config;
+        env->hooks = {};
+        env->frameSkip = 1;
+        env->pooling = ScreenPooling::LastFrame;
+        env->envCount = envCount;
+        env->pool = createCPUStatePool(envCount, false);
+        env->states = new CPUState*[envCount];
+        env->isPendingReset = new bool[envCount];
+        env->buffers = {};
+        env->sharedHeader = nullptr;
+        env->sharedSizeInBytes = 0;
+        env->sharedName = nullptr;
+
+        // Every environment shares the program pages.
+        load_pool_program(*env->pool, program, programSize);
+
+        for (u32 envIndex = 0; envIndex < envCount; envIndex++)
+        {
+            env->states[envIndex] = acquire_cpu_state(*env->pool);
+            Assert(env->states[envIndex] != nullptr);
+
+            seed_random_generator(*env->states[envIndex], config.randomSeed + envIndex);
+            env->isPendingReset[envIndex] = false;
+        }
+
+        return env;
+    }
+
+    void destroyBatchEnv(BatchEnv* env)
+    {
+        Assert(env != nullptr);
+
+        free_shared_buffers(*env);
+
+        for (u32 envIndex = 0; envIndex < env->envCount; envIndex++)
+            release_cpu_state(*env->pool, env->states[envIndex]);
+
+        destroyCPUStatePool(env->pool);
+
+        delete[] env->isPendingReset;
+        delete[] env->states;
+        delete env;
+    }
+
+    void set_batch_env_hooks(BatchEnv& env, const BatchEnvHooks& hooks)
+    {
+        env.hooks = hooks;
+    }
+
+    void set_batch_env_frame_skip(BatchEnv& env, u32 frameCount, ScreenPooling pooling)
+    {
+        Assert(frameCount > 0);
+
+        env.frameSkip = frameCount;
+        env.pooling = pooling;
+    }
+
+    void bind_batch_env_buffers(BatchEnv& env, const BatchEnvBuffers& buffers)
+    {
+        Assert(buffers.actions != nullptr);
+        Assert(buffers.observations != nullptr);
+        Assert(buffers.rewards != nullptr);
+        Assert(buffers.dones != nullptr);
+
+        free_shared_buffers(env);
+
+        env.buffers = buffers;
+    }
+
+    bool create_batch_env_shared_buffers(BatchEnv& env, const char* name)
+    {
+        Assert(name != nullptr);
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+        const u64 envCount = env.envCount;
+        const u64 actionsOffset = align_up(sizeof(BatchEnvSharedHeader), SharedArrayAlignment);
+        const u64 observationsOffset = align_up(actionsOffset + envCount * sizeof(u16), SharedArrayAlignment);
+        const u64 rewardsOffset = align_up(observationsOffset + envCount * ObservationSizeInBytes, SharedArrayAlignment);
+        const u64 donesOffset = align_up(rewardsOffset + envCount * sizeof(f32), SharedArrayAlignment);
+        const u64 sizeInBytes = donesOffset + envCount * sizeof(u8);
+
+        // The previous segment stays bound until the new one is ready, but it has to give up its name
+        // first if it is the same. Its mapping stays valid after that.
+        if (env.sharedName != nullptr && std::strcmp(env.sharedName, name) == 0)
+        {
+            shm_unlink(env.sharedName);
+            delete[] env.sharedName;
+            env.sharedName = nullptr;
+        }
+
+        // Never take over a segment that someone else created, a stale one has to be unlinked by its owner.
+        const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+
+        if (fd == -1)
+            return false;
+
+        if (ftruncate(fd, static_cast<off_t>(sizeInBytes)) != 0)
+        {
+            close(fd);
+            shm_unlink(name);
+            return false;
+        }
+
+        void* mapping = mmap(nullptr, sizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (mapping == MAP_FAILED)
+        {
+            shm_unlink(name);
+            return false;
+        }
+
+        u8* base = static_cast<u8*>(mapping);
+        BatchEnvSharedHeader* header = static_cast<BatchEnvSharedHeader*>(mapping);
+
+        header->magic = BatchEnvSharedMagic;
+        header->version = BatchEnvSharedVersion;
+        header->envCount = env.envCount;
+        header->observationSizeInBytes = ObservationSizeInBytes;
+        header->actionsOffset = actionsOffset;
+        header->observationsOffset = observationsOffset;
+        header->rewardsOffset = rewardsOffset;
+        header->donesOffset = donesOffset;
+        __atomic_store_n(&header->stepCount, 0, __ATOMIC_RELEASE);
+
+        free_shared_buffers(env);
+
+        env.buffers.actions = reinterpret_cast<const u16*>(base + actionsOffset);
+        env.buffers.observations = base + observationsOffset;
+        env.buffers.rewards = reinterpret_cast<f32*>(base + rewardsOffset);
+        env.buffers.dones = base + donesOffset;
+
+        const std::size_t nameLength = std::strlen(name);
+
+        env.sharedHeader = header;
+        env.sharedSizeInBytes = sizeInBytes;
+        env.sharedName = new char[nameLength + 1];
+        std::memcpy(env.sharedName, name, nameLength + 1);
+
+        return true;
+#else
+        static_cast<void>(env);
+        return false;
+#endif
+    }
+
+    u64 load_batch_env_step_count(const BatchEnvSharedHeader& header)
+    {
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+        return __atomic_load_n(&header.stepCount, __ATOMIC_ACQUIRE);
+#else
+        return header.stepCount; // No shared memory, nobody else can be writing it
+#endif
+    }
+
+    void reset_batch_env(BatchEnv& env)
+    {
+        Assert(env.buffers.observations != nullptr); // No buffers bound
+
+        for (u32 envIndex = 0; envIndex < env.envCount; envIndex++)
+        {
+            reset_env(env, envIndex);
+
+            std::memcpy(get_observation(env, envIndex), env.states[envIndex]->screen, ObservationSizeInBytes);
+            write_outputs(env, envIndex, false);
+        }
+
+        signal_step_completion(env);
+    }
+
+    void step_batch_env(BatchEnv& env)
+    {
+        CHIP8EMU_TRACE_SCOPE("step_batch_env");
+
+        Assert(env.buffers.observations != nullptr); // No buffers bound
+
+        for (u32 envIndex = 0; envIndex < env.envCount; envIndex++)
+        {
+            CPUState& state = *env.states[envIndex];
+
+            if (env.isPendingReset[envIndex])
+                reset_env(env, envIndex);
+
+            execute_frames(env.config, state, env.buffers.actions[envIndex], env.frameSkip, BatchEnvFrameTimeMs,
+                           env.pooling, get_observation(env, envIndex));
+
+            write_outputs(env, envIndex, true);
+        }
+
+        signal_step_completion(env);
+    }
+}
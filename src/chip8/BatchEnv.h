@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Config.h"
+#include "Cpu.h"
+#include "Execution.h"
+
+namespace chip8
+{
+    struct CPUStatePool;
+
+    // Observations are the packed screen, one bit per pixel, exactly like CPUState::screen.
+    static const u32 ObservationSizeInBytes = ScreenHeight * ScreenLineSizeInBytes;
+
+    // Every step advances all environments by frameSkip frames of this duration.
+    static const unsigned int BatchEnvFrameTimeMs = DelayTimerPeriodMs;
+
+    // Called after each step, once per environment.
+    using BatchEnvRewardFunction = f32 (*)(const CPUState& state, u32 envIndex, void* userData);
+    using BatchEnvDoneFunction = bool (*)(const CPUState& state, u32 envIndex, void* userData);
+
+    struct BatchEnvHooks
+    {
+        BatchEnvRewardFunction computeReward; // Rewards stay at zero if null
+        BatchEnvDoneFunction isDone; // Environments never end if null
+        void* userData;
+    };
+
+    // Contiguous arrays of envCount elements each, owned by the caller.
+    struct BatchEnvBuffers
+    {
+        const u16* actions; // Key masks, one bit per key
+        u8* observations; // envCount * ObservationSizeInBytes
+        f32* rewards;
+        u8* dones;
+    };
+
+    // Layout of the shared-memory segment, all offsets are from the start of the segment.
+    // Every array is aligned on 64 bytes so that consumers can map them directly.
+    static const u32 BatchEnvSharedMagic = 0x45423843; // "C8BE"
+    static const u32 BatchEnvSharedVersion = 1;
+
+    struct BatchEnvSharedHeader
+    {
+        u32 magic;
+        u32 version;
+        u32 envCount;
+        u32 observationSizeInBytes;
+        u64 actionsOffset;
+        u64 observationsOffset;
+        u64 rewardsOffset;
+        u64 donesOffset;
+        u64 stepCount; // Bumped with a release store after every step, once all the outputs are written
+    };
+
+    // Fixed set of machines running the same program, stepped in lockstep.
+    // Done environments are reset at the start of the next step, so the caller
+    // always gets to see their final observation.
+    struct BatchEnv
+    {
+        EmuConfig config;
+        BatchEnvHooks hooks;
+
+        u32 frameSkip;
+        ScreenPooling pooling;
+
+        u32 envCount;
+        CPUStatePool* pool;
+        CPUState** states;
+        bool* isPendingReset;
+
+        BatchEnvBuffers buffers;
+
+        // Only set when the buffers live in a shared-memory segment owned by the environment.
+        BatchEnvSharedHeader* sharedHeader;
+        u64 sharedSizeInBytes;
+        char* sharedName;
+    };
+
+    CHIP8EMU_EMU_API BatchEnv* createBatchEnv(u32 envCount, const EmuConfig& config, const u8* program, u16 programSize);
+    CHIP8EMU_EMU_API void destroyBatchEnv(BatchEnv* env);
+
+    CHIP8EMU_EMU_API void set_batch_env_hooks(BatchEnv& env, const BatchEnvHooks& hooks);
+
+    // Repeats each action for frameCount frames, rewards and done flags only look at the last one.
+    // Defaults to a single frame.
+    CHIP8EMU_EMU_API void set_batch_env_frame_skip(BatchEnv& env, u32 frameCount, ScreenPooling pooling);
+
+    // Buffers have to outlive the environment, or be rebound.
+    CHIP8EMU_EMU_API void bind_batch_env_buffers(BatchEnv& env, const BatchEnvBuffers& buffers);
+
+    // Creates a POSIX shared-memory segment with the layout above and binds the buffers to it.
+    // Other processes can shm_open() the same name and read the results without any copy.
+    // The segment is unlinked when the environment is destroyed.
+    // Returns false if shared memory is not available or if the name is already taken, the buffers
+    // bound before are kept in that case.
+    CHIP8EMU_EMU_API bool create_batch_env_shared_buffers(BatchEnv& env, const char* name);
+
+    // Acquire load of the step count, for consumers polling the shared header.
+    // The outputs of that step are visible once it returns.
+    CHIP8EMU_EMU_API u64 load_batch_env_step_count(const BatchEnvSharedHeader& header);
+
+    // Resets every environment and writes the initial observations.
+    CHIP8EMU_EMU_API void reset_batch_env(BatchEnv& env);
+
+    // Applies the actions, runs the frames on every environment and writes the outputs.
+    CHIP8EMU_EMU_API void step_batch_env(BatchEnv& env);
+}
@@ -7,8 +7,18 @@
 
 #pragma once
 
+#include "Quirks.h"
+
+#include "core/Types.h"
+
 namespace chip8
 {
+    struct CodeCoverage;
+    struct InstructionTraceWriter;
+    struct Profiler;
+    struct ProgramVerification;
+    struct RecompiledRom;
+
     struct Color
     {
         float r;
@@ -22,10 +32,27 @@ namespace chip8
         Color secondary;
     };
 
+    // Checked execution validates registers, addresses and the stack, an invalid instruction trips an Assert
+    // and does nothing. Unchecked execution compiles the checks away and masks addresses to 12 bits instead,
+    // roms can't escape the state but misbehave silently. Both run the same otherwise.
+    enum class ExecutionPolicy : u8
+    {
+        Checked,
+        Unchecked
+    };
+
     struct EmuConfig
     {
         bool debugMode;
         Palette palette;
         unsigned int screenScale;
+        u64 randomSeed; // Frontends pass it to seed_random_generator()
+        QuirkProfile quirkProfile; // Picked with the rom, see Quirks.h
+        ExecutionPolicy executionPolicy;
+        Profiler* profiler; // Optional, see Profiler.h
+        InstructionTraceWriter* instructionTrace; // Optional, see InstructionTrace.h
+        CodeCoverage* coverage; // Optional, see Coverage.h
+        const ProgramVerification* verification; // Optional, lets checked execution skip proven checks, see Verifier.h
+        const RecompiledRom* recompiledRom; // Optional, runs the rom through code generated ahead of time, see Recompiler.h
     };
 }
@@ -0,0 +1,617 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ControlFlow.h"
+
+#include "Memory.h"
+#include "Opcode.h"
+
+#include "core/Assert.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace chip8
+{
+    namespace
+    {
+        static const u8 SlotReached = 1 << 0;
+        static const u8 SlotLeader = 1 << 1;
+        static const u8 SlotEntry = 1 << 2;
+
+        // Bnnn adds a byte to nnn.
+        static const u32 MaxJumpTableSizeInBytes = 0x100;
+
+        struct InstructionFlow
+        {
+            u8 blockFlags;
+            bool hasCallee;
+            u16 callee;
+            std::vector<ControlFlowEdge> edges;
+        };
+
+        struct GraphBuilder
+        {
+            const u8* program;
+            u16 romEndAddress;
+            u32 quirkFlags;
+
+            std::vector<u8> slots; // One per word of the rom
+            std::vector<InstructionFlow> flows;
+            std::vector<u16> pendingAddresses;
+        };
+
+        bool is_in_rom(u16 romEndAddress, u32 address)
+        {
+            return (address & 0x0001) == 0 && address >= MinProgramAddress && address + 2 <= romEndAddress;
+        }
+
+        u32 get_slot_index(u16 address)
+        {
+            return static_cast<u32>(address - MinProgramAddress) / 2;
+        }
+
+        u16 read_instruction(const u8* program, u16 address)
+        {
+            return load_u16_big_endian(program + (address - MinProgramAddress));
+        }
+
+        bool is_valid_jump_target(u32 address)
+        {
+            return (address & 0x0001) == 0 && address >= MinProgramAddress && address + 2 <= MaxProgramAddress;
+        }
+
+        bool ends_basic_block(u16 instruction, const InstructionFlow& flow)
+        {
+            return get_opcode_flow(instruction) != OpcodeFlow::Next || flow.blockFlags != 0;
+        }
+
+        void add_jump_edge(InstructionFlow& flow, u16 address, u32 target, ControlFlowEdgeKind kind)
+        {
+            if (!is_valid_jump_target(target))
+            {
+                flow.blockFlags |= BasicBlockInvalid;
+                return;
+            }
+
+            // The pc doesn't change, so the interpreter steps over the jump.
+            const u16 successor = static_cast<u16>(target == address ? address + 2 : target);
+
+            flow.edges.push_back({successor, kind});
+        }
+
+        void find_computed_jump_targets(const GraphBuilder& builder, u16 address, u16 instruction,
+                                        std::vector<u32>& targets)
+        {
+            const u16 baseAddress = instruction & 0x0FFF;
+            const u8 registerName = (builder.quirkFlags & QuirkJumpVx) ? static_cast<u8>(baseAddress >> 8) : 0;
+
+            // LD V0, byte right before the jump
+            if (is_in_rom(builder.romEndAddress, address - 2u))
+            {
+                const u16 previousInstruction = read_instruction(builder.program, static_cast<u16>(address - 2));
+
+                if (get_opcode_class(previousInstruction) == OpcodeClass::LdImm
+                    && ((previousInstruction >> 8) & 0x000F) == registerName)
+                {
+                    targets.push_back(baseAddress + (previousInstruction & 0x00FF));
+                    return;
+                }
+            }
+
+            // Jump table at nnn
+            for (u32 offset = 0; offset < MaxJumpTableSizeInBytes; offset += 2)
+            {
+                const u32 entryAddress = baseAddress + offset;
+
+                if (!is_in_rom(builder.romEndAddress, entryAddress)
+                    || get_opcode_class(read_instruction(builder.program, static_cast<u16>(entryAddress)))
+                           != OpcodeClass::Jp)
+                    break;
+
+                targets.push_back(entryAddress);
+            }
+        }
+
+        void decode_instruction_flow(const GraphBuilder& builder, u16 address, InstructionFlow& flow)
+        {
+            const u16 instruction = read_instruction(builder.program, address);
+            const u16 nextAddress = static_cast<u16>(address + 2);
+
+            flow.blockFlags = 0;
+            flow.hasCallee = false;
+            flow.callee = 0;
+            flow.edges.clear();
+
+            switch (get_opcode_flow(instruction))
+            {
+                case OpcodeFlow::Next:
+                    flow.edges.push_back({nextAddress, ControlFlowEdgeKind::Next});
+                    break;
+                case OpcodeFlow::Skip:
+                    flow.edges.push_back({nextAddress, ControlFlowEdgeKind::Next});
+                    flow.edges.push_back({static_cast<u16>(address + 4), ControlFlowEdgeKind::Skip});
+                    break;
+                case OpcodeFlow::Jump:
+                    add_jump_edge(flow, address, instruction & 0x0FFFu, ControlFlowEdgeKind::Jump);
+                    break;
+                case OpcodeFlow::ComputedJump:
+                {
+                    std::vector<u32> targets;
+                    find_computed_jump_targets(builder, address, instruction, targets);
+
+                    if (targets.empty())
+                        flow.blockFlags |= BasicBlockUnresolvedJump;
+
+                    for (u32 target : targets)
+                        add_jump_edge(flow, address, target, ControlFlowEdgeKind::ComputedJump);
+                    break;
+                }
+                case OpcodeFlow::Call:
+                {
+                    const u16 callee = instruction & 0x0FFF;
+
+                    if (!is_valid_jump_target(callee))
+                    {
+                        flow.blockFlags |= BasicBlockInvalid;
+                        break;
+                    }
+
+                    // A call to its own address is stepped over, like a jump.
+                    if (callee != address)
+                    {
+                        flow.hasCallee = true;
+                        flow.callee = callee;
+
+                        if (!is_in_rom(builder.romEndAddress, callee))
+                            flow.blockFlags |= BasicBlockLeavesRom;
+                    }
+
+                    flow.edges.push_back({nextAddress, ControlFlowEdgeKind::CallReturn});
+                    break;
+                }
+                case OpcodeFlow::Return:
+                    break;
+                case OpcodeFlow::Invalid:
+                    flow.blockFlags |= BasicBlockInvalid;
+                    break;
+            }
+
+            for (const ControlFlowEdge& edge : flow.edges)
+            {
+                if (!is_in_rom(builder.romEndAddress, edge.address))
+                    flow.blockFlags |= BasicBlockLeavesRom;
+            }
+        }
+
+        void queue_instruction(GraphBuilder& builder, u16 address, u8 slotFlags)
+        {
+            u8& slot = builder.slots[get_slot_index(address)];
+
+            if (!(slot & SlotReached))
+                builder.pendingAddresses.push_back(address);
+
+            slot |= SlotReached | slotFlags;
+        }
+
+        void discover_instructions(GraphBuilder& builder)
+        {
+            if (builder.slots.empty())
+                return;
+
+            queue_instruction(builder, MinProgramAddress, SlotLeader | SlotEntry);
+
+            while (!builder.pendingAddresses.empty())
+            {
+                const u16 address = builder.pendingAddresses.back();
+                builder.pendingAddresses.pop_back();
+
+                InstructionFlow& flow = builder.flows[get_slot_index(address)];
+                decode_instruction_flow(builder, address, flow);
+
+                // Anything but falling through starts a new block.
+                const u8 successorFlags = ends_basic_block(read_instruction(builder.program, address), flow) ? SlotLeader : 0;
+
+                for (const ControlFlowEdge& edge : flow.edges)
+                {
+                    if (is_in_rom(builder.romEndAddress, edge.address))
+                        queue_instruction(builder, edge.address, successorFlags);
+                }
+
+                if (flow.hasCallee && is_in_rom(builder.romEndAddress, flow.callee))
+                    queue_instruction(builder, flow.callee, SlotLeader | SlotEntry);
+            }
+        }
+
+        void split_basic_blocks(const GraphBuilder& builder, ControlFlowGraph& graph)
+        {
+            bool isBlockOpen = false;
+
+            for (u32 slotIndex = 0; slotIndex < builder.slots.size(); slotIndex++)
+            {
+                const u8 slot = builder.slots[slotIndex];
+
+                if (!(slot & SlotReached))
+                {
+                    isBlockOpen = false;
+                    continue;
+                }
+
+                const u16 address = static_cast<u16>(MinProgramAddress + slotIndex * 2);
+                const InstructionFlow& flow = builder.flows[slotIndex];
+
+                if (!isBlockOpen || (slot & SlotLeader))
+                    graph.blocks.push_back({address, 0, 0, {}});
+
+                // The last instruction decides where the block goes.
+                BasicBlock& block = graph.blocks.back();
+                block.instructionCount++;
+                block.flags = flow.blockFlags;
+                block.successors = flow.edges;
+
+                isBlockOpen = !ends_basic_block(read_instruction(builder.program, address), flow);
+            }
+        }
+
+        void collect_subroutine(const GraphBuilder& builder, const ControlFlowGraph& graph, Subroutine& subroutine)
+        {
+            std::vector<bool> isVisited(graph.blocks.size(), false);
+            std::vector<u32> pendingBlockIndices;
+
+            const u32 entryBlockIndex = find_basic_block(graph, subroutine.address);
+            Assert(entryBlockIndex != InvalidBasicBlockIndex);
+
+            pendingBlockIndices.push_back(entryBlockIndex);
+            isVisited[entryBlockIndex] = true;
+
+            while (!pendingBlockIndices.empty())
+            {
+                const u32 blockIndex = pendingBlockIndices.back();
+                pendingBlockIndices.pop_back();
+
+                const BasicBlock& block = graph.blocks[blockIndex];
+                const u16 lastAddress = static_cast<u16>(block.address + (block.instructionCount - 1) * 2);
+                const InstructionFlow& lastFlow = builder.flows[get_slot_index(lastAddress)];
+
+                subroutine.blockIndices.push_back(blockIndex);
+
+                if (lastFlow.hasCallee && is_in_rom(graph.romEndAddress, lastFlow.callee))
+                    subroutine.callees.push_back(lastFlow.callee);
+
+                for (const ControlFlowEdge& edge : block.successors)
+                {
+                    const u32 successorIndex = find_basic_block(graph, edge.address);
+
+                    if (successorIndex != InvalidBasicBlockIndex && !isVisited[successorIndex])
+                    {
+                        isVisited[successorIndex] = true;
+                        pendingBlockIndices.push_back(successorIndex);
+                    }
+                }
+            }
+
+            std::sort(subroutine.blockIndices.begin(), subroutine.blockIndices.end());
+            std::sort(subroutine.callees.begin(), subroutine.callees.end());
+            subroutine.callees.erase(std::unique(subroutine.callees.begin(), subroutine.callees.end()),
+                                     subroutine.callees.end());
+        }
+
+        bool is_subroutine_entry(const ControlFlowGraph& graph, u16 address)
+        {
+            const auto it = std::lower_bound(
+                graph.subroutines.begin(), graph.subroutines.end(), address,
+                [](const Subroutine& subroutine, u16 value) { return subroutine.address < value; });
+
+            return it != graph.subroutines.end() && it->address == address;
+        }
+
+        void write_address(std::ostream& output, u16 address)
+        {
+            output << std::hex << std::uppercase << std::setfill('0') << std::setw(3) << address << std::dec
+                   << std::nouppercase << std::setfill(' ');
+        }
+
+        // sub_2A0 for subroutines, loc_2A4 for other blocks and 0xFA0 outside of the rom.
+        void write_label(std::ostream& output, const ControlFlowGraph& graph, u16 address)
+        {
+            if (!is_in_rom(graph.romEndAddress, address))
+                output << "0x";
+            else
+                output << (is_subroutine_entry(graph, address) ? "sub_" : "loc_");
+
+            write_address(output, address);
+        }
+
+        // Address and raw word, e.g. "0x200  A220  ".
+        void write_word(std::ostream& output, u16 address, u16 instruction)
+        {
+            output << "0x";
+            write_address(output, address);
+            output << "  " << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << instruction
+                   << std::dec << std::nouppercase << std::setfill(' ') << "  ";
+        }
+
+        void write_instruction(std::ostream& output, const u8* program, u16 address, const char* lineEnd)
+        {
+            const u16 instruction = read_instruction(program, address);
+
+            write_word(output, address, instruction);
+            output << disassemble_instruction(instruction) << lineEnd;
+        }
+
+        u32 count_unresolved_jumps(const ControlFlowGraph& graph)
+        {
+            u32 count = 0;
+
+            for (const BasicBlock& block : graph.blocks)
+                count += (block.flags & BasicBlockUnresolvedJump) ? 1 : 0;
+
+            return count;
+        }
+
+        // Only when the block doesn't simply fall through into the next one.
+        void write_block_successors(std::ostream& output, const ControlFlowGraph& graph, const BasicBlock& block)
+        {
+            const u16 endAddress = static_cast<u16>(block.address + block.instructionCount * 2);
+
+            if (block.flags == 0 && block.successors.size() == 1 && block.successors[0].address == endAddress
+                && block.successors[0].kind == ControlFlowEdgeKind::Next)
+                return;
+
+            output << "    ;";
+
+            if (!block.successors.empty())
+            {
+                output << " ->";
+
+                for (const ControlFlowEdge& edge : block.successors)
+                {
+                    output << ' ';
+                    write_label(output, graph, edge.address);
+                }
+            }
+            else if (block.flags == 0)
+                output << " returns";
+
+            if (block.flags & BasicBlockUnresolvedJump)
+                output << " unresolved";
+            if (block.flags & BasicBlockInvalid)
+                output << " asserts";
+
+            output << "\n";
+        }
+
+        void write_dot_node_id(std::ostream& output, u16 address)
+        {
+            output << "b_";
+            write_address(output, address);
+        }
+
+        void write_dot_block(std::ostream& output, const ControlFlowGraph& graph, const BasicBlock& block,
+                             const u8* program)
+        {
+            output << "        ";
+            write_dot_node_id(output, block.address);
+            output << " [label=\"";
+            write_label(output, graph, block.address);
+            output << ":\\l";
+
+            for (u16 index = 0; index < block.instructionCount; index++)
+                write_instruction(output, program, static_cast<u16>(block.address + index * 2), "\\l");
+
+            output << "\"";
+
+            if (block.flags & (BasicBlockUnresolvedJump | BasicBlockInvalid))
+                output << ", color=red";
+
+            output << "];\n";
+        }
+
+        const char* get_dot_edge_style(ControlFlowEdgeKind kind)
+        {
+            switch (kind)
+            {
+                case ControlFlowEdgeKind::Next:
+                    return "";
+                case ControlFlowEdgeKind::Skip:
+                    return " [style=dashed]";
+                case ControlFlowEdgeKind::Jump:
+                    return " [style=bold]";
+                case ControlFlowEdgeKind::ComputedJump:
+                    return " [style=bold, color=blue]";
+                case ControlFlowEdgeKind::CallReturn:
+                    return " [color=gray]";
+            }
+
+            AssertUnreachable();
+            return "";
+        }
+    }
+
+    void build_control_flow_graph(ControlFlowGraph& graph, const u8* program, u16 programSize,
+                                  QuirkProfile quirkProfile)
+    {
+        Assert(programSize <= MemorySizeInBytes - MinProgramAddress);
+
+        GraphBuilder builder;
+        builder.program = program;
+        builder.romEndAddress = static_cast<u16>(MinProgramAddress + (programSize & ~0x0001));
+        builder.quirkFlags = get_quirk_flags(quirkProfile);
+        builder.slots.assign(programSize / 2, 0);
+        builder.flows.resize(programSize / 2);
+
+        graph.romEndAddress = builder.romEndAddress;
+        graph.blocks.clear();
+        graph.subroutines.clear();
+
+        discover_instructions(builder);
+        split_basic_blocks(builder, graph);
+
+        for (u32 slotIndex = 0; slotIndex < builder.slots.size(); slotIndex++)
+        {
+            if (!(builder.slots[slotIndex] & SlotEntry))
+                continue;
+
+            Subroutine subroutine;
+            subroutine.address = static_cast<u16>(MinProgramAddress + slotIndex * 2);
+
+            collect_subroutine(builder, graph, subroutine);
+
+            graph.subroutines.push_back(subroutine);
+        }
+    }
+
+    u32 find_basic_block(const ControlFlowGraph& graph, u16 address)
+    {
+        const auto it = std::upper_bound(graph.blocks.begin(), graph.blocks.end(), address,
+                                         [](u16 value, const BasicBlock& block) { return value < block.address; });
+
+        if (it == graph.blocks.begin())
+            return InvalidBasicBlockIndex;
+
+        const BasicBlock& block = *(it - 1);
+
+        if ((address & 0x0001) != 0 || address >= block.address + block.instructionCount * 2u)
+            return InvalidBasicBlockIndex;
+
+        return static_cast<u32>(it - 1 - graph.blocks.begin());
+    }
+
+    void write_control_flow_listing(std::ostream& output, const ControlFlowGraph& graph, const u8* program,
+                                    u16 programSize)
+    {
+        Assert(graph.romEndAddress == MinProgramAddress + (programSize & ~0x0001));
+
+        output << "; " << graph.subroutines.size() << " subroutines, " << graph.blocks.size() << " basic blocks, "
+               << count_unresolved_jumps(graph) << " unresolved jumps\n";
+
+        for (const Subroutine& subroutine : graph.subroutines)
+        {
+            if (subroutine.callees.empty())
+                continue;
+
+            output << "; ";
+            write_label(output, graph, subroutine.address);
+            output << " calls";
+
+            for (u16 callee : subroutine.callees)
+            {
+                output << ' ';
+                write_label(output, graph, callee);
+            }
+
+            output << "\n";
+        }
+
+        u32 blockIndex = 0;
+
+        for (u16 address = MinProgramAddress; address < graph.romEndAddress; address += 2)
+        {
+            while (blockIndex < graph.blocks.size()
+                   && graph.blocks[blockIndex].address + graph.blocks[blockIndex].instructionCount * 2u <= address)
+                blockIndex++;
+
+            const bool isInBlock = blockIndex < graph.blocks.size() && graph.blocks[blockIndex].address <= address;
+
+            if (!isInBlock)
+            {
+                // Data, or code only reachable through something the graph couldn't follow.
+                const u16 word = read_instruction(program, address);
+
+                output << "    ";
+                write_word(output, address, word);
+                output << "DW 0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << word
+                       << std::dec << std::nouppercase << std::setfill(' ') << "\n";
+                continue;
+            }
+
+            const BasicBlock& block = graph.blocks[blockIndex];
+
+            if (block.address == address)
+            {
+                output << "\n";
+                write_label(output, graph, address);
+                output << ":\n";
+            }
+
+            output << "    ";
+            write_instruction(output, program, address, "\n");
+
+            if (address + 2u == block.address + block.instructionCount * 2u)
+                write_block_successors(output, graph, block);
+        }
+    }
+
+    void write_control_flow_dot(std::ostream& output, const ControlFlowGraph& graph, const u8* program,
+                                u16 programSize)
+    {
+        Assert(graph.romEndAddress == MinProgramAddress + (programSize & ~0x0001));
+
+        output << "digraph rom {\n";
+        output << "    node [shape=box, fontname=\"monospace\"];\n";
+
+        // Blocks shared between subroutines go in the first cluster.
+        std::vector<bool> isBlockWritten(graph.blocks.size(), false);
+
+        for (const Subroutine& subroutine : graph.subroutines)
+        {
+            output << "    subgraph cluster_";
+            write_label(output, graph, subroutine.address);
+            output << " {\n        label=\"";
+            write_label(output, graph, subroutine.address);
+            output << "\";\n";
+
+            for (u32 blockIndex : subroutine.blockIndices)
+            {
+                if (isBlockWritten[blockIndex])
+                    continue;
+
+                write_dot_block(output, graph, graph.blocks[blockIndex], program);
+                isBlockWritten[blockIndex] = true;
+            }
+
+            output << "    }\n";
+        }
+
+        for (const BasicBlock& block : graph.blocks)
+        {
+            for (const ControlFlowEdge& edge : block.successors)
+            {
+                output << "    ";
+                write_dot_node_id(output, block.address);
+                output << " -> ";
+
+                if (is_in_rom(graph.romEndAddress, edge.address))
+                    write_dot_node_id(output, edge.address);
+                else
+                {
+                    output << "\"0x";
+                    write_address(output, edge.address);
+                    output << "\"";
+                }
+
+                output << get_dot_edge_style(edge.kind) << ";\n";
+            }
+
+            const u16 lastAddress = static_cast<u16>(block.address + (block.instructionCount - 1) * 2);
+            const u16 lastInstruction = read_instruction(program, lastAddress);
+            const u16 callee = lastInstruction & 0x0FFF;
+
+            if (get_opcode_class(lastInstruction) == OpcodeClass::Call && callee != lastAddress
+                && is_in_rom(graph.romEndAddress, callee))
+            {
+                output << "    ";
+                write_dot_node_id(output, block.address);
+                output << " -> ";
+                write_dot_node_id(output, callee);
+                output << " [style=dotted];\n";
+            }
+        }
+
+        output << "}\n";
+    }
+}
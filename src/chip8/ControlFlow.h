@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+#include "Quirks.h"
+
+#include <ostream>
+#include <vector>
+
+namespace chip8
+{
+    // Static control flow graph of a rom, decoded with the opcode table of the interpreter.
+    //
+    // Code is discovered from MinProgramAddress by following the instructions the way the checked interpreter
+    // runs them, calls are assumed to return. Instructions that always assert (invalid opcodes and jumps) end
+    // their block without successors. Targets past the end of the rom are kept as edges but not followed.
+    //
+    // Computed jumps (Bnnn) go through two heuristics: right after LD V0, byte the jump has a single target,
+    // otherwise the targets are the run of JP instructions found at nnn, the usual shape of a jump table.
+    // Anything else is left unresolved.
+    enum class ControlFlowEdgeKind : u8
+    {
+        Next,         // Falls through to the next instruction
+        Skip,         // Skipped the next instruction
+        Jump,
+        ComputedJump,
+        CallReturn,   // Comes back from a subroutine
+    };
+
+    struct ControlFlowEdge
+    {
+        u16 address;
+        ControlFlowEdgeKind kind;
+    };
+
+    static const u8 BasicBlockUnresolvedJump = 1 << 0; // Ends on a computed jump that no heuristic could follow
+    static const u8 BasicBlockInvalid = 1 << 1;        // Ends on an instruction that always asserts
+    static const u8 BasicBlockLeavesRom = 1 << 2;      // Has successors past the end of the rom
+
+    struct BasicBlock
+    {
+        u16 address;
+        u16 instructionCount;
+        u8 flags;
+        std::vector<ControlFlowEdge> successors; // Calls not included, see Subroutine::callees
+    };
+
+    struct Subroutine
+    {
+        u16 address;
+        std::vector<u32> blockIndices; // Reachable from the entry without following calls
+        std::vector<u16> callees;
+    };
+
+    struct ControlFlowGraph
+    {
+        u16 romEndAddress;
+        std::vector<BasicBlock> blocks;      // Sorted by address
+        std::vector<Subroutine> subroutines; // Sorted by address, the main program comes first
+    };
+
+    static const u32 InvalidBasicBlockIndex = 0xFFFFFFFF;
+
+    // The rom is expected at MinProgramAddress, the way load_program() puts it.
+    CHIP8EMU_EMU_API void build_control_flow_graph(ControlFlowGraph& graph, const u8* program, u16 programSize,
+                                                   QuirkProfile quirkProfile);
+
+    // Index of the block holding the instruction at this address, or InvalidBasicBlockIndex.
+    CHIP8EMU_EMU_API u32 find_basic_block(const ControlFlowGraph& graph, u16 address);
+
+    // Disassembly of the whole rom with block labels and successors. Words no block covers are printed as data.
+    CHIP8EMU_EMU_API void write_control_flow_listing(std::ostream& output, const ControlFlowGraph& graph,
+                                                     const u8* program, u16 programSize);
+
+    // Graphviz digraph, one cluster per subroutine. Calls are drawn as dotted edges.
+    CHIP8EMU_EMU_API void write_control_flow_dot(std::ostream& output, const ControlFlowGraph& graph,
+                                                 const u8* program, u16 programSize);
+}
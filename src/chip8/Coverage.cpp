@@ -0,0 +1,202 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Coverage.h"
+
+#include "Memory.h"
+#include "Opcode.h"
+#include "Serialization.h"
+
+#include "core/Assert.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+namespace chip8
+{
+    namespace
+    {
+        static const u16 CodeCoverageHeaderSizeInBytes = 8;
+
+        bool is_skip_instruction(u16 instruction)
+        {
+            return get_opcode_flow(instruction) == OpcodeFlow::Skip;
+        }
+
+        u8 get_slot(const CodeCoverage& coverage, u16 address)
+        {
+            return coverage.slots[(address >> 1) % CodeCoverageSlotCount];
+        }
+
+        void write_percentage(std::ostream& output, u32 count, u32 total)
+        {
+            // In tenths of a percent, without touching the stream's float formatting
+            const u64 permille = total > 0 ? (static_cast<u64>(count) * 1000 + total / 2) / total : 0;
+
+            output << count << '/' << total << " (" << permille / 10 << '.' << permille % 10 << "%)";
+        }
+    }
+
+    const char* get_code_coverage_error_string(CodeCoverageError error)
+    {
+        switch (error)
+        {
+            case CodeCoverageError::None:
+                return "no error";
+            case CodeCoverageError::IOError:
+                return "could not access file";
+            case CodeCoverageError::InvalidMagic:
+                return "not a coverage file";
+            case CodeCoverageError::UnsupportedVersion:
+                return "unsupported version";
+            case CodeCoverageError::Truncated:
+                return "truncated coverage";
+        }
+
+        AssertUnreachable();
+        return "unknown error";
+    }
+
+    void clear_code_coverage(CodeCoverage& coverage)
+    {
+        std::memset(coverage.slots, 0, sizeof(coverage.slots));
+    }
+
+    void merge_code_coverage(CodeCoverage& destination, const CodeCoverage& source)
+    {
+        // Eight slots at a time.
+        static const u32 CoverageSizeInWords = CodeCoverageSlotCount / sizeof(u64);
+        static_assert(CodeCoverageSlotCount % sizeof(u64) == 0, "coverage must be made of whole words");
+
+        for (u32 wordIndex = 0; wordIndex < CoverageSizeInWords; wordIndex++)
+        {
+            u64 destinationWord;
+            u64 sourceWord;
+            std::memcpy(&destinationWord, destination.slots + wordIndex * sizeof(u64), sizeof(u64));
+            std::memcpy(&sourceWord, source.slots + wordIndex * sizeof(u64), sizeof(u64));
+
+            destinationWord |= sourceWord;
+            std::memcpy(destination.slots + wordIndex * sizeof(u64), &destinationWord, sizeof(u64));
+        }
+    }
+
+    CodeCoverageError save_code_coverage_to_file(const CodeCoverage& coverage, const char* path)
+    {
+        Assert(path != nullptr);
+
+        u8 header[CodeCoverageHeaderSizeInBytes];
+
+        write_u32_little_endian(header + 0, CodeCoverageMagic);
+        write_u16_little_endian(header + 4, CodeCoverageVersion);
+        write_u16_little_endian(header + 6, static_cast<u16>(CodeCoverageSlotCount));
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(coverage.slots), sizeof(coverage.slots));
+
+        return file.good() ? CodeCoverageError::None : CodeCoverageError::IOError;
+    }
+
+    CodeCoverageError load_code_coverage_from_file(CodeCoverage& coverage, const char* path)
+    {
+        Assert(path != nullptr);
+
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file.good())
+            return CodeCoverageError::IOError;
+
+        u8 header[CodeCoverageHeaderSizeInBytes];
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+        if (!file.good())
+            return CodeCoverageError::Truncated;
+
+        if (read_u32_little_endian(header + 0) != CodeCoverageMagic)
+            return CodeCoverageError::InvalidMagic;
+
+        if (read_u16_little_endian(header + 4) != CodeCoverageVersion
+            || read_u16_little_endian(header + 6) != CodeCoverageSlotCount)
+            return CodeCoverageError::UnsupportedVersion;
+
+        CodeCoverage loadedCoverage;
+        file.read(reinterpret_cast<char*>(loadedCoverage.slots), sizeof(loadedCoverage.slots));
+
+        if (!file.good())
+            return CodeCoverageError::Truncated;
+
+        coverage = loadedCoverage;
+
+        return CodeCoverageError::None;
+    }
+
+    CodeCoverageSummary get_code_coverage_summary(const CodeCoverage& coverage, const u8* program, u16 programSize)
+    {
+        Assert(programSize <= MemorySizeInBytes - MinProgramAddress);
+
+        CodeCoverageSummary summary = {};
+
+        for (u16 offset = 0; offset + 1u < programSize; offset += 2)
+        {
+            const u16 address = static_cast<u16>(MinProgramAddress + offset);
+            const u16 instruction = load_u16_big_endian(program + offset);
+            const u8 slot = get_slot(coverage, address);
+
+            summary.instructionCount++;
+
+            if (slot != 0)
+                summary.executedInstructionCount++;
+
+            if (is_skip_instruction(instruction))
+            {
+                summary.skipOutcomeCount += 2;
+                summary.coveredSkipOutcomeCount += (slot & CodeCoverageNext) != 0 ? 1 : 0;
+                summary.coveredSkipOutcomeCount += (slot & CodeCoverageSkip) != 0 ? 1 : 0;
+            }
+        }
+
+        return summary;
+    }
+
+    void write_code_coverage_report(std::ostream& output, const CodeCoverage& coverage, const u8* program,
+                                    u16 programSize)
+    {
+        const CodeCoverageSummary summary = get_code_coverage_summary(coverage, program, programSize);
+
+        output << "; instructions executed: ";
+        write_percentage(output, summary.executedInstructionCount, summary.instructionCount);
+        output << "\n; skip outcomes covered: ";
+        write_percentage(output, summary.coveredSkipOutcomeCount, summary.skipOutcomeCount);
+        output << "\n";
+
+        for (u16 offset = 0; offset + 1u < programSize; offset += 2)
+        {
+            const u16 address = static_cast<u16>(MinProgramAddress + offset);
+            const u16 instruction = load_u16_big_endian(program + offset);
+            const u8 slot = get_slot(coverage, address);
+            const std::string disassembly = disassemble_instruction(instruction);
+
+            output << (slot != 0 ? '+' : '-') << " 0x" << std::hex << std::uppercase << std::setfill('0')
+                   << std::setw(3) << address << "  " << std::setw(4) << instruction << std::dec << std::nouppercase
+                   << std::setfill(' ') << "  ";
+
+            if (slot != 0 && is_skip_instruction(instruction))
+            {
+                const bool hasSkipped = (slot & CodeCoverageSkip) != 0;
+                const bool hasFallenThrough = (slot & CodeCoverageNext) != 0;
+
+                output << std::left << std::setw(20) << disassembly << std::right << "; "
+                       << (hasSkipped ? (hasFallenThrough ? "both ways" : "always skips") : "never skips");
+            }
+            else
+                output << disassembly;
+
+            output << "\n";
+        }
+    }
+}
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+
+#include <ostream>
+
+namespace chip8
+{
+    // Code coverage of a rom: one byte of flags per instruction address, telling where the pc went
+    // after executing it. Recording costs a single OR into the bitmap per instruction, and runs
+    // get merged by OR-ing their bitmaps together.
+    //
+    // For skip instructions, CodeCoverageNext means the skip was not taken and CodeCoverageSkip that it was.
+    // Any flag set means the instruction ran at least once.
+    //
+    // File layout: u32 magic, u16 version, u16 slot count, then the slots. Values are little-endian.
+    static const u32 CodeCoverageMagic = 0x56433843; // "C8CV"
+    static const u16 CodeCoverageVersion = 1;
+    static const u32 CodeCoverageSlotCount = MemorySizeInBytes / 2;
+
+    static const u8 CodeCoverageNext = 1 << 0; // Went on to pc + 2
+    static const u8 CodeCoverageSkip = 1 << 1; // Went on to pc + 4
+    static const u8 CodeCoverageJump = 1 << 2; // Anywhere else
+    static const u8 CodeCoverageWait = 1 << 3; // Stayed on pc, LD Vx, K waiting for a key
+
+    struct CodeCoverage
+    {
+        u8 slots[CodeCoverageSlotCount]; // Indexed by pc / 2
+    };
+
+    enum class CodeCoverageError
+    {
+        None,
+        IOError,
+        InvalidMagic,
+        UnsupportedVersion,
+        Truncated
+    };
+
+    struct CodeCoverageSummary
+    {
+        u32 instructionCount; // Every word of the rom, data included
+        u32 executedInstructionCount;
+        u32 skipOutcomeCount; // Two per skip instruction of the rom
+        u32 coveredSkipOutcomeCount;
+    };
+
+    CHIP8EMU_EMU_API const char* get_code_coverage_error_string(CodeCoverageError error);
+
+    // Called by execute_step() when EmuConfig::coverage is set, nextPC is the pc after execution.
+    inline void record_code_coverage(CodeCoverage& coverage, u16 pc, u16 nextPC)
+    {
+        const u16 pcDelta = static_cast<u16>(nextPC - pc);
+        const u8 flag = pcDelta == 2   ? CodeCoverageNext
+                        : pcDelta == 4 ? CodeCoverageSkip
+                        : pcDelta == 0 ? CodeCoverageWait
+                                       : CodeCoverageJump;
+
+        coverage.slots[(pc >> 1) % CodeCoverageSlotCount] |= flag;
+    }
+
+    CHIP8EMU_EMU_API void clear_code_coverage(CodeCoverage& coverage);
+    CHIP8EMU_EMU_API void merge_code_coverage(CodeCoverage& destination, const CodeCoverage& source);
+
+    CHIP8EMU_EMU_API CodeCoverageError save_code_coverage_to_file(const CodeCoverage& coverage, const char* path);
+    CHIP8EMU_EMU_API CodeCoverageError load_code_coverage_from_file(CodeCoverage& coverage, const char* path);
+
+    // The rom is expected at MinProgramAddress, the way load_program() puts it.
+    CHIP8EMU_EMU_API CodeCoverageSummary get_code_coverage_summary(const CodeCoverage& coverage, const u8* program,
+                                                                   u16 programSize);
+
+    // Disassembles the rom one word at a time, with the coverage of each instruction:
+    // '+' when it ran, '-' when it didn't, and which way the skips went.
+    CHIP8EMU_EMU_API void write_code_coverage_report(std::ostream& output, const CodeCoverage& coverage,
+                                                     const u8* program, u16 programSize);
+}
@@ -7,6 +7,9 @@
 
 #include "Cpu.h"
 
+#include "Memory.h"
+#include "StateHash.h"
+
 #include "core/Assert.h"
 
 #include <cstring>
@@ -45,7 +48,7 @@ namespace chip8
             // Make sure we don't spill in program addressable space.
             Assert((tableOffset + tableSize - 1) < MinProgramAddress);
 
-            std::memcpy(&state.memory[FontTableOffsetInBytes], &FontTable[0][0], tableSize);
+            write_memory_range(state, FontTableOffsetInBytes, &FontTable[0][0], tableSize);
 
             // Assing font table addresses in memory
             for (u32 tableIndex = 0; tableIndex < FontTableGlyphCount; tableIndex++)
@@ -57,20 +60,73 @@ namespace chip8
     {
         CPUState state = {};
 
-        // Leave the memory uninitialized. This is very useful when debugging with valgrind.
-        state.memory = new u8[MemorySizeInBytes];
+        // Power-on memory is zeroed, so that states loaded with the same rom are equal and hash the same.
+        for (u32 pageIndex = 0; pageIndex < MemoryPageCount; pageIndex++)
+        {
+            state.memoryPages[pageIndex] = allocate_memory_page(nullptr);
+            std::memset(state.memoryPages[pageIndex]->bytes, 0, MemoryPageSizeInBytes);
+        }
+
+        initCPUState(state);
+
+        return state;
+    }
+
+    void initCPUState(CPUState& state)
+    {
+        MemoryPage* memoryPages[MemoryPageCount];
+        std::memcpy(memoryPages, state.memoryPages, sizeof(memoryPages));
+
+        state = {};
+        std::memcpy(state.memoryPages, memoryPages, sizeof(memoryPages));
 
         // Set PC to first address
         state.pc = MinProgramAddress;
 
+        seed_random_generator(state, 0);
+
         load_font_table(state);
 
-        return state;
+        // Memory contents were kept, start hashing from what is actually there.
+        recompute_state_hash(state);
+    }
+
+    void seed_random_generator(CPUState& state, u64 seed)
+    {
+        // Run the seed through splitmix64 so that close seeds give unrelated sequences.
+        const u64 mixedSeed = next_splitmix64(seed);
+
+        // xorshift gets stuck on zero.
+        state.randomState = (mixedSeed != 0) ? mixedSeed : 0x9E3779B97F4A7C15;
+    }
+
+    u64 next_splitmix64(u64& generatorState)
+    {
+        generatorState += 0x9E3779B97F4A7C15;
+
+        u64 value = generatorState;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+
+        return value ^ (value >> 31);
+    }
+
+    CPUState forkCPUState(const CPUState& parent)
+    {
+        CPUState child = parent;
+
+        for (u32 pageIndex = 0; pageIndex < MemoryPageCount; pageIndex++)
+            acquire_memory_page(child.memoryPages[pageIndex]);
+
+        return child;
     }
 
     void destroyCPUState(CPUState& state)
     {
-         delete[] state.memory;
-         state.memory = nullptr;
+        for (u32 pageIndex = 0; pageIndex < MemoryPageCount; pageIndex++)
+        {
+            release_memory_page(state.memoryPages[pageIndex]);
+            state.memoryPages[pageIndex] = nullptr;
+        }
     }
 }
@@ -11,6 +11,8 @@
 
 #include "core/Types.h"
 
+#include <atomic>
+
 namespace chip8
 {
     static const unsigned int VRegisterCount = 16;
@@ -29,6 +31,8 @@ namespace chip8
     // Memory
     static const u16 MinProgramAddress = 0x0200;
     static const u16 MaxProgramAddress = 0x0FFF;
+    static const unsigned int MemoryPageSizeInBytes = 0x100;
+    static const unsigned int MemoryPageCount = MemorySizeInBytes / MemoryPageSizeInBytes;
 
     // Timings
     static const unsigned int DelayTimerFrequency = 60;
@@ -44,6 +48,18 @@ namespace chip8
         VC, VD, VE, VF
     };
 
+    struct MemoryPageAllocator;
+
+    // Memory is split in reference-counted pages that can be shared between states.
+    // Shared pages are read-only, they get copied on the first write.
+    struct MemoryPage
+    {
+        // While the page sits in its allocator free list, this holds the index of the next free page.
+        std::atomic<u32> refCount;
+        MemoryPageAllocator* allocator; // nullptr for pages living on the heap
+        u8 bytes[MemoryPageSizeInBytes];
+    };
+
     struct CPUState
     {
         u16 pc;
@@ -59,7 +75,13 @@ namespace chip8
         u32 delayTimerAccumulator;
         u32 executionTimerAccumulator;
 
-        u8* memory;
+        // Instructions executed by execute_step() since power-on.
+        u64 instructionCount;
+
+        // xorshift64* state used by RND, never zero.
+        u64 randomState;
+
+        MemoryPage* memoryPages[MemoryPageCount];
 
         u16 keyState;
 
@@ -68,8 +90,30 @@ namespace chip8
 
         u16 fontTableOffsets[FontTableGlyphCount];
         u8 screen[ScreenHeight][ScreenLineSizeInBytes];
+
+        // Zobrist hashes of the memory and screen contents, see StateHash.h
+        u64 memoryHash;
+        u64 screenHash;
     };
 
+    // Power-on state: zeroed memory with the font table, pc at MinProgramAddress.
     CHIP8EMU_EMU_API CPUState createCPUState();
+
+    // Resets the state to its power-on configuration.
+    // The memory pages currently bound to the state are kept.
+    CHIP8EMU_EMU_API void initCPUState(CPUState& state);
+
+    // RND output only depends on the seed, so two states seeded the same way stay in lockstep.
+    // States start seeded with 0, like the default EmuConfig.
+    CHIP8EMU_EMU_API void seed_random_generator(CPUState& state, u64 seed);
+
+    // splitmix64, advances the generator and returns the next value.
+    // For fuzzers and tools that need their own reproducible stream, RND doesn't use it.
+    CHIP8EMU_EMU_API u64 next_splitmix64(u64& generatorState);
+
+    // Makes a copy of the state that shares all of its memory pages with the parent.
+    // Both states can then be written to independently, and have to be destroyed separately.
+    CHIP8EMU_EMU_API CPUState forkCPUState(const CPUState& parent);
+
     CHIP8EMU_EMU_API void destroyCPUState(CPUState& state);
 }
@@ -0,0 +1,221 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "CpuPool.h"
+
+#include "Execution.h"
+#include "FreeList.h"
+
+#include "core/Assert.h"
+#include "core/Platform.h"
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+#    include <sys/mman.h>
+#endif
+
+namespace chip8
+{
+    struct CPUStatePoolSlot
+    {
+        alignas(64) CPUState state;
+        std::atomic<u32> nextFreeIndex;
+    };
+
+    namespace
+    {
+        static const u64 RegularPageSizeInBytes = 4 * 1024;
+        static const u64 HugePageSizeInBytes = 2 * 1024 * 1024;
+
+        u64 align_up(u64 value, u64 alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        u8* allocate_arena(u64& sizeInBytes, bool useHugePages, bool& isUsingHugePages)
+        {
+            isUsingHugePages = false;
+
+#if defined(CHIP8EMU_PLATFORM_LINUX)
+            if (useHugePages)
+            {
+                const u64 hugeSizeInBytes = align_up(sizeInBytes, HugePageSizeInBytes);
+                void* hugeArena = mmap(nullptr, hugeSizeInBytes, PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+                if (hugeArena != MAP_FAILED)
+                {
+                    sizeInBytes = hugeSizeInBytes;
+                    isUsingHugePages = true;
+                    return static_cast<u8*>(hugeArena);
+                }
+            }
+#endif
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+            sizeInBytes = align_up(sizeInBytes, useHugePages ? HugePageSizeInBytes : RegularPageSizeInBytes);
+
+            void* arena = mmap(nullptr, sizeInBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            Assert(arena != MAP_FAILED);
+
+#    if defined(MADV_HUGEPAGE)
+            // No reserved huge pages, let transparent huge pages kick in if possible.
+            if (useHugePages)
+                madvise(arena, sizeInBytes, MADV_HUGEPAGE);
+#    endif
+
+            return static_cast<u8*>(arena);
+#elif defined(CHIP8EMU_PLATFORM_WINDOWS)
+            sizeInBytes = align_up(sizeInBytes, RegularPageSizeInBytes);
+
+            void* arena = VirtualAlloc(nullptr, sizeInBytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+            Assert(arena != nullptr);
+
+            return static_cast<u8*>(arena);
+#endif
+        }
+
+        void free_arena(u8* arena, u64 sizeInBytes)
+        {
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+            munmap(arena, sizeInBytes);
+#elif defined(CHIP8EMU_PLATFORM_WINDOWS)
+            static_cast<void>(sizeInBytes);
+            VirtualFree(arena, 0, MEM_RELEASE);
+#endif
+        }
+
+        void bind_template_pages(const CPUStatePool& pool, CPUState& state)
+        {
+            state = pool.templateState;
+
+            for (u32 pageIndex = 0; pageIndex < MemoryPageCount; pageIndex++)
+                acquire_memory_page(state.memoryPages[pageIndex]);
+        }
+
+        void release_pages(CPUState& state)
+        {
+            for (u32 pageIndex = 0; pageIndex < MemoryPageCount; pageIndex++)
+            {
+                release_memory_page(state.memoryPages[pageIndex]);
+                state.memoryPages[pageIndex] = nullptr;
+            }
+        }
+    }
+
+    CPUStatePool* createCPUStatePool(u32 capacity, bool useHugePages)
+    {
+        Assert(capacity > 0);
+        Assert(capacity < InvalidFreeListIndex / MemoryPageCount - 1);
+
+        CPUStatePool* pool = new CPUStatePool;
+
+        // Slots come first, then enough memory pages for every slot plus the template.
+        // In practice most states share their pages with the template and leave the rest untouched.
+        const u32 pageCount = (capacity + 1) * MemoryPageCount;
+        const u64 slotsSizeInBytes = align_up(static_cast<u64>(capacity) * sizeof(CPUStatePoolSlot), alignof(MemoryPage));
+
+        pool->arenaSizeInBytes = slotsSizeInBytes + static_cast<u64>(pageCount) * sizeof(MemoryPage);
+        pool->arena = allocate_arena(pool->arenaSizeInBytes, useHugePages, pool->isUsingHugePages);
+        pool->capacity = capacity;
+        pool->slots = reinterpret_cast<CPUStatePoolSlot*>(pool->arena);
+
+        MemoryPage* pages = reinterpret_cast<MemoryPage*>(pool->arena + slotsSizeInBytes);
+
+        for (u32 pageIndex = 0; pageIndex < pageCount; pageIndex++)
+            new (&pages[pageIndex]) MemoryPage;
+
+        init_memory_page_allocator(pool->pageAllocator, pages, pageCount);
+
+        // Build the template once. Zero the memory so that every reset is deterministic.
+        const u8 zeroPage[MemoryPageSizeInBytes] = {};
+
+        for (u32 pageIndex = 0; pageIndex < MemoryPageCount; pageIndex++)
+        {
+            MemoryPage* page = allocate_memory_page(&pool->pageAllocator);
+            std::memcpy(page->bytes, zeroPage, MemoryPageSizeInBytes);
+
+            pool->templateState.memoryPages[pageIndex] = page;
+        }
+
+        initCPUState(pool->templateState);
+
+        // Chain all the slots in the free list, lowest index on top.
+        for (u32 slotIndex = 0; slotIndex < capacity; slotIndex++)
+        {
+            CPUStatePoolSlot* slot = new (&pool->slots[slotIndex]) CPUStatePoolSlot;
+            const u32 nextIndex = (slotIndex + 1 < capacity) ? (slotIndex + 1) : InvalidFreeListIndex;
+
+            slot->nextFreeIndex.store(nextIndex, std::memory_order_relaxed);
+        }
+
+        pool->freeListHead.store(pack_free_list_head(0, 0), std::memory_order_release);
+
+        return pool;
+    }
+
+    void destroyCPUStatePool(CPUStatePool* pool)
+    {
+        Assert(pool != nullptr);
+
+        // Pages might have spilled on the heap if the template was modified while shared.
+        release_pages(pool->templateState);
+
+        // Slots and pages are trivially destructible, just drop the whole arena.
+        free_arena(pool->arena, pool->arenaSizeInBytes);
+
+        delete pool;
+    }
+
+    CPUState* acquire_cpu_state(CPUStatePool& pool)
+    {
+        const u32 slotIndex = pop_free_list(pool.freeListHead,
+                                            [&pool](u32 index) -> std::atomic<u32>& { return pool.slots[index].nextFreeIndex; });
+
+        if (slotIndex == InvalidFreeListIndex)
+            return nullptr; // Pool exhausted
+
+        CPUState& state = pool.slots[slotIndex].state;
+
+        bind_template_pages(pool, state);
+
+        return &state;
+    }
+
+    void release_cpu_state(CPUStatePool& pool, CPUState* state)
+    {
+        Assert(state != nullptr);
+
+        const u8* slotBase = reinterpret_cast<const u8*>(state) - offsetof(CPUStatePoolSlot, state);
+        const std::ptrdiff_t slotOffsetInBytes = slotBase - reinterpret_cast<const u8*>(pool.slots);
+        const u32 slotIndex = static_cast<u32>(slotOffsetInBytes / static_cast<std::ptrdiff_t>(sizeof(CPUStatePoolSlot)));
+
+        Assert(slotOffsetInBytes >= 0); // State was not acquired from this pool
+        Assert(slotIndex < pool.capacity); // State was not acquired from this pool
+
+        // Give the pages back right away so they can be reused by other states.
+        release_pages(*state);
+
+        CPUStatePoolSlot& slot = pool.slots[slotIndex];
+
+        push_free_list(pool.freeListHead, slotIndex, slot.nextFreeIndex);
+    }
+
+    void reset_cpu_state(const CPUStatePool& pool, CPUState& state)
+    {
+        release_pages(state);
+        bind_template_pages(pool, state);
+    }
+
+    void load_pool_program(CPUStatePool& pool, const u8* program, u16 size)
+    {
+        load_program(pool.templateState, program, size);
+    }
+}
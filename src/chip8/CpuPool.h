@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+#include "Memory.h"
+
+#include <atomic>
+
+namespace chip8
+{
+    struct CPUStatePoolSlot;
+
+    // Fixed-capacity pool of CPU states carved out of a single page-aligned arena.
+    // Acquiring and releasing states is lock-free and never touches the heap,
+    // which matters when spinning up thousands of short-lived machines.
+    struct CPUStatePool
+    {
+        u8* arena;
+        u64 arenaSizeInBytes;
+        bool isUsingHugePages;
+
+        u32 capacity;
+        CPUStatePoolSlot* slots;
+
+        // Enough pages for every state to own all of its memory.
+        MemoryPageAllocator pageAllocator;
+
+        // Freshly initialized state. Reset states share its memory pages until they write to them.
+        CPUState templateState;
+
+        std::atomic<u64> freeListHead;
+    };
+
+    // Pass useHugePages to ask the OS to back the arena with huge pages.
+    // This is only a hint, the pool silently falls back to regular pages.
+    CHIP8EMU_EMU_API CPUStatePool* createCPUStatePool(u32 capacity, bool useHugePages);
+    CHIP8EMU_EMU_API void destroyCPUStatePool(CPUStatePool* pool);
+
+    // Returns a freshly reset state, or nullptr if the pool is exhausted.
+    // Safe to call concurrently with other acquire/release calls.
+    CHIP8EMU_EMU_API CPUState* acquire_cpu_state(CPUStatePool& pool);
+    CHIP8EMU_EMU_API void release_cpu_state(CPUStatePool& pool, CPUState* state);
+
+    // Puts an acquired state back to its power-on configuration.
+    CHIP8EMU_EMU_API void reset_cpu_state(const CPUStatePool& pool, CPUState& state);
+
+    // Bakes a program into the template state, so every state acquired after this comes
+    // with the program already loaded, at no extra cost.
+    CHIP8EMU_EMU_API void load_pool_program(CPUStatePool& pool, const u8* program, u16 size);
+}
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "DeltaCodec.h"
+
+#include "core/Assert.h"
+
+#include <cstring>
+
+namespace chip8
+{
+    namespace
+    {
+        // Runs this short are cheaper to store as literals.
+        static const u32 MinZeroRunLength = 3;
+
+        // Lengths are stored as little-endian base-128 varints, 2 bytes at most
+        // given MaxDeltaBufferSizeInBytes.
+        u32 write_length(u8* output, u32 length)
+        {
+            if (length < 0x80)
+            {
+                output[0] = static_cast<u8>(length);
+                return 1;
+            }
+
+            output[0] = static_cast<u8>((length & 0x7F) | 0x80);
+            output[1] = static_cast<u8>(length >> 7);
+            return 2;
+        }
+
+        u32 read_length(const u8* input, u32& length)
+        {
+            if ((input[0] & 0x80) == 0)
+            {
+                length = input[0];
+                return 1;
+            }
+
+            length = static_cast<u32>(input[0] & 0x7F) | (static_cast<u32>(input[1]) << 7);
+            return 2;
+        }
+
+        u8 get_xor_byte(const u8* reference, const u8* current, u32 index)
+        {
+            return reference ? static_cast<u8>(reference[index] ^ current[index]) : current[index];
+        }
+
+        u32 get_zero_run_length(const u8* reference, const u8* current, u32 start, u32 sizeInBytes)
+        {
+            u32 index = start;
+
+            while (index < sizeInBytes && get_xor_byte(reference, current, index) == 0)
+                index++;
+
+            return index - start;
+        }
+    }
+
+    u32 encode_xor_delta(const u8* reference, const u8* current, u32 sizeInBytes, u8* output)
+    {
+        Assert(current != nullptr);
+        Assert(output != nullptr);
+        Assert(sizeInBytes < MaxDeltaBufferSizeInBytes);
+
+        u32 inputOffset = 0;
+        u32 outputOffset = 0;
+
+        while (inputOffset < sizeInBytes)
+        {
+            const u32 zeroRunLength = get_zero_run_length(reference, current, inputOffset, sizeInBytes);
+            const u32 literalStart = inputOffset + zeroRunLength;
+            u32 literalEnd = literalStart;
+
+            // Extend the literal until we find a zero run worth encoding.
+            while (literalEnd < sizeInBytes)
+            {
+                const u32 nextZeroRunLength = get_zero_run_length(reference, current, literalEnd, sizeInBytes);
+
+                if (nextZeroRunLength >= MinZeroRunLength || literalEnd + nextZeroRunLength == sizeInBytes)
+                    break;
+
+                literalEnd += nextZeroRunLength + 1;
+            }
+
+            const u32 literalLength = literalEnd - literalStart;
+
+            outputOffset += write_length(&output[outputOffset], zeroRunLength);
+            outputOffset += write_length(&output[outputOffset], literalLength);
+
+            for (u32 index = literalStart; index < literalEnd; index++)
+                output[outputOffset++] = get_xor_byte(reference, current, index);
+
+            inputOffset = literalEnd;
+        }
+
+        Assert(outputOffset <= get_max_xor_delta_size(sizeInBytes));
+
+        return outputOffset;
+    }
+
+    void decode_xor_delta(const u8* reference, const u8* delta, u32 deltaSizeInBytes, u8* output, u32 sizeInBytes)
+    {
+        Assert(delta != nullptr);
+        Assert(output != nullptr);
+
+        if (reference)
+            std::memcpy(output, reference, sizeInBytes);
+        else
+            std::memset(output, 0, sizeInBytes);
+
+        u32 deltaOffset = 0;
+        u32 outputOffset = 0;
+
+        while (deltaOffset < deltaSizeInBytes)
+        {
+            u32 zeroRunLength = 0;
+            u32 literalLength = 0;
+
+            deltaOffset += read_length(&delta[deltaOffset], zeroRunLength);
+            deltaOffset += read_length(&delta[deltaOffset], literalLength);
+
+            outputOffset += zeroRunLength;
+
+            Assert(outputOffset + literalLength <= sizeInBytes); // Corrupted delta
+
+            for (u32 index = 0; index < literalLength; index++)
+                output[outputOffset + index] ^= delta[deltaOffset + index];
+
+            deltaOffset += literalLength;
+            outputOffset += literalLength;
+        }
+
+        Assert(outputOffset == sizeInBytes); // Corrupted delta
+    }
+}
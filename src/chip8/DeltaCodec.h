@@ -0,0 +1,35 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+
+#include "core/Types.h"
+
+namespace chip8
+{
+    // XOR/RLE delta coding.
+    // The current buffer is XORed against a reference buffer of the same size, and the
+    // result is stored as a sequence of (zero run length, literal length, literal bytes).
+    // This is very effective on successive machine states since most bytes don't change.
+    // Passing a null reference encodes against an all-zero buffer.
+    static const u32 MaxDeltaBufferSizeInBytes = 0x4000;
+
+    constexpr u32 get_max_xor_delta_size(u32 sizeInBytes)
+    {
+        // Short zero runs are folded into literals so every run header pays for itself.
+        return sizeInBytes + sizeInBytes / 3 + 8;
+    }
+
+    // Returns the size of the encoded delta. The output must hold at least get_max_xor_delta_size() bytes.
+    CHIP8EMU_EMU_API u32 encode_xor_delta(const u8* reference, const u8* current, u32 sizeInBytes, u8* output);
+
+    // Reconstructs the current buffer from the reference and the delta.
+    CHIP8EMU_EMU_API void decode_xor_delta(const u8* reference, const u8* delta, u32 deltaSizeInBytes, u8* output,
+                                           u32 sizeInBytes);
+}
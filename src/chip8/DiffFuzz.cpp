@@ -0,0 +1,520 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "DiffFuzz.h"
+
+#include "Memory.h"
+#include "Opcode.h"
+#include "StateHash.h"
+#include "ThreadPool.h"
+
+#include "core/Assert.h"
+
+#include <cstring>
+#include <iomanip>
+
+namespace chip8
+{
+    namespace
+    {
+        struct InstructionTemplate
+        {
+            u16 base;
+            u16 operandMask;
+        };
+
+        // Indexed by OpcodeClass, random operands get ORed in the mask.
+        const InstructionTemplate InstructionTemplates[] = {
+            {0x00E0, 0x0000}, // CLS
+            {0x00EE, 0x0000}, // RET
+            {0x0000, 0x0FFF}, // SYS addr
+            {0x1000, 0x0FFF}, // JP addr
+            {0x2000, 0x0FFF}, // CALL addr
+            {0x3000, 0x0FFF}, // SE Vx, byte
+            {0x4000, 0x0FFF}, // SNE Vx, byte
+            {0x5000, 0x0FF0}, // SE Vx, Vy
+            {0x6000, 0x0FFF}, // LD Vx, byte
+            {0x7000, 0x0FFF}, // ADD Vx, byte
+            {0x8000, 0x0FF0}, // LD Vx, Vy
+            {0x8001, 0x0FF0}, // OR Vx, Vy
+            {0x8002, 0x0FF0}, // AND Vx, Vy
+            {0x8003, 0x0FF0}, // XOR Vx, Vy
+            {0x8004, 0x0FF0}, // ADD Vx, Vy
+            {0x8005, 0x0FF0}, // SUB Vx, Vy
+            {0x8006, 0x0FF0}, // SHR Vx {, Vy}
+            {0x8007, 0x0FF0}, // SUBN Vx, Vy
+            {0x800E, 0x0FF0}, // SHL Vx {, Vy}
+            {0x9000, 0x0FF0}, // SNE Vx, Vy
+            {0xA000, 0x0FFF}, // LD I, addr
+            {0xB000, 0x0FFF}, // JP V0, addr
+            {0xC000, 0x0FFF}, // RND Vx, byte
+            {0xD000, 0x0FFF}, // DRW Vx, Vy, nibble
+            {0xE09E, 0x0F00}, // SKP Vx
+            {0xE0A1, 0x0F00}, // SKNP Vx
+            {0xF007, 0x0F00}, // LD Vx, DT
+            {0xF00A, 0x0F00}, // LD Vx, K
+            {0xF015, 0x0F00}, // LD DT, Vx
+            {0xF018, 0x0F00}, // LD ST, Vx
+            {0xF01E, 0x0F00}, // ADD I, Vx
+            {0xF029, 0x0F00}, // LD F, Vx
+            {0xF033, 0x0F00}, // LD B, Vx
+            {0xF055, 0x0F00}, // LD [I], Vx
+            {0xF065, 0x0F00}, // LD Vx, [I]
+        };
+
+        static_assert(sizeof(InstructionTemplates) / sizeof(InstructionTemplates[0])
+                          == static_cast<u32>(OpcodeClass::Invalid),
+                      "every valid opcode class needs a template");
+
+        // Most operands are random, a few tries are usually enough to find a valid one.
+        static const u32 MaxGenerationAttemptCount = 32;
+
+        // One in KeyStateChangeRate steps presses or releases keys.
+        static const u32 KeyStateChangeRate = 8;
+
+        // Skips check the 6 bytes after the pc, and the step after can skip again.
+        static const u16 MaxSafePC = MaxProgramAddress + 1 - 10;
+
+        u16 generate_safe_pc(u64& rngState)
+        {
+            const u16 range = (MaxSafePC - MinProgramAddress) / 2 + 1;
+
+            return static_cast<u16>(MinProgramAddress + 2 * (next_splitmix64(rngState) % range));
+        }
+
+        // Where the next step can start from, with or without a skip.
+        bool is_safe_pc(u32 address)
+        {
+            return (address & 0x0001) == 0 && address >= MinProgramAddress && address <= MaxSafePC;
+        }
+
+        bool is_readable(u32 address, u32 sizeInBytes)
+        {
+            return address + sizeInBytes - 1 <= MaxProgramAddress;
+        }
+
+        bool is_writable(u32 address, u32 sizeInBytes)
+        {
+            return address >= MinProgramAddress && is_readable(address, sizeInBytes);
+        }
+
+        void run_step(const EmuConfig& config, const ExecutionEngine& engine, CPUState& state, const DiffFuzzStep& step)
+        {
+            state.keyState = step.keyState;
+            engine.execute(config, state, step.instruction);
+        }
+
+        u64 get_case_seed(u64 seed, u32 caseIndex)
+        {
+            u64 rngState = seed ^ (static_cast<u64>(caseIndex) << 32);
+
+            return next_splitmix64(rngState);
+        }
+
+        struct FuzzerJob
+        {
+            const EmuConfig* config;
+            const ExecutionEngine* reference;
+            const ExecutionEngine* candidate;
+            u64 seed;
+            u32 stepCount;
+            std::vector<DiffFuzzResult> results;
+            std::vector<DiffFuzzFinding> findings; // One slot per case, only filled on divergence
+            std::vector<u32> caseStepCounts;
+        };
+
+        void run_fuzzer_case(u32 caseIndex, void* userData)
+        {
+            FuzzerJob& job = *static_cast<FuzzerJob*>(userData);
+            DiffFuzzFinding& finding = job.findings[caseIndex];
+
+            const DiffFuzzResult result = fuzz_diff_case(*job.config, *job.reference, *job.candidate,
+                                                         get_case_seed(job.seed, caseIndex), job.stepCount,
+                                                         finding.fuzzCase, finding.divergence);
+
+            job.caseStepCounts[caseIndex] = static_cast<u32>(finding.fuzzCase.steps.size());
+
+            if (result == DiffFuzzResult::Diverged)
+                minimize_diff_fuzz_case(*job.config, *job.reference, *job.candidate, finding.fuzzCase,
+                                        finding.divergence);
+
+            job.results[caseIndex] = result;
+        }
+    }
+
+    void generate_diff_fuzz_state(CPUState& state, u64 stateSeed)
+    {
+        u64 rngState = stateSeed;
+
+        u8 memory[MemorySizeInBytes];
+
+        for (u8& byte : memory)
+            byte = static_cast<u8>(next_splitmix64(rngState));
+
+        write_memory_range(state, 0, memory, MemorySizeInBytes);
+
+        // Puts the font back
+        initCPUState(state);
+
+        state.pc = generate_safe_pc(rngState);
+        state.sp = static_cast<u8>(next_splitmix64(rngState) % StackSize);
+
+        // Return addresses have to be valid too, the ones above sp don't matter but are set anyway.
+        for (u16& returnAddress : state.stack)
+            returnAddress = generate_safe_pc(rngState);
+
+        for (u8& value : state.vRegisters)
+        {
+            // Small values are needed by LD F, SKP and SKNP.
+            const u64 random = next_splitmix64(rngState);
+            value = static_cast<u8>((random & 0x100) ? (random & 0x0F) : random);
+        }
+
+        state.i = static_cast<u16>(next_splitmix64(rngState) % MemorySizeInBytes);
+        state.delayTimer = static_cast<u8>(next_splitmix64(rngState));
+        state.soundTimer = static_cast<u8>(next_splitmix64(rngState));
+        state.keyState = static_cast<u16>(next_splitmix64(rngState));
+        state.keyStatePrev = static_cast<u16>(next_splitmix64(rngState));
+
+        for (u32 y = 0; y < ScreenHeight; y++)
+        {
+            for (u32 x = 0; x < ScreenLineSizeInBytes; x++)
+                state.screen[y][x] = static_cast<u8>(next_splitmix64(rngState));
+        }
+
+        seed_random_generator(state, next_splitmix64(rngState));
+        recompute_state_hash(state);
+    }
+
+    bool is_diff_fuzz_step_valid(const CPUState& state, const DiffFuzzStep& step)
+    {
+        const u16 instruction = step.instruction;
+        const OpcodeClass opcodeClass = get_opcode_class(instruction);
+        const u8 x = static_cast<u8>((instruction >> 8) & 0x0F);
+        const u8 n = static_cast<u8>(instruction & 0x0F);
+        const u16 address = instruction & 0x0FFF;
+        const u8 vx = state.vRegisters[x];
+
+        // Every other instruction would be skipped by the real fetch loop.
+        if (state.isWaitingForKey)
+        {
+            // get_key_pressed() never reports key 0 and asserts when it is the only one pressed.
+            const u16 keyStatePressMask = static_cast<u16>(~state.keyStatePrev & step.keyState);
+
+            return opcodeClass == OpcodeClass::LdVxK && keyStatePressMask != 0x0001;
+        }
+
+        switch (opcodeClass)
+        {
+            case OpcodeClass::Ret:
+                return state.sp > 0 && is_safe_pc(state.stack[state.sp] + 2u);
+            case OpcodeClass::Jp:
+                return is_safe_pc(address);
+            case OpcodeClass::Call:
+                // stack[0] is never used, so the stack holds one less entry than StackSize.
+                return state.sp + 1u < StackSize && is_safe_pc(address);
+            case OpcodeClass::JpV0:
+                return is_safe_pc(address + static_cast<u32>(state.vRegisters[V0]));
+            case OpcodeClass::Invalid:
+            case OpcodeClass::Count:
+                return false;
+            default:
+                break;
+        }
+
+        // Everything else moves the pc forward by 2 or 4.
+        if (!is_safe_pc(state.pc + 4u))
+            return false;
+
+        switch (opcodeClass)
+        {
+            case OpcodeClass::Drw:
+                return n > 0 && is_readable(state.i, n);
+            case OpcodeClass::Skp:
+            case OpcodeClass::Sknp:
+            case OpcodeClass::LdF:
+                return vx < FontTableGlyphCount;
+            case OpcodeClass::AddI:
+                return state.i + static_cast<u32>(vx) <= 0xFFFF;
+            case OpcodeClass::LdB:
+                return is_writable(state.i, 3);
+            case OpcodeClass::LdIVx:
+                return is_writable(state.i, x + 1u);
+            case OpcodeClass::LdVxI:
+                return is_readable(state.i, x + 1u);
+            default:
+                return true;
+        }
+    }
+
+    DiffFuzzStep generate_diff_fuzz_step(const CPUState& state, u64& rngState)
+    {
+        DiffFuzzStep step;
+
+        step.keyState = state.keyState;
+
+        if (next_splitmix64(rngState) % KeyStateChangeRate == 0)
+            step.keyState = static_cast<u16>(next_splitmix64(rngState));
+
+        for (u32 attempt = 0; attempt < MaxGenerationAttemptCount; attempt++)
+        {
+            const u32 classIndex = static_cast<u32>(next_splitmix64(rngState) % static_cast<u32>(OpcodeClass::Invalid));
+            const InstructionTemplate& instructionTemplate =
+                InstructionTemplates[state.isWaitingForKey ? static_cast<u32>(OpcodeClass::LdVxK) : classIndex];
+
+            step.instruction = static_cast<u16>(instructionTemplate.base
+                                                | (next_splitmix64(rngState) & instructionTemplate.operandMask));
+
+            if (is_diff_fuzz_step_valid(state, step))
+                return step;
+        }
+
+        // Nothing fit, jump somewhere safe. Releasing every key also ends LD Vx, K waits.
+        step.keyState = 0;
+        step.instruction = state.isWaitingForKey ? 0xF00A : static_cast<u16>(0x1000 | generate_safe_pc(rngState));
+
+        Assert(is_diff_fuzz_step_valid(state, step));
+
+        return step;
+    }
+
+    const char* find_cpu_state_difference(const CPUState& lhs, const CPUState& rhs)
+    {
+        if (lhs.pc != rhs.pc)
+            return "pc";
+        if (lhs.sp != rhs.sp)
+            return "sp";
+        if (std::memcmp(lhs.stack, rhs.stack, sizeof(lhs.stack)) != 0)
+            return "stack";
+        if (std::memcmp(lhs.vRegisters, rhs.vRegisters, sizeof(lhs.vRegisters)) != 0)
+            return "vRegisters";
+        if (lhs.i != rhs.i)
+            return "i";
+        if (lhs.delayTimer != rhs.delayTimer)
+            return "delayTimer";
+        if (lhs.soundTimer != rhs.soundTimer)
+            return "soundTimer";
+        if (lhs.delayTimerAccumulator != rhs.delayTimerAccumulator)
+            return "delayTimerAccumulator";
+        if (lhs.executionTimerAccumulator != rhs.executionTimerAccumulator)
+            return "executionTimerAccumulator";
+        if (lhs.instructionCount != rhs.instructionCount)
+            return "instructionCount";
+        if (lhs.randomState != rhs.randomState)
+            return "randomState";
+
+        for (u32 pageIndex = 0; pageIndex < MemoryPageCount; pageIndex++)
+        {
+            const MemoryPage* lhsPage = lhs.memoryPages[pageIndex];
+            const MemoryPage* rhsPage = rhs.memoryPages[pageIndex];
+
+            if (lhsPage != rhsPage && std::memcmp(lhsPage->bytes, rhsPage->bytes, MemoryPageSizeInBytes) != 0)
+                return "memory";
+        }
+
+        if (lhs.keyState != rhs.keyState)
+            return "keyState";
+        if (lhs.keyStatePrev != rhs.keyStatePrev)
+            return "keyStatePrev";
+        if (lhs.isWaitingForKey != rhs.isWaitingForKey)
+            return "isWaitingForKey";
+        if (std::memcmp(lhs.fontTableOffsets, rhs.fontTableOffsets, sizeof(lhs.fontTableOffsets)) != 0)
+            return "fontTableOffsets";
+        if (std::memcmp(lhs.screen, rhs.screen, sizeof(lhs.screen)) != 0)
+            return "screen";
+        if (lhs.memoryHash != rhs.memoryHash)
+            return "memoryHash";
+        if (lhs.screenHash != rhs.screenHash)
+            return "screenHash";
+
+        return nullptr;
+    }
+
+    DiffFuzzResult run_diff_fuzz_case(const EmuConfig& config, const ExecutionEngine& reference,
+                                      const ExecutionEngine& candidate, const DiffFuzzCase& fuzzCase,
+                                      DiffFuzzDivergence& divergence)
+    {
+        CPUState referenceState = createCPUState();
+
+        generate_diff_fuzz_state(referenceState, fuzzCase.stateSeed);
+
+        CPUState candidateState = forkCPUState(referenceState);
+        DiffFuzzResult result = DiffFuzzResult::Match;
+
+        for (u32 stepIndex = 0; stepIndex < fuzzCase.steps.size(); stepIndex++)
+        {
+            const DiffFuzzStep& step = fuzzCase.steps[stepIndex];
+
+            if (!is_diff_fuzz_step_valid(referenceState, step))
+            {
+                result = DiffFuzzResult::InvalidStep;
+                break;
+            }
+
+            run_step(config, reference, referenceState, step);
+            run_step(config, candidate, candidateState, step);
+
+            const char* fieldName = find_cpu_state_difference(referenceState, candidateState);
+
+            if (fieldName != nullptr)
+            {
+                divergence.stepIndex = stepIndex;
+                divergence.fieldName = fieldName;
+                result = DiffFuzzResult::Diverged;
+                break;
+            }
+        }
+
+        destroyCPUState(candidateState);
+        destroyCPUState(referenceState);
+
+        return result;
+    }
+
+    DiffFuzzResult fuzz_diff_case(const EmuConfig& config, const ExecutionEngine& reference,
+                                  const ExecutionEngine& candidate, u64 seed, u32 stepCount, DiffFuzzCase& fuzzCase,
+                                  DiffFuzzDivergence& divergence)
+    {
+        u64 rngState = seed;
+
+        fuzzCase.stateSeed = next_splitmix64(rngState);
+        fuzzCase.steps.clear();
+
+        CPUState referenceState = createCPUState();
+
+        generate_diff_fuzz_state(referenceState, fuzzCase.stateSeed);
+
+        CPUState candidateState = forkCPUState(referenceState);
+        DiffFuzzResult result = DiffFuzzResult::Match;
+
+        for (u32 stepIndex = 0; stepIndex < stepCount; stepIndex++)
+        {
+            const DiffFuzzStep step = generate_diff_fuzz_step(referenceState, rngState);
+
+            fuzzCase.steps.push_back(step);
+
+            run_step(config, reference, referenceState, step);
+            run_step(config, candidate, candidateState, step);
+
+            const char* fieldName = find_cpu_state_difference(referenceState, candidateState);
+
+            if (fieldName != nullptr)
+            {
+                divergence.stepIndex = stepIndex;
+                divergence.fieldName = fieldName;
+                result = DiffFuzzResult::Diverged;
+                break;
+            }
+        }
+
+        destroyCPUState(candidateState);
+        destroyCPUState(referenceState);
+
+        return result;
+    }
+
+    void minimize_diff_fuzz_case(const EmuConfig& config, const ExecutionEngine& reference,
+                                 const ExecutionEngine& candidate, DiffFuzzCase& fuzzCase,
+                                 DiffFuzzDivergence& divergence)
+    {
+        Assert(run_diff_fuzz_case(config, reference, candidate, fuzzCase, divergence) == DiffFuzzResult::Diverged);
+
+        std::vector<DiffFuzzStep>& steps = fuzzCase.steps;
+        steps.resize(divergence.stepIndex + 1);
+
+        DiffFuzzCase trialCase;
+        DiffFuzzDivergence trialDivergence;
+
+        trialCase.stateSeed = fuzzCase.stateSeed;
+
+        // Remove chunks of steps, halving their size until single steps can't be removed anymore.
+        // Removing a step changes the state seen by the next ones, some trials become invalid.
+        bool hasShrunk = true;
+
+        while (hasShrunk)
+        {
+            hasShrunk = false;
+
+            for (u32 chunkSize = static_cast<u32>(steps.size() / 2); chunkSize > 0; chunkSize /= 2)
+            {
+                u32 chunkStart = 0;
+
+                while (chunkStart + chunkSize <= steps.size())
+                {
+                    trialCase.steps.assign(steps.begin(), steps.begin() + chunkStart);
+                    trialCase.steps.insert(trialCase.steps.end(), steps.begin() + chunkStart + chunkSize, steps.end());
+
+                    if (run_diff_fuzz_case(config, reference, candidate, trialCase, trialDivergence)
+                        == DiffFuzzResult::Diverged)
+                    {
+                        trialCase.steps.resize(trialDivergence.stepIndex + 1);
+                        steps.swap(trialCase.steps);
+                        divergence = trialDivergence;
+                        hasShrunk = true;
+                    }
+                    else
+                        chunkStart += chunkSize;
+                }
+            }
+        }
+    }
+
+    void run_diff_fuzzer(ThreadPool& pool, const EmuConfig& config, const ExecutionEngine& reference,
+                         const ExecutionEngine& candidate, u64 seed, u32 caseCount, u32 stepCount,
+                         DiffFuzzReport& report)
+    {
+        FuzzerJob job;
+
+        job.config = &config;
+        job.reference = &reference;
+        job.candidate = &candidate;
+        job.seed = seed;
+        job.stepCount = stepCount;
+        job.results.resize(caseCount, DiffFuzzResult::Match);
+        job.findings.resize(caseCount);
+        job.caseStepCounts.resize(caseCount, 0);
+
+        parallel_for(pool, caseCount, &run_fuzzer_case, &job);
+
+        report.caseCount = caseCount;
+        report.stepCount = 0;
+        report.findings.clear();
+
+        for (u32 caseIndex = 0; caseIndex < caseCount; caseIndex++)
+        {
+            report.stepCount += job.caseStepCounts[caseIndex];
+
+            if (job.results[caseIndex] == DiffFuzzResult::Diverged)
+                report.findings.push_back(job.findings[caseIndex]);
+        }
+    }
+
+    void write_diff_fuzz_regression(std::ostream& output, const DiffFuzzFinding& finding,
+                                    const ExecutionEngine& reference, const ExecutionEngine& candidate)
+    {
+        const DiffFuzzCase& fuzzCase = finding.fuzzCase;
+
+        output << std::hex << std::uppercase << std::setfill('0');
+        output << "TEST_CASE(\"Differential regression " << reference.name << " vs " << candidate.name << " 0x"
+               << std::setw(16) << fuzzCase.stateSeed << "\")\n";
+        output << "{\n";
+        output << "    // Diverged on " << finding.divergence.fieldName << "\n";
+        output << "    const chip8::DiffFuzzStep steps[] = {\n";
+
+        for (const DiffFuzzStep& step : fuzzCase.steps)
+        {
+            output << "        {0x" << std::setw(4) << step.instruction << ", 0x" << std::setw(4) << step.keyState
+                   << "}, // " << get_opcode_class_name(get_opcode_class(step.instruction)) << "\n";
+        }
+
+        output << "    };\n\n";
+        output << "    check_diff_fuzz_regression(\"" << reference.name << "\", \"" << candidate.name << "\", 0x"
+               << std::setw(16) << fuzzCase.stateSeed << ", steps, sizeof(steps) / sizeof(steps[0]));\n";
+        output << "}\n";
+        output << std::dec << std::nouppercase << std::setfill(' ');
+    }
+}
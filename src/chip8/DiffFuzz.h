@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "ExecutionEngine.h"
+
+#include <ostream>
+#include <vector>
+
+namespace chip8
+{
+    struct ThreadPool;
+
+    // Differential fuzzing: random instruction streams go through a reference and a candidate
+    // engine in lockstep, and the full states get compared after every step.
+    //
+    // Instructions are fed to the engines directly instead of being fetched, so a case is a seed for
+    // the initial state plus a list of steps. Steps are only generated when the reference would accept
+    // them without tripping an Assert, the goal is to compare engines, not to find invalid programs.
+    struct DiffFuzzStep
+    {
+        u16 instruction;
+        u16 keyState; // Applied right before the instruction
+    };
+
+    struct DiffFuzzCase
+    {
+        u64 stateSeed;
+        std::vector<DiffFuzzStep> steps;
+    };
+
+    enum class DiffFuzzResult
+    {
+        Match,
+        Diverged,
+        InvalidStep // The reference state could not run one of the steps, the case says nothing
+    };
+
+    struct DiffFuzzDivergence
+    {
+        u32 stepIndex;
+        const char* fieldName; // First field that differs, see find_cpu_state_difference()
+    };
+
+    struct DiffFuzzFinding
+    {
+        DiffFuzzCase fuzzCase; // Minimized
+        DiffFuzzDivergence divergence;
+    };
+
+    struct DiffFuzzReport
+    {
+        u32 caseCount;
+        u64 stepCount;
+        std::vector<DiffFuzzFinding> findings;
+    };
+
+    // Random registers, stack, timers, screen and memory, always a state the reference can run from.
+    // The state must own its memory pages, see createCPUState().
+    CHIP8EMU_EMU_API void generate_diff_fuzz_state(CPUState& state, u64 stateSeed);
+
+    // True if the reference runs the step from this state without tripping an Assert,
+    // and leaves the pc somewhere the next step can run from.
+    CHIP8EMU_EMU_API bool is_diff_fuzz_step_valid(const CPUState& state, const DiffFuzzStep& step);
+
+    // rngState is any non-zero value, it gets updated.
+    CHIP8EMU_EMU_API DiffFuzzStep generate_diff_fuzz_step(const CPUState& state, u64& rngState);
+
+    // Returns the name of the first field that differs, or nullptr if the states are equal.
+    // Memory is compared byte per byte, sharing pages or not doesn't matter.
+    CHIP8EMU_EMU_API const char* find_cpu_state_difference(const CPUState& lhs, const CPUState& rhs);
+
+    CHIP8EMU_EMU_API DiffFuzzResult run_diff_fuzz_case(const EmuConfig& config, const ExecutionEngine& reference,
+                                                       const ExecutionEngine& candidate, const DiffFuzzCase& fuzzCase,
+                                                       DiffFuzzDivergence& divergence);
+
+    // Generates up to stepCount steps on the fly from the reference state.
+    // On divergence, the case stops at the diverging step.
+    CHIP8EMU_EMU_API DiffFuzzResult fuzz_diff_case(const EmuConfig& config, const ExecutionEngine& reference,
+                                                   const ExecutionEngine& candidate, u64 seed, u32 stepCount,
+                                                   DiffFuzzCase& fuzzCase, DiffFuzzDivergence& divergence);
+
+    // Drops every step that is not needed to reproduce the divergence.
+    CHIP8EMU_EMU_API void minimize_diff_fuzz_case(const EmuConfig& config, const ExecutionEngine& reference,
+                                                  const ExecutionEngine& candidate, DiffFuzzCase& fuzzCase,
+                                                  DiffFuzzDivergence& divergence);
+
+    // Runs caseCount cases of stepCount steps each over the pool, every divergence found gets minimized.
+    // The cases only depend on the seed, not on the number of workers.
+    CHIP8EMU_EMU_API void run_diff_fuzzer(ThreadPool& pool, const EmuConfig& config, const ExecutionEngine& reference,
+                                          const ExecutionEngine& candidate, u64 seed, u32 caseCount, u32 stepCount,
+                                          DiffFuzzReport& report);
+
+    // Writes a doctest TEST_CASE replaying the case, meant to be appended to
+    // src/chip8/test/difffuzz_regressions.inc
+    CHIP8EMU_EMU_API void write_diff_fuzz_regression(std::ostream& output, const DiffFuzzFinding& finding,
+                                                     const ExecutionEngine& reference,
+                                                     const ExecutionEngine& candidate);
+}
@@ -7,7 +7,9 @@
 
 #include "Display.h"
 
+#include "Config.h"
 #include "Cpu.h"
+#include "StateHash.h"
 
 #include "core/Assert.h"
 
@@ -38,6 +40,53 @@ namespace chip8
         const u8 mask = static_cast<u8>(1 << screenOffsetBit);
         const u8 screenByteValue = state.screen[y][screenOffsetByte];
 
+        // Toggling a pixel toggles its key.
+        if (((screenByteValue >> screenOffsetBit) & 0x1) != value)
+            state.screenHash ^= get_screen_hash_key(x, y);
+
         state.screen[y][screenOffsetByte] = static_cast<u8>(screenByteValue & ~mask) | static_cast<u8>(value << screenOffsetBit);
     }
+
+    void fill_image_buffer(u8* imageOutput, const CPUState& state, const Palette& palette, unsigned int scale)
+    {
+        static constexpr u32 pixelFormatBGRASizeInBytes = 4;
+
+        const u8 primaryColorBGRA[4] = {
+            static_cast<u8>(palette.primary.b * 255.f),
+            static_cast<u8>(palette.primary.g * 255.f),
+            static_cast<u8>(palette.primary.r * 255.f),
+            255
+        };
+        const u8 secondaryColorBGRA[4] = {
+            static_cast<u8>(palette.secondary.b * 255.f),
+            static_cast<u8>(palette.secondary.g * 255.f),
+            static_cast<u8>(palette.secondary.r * 255.f),
+            255
+        };
+
+        for (unsigned int j = 0; j < ScreenHeight * scale; j++)
+        {
+            for (unsigned int i = 0; i < ScreenWidth * scale; i++)
+            {
+                const unsigned int pixelIndexFlatDst = j * ScreenWidth * scale + i;
+                const unsigned int pixelOutputOffsetInBytes = pixelIndexFlatDst * pixelFormatBGRASizeInBytes;
+                const u8 pixelValue = read_screen_pixel(state, i / scale, j / scale);
+
+                if (pixelValue)
+                {
+                    imageOutput[pixelOutputOffsetInBytes + 0] = primaryColorBGRA[0];
+                    imageOutput[pixelOutputOffsetInBytes + 1] = primaryColorBGRA[1];
+                    imageOutput[pixelOutputOffsetInBytes + 2] = primaryColorBGRA[2];
+                    imageOutput[pixelOutputOffsetInBytes + 3] = primaryColorBGRA[3];
+                }
+                else
+                {
+                    imageOutput[pixelOutputOffsetInBytes + 0] = secondaryColorBGRA[0];
+                    imageOutput[pixelOutputOffsetInBytes + 1] = secondaryColorBGRA[1];
+                    imageOutput[pixelOutputOffsetInBytes + 2] = secondaryColorBGRA[2];
+                    imageOutput[pixelOutputOffsetInBytes + 3] = secondaryColorBGRA[3];
+                }
+            }
+        }
+    }
 }
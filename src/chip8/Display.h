@@ -18,5 +18,9 @@ namespace chip8
     struct Palette;
 
     CHIP8EMU_EMU_API u8 read_screen_pixel(const CPUState& state, u32 x, u32 y);
-    void write_screen_pixel(CPUState& state, u32 x, u32 y, u8 value);
+    CHIP8EMU_EMU_API void write_screen_pixel(CPUState& state, u32 x, u32 y, u8 value);
+
+    // Converts the screen to a BGRA8 image magnified by scale, ready to be uploaded as a texture.
+    // The output must hold ScreenWidth * ScreenHeight * scale * scale * 4 bytes.
+    CHIP8EMU_EMU_API void fill_image_buffer(u8* imageOutput, const CPUState& state, const Palette& palette, unsigned int scale);
 }
@@ -7,8 +7,18 @@
 
 #include "Execution.h"
 
-#include "Instruction.h"
+#include "Coverage.h"
+#include "Instruction.inl"
+#include "InstructionTrace.h"
+#include "Keyboard.h"
 #include "Memory.h"
+#include "Opcode.h"
+#include "OpcodeStats.h"
+#include "Profiler.h"
+#include "Quirks.h"
+#include "Recompiler.h"
+#include "Trace.h"
+#include "Verifier.h"
 
 #include "core/Assert.h"
 
@@ -18,332 +28,602 @@
 
 namespace chip8
 {
-    void load_program(CPUState& state, const u8* program, u16 size)
-    {
-        Assert((size & 0x0001) == 0); // Unaligned size
-        Assert(is_valid_memory_range(MinProgramAddress, size, MemoryUsage::Write));
-
-        std::memcpy(&state.memory[MinProgramAddress], program, size);
-    }
-
-    u16 load_next_instruction(CPUState& state)
-    {
-        const u8* instructionPtr = &(state.memory[state.pc]);
-
-        return load_u16_big_endian(instructionPtr);
-    }
-
-    void execute_step(const EmuConfig& config, CPUState& state, unsigned int deltaTimeMs)
+    namespace
     {
-        uint instructionsToExecute = 0;
-        update_timers(state, instructionsToExecute, deltaTimeMs);
-
-        for (uint i = 0; i < instructionsToExecute; i++)
+        static const u16 UncheckedAddressMask = MemorySizeInBytes - 1;
+
+        template <ExecutionPolicy Policy>
+        u16 fetch_instruction(CPUState& state)
+        {
+            if (Policy == ExecutionPolicy::Checked)
+                return load_next_instruction(state);
+
+            // Aligned, so that the instruction never straddles two pages.
+            state.pc = static_cast<u16>(state.pc & UncheckedAddressMask & ~0x0001);
+
+            const u8* instructionPtr = get_memory_pointer(state, state.pc);
+
+            return static_cast<u16>((instructionPtr[0] << 8) | instructionPtr[1]);
+        }
+
+        template <u32 QuirkFlags, ExecutionPolicy Policy>
+        void execute_specialized_instruction(CPUState& state, u16 instruction)
+        {
+            CHIP8EMU_OPCODE_STATS_SCOPE(instruction);
+
+            // Save PC for later
+            const u16 pcSave = state.pc;
+
+            // Decode and execute
+            switch (get_opcode_class(instruction))
+            {
+                case OpcodeClass::Cls:
+                    // 00E0 - CLS
+                    execute_cls<Policy>(state);
+                    break;
+                case OpcodeClass::Ret:
+                    // 00EE - RET
+                    execute_ret<Policy>(state);
+                    break;
+                case OpcodeClass::Sys:
+                {
+                    // 0nnn - SYS addr
+                    const u16 address = instruction & 0x0FFF;
+
+                    execute_sys<Policy>(state, address);
+                    break;
+                }
+                case OpcodeClass::Jp:
+                {
+                    // 1nnn - JP addr
+                    const u16 address = instruction & 0x0FFF;
+
+                    execute_jp<Policy>(state, address);
+                    break;
+                }
+                case OpcodeClass::Call:
+                {
+                    // 2nnn - CALL addr
+                    const u16 address = instruction & 0x0FFF;
+
+                    execute_call<Policy>(state, address);
+                    break;
+                }
+                case OpcodeClass::SeImm:
+                {
+                    // 3xkk - SE Vx, byte
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 value = static_cast<u8>(instruction & 0x00FF);
+
+                    execute_se<Policy>(state, registerName, value);
+                    break;
+                }
+                case OpcodeClass::SneImm:
+                {
+                    // 4xkk - SNE Vx, byte
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 value = static_cast<u8>(instruction & 0x00FF);
+
+                    execute_sne<Policy>(state, registerName, value);
+                    break;
+                }
+                case OpcodeClass::SeReg:
+                {
+                    // 5xy0 - SE Vx, Vy
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    execute_se2<Policy>(state, registerLHS, registerRHS);
+                    break;
+                }
+                case OpcodeClass::LdImm:
+                {
+                    // 6xkk - LD Vx, byte
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 value = static_cast<u8>(instruction & 0x00FF);
+
+                    execute_ld<Policy>(state, registerName, value);
+                    break;
+                }
+                case OpcodeClass::AddImm:
+                {
+                    // 7xkk - ADD Vx, byte
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 value = static_cast<u8>(instruction & 0x00FF);
+
+                    execute_add<Policy>(state, registerName, value);
+                    break;
+                }
+                case OpcodeClass::LdReg:
+                {
+                    // 8xy0 - LD Vx, Vy
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    execute_ld2<Policy>(state, registerLHS, registerRHS);
+                    break;
+                }
+                case OpcodeClass::Or:
+                {
+                    // 8xy1 - OR Vx, Vy
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    execute_or<Policy>(state, registerLHS, registerRHS);
+
+                    if (QuirkFlags & QuirkLogicResetVF)
+                        state.vRegisters[VF] = 0;
+
+                    break;
+                }
+                case OpcodeClass::And:
+                {
+                    // 8xy2 - AND Vx, Vy
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    execute_and<Policy>(state, registerLHS, registerRHS);
+
+                    if (QuirkFlags & QuirkLogicResetVF)
+                        state.vRegisters[VF] = 0;
+
+                    break;
+                }
+                case OpcodeClass::Xor:
+                {
+                    // 8xy3 - XOR Vx, Vy
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    execute_xor<Policy>(state, registerLHS, registerRHS);
+
+                    if (QuirkFlags & QuirkLogicResetVF)
+                        state.vRegisters[VF] = 0;
+
+                    break;
+                }
+                case OpcodeClass::AddReg:
+                {
+                    // 8xy4 - ADD Vx, Vy
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    execute_add2<Policy>(state, registerLHS, registerRHS);
+                    break;
+                }
+                case OpcodeClass::Sub:
+                {
+                    // 8xy5 - SUB Vx, Vy
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    execute_sub<Policy>(state, registerLHS, registerRHS);
+                    break;
+                }
+                case OpcodeClass::Shr:
+                {
+                    // 8xy6 - SHR Vx {, Vy}
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    if (QuirkFlags & QuirkShiftVy)
+                        execute_ld2<Policy>(state, registerLHS, registerRHS);
+
+                    execute_shr1<Policy>(state, registerLHS, registerRHS);
+                    break;
+                }
+                case OpcodeClass::Subn:
+                {
+                    // 8xy7 - SUBN Vx, Vy
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    execute_subn<Policy>(state, registerLHS, registerRHS);
+                    break;
+                }
+                case OpcodeClass::Shl:
+                {
+                    // 8xyE - SHL Vx {, Vy}
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    if (QuirkFlags & QuirkShiftVy)
+                        execute_ld2<Policy>(state, registerLHS, registerRHS);
+
+                    execute_shl1<Policy>(state, registerLHS, registerRHS);
+                    break;
+                }
+                case OpcodeClass::SneReg:
+                {
+                    // 9xy0 - SNE Vx, Vy
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+
+                    execute_sne2<Policy>(state, registerLHS, registerRHS);
+                    break;
+                }
+                case OpcodeClass::LdI:
+                {
+                    // Annn - LD I, addr
+                    const u16 address = instruction & 0x0FFF;
+
+                    execute_ldi<Policy>(state, address);
+                    break;
+                }
+                case OpcodeClass::JpV0:
+                {
+                    // Bnnn - JP V0, addr
+                    const u16 address = instruction & 0x0FFF;
+
+                    if (QuirkFlags & QuirkJumpVx)
+                        execute_jp2_vx<Policy>(state, address);
+                    else
+                        execute_jp2<Policy>(state, address);
+
+                    break;
+                }
+                case OpcodeClass::Rnd:
+                {
+                    // Cxkk - RND Vx, byte
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 value = static_cast<u8>(instruction & 0x00FF);
+
+                    execute_rnd<Policy>(state, registerName, value);
+                    break;
+                }
+                case OpcodeClass::Drw:
+                {
+                    // Dxyn - DRW Vx, Vy, nibble
+                    const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
+                    const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+                    const u8 size = static_cast<u8>(instruction & 0x000F);
+
+                    if (QuirkFlags & QuirkSpriteClip)
+                        execute_drw_clip<Policy>(state, registerLHS, registerRHS, size);
+                    else
+                        execute_drw<Policy>(state, registerLHS, registerRHS, size);
+
+                    break;
+                }
+                case OpcodeClass::Skp:
+                {
+                    // Ex9E - SKP Vx
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_skp<Policy>(state, registerName);
+                    break;
+                }
+                case OpcodeClass::Sknp:
+                {
+                    // ExA1 - SKNP Vx
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_sknp<Policy>(state, registerName);
+                    break;
+                }
+                case OpcodeClass::LdVxDt:
+                {
+                    // Fx07 - LD Vx, DT
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_ldt<Policy>(state, registerName);
+                    break;
+                }
+                case OpcodeClass::LdVxK:
+                {
+                    // Fx0A - LD Vx, K
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_ldk<Policy>(state, registerName);
+                    break;
+                }
+                case OpcodeClass::LdDtVx:
+                {
+                    // Fx15 - LD DT, Vx
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_lddt<Policy>(state, registerName);
+                    break;
+                }
+                case OpcodeClass::LdStVx:
+                {
+                    // Fx18 - LD ST, Vx
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_ldst<Policy>(state, registerName);
+                    break;
+                }
+                case OpcodeClass::AddI:
+                {
+                    // Fx1E - ADD I, Vx
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_addi<Policy>(state, registerName);
+                    break;
+                }
+                case OpcodeClass::LdF:
+                {
+                    // Fx29 - LD F, Vx
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_ldf<Policy>(state, registerName);
+                    break;
+                }
+                case OpcodeClass::LdB:
+                {
+                    // Fx33 - LD B, Vx
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_ldb<Policy>(state, registerName);
+                    break;
+                }
+                case OpcodeClass::LdIVx:
+                {
+                    // Fx55 - LD [I], Vx
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_ldai<Policy>(state, registerName);
+
+                    if (QuirkFlags & QuirkLoadStoreIncrementI)
+                        state.i = static_cast<u16>(state.i + registerName + 1);
+
+                    break;
+                }
+                case OpcodeClass::LdVxI:
+                {
+                    // Fx65 - LD Vx, [I]
+                    const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+
+                    execute_ldm<Policy>(state, registerName);
+
+                    if (QuirkFlags & QuirkLoadStoreIncrementI)
+                        state.i = static_cast<u16>(state.i + registerName + 1);
+
+                    break;
+                }
+                case OpcodeClass::Invalid:
+                case OpcodeClass::Count:
+                    if (Policy == ExecutionPolicy::Checked)
+                        Assert(false); // Unknown instruction
+                    break;
+            }
+
+            // Increment PC only if it was NOT overriden by an instruction,
+            // or if we are waiting for user input.
+            if (pcSave == state.pc && !state.isWaitingForKey)
+                state.pc += 2;
+
+            // Unchecked jumps and skips can leave the pc anywhere.
+            if (Policy == ExecutionPolicy::Unchecked)
+                state.pc = static_cast<u16>(state.pc & UncheckedAddressMask);
+
+            // Save previous key state
+            state.keyStatePrev = state.keyState;
+        }
+
+        // Hooks only exist in the instrumented instantiations, plain runs don't test them per instruction.
+        template <u32 QuirkFlags, ExecutionPolicy Policy, bool IsInstrumented>
+        void execute_next_instruction(const EmuConfig& config, CPUState& state)
         {
             // Simulate logic
-            u16 nextInstruction = load_next_instruction(state);
-            execute_instruction(config, state, nextInstruction);
-        }
-    }
+            const u16 nextInstruction = fetch_instruction<Policy>(state);
+            const u16 pc = state.pc;
+            const u8 sp = state.sp;
 
-    void update_timers(CPUState& state, unsigned int& executionCounter, unsigned int deltaTimeMs)
-    {
-        // Update delay timer
-        state.delayTimerAccumulator += deltaTimeMs;
+            execute_specialized_instruction<QuirkFlags, Policy>(state, nextInstruction);
 
-        const uint delayTimerDecrement = state.delayTimerAccumulator / DelayTimerPeriodMs;
-        state.delayTimer = std::max(0, static_cast<int>(state.delayTimer) - static_cast<int>(delayTimerDecrement));
+            state.instructionCount++;
 
-        // Remove accumulated ticks
-        state.delayTimerAccumulator = state.delayTimerAccumulator % DelayTimerPeriodMs;
+            if (IsInstrumented)
+            {
+                if (config.profiler)
+                    profile_instruction(*config.profiler, state, pc, sp);
 
-        // Update execution counter
-        state.executionTimerAccumulator += deltaTimeMs;
-
-        executionCounter = state.executionTimerAccumulator / InstructionExecutionPeriodMs;
-        state.executionTimerAccumulator = state.executionTimerAccumulator % InstructionExecutionPeriodMs;
+                if (config.instructionTrace)
+                    record_instruction(*config.instructionTrace, state, pc, nextInstruction);
 
-        // TODO Handle sound
-        if (state.soundTimer > 0)
-            state.soundTimer--;
-    }
-
-    void execute_instruction(const EmuConfig& config, CPUState& state, u16 instruction)
-    {
-        // Save PC for later
-        const u16 pcSave = state.pc;
+                if (config.coverage)
+                    record_code_coverage(*config.coverage, pc, state.pc);
+            }
+        }
 
-        // Decode and execute
-        if (instruction == 0x00E0)
+        // With a verification, instructions proven safe run unchecked and the others checked.
+        template <u32 QuirkFlags, ExecutionPolicy Policy, bool IsVerified, bool IsInstrumented>
+        void execute_specialized_instructions(const EmuConfig& config, CPUState& state, uint instructionCount)
         {
-            // 00E0 - CLS
-            execute_cls(state);
+            static_assert(!IsVerified || Policy == ExecutionPolicy::Checked, "only checked runs are verified");
+
+            for (uint i = 0; i < instructionCount; i++)
+            {
+                if (IsVerified && is_verified_instruction(*config.verification, state.pc))
+                    execute_next_instruction<QuirkFlags, ExecutionPolicy::Unchecked, IsInstrumented>(config, state);
+                else
+                    execute_next_instruction<QuirkFlags, Policy, IsInstrumented>(config, state);
+            }
         }
-        else if (instruction == 0x00EE)
+
+        template <u32 QuirkFlags, bool IsInstrumented>
+        void execute_instrumented_instructions(const EmuConfig& config, CPUState& state, uint instructionCount)
         {
-            // 00EE - RET
-            execute_ret(state);
+            if (config.executionPolicy == ExecutionPolicy::Unchecked)
+                execute_specialized_instructions<QuirkFlags, ExecutionPolicy::Unchecked, false, IsInstrumented>(
+                    config, state, instructionCount);
+            else if (config.verification != nullptr && get_quirk_flags(config.verification->quirkProfile) == QuirkFlags)
+                execute_specialized_instructions<QuirkFlags, ExecutionPolicy::Checked, true, IsInstrumented>(
+                    config, state, instructionCount);
+            else
+                execute_specialized_instructions<QuirkFlags, ExecutionPolicy::Checked, false, IsInstrumented>(
+                    config, state, instructionCount);
         }
-        else if ((instruction & ~0x0FFF) == 0x0000)
-        {
-            // 0nnn - SYS addr
-            const u16 address = instruction & 0x0FFF;
 
-            execute_sys(state, address);
-        }
-        else if ((instruction & ~0x0FFF) == 0x1000)
+        // The policy is picked with the profile, each pair gets its own instantiation.
+        // Hooks are picked the same way, once per step.
+        template <u32 QuirkFlags>
+        void execute_instructions(const EmuConfig& config, CPUState& state, uint instructionCount)
         {
-            // 1nnn - JP addr
-            const u16 address = instruction & 0x0FFF;
-
-            execute_jp(state, address);
+            if (config.profiler || config.instructionTrace || config.coverage)
+                execute_instrumented_instructions<QuirkFlags, true>(config, state, instructionCount);
+            else
+                execute_instrumented_instructions<QuirkFlags, false>(config, state, instructionCount);
         }
-        else if ((instruction & ~0x0FFF) == 0x2000)
-        {
-            // 2nnn - CALL addr
-            const u16 address = instruction & 0x0FFF;
 
-            execute_call(state, address);
-        }
-        else if ((instruction & ~0x0FFF) == 0x3000)
+        template <u32 QuirkFlags>
+        void execute_instruction_with_quirks(const EmuConfig& config, CPUState& state, u16 instruction)
         {
-            // 3xkk - SE Vx, byte
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 value = static_cast<u8>(instruction & 0x00FF);
-
-            execute_se(state, registerName, value);
+            if (config.executionPolicy == ExecutionPolicy::Unchecked)
+                execute_specialized_instruction<QuirkFlags, ExecutionPolicy::Unchecked>(state, instruction);
+            else
+                execute_specialized_instruction<QuirkFlags, ExecutionPolicy::Checked>(state, instruction);
         }
-        else if ((instruction & ~0x0FFF) == 0x4000)
-        {
-            // 4xkk - SNE Vx, byte
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 value = static_cast<u8>(instruction & 0x00FF);
+    }
 
-            execute_sne(state, registerName, value);
-        }
-        else if ((instruction & ~0x0FF0) == 0x5000)
-        {
-            // 5xy0 - SE Vx, Vy
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+    void load_program(CPUState& state, const u8* program, u16 size)
+    {
+        Assert((size & 0x0001) == 0); // Unaligned size
+        Assert(is_valid_memory_range(MinProgramAddress, size, MemoryUsage::Write));
 
-            execute_se2(state, registerLHS, registerRHS);
-        }
-        else if ((instruction & ~0x0FFF) == 0x6000)
-        {
-            // 6xkk - LD Vx, byte
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 value = static_cast<u8>(instruction & 0x00FF);
+        write_memory_range(state, MinProgramAddress, program, size);
+    }
 
-            execute_ld(state, registerName, value);
-        }
-        else if ((instruction & ~0x0FFF) == 0x7000)
-        {
-            // 7xkk - ADD Vx, byte
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 value = static_cast<u8>(instruction & 0x00FF);
+    u16 load_next_instruction(CPUState& state)
+    {
+        // Instructions are aligned so they never straddle two pages.
+        // The pc can still run past the end of memory.
+        const bool isValidPC = (state.pc & 0x0001) == 0 && state.pc < MaxProgramAddress;
+        Assert(isValidPC);
 
-            execute_add(state, registerName, value);
-        }
-        else if ((instruction & ~0x0FF0) == 0x8000)
-        {
-            // 8xy0 - LD Vx, Vy
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+        // SYS is ignored, the pc keeps going until it wraps around.
+        if (!isValidPC)
+            return 0x0000;
 
-            execute_ld2(state, registerLHS, registerRHS);
-        }
-        else if ((instruction & ~0x0FF0) == 0x8001)
-        {
-            // 8xy1 - OR Vx, Vy
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+        const u8* instructionPtr = get_memory_pointer(state, state.pc);
 
-            execute_or(state, registerLHS, registerRHS);
-        }
-        else if ((instruction & ~0x0FF0) == 0x8002)
-        {
-            // 8xy2 - AND Vx, Vy
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+        return load_u16_big_endian(instructionPtr);
+    }
 
-            execute_and(state, registerLHS, registerRHS);
-        }
-        else if ((instruction & ~0x0FF0) == 0x8003)
-        {
-            // 8xy3 - XOR Vx, Vy
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+    void execute_step(const EmuConfig& config, CPUState& state, unsigned int deltaTimeMs)
+    {
+        CHIP8EMU_TRACE_SCOPE("execute_step");
 
-            execute_xor(state, registerLHS, registerRHS);
-        }
-        else if ((instruction & ~0x0FF0) == 0x8004)
-        {
-            // 8xy4 - ADD Vx, Vy
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+        // A verification only holds for the profile it was made for.
+        Assert(config.verification == nullptr || config.verification->quirkProfile == config.quirkProfile);
 
-            execute_add2(state, registerLHS, registerRHS);
-        }
-        else if ((instruction & ~0x0FF0) == 0x8005)
-        {
-            // 8xy5 - SUB Vx, Vy
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+        uint instructionsToExecute = 0;
+        update_timers(state, instructionsToExecute, deltaTimeMs);
 
-            execute_sub(state, registerLHS, registerRHS);
-        }
-        else if ((instruction & ~0x0FF0) == 0x8006)
+        // Generated code runs like the checked interpreter, but has nowhere to report instructions to.
+        if (config.recompiledRom != nullptr && config.executionPolicy == ExecutionPolicy::Checked
+            && config.profiler == nullptr && config.instructionTrace == nullptr && config.coverage == nullptr)
         {
-            // 8xy6 - SHR Vx {, Vy}
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+            Assert(config.recompiledRom->quirkProfile == config.quirkProfile); // Generated for another profile
 
-            execute_shr1(state, registerLHS, registerRHS);
+            config.recompiledRom->run(config, state, instructionsToExecute);
+            return;
         }
-        else if ((instruction & ~0x0FF0) == 0x8007)
-        {
-            // 8xy7 - SUBN Vx, Vy
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
 
-            execute_subn(state, registerLHS, registerRHS);
-        }
-        else if ((instruction & ~0x0FF0) == 0x800E)
+        // Dispatch once per step, each profile and policy runs its own instantiation of the loop.
+        switch (config.quirkProfile)
         {
-            // 8xyE - SHL Vx {, Vy}
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
-
-            execute_shl1(state, registerLHS, registerRHS);
+            case QuirkProfile::Default:
+                execute_instructions<get_quirk_flags(QuirkProfile::Default)>(config, state, instructionsToExecute);
+                break;
+            case QuirkProfile::Cosmac:
+                execute_instructions<get_quirk_flags(QuirkProfile::Cosmac)>(config, state, instructionsToExecute);
+                break;
+            case QuirkProfile::SuperChip:
+                execute_instructions<get_quirk_flags(QuirkProfile::SuperChip)>(config, state, instructionsToExecute);
+                break;
+            case QuirkProfile::XOChip:
+                execute_instructions<get_quirk_flags(QuirkProfile::XOChip)>(config, state, instructionsToExecute);
+                break;
+            case QuirkProfile::Count:
+                AssertUnreachable();
+                break;
         }
-        else if ((instruction & ~0x0FF0) == 0x9000)
-        {
-            // 9xy0 - SNE Vx, Vy
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
+    }
 
-            execute_sne2(state, registerLHS, registerRHS);
-        }
-        else if ((instruction & ~0x0FFF) == 0xA000)
-        {
-            // Annn - LD I, addr
-            const u16 address = instruction & 0x0FFF;
+    void execute_frames(const EmuConfig& config, CPUState& state, u16 keyState, u32 frameCount,
+                        unsigned int frameTimeMs, ScreenPooling pooling, u8* screenOutput)
+    {
+        static const u32 ScreenSizeInBytes = ScreenHeight * ScreenLineSizeInBytes;
 
-            execute_ldi(state, address);
-        }
-        else if ((instruction & ~0x0FFF) == 0xB000)
-        {
-            // Bnnn - JP V0, addr
-            const u16 address = instruction & 0x0FFF;
+        Assert(frameCount > 0);
+        Assert(screenOutput != nullptr);
 
-            execute_jp2(state, address);
-        }
-        else if ((instruction & ~0x0FFF) == 0xC000)
-        {
-            // Cxkk - RND Vx, byte
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 value = static_cast<u8>(instruction & 0x00FF);
+        set_key_state(state, keyState);
 
-            execute_rnd(state, registerName, value);
-        }
-        else if ((instruction & ~0x0FFF) == 0xD000)
+        if (pooling == ScreenPooling::LastFrame)
         {
-            // Dxyn - DRW Vx, Vy, nibble
-            const u8 registerLHS = static_cast<u8>((instruction & 0x0F00) >> 8);
-            const u8 registerRHS = static_cast<u8>((instruction & 0x00F0) >> 4);
-            const u8 size = static_cast<u8>(instruction & 0x000F);
+            for (u32 frameIndex = 0; frameIndex < frameCount; frameIndex++)
+                execute_step(config, state, frameTimeMs);
 
-            execute_drw(state, registerLHS, registerRHS, size);
+            std::memcpy(screenOutput, state.screen, ScreenSizeInBytes);
+            return;
         }
-        else if ((instruction & ~0x0F00) == 0xE09E)
-        {
-            // Ex9E - SKP Vx
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
 
-            execute_skp(state, registerName);
-        }
-        else if ((instruction & ~0x0F00) == 0xE0A1)
-        {
-            // ExA1 - SKNP Vx
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+        Assert(pooling == ScreenPooling::Or);
 
-            execute_sknp(state, registerName);
-        }
-        else if ((instruction & ~0x0F00) == 0xF007)
-        {
-            // Fx07 - LD Vx, DT
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+        // Pool in registers, 64 pixels at a time.
+        static const u32 ScreenSizeInWords = ScreenSizeInBytes / sizeof(u64);
+        static_assert(ScreenSizeInBytes % sizeof(u64) == 0, "screen must be made of whole words");
 
-            execute_ldt(state, registerName);
-        }
-        else if ((instruction & ~0x0F00) == 0xF00A)
-        {
-            // Fx0A - LD Vx, K
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+        u64 pooledScreen[ScreenSizeInWords] = {};
 
-            execute_ldk(state, registerName);
-        }
-        else if ((instruction & ~0x0F00) == 0xF015)
+        for (u32 frameIndex = 0; frameIndex < frameCount; frameIndex++)
         {
-            // Fx15 - LD DT, Vx
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+            execute_step(config, state, frameTimeMs);
 
-            execute_lddt(state, registerName);
-        }
-        else if ((instruction & ~0x0F00) == 0xF018)
-        {
-            // Fx18 - LD ST, Vx
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+            u64 screen[ScreenSizeInWords];
+            std::memcpy(screen, state.screen, ScreenSizeInBytes);
 
-            execute_ldst(state, registerName);
+            for (u32 wordIndex = 0; wordIndex < ScreenSizeInWords; wordIndex++)
+                pooledScreen[wordIndex] |= screen[wordIndex];
         }
-        else if ((instruction & ~0x0F00) == 0xF01E)
-        {
-            // Fx1E - ADD I, Vx
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
 
-            execute_addi(state, registerName);
-        }
-        else if ((instruction & ~0x0F00) == 0xF029)
-        {
-            // Fx29 - LD F, Vx
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+        std::memcpy(screenOutput, pooledScreen, ScreenSizeInBytes);
+    }
 
-            execute_ldf(state, registerName);
-        }
-        else if ((instruction & ~0x0F00) == 0xF033)
-        {
-            // Fx33 - LD B, Vx
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+    void update_timers(CPUState& state, unsigned int& executionCounter, unsigned int deltaTimeMs)
+    {
+        // Update delay timer
+        state.delayTimerAccumulator += deltaTimeMs;
 
-            execute_ldb(state, registerName);
-        }
-        else if ((instruction & ~0x0F00) == 0xF055)
-        {
-            // Fx55 - LD [I], Vx
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+        const uint delayTimerDecrement = state.delayTimerAccumulator / DelayTimerPeriodMs;
+        state.delayTimer = std::max(0, static_cast<int>(state.delayTimer) - static_cast<int>(delayTimerDecrement));
 
-            execute_ldai(state, registerName);
-        }
-        else if ((instruction & ~0x0F00) == 0xF065)
-        {
-            // Fx65 - LD Vx, [I]
-            const u8 registerName = static_cast<u8>((instruction & 0x0F00) >> 8);
+        // Remove accumulated ticks
+        state.delayTimerAccumulator = state.delayTimerAccumulator % DelayTimerPeriodMs;
 
-            execute_ldm(state, registerName);
-        }
-        else
-        {
-            Assert(false); // Unknown instruction
-        }
+        // Update execution counter
+        state.executionTimerAccumulator += deltaTimeMs;
 
-        // Increment PC only if it was NOT overriden by an instruction,
-        // or if we are waiting for user input.
-        if (pcSave == state.pc && !state.isWaitingForKey)
-            state.pc += 2;
+        executionCounter = state.executionTimerAccumulator / InstructionExecutionPeriodMs;
+        state.executionTimerAccumulator = state.executionTimerAccumulator % InstructionExecutionPeriodMs;
 
-        // Save previous key state
-        state.keyStatePrev = state.keyState;
+        // TODO Handle sound
+        if (state.soundTimer > 0)
+            state.soundTimer--;
+    }
+
+    void execute_instruction(const EmuConfig& config, CPUState& state, u16 instruction)
+    {
+        switch (config.quirkProfile)
+        {
+            case QuirkProfile::Default:
+                execute_instruction_with_quirks<get_quirk_flags(QuirkProfile::Default)>(config, state, instruction);
+                break;
+            case QuirkProfile::Cosmac:
+                execute_instruction_with_quirks<get_quirk_flags(QuirkProfile::Cosmac)>(config, state, instruction);
+                break;
+            case QuirkProfile::SuperChip:
+                execute_instruction_with_quirks<get_quirk_flags(QuirkProfile::SuperChip)>(config, state, instruction);
+                break;
+            case QuirkProfile::XOChip:
+                execute_instruction_with_quirks<get_quirk_flags(QuirkProfile::XOChip)>(config, state, instruction);
+                break;
+            case QuirkProfile::Count:
+                AssertUnreachable();
+                break;
+        }
     }
 }
@@ -14,10 +14,23 @@
 namespace chip8
 {
     CHIP8EMU_EMU_API void load_program(CPUState& state, const u8* program, u16 size);
-    u16 load_next_instruction(CPUState& state);
+    CHIP8EMU_EMU_API u16 load_next_instruction(CPUState& state);
 
     CHIP8EMU_EMU_API void execute_step(const EmuConfig& config, CPUState& state, unsigned int deltaTimeMs);
 
+    // How the screens of the frames run by execute_frames() get combined.
+    enum class ScreenPooling
+    {
+        LastFrame, // Only the final screen
+        Or // Every pixel lit during any of the frames, hides sprite flicker
+    };
+
+    // Holds the key state for frameCount frames of frameTimeMs each (action repeat).
+    // Intermediate screens are never copied out, pooling works directly on the packed screen.
+    // The output has the same layout as CPUState::screen.
+    CHIP8EMU_EMU_API void execute_frames(const EmuConfig& config, CPUState& state, u16 keyState, u32 frameCount,
+                                         unsigned int frameTimeMs, ScreenPooling pooling, u8* screenOutput);
+
     void update_timers(CPUState& state, unsigned int& executionCounter, unsigned int deltaTimeMs);
     CHIP8EMU_EMU_API void execute_instruction(const EmuConfig& config, CPUState& state, u16 instruction);
 }
@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ExecutionEngine.h"
+
+#include "Execution.h"
+
+#include "core/Assert.h"
+
+#include <cstring>
+
+namespace chip8
+{
+    namespace
+    {
+        // Valid programs must not notice the missing checks.
+        void execute_instruction_unchecked(const EmuConfig& config, CPUState& state, u16 instruction)
+        {
+            EmuConfig uncheckedConfig = config;
+            uncheckedConfig.executionPolicy = ExecutionPolicy::Unchecked;
+
+            execute_instruction(uncheckedConfig, state, instruction);
+        }
+
+        const ExecutionEngine ExecutionEngines[] = {
+            {"reference", &execute_instruction},
+            {"unchecked", &execute_instruction_unchecked},
+        };
+
+        static const u32 ExecutionEngineCount = sizeof(ExecutionEngines) / sizeof(ExecutionEngines[0]);
+    }
+
+    u32 get_execution_engine_count()
+    {
+        return ExecutionEngineCount;
+    }
+
+    const ExecutionEngine& get_execution_engine(u32 index)
+    {
+        Assert(index < ExecutionEngineCount);
+
+        return ExecutionEngines[index < ExecutionEngineCount ? index : 0];
+    }
+
+    const ExecutionEngine* find_execution_engine(const char* name)
+    {
+        for (const ExecutionEngine& engine : ExecutionEngines)
+        {
+            if (std::strcmp(engine.name, name) == 0)
+                return &engine;
+        }
+
+        return nullptr;
+    }
+}
@@ -0,0 +1,34 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Config.h"
+#include "Cpu.h"
+
+namespace chip8
+{
+    // Same contract as execute_instruction(): runs one already fetched instruction,
+    // then moves the pc past it unless the instruction changed it.
+    using InstructionExecutor = void (*)(const EmuConfig& config, CPUState& state, u16 instruction);
+
+    // Every way of running instructions, so that tools can pick them by name and
+    // the differential fuzzer can check them against the reference.
+    struct ExecutionEngine
+    {
+        const char* name;
+        InstructionExecutor execute;
+    };
+
+    // The reference engine is always the first one.
+    CHIP8EMU_EMU_API u32 get_execution_engine_count();
+    CHIP8EMU_EMU_API const ExecutionEngine& get_execution_engine(u32 index);
+
+    // Returns nullptr if there is no engine with that name.
+    CHIP8EMU_EMU_API const ExecutionEngine* find_execution_engine(const char* name);
+}
@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Expansion.h"
+
+#include "Execution.h"
+#include "StateHash.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include "core/Assert.h"
+
+namespace chip8
+{
+    namespace
+    {
+        struct ExpansionJob
+        {
+            const EmuConfig* config;
+            const u16* actions;
+            u32 actionCount;
+            unsigned int frameTimeMs;
+            CPUState* children;
+            u64* childHashes;
+        };
+
+        void step_child(u32 childIndex, void* userData)
+        {
+            const ExpansionJob& job = *static_cast<const ExpansionJob*>(userData);
+            CPUState& child = job.children[childIndex];
+
+            set_key_state(child, job.actions[childIndex % job.actionCount]);
+            execute_step(*job.config, child, job.frameTimeMs);
+
+            job.childHashes[childIndex] = get_state_hash(child);
+        }
+    }
+
+    void expand_states(ThreadPool* pool, const EmuConfig& config, const CPUState* parents, u32 parentCount,
+                       const u16* actions, u32 actionCount, unsigned int frameTimeMs,
+                       CPUState* children, u64* childHashes)
+    {
+        CHIP8EMU_TRACE_SCOPE("expand_states");
+
+        Assert(parents != nullptr);
+        Assert(actions != nullptr);
+        Assert(children != nullptr);
+        Assert(childHashes != nullptr);
+
+        const u32 childCount = parentCount * actionCount;
+
+        // Page reference counts are atomic, but forking everything up front keeps the
+        // workers away from the parents entirely.
+        for (u32 childIndex = 0; childIndex < childCount; childIndex++)
+            children[childIndex] = forkCPUState(parents[childIndex / actionCount]);
+
+        ExpansionJob job = {&config, actions, actionCount, frameTimeMs, children, childHashes};
+
+        if (pool)
+            parallel_for(*pool, childCount, &step_child, &job);
+        else
+        {
+            for (u32 childIndex = 0; childIndex < childCount; childIndex++)
+                step_child(childIndex, &job);
+        }
+    }
+}
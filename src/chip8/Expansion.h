@@ -0,0 +1,38 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Config.h"
+#include "Cpu.h"
+#include "Keyboard.h"
+
+namespace chip8
+{
+    struct ThreadPool;
+
+    // The usual action set for tree search: no key, then every key pressed on its own.
+    static const u32 SingleKeyActionCount = KeyIDCount + 1;
+
+    inline u16 get_single_key_action(u32 actionIndex)
+    {
+        return actionIndex == 0 ? 0 : static_cast<u16>(1 << (actionIndex - 1));
+    }
+
+    // Expands every parent into one child per action, each child running one frame with the
+    // action's key mask held. Children are forks, so they share every page they don't write to
+    // with their parent, and have to be destroyed with destroyCPUState().
+    //
+    // Outputs are laid out parent by parent: child (p, a) lands at index p * actionCount + a,
+    // along with its state hash.
+    // Forking happens on the calling thread, the stepping is spread over the thread pool
+    // when one is given. Expand several parents per call to amortize waking the workers up.
+    CHIP8EMU_EMU_API void expand_states(ThreadPool* pool, const EmuConfig& config, const CPUState* parents, u32 parentCount,
+                                        const u16* actions, u32 actionCount, unsigned int frameTimeMs,
+                                        CPUState* children, u64* childHashes);
+}
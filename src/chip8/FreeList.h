@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "core/Types.h"
+
+#include <atomic>
+
+namespace chip8
+{
+    // Lock-free stack of indices (Treiber stack).
+    // The head packs the top index in the low 32 bits and a tag in the high 32 bits.
+    // The tag is bumped on every update so a stale head can never be swapped back in (ABA).
+    // Each element provides its own link to the next free index.
+    static const u32 InvalidFreeListIndex = 0xFFFFFFFF;
+
+    inline u64 pack_free_list_head(u32 tag, u32 index)
+    {
+        return (static_cast<u64>(tag) << 32) | index;
+    }
+
+    inline u32 get_free_list_tag(u64 head)
+    {
+        return static_cast<u32>(head >> 32);
+    }
+
+    inline u32 get_free_list_index(u64 head)
+    {
+        return static_cast<u32>(head & 0xFFFFFFFF);
+    }
+
+    // Returns InvalidFreeListIndex when the list is empty.
+    template <typename GetLinkFunction>
+    u32 pop_free_list(std::atomic<u64>& head, GetLinkFunction getLink)
+    {
+        u64 currentHead = head.load(std::memory_order_acquire);
+
+        while (true)
+        {
+            const u32 index = get_free_list_index(currentHead);
+
+            if (index == InvalidFreeListIndex)
+                return InvalidFreeListIndex;
+
+            const u32 nextIndex = getLink(index).load(std::memory_order_relaxed);
+            const u64 nextHead = pack_free_list_head(get_free_list_tag(currentHead) + 1, nextIndex);
+
+            if (head.compare_exchange_weak(currentHead, nextHead, std::memory_order_acquire, std::memory_order_acquire))
+                return index;
+        }
+    }
+
+    inline void push_free_list(std::atomic<u64>& head, u32 index, std::atomic<u32>& link)
+    {
+        u64 currentHead = head.load(std::memory_order_relaxed);
+
+        do
+        {
+            link.store(get_free_list_index(currentHead), std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(currentHead, pack_free_list_head(get_free_list_tag(currentHead) + 1, index),
+                                             std::memory_order_release, std::memory_order_relaxed));
+    }
+}
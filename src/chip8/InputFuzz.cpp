@@ -0,0 +1,380 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "InputFuzz.h"
+
+#include "Execution.h"
+#include "Keyboard.h"
+#include "Memory.h"
+#include "Opcode.h"
+
+#include "core/Assert.h"
+
+#include <algorithm>
+#include <bitset>
+
+namespace chip8
+{
+    namespace
+    {
+        static const u32 EdgeMapWordCount = InputFuzzEdgeMapSizeInBits / 64;
+
+        static const u32 MaxMutationCount = 4;
+        static const u32 MaxMutationLengthInFrames = 64;
+
+        struct AssertCapture
+        {
+            bool hasFailed;
+            const char* file;
+            int line;
+        };
+
+        void capture_assert(const char* file, const char* /*func*/, int line, const std::string& /*message*/,
+                            void* userData)
+        {
+            AssertCapture& capture = *static_cast<AssertCapture*>(userData);
+
+            // The first one is the cause, the others are fallout.
+            if (capture.hasFailed)
+                return;
+
+            capture.hasFailed = true;
+            capture.file = file;
+            capture.line = line;
+        }
+
+        // pc and sp are the values before the instruction ran.
+        InputFuzzFailureKind classify_failure(bool isFetch, u16 pc, u8 sp, u16 instruction)
+        {
+            if (isFetch)
+                return InputFuzzFailureKind::InvalidProgramCounter;
+
+            switch (get_opcode_class(instruction))
+            {
+                case OpcodeClass::Call:
+                    return sp + 1u >= StackSize ? InputFuzzFailureKind::StackOverflow : InputFuzzFailureKind::InvalidJump;
+                case OpcodeClass::Ret:
+                    return sp == 0 ? InputFuzzFailureKind::StackUnderflow : InputFuzzFailureKind::InvalidJump;
+                case OpcodeClass::Jp:
+                case OpcodeClass::JpV0:
+                    return InputFuzzFailureKind::InvalidJump;
+                case OpcodeClass::Drw:
+                case OpcodeClass::LdB:
+                case OpcodeClass::LdIVx:
+                case OpcodeClass::LdVxI:
+                    return InputFuzzFailureKind::InvalidMemoryAccess;
+                case OpcodeClass::SeImm:
+                case OpcodeClass::SneImm:
+                case OpcodeClass::SeReg:
+                case OpcodeClass::SneReg:
+                case OpcodeClass::Skp:
+                case OpcodeClass::Sknp:
+                    return is_valid_memory_range(pc, 6, MemoryUsage::Execute) ? InputFuzzFailureKind::Other
+                                                                             : InputFuzzFailureKind::InvalidProgramCounter;
+                case OpcodeClass::Invalid:
+                    return InputFuzzFailureKind::InvalidOpcode;
+                default:
+                    return InputFuzzFailureKind::Other;
+            }
+        }
+    }
+
+    struct InputFuzzer
+    {
+        InputFuzzConfig config;
+
+        // Power-on state with the program loaded, every run forks it.
+        CPUState rootState;
+
+        std::vector<std::vector<u16>> corpus;
+        std::vector<u64> coverage;
+        std::vector<u64> runCoverage;
+        std::vector<InputFuzzFailure> failures;
+
+        u64 rngState;
+        u64 runCount;
+        u64 instructionCount;
+    };
+
+    namespace
+    {
+        // Same loop as execute_step(), with the edge coverage and a check for Asserts after every instruction.
+        // Returns true if an Assert tripped, the failure is filled in then.
+        bool run_key_schedule(InputFuzzer& fuzzer, const std::vector<u16>& schedule, InputFuzzFailure& failure)
+        {
+            const EmuConfig config = {};
+            const unsigned int frameTimeMs = fuzzer.config.frameTimeMs;
+            u64* runCoverage = fuzzer.runCoverage.data();
+
+            CPUState state = forkCPUState(fuzzer.rootState);
+            AssertCapture capture = {};
+
+            setAssertHandler(&capture_assert, &capture);
+
+            for (u32 frameIndex = 0; frameIndex < schedule.size() && !capture.hasFailed; frameIndex++)
+            {
+                set_key_state(state, schedule[frameIndex]);
+
+                unsigned int instructionsToExecute = 0;
+                update_timers(state, instructionsToExecute, frameTimeMs);
+
+                for (unsigned int i = 0; i < instructionsToExecute; i++)
+                {
+                    const u16 pc = state.pc;
+                    const u8 sp = state.sp;
+                    const u16 instruction = load_next_instruction(state);
+                    const bool isFetchFailure = capture.hasFailed;
+
+                    if (!isFetchFailure)
+                    {
+                        execute_instruction(config, state, instruction);
+                        state.instructionCount++;
+
+                        // Program addresses fit in 12 bits, so the edge is exact for all but the highest ones.
+                        const u32 edge = ((static_cast<u32>(pc) << 4) ^ state.pc) % InputFuzzEdgeMapSizeInBits;
+                        runCoverage[edge / 64] |= u64(1) << (edge % 64);
+                    }
+
+                    if (capture.hasFailed)
+                    {
+                        failure.kind = classify_failure(isFetchFailure, pc, sp, instruction);
+                        failure.pc = pc;
+                        failure.instruction = isFetchFailure ? 0 : instruction;
+                        failure.instructionCount = state.instructionCount;
+                        failure.frameIndex = frameIndex;
+                        failure.file = capture.file;
+                        failure.line = capture.line;
+                        failure.keySchedule.assign(schedule.begin(), schedule.begin() + frameIndex + 1);
+                        break;
+                    }
+                }
+            }
+
+            setAssertHandler(nullptr, nullptr);
+
+            fuzzer.instructionCount += state.instructionCount;
+
+            destroyCPUState(state);
+
+            return capture.hasFailed;
+        }
+
+        void mutate_key_schedule(std::vector<u16>& schedule, const std::vector<std::vector<u16>>& corpus, u64& rngState)
+        {
+            const u32 frameCount = static_cast<u32>(schedule.size());
+            const u32 mutationCount = 1 + static_cast<u32>(next_splitmix64(rngState) % MaxMutationCount);
+
+            for (u32 mutationIndex = 0; mutationIndex < mutationCount; mutationIndex++)
+            {
+                const u32 start = static_cast<u32>(next_splitmix64(rngState) % frameCount);
+                const u32 maxLength = 1 + static_cast<u32>(next_splitmix64(rngState) % MaxMutationLengthInFrames);
+                const u32 length = std::min(maxLength, frameCount - start);
+                const auto rangeBegin = schedule.begin() + start;
+                const auto rangeEnd = rangeBegin + length;
+
+                switch (next_splitmix64(rngState) % 6)
+                {
+                    case 0: // Hold a single key
+                    {
+                        const u16 keyMask = static_cast<u16>(1 << (next_splitmix64(rngState) % KeyIDCount));
+
+                        std::fill(rangeBegin, rangeEnd, keyMask);
+                        break;
+                    }
+                    case 1: // Release everything
+                        std::fill(rangeBegin, rangeEnd, static_cast<u16>(0));
+                        break;
+                    case 2: // Toggle a key on top of the others
+                    {
+                        const u16 keyMask = static_cast<u16>(1 << (next_splitmix64(rngState) % KeyIDCount));
+
+                        for (auto it = rangeBegin; it != rangeEnd; ++it)
+                            *it ^= keyMask;
+                        break;
+                    }
+                    case 3: // Splice in the same frames from another input
+                    {
+                        const std::vector<u16>& other = corpus[next_splitmix64(rngState) % corpus.size()];
+                        std::copy(other.begin() + start, other.begin() + start + length, rangeBegin);
+                        break;
+                    }
+                    case 4: // Delay the rest of the input
+                        schedule.insert(rangeBegin, length, 0);
+                        schedule.resize(frameCount);
+                        break;
+                    case 5: // Bring the rest of the input forward
+                        schedule.erase(rangeBegin, rangeEnd);
+                        schedule.resize(frameCount, 0);
+                        break;
+                }
+            }
+        }
+
+        // Merges the run into the global coverage, returns true if it hit new edges.
+        bool merge_run_coverage(InputFuzzer& fuzzer)
+        {
+            bool hasNewEdges = false;
+
+            for (u32 wordIndex = 0; wordIndex < EdgeMapWordCount; wordIndex++)
+            {
+                const u64 runWord = fuzzer.runCoverage[wordIndex];
+
+                hasNewEdges |= (runWord & ~fuzzer.coverage[wordIndex]) != 0;
+                fuzzer.coverage[wordIndex] |= runWord;
+                fuzzer.runCoverage[wordIndex] = 0;
+            }
+
+            return hasNewEdges;
+        }
+
+        void add_failure(InputFuzzer& fuzzer, const InputFuzzFailure& failure)
+        {
+            for (const InputFuzzFailure& knownFailure : fuzzer.failures)
+            {
+                if (knownFailure.kind == failure.kind && knownFailure.pc == failure.pc)
+                    return;
+            }
+
+            fuzzer.failures.push_back(failure);
+        }
+
+        void run_and_record(InputFuzzer& fuzzer, const std::vector<u16>& schedule)
+        {
+            InputFuzzFailure failure;
+
+            const bool hasFailed = run_key_schedule(fuzzer, schedule, failure);
+
+            if (merge_run_coverage(fuzzer))
+                fuzzer.corpus.push_back(schedule);
+
+            if (hasFailed)
+                add_failure(fuzzer, failure);
+
+            fuzzer.runCount++;
+        }
+    }
+
+    InputFuzzer* createInputFuzzer(const u8* program, u16 programSize, const InputFuzzConfig& config)
+    {
+        Assert(config.frameCount > 0);
+
+        InputFuzzer* fuzzer = new InputFuzzer();
+
+        fuzzer->config = config;
+        fuzzer->coverage.resize(EdgeMapWordCount, 0);
+        fuzzer->runCoverage.resize(EdgeMapWordCount, 0);
+        fuzzer->rngState = config.mutationSeed;
+        fuzzer->runCount = 0;
+        fuzzer->instructionCount = 0;
+
+        fuzzer->rootState = createCPUState();
+        seed_random_generator(fuzzer->rootState, config.randomSeed);
+        load_program(fuzzer->rootState, program, programSize);
+
+        // Doing nothing is the first input.
+        const std::vector<u16> idleSchedule(config.frameCount, 0);
+
+        run_and_record(*fuzzer, idleSchedule);
+
+        if (fuzzer->corpus.empty())
+            fuzzer->corpus.push_back(idleSchedule);
+
+        return fuzzer;
+    }
+
+    void destroyInputFuzzer(InputFuzzer* fuzzer)
+    {
+        Assert(fuzzer != nullptr);
+
+        destroyCPUState(fuzzer->rootState);
+
+        delete fuzzer;
+    }
+
+    const char* get_input_fuzz_failure_kind_name(InputFuzzFailureKind kind)
+    {
+        switch (kind)
+        {
+            case InputFuzzFailureKind::StackOverflow:
+                return "stack_overflow";
+            case InputFuzzFailureKind::StackUnderflow:
+                return "stack_underflow";
+            case InputFuzzFailureKind::InvalidJump:
+                return "invalid_jump";
+            case InputFuzzFailureKind::InvalidMemoryAccess:
+                return "invalid_memory_access";
+            case InputFuzzFailureKind::InvalidProgramCounter:
+                return "invalid_program_counter";
+            case InputFuzzFailureKind::InvalidOpcode:
+                return "invalid_opcode";
+            case InputFuzzFailureKind::Other:
+                return "other";
+        }
+
+        AssertUnreachable();
+        return "unknown";
+    }
+
+    void run_input_fuzzer(InputFuzzer& fuzzer, u32 runCount)
+    {
+        std::vector<u16> schedule;
+
+        for (u32 runIndex = 0; runIndex < runCount; runIndex++)
+        {
+            schedule = fuzzer.corpus[next_splitmix64(fuzzer.rngState) % fuzzer.corpus.size()];
+
+            mutate_key_schedule(schedule, fuzzer.corpus, fuzzer.rngState);
+            run_and_record(fuzzer, schedule);
+        }
+    }
+
+    InputFuzzStats get_input_fuzzer_stats(const InputFuzzer& fuzzer)
+    {
+        InputFuzzStats stats;
+
+        stats.runCount = fuzzer.runCount;
+        stats.instructionCount = fuzzer.instructionCount;
+        stats.corpusSize = static_cast<u32>(fuzzer.corpus.size());
+        stats.coveredEdgeCount = 0;
+
+        for (u64 word : fuzzer.coverage)
+            stats.coveredEdgeCount += static_cast<u32>(std::bitset<64>(word).count());
+
+        return stats;
+    }
+
+    const std::vector<InputFuzzFailure>& get_input_fuzzer_failures(const InputFuzzer& fuzzer)
+    {
+        return fuzzer.failures;
+    }
+
+    bool record_input_fuzz_failure(const InputFuzzer& fuzzer, const InputFuzzFailure& failure, InputLog& log)
+    {
+        const EmuConfig config = {};
+
+        CPUState state = forkCPUState(fuzzer.rootState);
+        AssertCapture capture = {};
+
+        clear_input_log(log);
+        log.randomSeed = fuzzer.config.randomSeed;
+
+        setAssertHandler(&capture_assert, &capture);
+
+        for (u32 frameIndex = 0; frameIndex < failure.keySchedule.size() && !capture.hasFailed; frameIndex++)
+        {
+            set_key_state(state, failure.keySchedule[frameIndex]);
+            record_input_frame(log, state, fuzzer.config.frameTimeMs);
+            execute_step(config, state, fuzzer.config.frameTimeMs);
+        }
+
+        setAssertHandler(nullptr, nullptr);
+
+        destroyCPUState(state);
+
+        return capture.hasFailed;
+    }
+}
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+#include "InputLog.h"
+
+#include <vector>
+
+namespace chip8
+{
+    // Coverage-guided fuzzing of the keypad: mutates per-frame key schedules and keeps the ones that
+    // reach new control flow edges, looking for runs where the rom trips an Assert.
+    //
+    // Runs start from power-on with the memory cleared, the way chip8emu --record does it, so failures can be
+    // saved as input logs and replayed with chip8emu --replay. Asserts are caught on the fuzzing thread only,
+    // and the run stops at the first one.
+    static const u32 InputFuzzEdgeMapSizeInBits = 1 << 16;
+
+    struct InputFuzzConfig
+    {
+        u32 frameCount; // Per run
+        unsigned int frameTimeMs;
+        u64 randomSeed; // Seed of the emulated RND, see seed_random_generator()
+        u64 mutationSeed;
+    };
+
+    enum class InputFuzzFailureKind
+    {
+        StackOverflow,
+        StackUnderflow,
+        InvalidJump,           // Unaligned or outside of the program
+        InvalidMemoryAccess,   // DRW, LD B, LD [I], LD Vx, [I]
+        InvalidProgramCounter, // Ran or skipped past the end of memory
+        InvalidOpcode,
+        Other                  // Anything else, e.g. LD F with Vx > 0xF
+    };
+
+    struct InputFuzzFailure
+    {
+        InputFuzzFailureKind kind;
+        u16 pc;
+        u16 instruction; // 0 for fetch failures
+        u64 instructionCount;
+        u32 frameIndex;
+
+        // First Assert that tripped
+        const char* file;
+        int line;
+
+        // Key state of every frame, up to the failing one.
+        std::vector<u16> keySchedule;
+    };
+
+    struct InputFuzzStats
+    {
+        u64 runCount;
+        u64 instructionCount;
+        u32 corpusSize;
+        u32 coveredEdgeCount;
+    };
+
+    struct InputFuzzer;
+
+    // The program is copied.
+    CHIP8EMU_EMU_API InputFuzzer* createInputFuzzer(const u8* program, u16 programSize, const InputFuzzConfig& config);
+    CHIP8EMU_EMU_API void destroyInputFuzzer(InputFuzzer* fuzzer);
+
+    CHIP8EMU_EMU_API const char* get_input_fuzz_failure_kind_name(InputFuzzFailureKind kind);
+
+    // Mutates and runs runCount key schedules. Call it again to keep going from the same corpus.
+    CHIP8EMU_EMU_API void run_input_fuzzer(InputFuzzer& fuzzer, u32 runCount);
+
+    CHIP8EMU_EMU_API InputFuzzStats get_input_fuzzer_stats(const InputFuzzer& fuzzer);
+
+    // One entry per distinct failure (kind and pc), with the first schedule that triggered it.
+    CHIP8EMU_EMU_API const std::vector<InputFuzzFailure>& get_input_fuzzer_failures(const InputFuzzer& fuzzer);
+
+    // Runs the schedule through execute_step() while recording it, the log replays the failure.
+    // Returns false if the schedule does not trip an Assert anymore.
+    CHIP8EMU_EMU_API bool record_input_fuzz_failure(const InputFuzzer& fuzzer, const InputFuzzFailure& failure,
+                                                    InputLog& log);
+}
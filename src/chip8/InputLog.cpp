@@ -0,0 +1,262 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "InputLog.h"
+
+#include "Execution.h"
+#include "Keyboard.h"
+#include "Serialization.h"
+
+#include "core/Assert.h"
+
+#include <fstream>
+#include <utility>
+
+namespace chip8
+{
+    namespace
+    {
+        static const u16 InputLogHeaderSizeInBytes = 24;
+
+        struct InputFrame
+        {
+            unsigned int deltaTimeMs;
+            bool hasKeyChange;
+            u64 instructionCountDelta;
+            u16 keyState;
+        };
+
+        void write_varint(std::vector<u8>& output, u64 value)
+        {
+            while (value >= 0x80)
+            {
+                output.push_back(static_cast<u8>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+
+            output.push_back(static_cast<u8>(value));
+        }
+
+        bool read_varint(const std::vector<u8>& input, std::size_t& offset, u64& value)
+        {
+            value = 0;
+
+            for (u32 shift = 0; shift < 64; shift += 7)
+            {
+                if (offset >= input.size())
+                    return false;
+
+                const u8 byte = input[offset++];
+                value |= static_cast<u64>(byte & 0x7F) << shift;
+
+                if ((byte & 0x80) == 0)
+                    return true;
+            }
+
+            return false; // Overlong varint
+        }
+
+        bool read_frame(const std::vector<u8>& input, std::size_t& offset, InputFrame& frame)
+        {
+            u64 header;
+
+            if (!read_varint(input, offset, header))
+                return false;
+
+            frame.deltaTimeMs = static_cast<unsigned int>(header >> 1);
+            frame.hasKeyChange = (header & 1) != 0;
+            frame.instructionCountDelta = 0;
+            frame.keyState = 0;
+
+            if (!frame.hasKeyChange)
+                return true;
+
+            if (!read_varint(input, offset, frame.instructionCountDelta))
+                return false;
+
+            if (offset + 2 > input.size())
+                return false;
+
+            frame.keyState = read_u16_little_endian(&input[offset]);
+            offset += 2;
+
+            return true;
+        }
+    }
+
+    const char* get_input_log_error_string(InputLogError error)
+    {
+        switch (error)
+        {
+            case InputLogError::None:
+                return "no error";
+            case InputLogError::IOError:
+                return "could not access file";
+            case InputLogError::InvalidMagic:
+                return "not an input log";
+            case InputLogError::UnsupportedVersion:
+                return "unsupported version";
+            case InputLogError::Truncated:
+                return "truncated log";
+            case InputLogError::Desync:
+                return "replay went out of sync";
+        }
+
+        AssertUnreachable();
+        return "unknown error";
+    }
+
+    void clear_input_log(InputLog& log)
+    {
+        log.data.clear();
+        log.frameCount = 0;
+        log.randomSeed = 0;
+        log.lastKeyState = 0;
+        log.lastKeyChangeInstructionCount = 0;
+    }
+
+    void record_input_frame(InputLog& log, const CPUState& state, unsigned int deltaTimeMs)
+    {
+        const bool hasKeyChange = state.keyState != log.lastKeyState;
+
+        write_varint(log.data, (static_cast<u64>(deltaTimeMs) << 1) | (hasKeyChange ? 1 : 0));
+
+        if (hasKeyChange)
+        {
+            Assert(state.instructionCount >= log.lastKeyChangeInstructionCount);
+
+            u8 keyStateBytes[2];
+            write_u16_little_endian(keyStateBytes, state.keyState);
+
+            write_varint(log.data, state.instructionCount - log.lastKeyChangeInstructionCount);
+            log.data.insert(log.data.end(), keyStateBytes, keyStateBytes + 2);
+
+            log.lastKeyState = state.keyState;
+            log.lastKeyChangeInstructionCount = state.instructionCount;
+        }
+
+        log.frameCount++;
+    }
+
+    InputLogError replay_input_log(const EmuConfig& config, CPUState& state, const InputLog& log)
+    {
+        std::size_t offset = 0;
+        u64 keyChangeInstructionCount = 0;
+
+        for (u32 frameIndex = 0; frameIndex < log.frameCount; frameIndex++)
+        {
+            InputFrame frame;
+
+            if (!read_frame(log.data, offset, frame))
+                return InputLogError::Truncated;
+
+            if (frame.hasKeyChange)
+            {
+                keyChangeInstructionCount += frame.instructionCountDelta;
+
+                if (state.instructionCount != keyChangeInstructionCount)
+                    return InputLogError::Desync;
+
+                set_key_state(state, frame.keyState);
+            }
+
+            execute_step(config, state, frame.deltaTimeMs);
+        }
+
+        return InputLogError::None;
+    }
+
+    InputLogError save_input_log_to_file(const InputLog& log, const char* path)
+    {
+        Assert(path != nullptr);
+
+        u8 header[InputLogHeaderSizeInBytes];
+
+        write_u32_little_endian(header + 0, InputLogMagic);
+        write_u16_little_endian(header + 4, InputLogVersion);
+        write_u16_little_endian(header + 6, InputLogHeaderSizeInBytes);
+        write_u32_little_endian(header + 8, log.frameCount);
+        write_u32_little_endian(header + 12, static_cast<u32>(log.data.size()));
+        write_u32_little_endian(header + 16, static_cast<u32>(log.randomSeed));
+        write_u32_little_endian(header + 20, static_cast<u32>(log.randomSeed >> 32));
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(log.data.data()), static_cast<std::streamsize>(log.data.size()));
+
+        return file.good() ? InputLogError::None : InputLogError::IOError;
+    }
+
+    InputLogError load_input_log_from_file(InputLog& log, const char* path)
+    {
+        Assert(path != nullptr);
+
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+        if (!file.good())
+            return InputLogError::IOError;
+
+        const std::size_t fileSizeInBytes = static_cast<std::size_t>(file.tellg());
+
+        u8 header[InputLogHeaderSizeInBytes];
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+        if (!file.good())
+            return InputLogError::Truncated;
+
+        if (read_u32_little_endian(header + 0) != InputLogMagic)
+            return InputLogError::InvalidMagic;
+
+        if (read_u16_little_endian(header + 4) != InputLogVersion
+            || read_u16_little_endian(header + 6) != InputLogHeaderSizeInBytes)
+            return InputLogError::UnsupportedVersion;
+
+        const u32 frameCount = read_u32_little_endian(header + 8);
+        const u32 dataSizeInBytes = read_u32_little_endian(header + 12);
+
+        // Check the size against the file before trusting it with an allocation.
+        if (dataSizeInBytes != fileSizeInBytes - InputLogHeaderSizeInBytes)
+            return InputLogError::Truncated;
+
+        InputLog loadedLog = {};
+        loadedLog.data.resize(dataSizeInBytes);
+        loadedLog.randomSeed = read_u32_little_endian(header + 16)
+                               | (static_cast<u64>(read_u32_little_endian(header + 20)) << 32);
+
+        file.read(reinterpret_cast<char*>(loadedLog.data.data()), dataSizeInBytes);
+
+        if (!file.good())
+            return InputLogError::Truncated;
+
+        // Walk the frames once to validate the log and recover the recording state,
+        // so that recording can resume where it stopped.
+        std::size_t offset = 0;
+
+        for (u32 frameIndex = 0; frameIndex < frameCount; frameIndex++)
+        {
+            InputFrame frame;
+
+            if (!read_frame(loadedLog.data, offset, frame))
+                return InputLogError::Truncated;
+
+            if (frame.hasKeyChange)
+            {
+                loadedLog.lastKeyState = frame.keyState;
+                loadedLog.lastKeyChangeInstructionCount += frame.instructionCountDelta;
+            }
+        }
+
+        if (offset != loadedLog.data.size())
+            return InputLogError::Truncated;
+
+        loadedLog.frameCount = frameCount;
+        log = std::move(loadedLog);
+
+        return InputLogError::None;
+    }
+}
@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Config.h"
+#include "Cpu.h"
+
+#include <vector>
+
+namespace chip8
+{
+    // Input logs hold everything that drives the emulation from the outside: the time
+    // step of every frame and the keypad changes, stamped with the instruction count.
+    // Feeding a log back into the state it was recorded from reproduces the exact same run.
+    //
+    // Each frame is stored as a varint of (deltaTimeMs << 1 | hasKeyChange), followed on key
+    // changes by a varint of the instructions executed since the previous change and the new
+    // 16-bit key mask. Idle frames cost a single byte.
+    static const u32 InputLogMagic = 0x4C493843; // "C8IL"
+    static const u16 InputLogVersion = 1;
+
+    struct InputLog
+    {
+        std::vector<u8> data;
+        u32 frameCount;
+
+        // Seed the state was started with, the replay has to use the same one.
+        u64 randomSeed;
+
+        u16 lastKeyState;
+        u64 lastKeyChangeInstructionCount;
+    };
+
+    enum class InputLogError
+    {
+        None,
+        IOError,
+        InvalidMagic,
+        UnsupportedVersion,
+        Truncated,
+        Desync
+    };
+
+    CHIP8EMU_EMU_API const char* get_input_log_error_string(InputLogError error);
+
+    CHIP8EMU_EMU_API void clear_input_log(InputLog& log);
+
+    // Call this right before execute_step(), once the keys are set, with the same time step.
+    // Recording has to start from the state the replay will start from, usually power-on.
+    CHIP8EMU_EMU_API void record_input_frame(InputLog& log, const CPUState& state, unsigned int deltaTimeMs);
+
+    // Runs the whole log on the state, without any frontend.
+    // Returns Desync if a key change doesn't land on the instruction it was recorded on.
+    CHIP8EMU_EMU_API InputLogError replay_input_log(const EmuConfig& config, CPUState& state, const InputLog& log);
+
+    CHIP8EMU_EMU_API InputLogError save_input_log_to_file(const InputLog& log, const char* path);
+    CHIP8EMU_EMU_API InputLogError load_input_log_from_file(InputLog& log, const char* path);
+}
@@ -7,43 +7,48 @@
 
 #pragma once
 
+#include "Config.h"
 #include "Cpu.h"
 
 namespace chip8
 {
-    void execute_cls(CPUState& state);
-    void execute_ret(CPUState& state);
-    void execute_sys(CPUState& state, u16 address);
-    void execute_jp(CPUState& state, u16 address);
-    void execute_call(CPUState& state, u16 address);
-    void execute_se(CPUState& state, u8 registerName, u8 value);
-    void execute_sne(CPUState& state, u8 registerName, u8 value);
-    void execute_se2(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_ld(CPUState& state, u8 registerName, u8 value);
-    void execute_add(CPUState& state, u8 registerName, u8 value);
-    void execute_ld2(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_or(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_and(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_xor(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_add2(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_sub(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_shr1(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_subn(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_shl1(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_sne2(CPUState& state, u8 registerLHS, u8 registerRHS);
-    void execute_ldi(CPUState& state, u16 address);
-    void execute_jp2(CPUState& state, u16 baseAddress);
-    void execute_rnd(CPUState& state, u8 registerName, u8 value);
-    void execute_drw(CPUState& state, u8 registerLHS, u8 registerRHS, u8 size);
-    void execute_skp(CPUState& state, u8 registerName);
-    void execute_sknp(CPUState& state, u8 registerName);
-    void execute_ldt(CPUState& state, u8 registerName);
-    void execute_ldk(CPUState& state, u8 registerName);
-    void execute_lddt(CPUState& state, u8 registerName);
-    void execute_ldst(CPUState& state, u8 registerName);
-    void execute_addi(CPUState& state, u8 registerName);
-    void execute_ldf(CPUState& state, u8 registerName);
-    void execute_ldb(CPUState& state, u8 registerName);
-    void execute_ldai(CPUState& state, u8 registerName);
-    void execute_ldm(CPUState& state, u8 registerName);
+    // Defined in Instruction.inl, so that the interpreter loop can inline them for both execution policies,
+    // see EmuConfig::executionPolicy.
+    template <ExecutionPolicy Policy> void execute_cls(CPUState& state);
+    template <ExecutionPolicy Policy> void execute_ret(CPUState& state);
+    template <ExecutionPolicy Policy> void execute_sys(CPUState& state, u16 address);
+    template <ExecutionPolicy Policy> void execute_jp(CPUState& state, u16 address);
+    template <ExecutionPolicy Policy> void execute_call(CPUState& state, u16 address);
+    template <ExecutionPolicy Policy> void execute_se(CPUState& state, u8 registerName, u8 value);
+    template <ExecutionPolicy Policy> void execute_sne(CPUState& state, u8 registerName, u8 value);
+    template <ExecutionPolicy Policy> void execute_se2(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_ld(CPUState& state, u8 registerName, u8 value);
+    template <ExecutionPolicy Policy> void execute_add(CPUState& state, u8 registerName, u8 value);
+    template <ExecutionPolicy Policy> void execute_ld2(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_or(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_and(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_xor(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_add2(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_sub(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_shr1(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_subn(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_shl1(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_sne2(CPUState& state, u8 registerLHS, u8 registerRHS);
+    template <ExecutionPolicy Policy> void execute_ldi(CPUState& state, u16 address);
+    template <ExecutionPolicy Policy> void execute_jp2(CPUState& state, u16 baseAddress);
+    template <ExecutionPolicy Policy> void execute_jp2_vx(CPUState& state, u16 baseAddress);
+    template <ExecutionPolicy Policy> void execute_rnd(CPUState& state, u8 registerName, u8 value);
+    template <ExecutionPolicy Policy> void execute_drw(CPUState& state, u8 registerLHS, u8 registerRHS, u8 size);
+    template <ExecutionPolicy Policy> void execute_drw_clip(CPUState& state, u8 registerLHS, u8 registerRHS, u8 size);
+    template <ExecutionPolicy Policy> void execute_skp(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_sknp(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_ldt(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_ldk(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_lddt(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_ldst(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_addi(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_ldf(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_ldb(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_ldai(CPUState& state, u8 registerName);
+    template <ExecutionPolicy Policy> void execute_ldm(CPUState& state, u8 registerName);
 }
@@ -0,0 +1,714 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Instruction.h"
+
+#include "Memory.h"
+#include "Keyboard.h"
+#include "Display.h"
+
+#include "core/Assert.h"
+
+#include <cstring>
+
+// Asserts of the hot path. Unchecked instantiations drop them, condition included.
+#define CheckedAssert(...)                          \
+    do                                              \
+    {                                               \
+        if (Policy == ExecutionPolicy::Checked)     \
+            Assert(__VA_ARGS__);                    \
+    } while (false)
+
+namespace chip8
+{
+    namespace
+    {
+        // Unchecked execution masks addresses and stack indices instead of validating them,
+        // so that any rom stays within the state.
+        static const u16 AddressMask = MemorySizeInBytes - 1;
+        static const u8 StackMask = StackSize - 1;
+
+        static_assert((MemorySizeInBytes & AddressMask) == 0, "memory size must be a power of two");
+        static_assert((StackSize & StackMask) == 0, "stack size must be a power of two");
+
+        template <ExecutionPolicy Policy>
+        bool check_memory_range(u16 baseAddress, u16 sizeInBytes, MemoryUsage usage)
+        {
+            return Policy == ExecutionPolicy::Unchecked || is_valid_memory_range(baseAddress, sizeInBytes, usage);
+        }
+
+        template <ExecutionPolicy Policy>
+        bool check_jump_target(u16 address)
+        {
+            return Policy == ExecutionPolicy::Unchecked
+                   || ((address & 0x0001) == 0 && is_valid_memory_range(address, 2, MemoryUsage::Execute));
+        }
+
+        u16 mask_address(u32 address)
+        {
+            return static_cast<u16>(address & AddressMask);
+        }
+
+        template <ExecutionPolicy Policy>
+        bool is_key_down(const CPUState& state, KeyID key)
+        {
+            // is_key_pressed() asserts on invalid keys
+            if (Policy == ExecutionPolicy::Checked)
+                return is_key_pressed(state, key);
+
+            return key < KeyIDCount && (state.keyState & (1 << key)) != 0;
+        }
+
+        template <ExecutionPolicy Policy>
+        KeyID get_first_key_pressed(u16 keyStatePressMask)
+        {
+            // get_key_pressed() asserts when only key 0 is pressed
+            if (Policy == ExecutionPolicy::Checked)
+                return get_key_pressed(keyStatePressMask);
+
+            for (KeyID key = 1; key < KeyIDCount; key++)
+            {
+                if (keyStatePressMask & (1 << key))
+                    return key;
+            }
+
+            return 0x0;
+        }
+
+        // xorshift64*, the high bits are the good ones.
+        u8 generate_random_byte(CPUState& state)
+        {
+            u64 x = state.randomState;
+
+            x ^= x >> 12;
+            x ^= x << 25;
+            x ^= x >> 27;
+
+            state.randomState = x;
+
+            return static_cast<u8>((x * 0x2545F4914F6CDD1D) >> 56);
+        }
+
+        // Sprites are XORed row by row, pixels that fall off the screen either wrap around or get dropped.
+        template <ExecutionPolicy Policy, bool ClipSprite>
+        void draw_sprite(CPUState& state, u8 registerLHS, u8 registerRHS, u8 size)
+        {
+            CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+            CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+            const bool isValidRange = check_memory_range<Policy>(state.i, size, MemoryUsage::Read);
+            CheckedAssert(isValidRange);
+
+            if (!isValidRange)
+                return;
+
+            int spriteStartX = state.vRegisters[registerLHS];
+            int spriteStartY = state.vRegisters[registerRHS];
+
+            // When clipping, only the start position wraps around.
+            if (ClipSprite)
+            {
+                spriteStartX %= static_cast<int>(ScreenWidth);
+                spriteStartY %= static_cast<int>(ScreenHeight);
+            }
+
+            bool collision = false;
+
+            // Sprites are made of rows of 1 byte each.
+            for (int rowIndex = 0; rowIndex < size; rowIndex++)
+            {
+                if (ClipSprite && spriteStartY + rowIndex >= static_cast<int>(ScreenHeight))
+                    break;
+
+                const u8 spriteRow = read_memory(state, mask_address(state.i + rowIndex));
+                const u8 screenY = (spriteStartY + rowIndex) % ScreenHeight;
+
+                for (int pixelIndex = 0; pixelIndex < 8; pixelIndex++)
+                {
+                    if (ClipSprite && spriteStartX + pixelIndex >= static_cast<int>(ScreenWidth))
+                        break;
+
+                    const u8 spritePixelValue = (spriteRow >> (7 - pixelIndex)) & 0x1;
+                    const u8 screenX = (spriteStartX + pixelIndex) % ScreenWidth;
+
+                    const u8 screenPixelValue = read_screen_pixel(state, screenX, screenY);
+
+                    const u8 result = screenPixelValue ^ spritePixelValue;
+
+                    // A pixel was erased
+                    if (screenPixelValue && !result)
+                        collision = true;
+
+                    write_screen_pixel(state, screenX, screenY, result);
+                }
+            }
+
+            state.vRegisters[VF] = collision ? 1 : 0;
+        }
+    }
+
+    // Clear the display.
+    template <ExecutionPolicy Policy>
+    void execute_cls(CPUState& state)
+    {
+        const u32 screenSizeInBytes = ScreenHeight * ScreenLineSizeInBytes;
+
+        std::memset(&state.screen[0][0], 0x0, screenSizeInBytes);
+        state.screenHash = 0;
+    }
+
+    // Return from a subroutine.
+    // The interpreter sets the program counter to the address at the top of the stack,
+    // then subtracts 1 from the stack pointer.
+    template <ExecutionPolicy Policy>
+    void execute_ret(CPUState& state)
+    {
+        CheckedAssert(state.sp > 0); // Stack Underflow
+
+        if (Policy == ExecutionPolicy::Checked && state.sp == 0)
+            return;
+
+        const u16 nextPC = state.stack[state.sp & StackMask] + 2;
+        const bool isValidTarget = check_memory_range<Policy>(nextPC, 2, MemoryUsage::Execute);
+        CheckedAssert(isValidTarget);
+
+        if (!isValidTarget)
+            return;
+
+        state.pc = mask_address(nextPC);
+        state.sp = (state.sp - 1) & StackMask;
+    }
+
+    // Jump to a machine code routine at nnn.
+    // This instruction is only used on the old computers on which Chip-8 was originally implemented.
+    // NOTE: We choose to ignore it since we don't load any code into system memory.
+    template <ExecutionPolicy Policy>
+    void execute_sys(CPUState& /*state*/, u16 /*address*/)
+    {
+        // noop
+    }
+
+    // Jump to location nnn.
+    // The interpreter sets the program counter to nnn.
+    template <ExecutionPolicy Policy>
+    void execute_jp(CPUState& state, u16 address)
+    {
+        const bool isValidTarget = check_jump_target<Policy>(address);
+        CheckedAssert(isValidTarget); // Unaligned or outside of the program
+
+        if (isValidTarget)
+            state.pc = address;
+    }
+
+    // Call subroutine at nnn.
+    // The interpreter increments the stack pointer, then puts the current PC on the top of the stack.
+    // The PC is then set to nnn.
+    template <ExecutionPolicy Policy>
+    void execute_call(CPUState& state, u16 address)
+    {
+        const bool isValidTarget = check_jump_target<Policy>(address);
+        CheckedAssert(isValidTarget); // Unaligned or outside of the program
+
+        // stack[0] is never used, sp points to the top entry.
+        CheckedAssert(state.sp + 1u < StackSize); // Stack overflow
+
+        if (Policy == ExecutionPolicy::Checked && (!isValidTarget || state.sp + 1u >= StackSize))
+            return;
+
+        state.sp = (state.sp + 1) & StackMask; // Increment sp, unchecked overflows wrap around
+        state.stack[state.sp] = state.pc; // Put PC on top of the stack
+        state.pc = address; // Set PC to new address
+    }
+
+    // Skip next instruction if Vx = kk.
+    // The interpreter compares register Vx to kk, and if they are equal,
+    // increments the program counter by 2.
+    template <ExecutionPolicy Policy>
+    void execute_se(CPUState& state, u8 registerName, u8 value)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        const bool canSkip = check_memory_range<Policy>(state.pc, 6, MemoryUsage::Execute);
+        CheckedAssert(canSkip);
+
+        const u8 registerValue = state.vRegisters[registerName];
+
+        if (canSkip && registerValue == value)
+            state.pc += 4;
+    }
+
+    // Skip next instruction if Vx != kk.
+    // The interpreter compares register Vx to kk, and if they are not equal,
+    // increments the program counter by 2.
+    template <ExecutionPolicy Policy>
+    void execute_sne(CPUState& state, u8 registerName, u8 value)
+    {
+        const u8 registerValue = state.vRegisters[registerName];
+
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        const bool canSkip = check_memory_range<Policy>(state.pc, 6, MemoryUsage::Execute);
+        CheckedAssert(canSkip);
+
+        if (canSkip && registerValue != value)
+            state.pc += 4;
+    }
+
+    // Skip next instruction if Vx = Vy.
+    // The interpreter compares register Vx to register Vy, and if they are equal,
+    // increments the program counter by 2.
+    template <ExecutionPolicy Policy>
+    void execute_se2(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        const bool canSkip = check_memory_range<Policy>(state.pc, 6, MemoryUsage::Execute);
+        CheckedAssert(canSkip);
+
+        const u8 registerValueLHS = state.vRegisters[registerLHS];
+        const u8 registerValueRHS = state.vRegisters[registerRHS];
+
+        if (canSkip && registerValueLHS == registerValueRHS)
+            state.pc += 4;
+    }
+
+    // Set Vx = kk.
+    // The interpreter puts the value kk into register Vx.
+    template <ExecutionPolicy Policy>
+    void execute_ld(CPUState& state, u8 registerName, u8 value)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        state.vRegisters[registerName] = value;
+    }
+
+    // Set Vx = Vx + kk.
+    // Adds the value kk to the value of register Vx, then stores the result in Vx.
+    // NOTE: Carry in NOT set.
+    // NOTE: Overflows will just wrap the value around.
+    template <ExecutionPolicy Policy>
+    void execute_add(CPUState& state, u8 registerName, u8 value)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        const u8 registerValue = state.vRegisters[registerName];
+        const u8 sum = registerValue + value;
+
+        state.vRegisters[registerName] = sum;
+    }
+
+    // Set Vx = Vy.
+    // Stores the value of register Vy in register Vx.
+    template <ExecutionPolicy Policy>
+    void execute_ld2(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        state.vRegisters[registerLHS] = state.vRegisters[registerRHS];
+    }
+
+    // Set Vx = Vx OR Vy.
+    // Performs a bitwise OR on the values of Vx and Vy, then stores the result in Vx.
+    // A bitwise OR compares the corrseponding bits from two values, and if either bit is 1,
+    // then the same bit in the result is also 1. Otherwise, it is 0.
+    template <ExecutionPolicy Policy>
+    void execute_or(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        state.vRegisters[registerLHS] |= state.vRegisters[registerRHS];
+    }
+
+    // Set Vx = Vx AND Vy.
+    // Performs a bitwise AND on the values of Vx and Vy, then stores the result in Vx.
+    // A bitwise AND compares the corrseponding bits from two values, and if both bits are 1,
+    // then the same bit in the result is also 1. Otherwise, it is 0.
+    template <ExecutionPolicy Policy>
+    void execute_and(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        state.vRegisters[registerLHS] &= state.vRegisters[registerRHS];
+    }
+
+    // Set Vx = Vx XOR Vy.
+    // Performs a bitwise exclusive OR on the values of Vx and Vy, then stores the result in Vx.
+    // An exclusive OR compares the corrseponding bits from two values, and if the bits are not both the same,
+    // then the corresponding bit in the result is set to 1.  Otherwise, it is 0.
+    template <ExecutionPolicy Policy>
+    void execute_xor(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        state.vRegisters[registerLHS] = state.vRegisters[registerLHS] ^ state.vRegisters[registerRHS];
+    }
+
+    // Set Vx = Vx + Vy, set VF = carry.
+    // The values of Vx and Vy are added together.
+    // If the result is greater than 8 bits (i.e., > 255,) VF is set to 1, otherwise 0.
+    // Only the lowest 8 bits of the result are kept, and stored in Vx.
+    template <ExecutionPolicy Policy>
+    void execute_add2(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        const u8 valueLHS = state.vRegisters[registerLHS];
+        const u8 valueRHS = state.vRegisters[registerRHS];
+        const u8 result = valueLHS + valueRHS;
+
+        state.vRegisters[registerLHS] = result;
+        state.vRegisters[VF] = (result > valueLHS) ? 0 : 1; // Set carry
+    }
+
+    // Set Vx = Vx - Vy, set VF = NOT borrow.
+    // If Vx > Vy, then VF is set to 1, otherwise 0.
+    // Then Vy is subtracted from Vx, and the results stored in Vx.
+    template <ExecutionPolicy Policy>
+    void execute_sub(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        const u8 valueLHS = state.vRegisters[registerLHS];
+        const u8 valueRHS = state.vRegisters[registerRHS];
+        const u8 result = valueLHS - valueRHS;
+
+        state.vRegisters[registerLHS] = result;
+        state.vRegisters[VF] = (valueLHS > valueRHS) ? 1 : 0; // Set carry
+    }
+
+    // Set Vx = Vx SHR 1.
+    // If the least-significant bit of Vx is 1, then VF is set to 1, otherwise 0.
+    // Then Vx is divided by 2.
+    // NOTE: registerRHS is just ignored apparently.
+    template <ExecutionPolicy Policy>
+    void execute_shr1(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        const u8 valueLHS = state.vRegisters[registerLHS];
+
+        state.vRegisters[registerLHS] = valueLHS >> 1;
+        state.vRegisters[VF] = valueLHS & 0x01; // Set carry
+    }
+
+    // Set Vx = Vy - Vx, set VF = NOT borrow.
+    // If Vy > Vx, then VF is set to 1, otherwise 0.
+    // Then Vx is subtracted from Vy, and the results stored in Vx.
+    template <ExecutionPolicy Policy>
+    void execute_subn(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        const u8 valueLHS = state.vRegisters[registerLHS];
+        const u8 valueRHS = state.vRegisters[registerRHS];
+        const u8 result = valueRHS - valueLHS;
+
+        state.vRegisters[registerLHS] = result;
+        state.vRegisters[VF] = (valueRHS > valueLHS) ? 1 : 0; // Set carry
+    }
+
+    // Set Vx = Vx SHL 1.
+    // If the most-significant bit of Vx is 1, then VF is set to 1, otherwise to 0. Then Vx is multiplied by 2.
+    // NOTE: registerRHS is just ignored apparently.
+    template <ExecutionPolicy Policy>
+    void execute_shl1(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        const u8 valueLHS = state.vRegisters[registerLHS];
+
+        state.vRegisters[registerLHS] = valueLHS << 1;
+        state.vRegisters[VF] = (valueLHS & 0x80) ? 1 : 0; // Set carry
+    }
+
+    // Skip next instruction if Vx != Vy.
+    // The values of Vx and Vy are compared, and if they are not equal, the program counter is increased by 2.
+    template <ExecutionPolicy Policy>
+    void execute_sne2(CPUState& state, u8 registerLHS, u8 registerRHS)
+    {
+        CheckedAssert((registerLHS & ~0x0F) == 0); // Invalid register
+        CheckedAssert((registerRHS & ~0x0F) == 0); // Invalid register
+
+        const bool canSkip = check_memory_range<Policy>(state.pc, 6, MemoryUsage::Execute);
+        CheckedAssert(canSkip);
+
+        const u8 valueLHS = state.vRegisters[registerLHS];
+        const u8 valueRHS = state.vRegisters[registerRHS];
+
+        if (canSkip && valueLHS != valueRHS)
+            state.pc += 4;
+    }
+
+    // Set I = nnn.
+    // The value of register I is set to nnn.
+    template <ExecutionPolicy Policy>
+    void execute_ldi(CPUState& state, u16 address)
+    {
+        state.i = address;
+    }
+
+    // Jump to location nnn + V0.
+    // The program counter is set to nnn plus the value of V0.
+    template <ExecutionPolicy Policy>
+    void execute_jp2(CPUState& state, u16 baseAddress)
+    {
+        const u16 offset = state.vRegisters[V0];
+        const u16 targetAddress = baseAddress + offset;
+
+        const bool isValidTarget = check_jump_target<Policy>(targetAddress);
+        CheckedAssert(isValidTarget); // Unaligned or outside of the program
+
+        if (isValidTarget)
+            state.pc = mask_address(targetAddress);
+    }
+
+    // Jump to location xnn + Vx.
+    // SUPER-CHIP reading of Bnnn: the register is the top nibble of the address.
+    template <ExecutionPolicy Policy>
+    void execute_jp2_vx(CPUState& state, u16 baseAddress)
+    {
+        const u8 registerName = static_cast<u8>((baseAddress & 0x0F00) >> 8);
+        const u16 offset = state.vRegisters[registerName];
+        const u16 targetAddress = baseAddress + offset;
+
+        const bool isValidTarget = check_jump_target<Policy>(targetAddress);
+        CheckedAssert(isValidTarget); // Unaligned or outside of the program
+
+        if (isValidTarget)
+            state.pc = mask_address(targetAddress);
+    }
+
+    // Set Vx = random byte AND kk.
+    // The interpreter generates a random number from 0 to 255, which is then ANDed with the value kk.
+    // The results are stored in Vx. See instruction 8xy2 for more information on AND.
+    template <ExecutionPolicy Policy>
+    void execute_rnd(CPUState& state, u8 registerName, u8 value)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        const u8 randomValue = generate_random_byte(state);
+        state.vRegisters[registerName] = randomValue & value;
+    }
+
+    // Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision.
+    // The interpreter reads n bytes from memory, starting at the address stored in I.
+    // These bytes are then displayed as sprites on screen at coordinates (Vx, Vy).
+    // Sprites are XORed onto the existing screen. If this causes any pixels to be erased, VF is set to 1,
+    // otherwise it is set to 0.
+    // If the sprite is positioned so part of it is outside the coordinates of the display,
+    // it wraps around to the opposite side of the screen. See instruction 8xy3 for more information on XOR,
+    // and section 2.4, Display, for more information on the Chip-8 screen and sprites.
+    template <ExecutionPolicy Policy>
+    void execute_drw(CPUState& state, u8 registerLHS, u8 registerRHS, u8 size)
+    {
+        draw_sprite<Policy, false>(state, registerLHS, registerRHS, size);
+    }
+
+    // Same as DRW, except that the parts of the sprite outside of the display are not drawn.
+    // The start position (Vx, Vy) still wraps around.
+    template <ExecutionPolicy Policy>
+    void execute_drw_clip(CPUState& state, u8 registerLHS, u8 registerRHS, u8 size)
+    {
+        draw_sprite<Policy, true>(state, registerLHS, registerRHS, size);
+    }
+
+    // Skip next instruction if key with the value of Vx is pressed.
+    // Checks the keyboard, and if the key corresponding to the value of Vx is currently in the down position,
+    // PC is increased by 2.
+    template <ExecutionPolicy Policy>
+    void execute_skp(CPUState& state, u8 registerName)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        const bool canSkip = check_memory_range<Policy>(state.pc, 6, MemoryUsage::Execute);
+        CheckedAssert(canSkip);
+
+        const u8 keyID = state.vRegisters[registerName];
+
+        if (canSkip && is_key_down<Policy>(state, keyID))
+            state.pc += 4;
+    }
+
+    // Skip next instruction if key with the value of Vx is not pressed.
+    // Checks the keyboard, and if the key corresponding to the value of Vx is currently in the up position,
+    // PC is increased by 2.
+    template <ExecutionPolicy Policy>
+    void execute_sknp(CPUState& state, u8 registerName)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        const bool canSkip = check_memory_range<Policy>(state.pc, 6, MemoryUsage::Execute);
+        CheckedAssert(canSkip);
+
+        const KeyID key = state.vRegisters[registerName];
+
+        if (canSkip && !is_key_down<Policy>(state, key))
+            state.pc += 4;
+    }
+
+    // Set Vx = delay timer value.
+    // The value of DT is placed into Vx.
+    template <ExecutionPolicy Policy>
+    void execute_ldt(CPUState& state, u8 registerName)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        state.vRegisters[registerName] = state.delayTimer;
+    }
+
+    // Wait for a key press, store the value of the key in Vx.
+    // All execution stops until a key is pressed, then the value of that key is stored in Vx.
+    template <ExecutionPolicy Policy>
+    void execute_ldk(CPUState& state, u8 registerName)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        // If we enter for the first time, set the waiting flag.
+        if (!state.isWaitingForKey)
+            state.isWaitingForKey = true;
+        else
+        {
+            const u16 keyStatePressMask = ~state.keyStatePrev & state.keyState;
+            // When waiting, check the key states.
+            if (keyStatePressMask)
+            {
+                state.vRegisters[registerName] = get_first_key_pressed<Policy>(keyStatePressMask);
+                state.isWaitingForKey = false;
+            }
+        }
+    }
+
+    // Set delay timer = Vx.
+    // DT is set equal to the value of Vx.
+    template <ExecutionPolicy Policy>
+    void execute_lddt(CPUState& state, u8 registerName)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        state.delayTimer = state.vRegisters[registerName];
+    }
+
+    // Set sound timer = Vx.
+    // ST is set equal to the value of Vx.
+    template <ExecutionPolicy Policy>
+    void execute_ldst(CPUState& state, u8 registerName)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        state.soundTimer = state.vRegisters[registerName];
+    }
+
+    // Set I = I + Vx.
+    // The values of I and Vx are added, and the results are stored in I.
+    // NOTE: Carry in NOT set.
+    // NOTE: Overflows will just wrap the value around.
+    template <ExecutionPolicy Policy>
+    void execute_addi(CPUState& state, u8 registerName)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        const u16 registerValue = state.vRegisters[registerName];
+        const u16 iValue = state.i;
+        const u16 sum = iValue + registerValue;
+
+        CheckedAssert(sum >= iValue); // Overflow
+
+        state.i = sum;
+    }
+
+    // Set I = location of sprite for digit Vx.
+    // The value of I is set to the location for the hexadecimal sprite corresponding to the value of Vx.
+    // See section 2.4, Display, for more information on the Chip-8 hexadecimal font.
+    template <ExecutionPolicy Policy>
+    void execute_ldf(CPUState& state, u8 registerName)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        const u8 glyphIndex = state.vRegisters[registerName];
+
+        CheckedAssert((glyphIndex & ~0x0F) == 0); // Invalid index
+
+        if (Policy == ExecutionPolicy::Checked && (glyphIndex & ~0x0F) != 0)
+            return;
+
+        state.i = state.fontTableOffsets[glyphIndex & 0x0F];
+    }
+
+    // Store BCD representation of Vx in memory locations I, I+1, and I+2.
+    // The interpreter takes the decimal value of Vx, and places the hundreds digit in memory at location in I,
+    // the tens digit at location I+1, and the ones digit at location I+2.
+    template <ExecutionPolicy Policy>
+    void execute_ldb(CPUState& state, u8 registerName)
+    {
+        CheckedAssert((registerName & ~0x0F) == 0); // Invalid register
+
+        const bool isValidRange = check_memory_range<Policy>(state.i, 3, MemoryUsage::Write);
+        CheckedAssert(isValidRange);
+
+        if (!isValidRange)
+            return;
+
+        const u8 registerValue = state.vRegisters[registerName];
+
+        write_memory(state, mask_address(state.i + 0), (registerValue / 100) % 10);
+        write_memory(state, mask_address(state.i + 1), (registerValue / 10) % 10);
+        write_memory(state, mask_address(state.i + 2), (registerValue) % 10);
+    }
+
+    // Store registers V0 through Vx in memory starting at location I.
+    // The interpreter copies the values of registers V0 through Vx into memory,
+    // starting at the address in I.
+    template <ExecutionPolicy Policy>
+    void execute_ldai(CPUState& state, u8 registerName)
+    {
+        const u8 registerIndexMax = registerName;
+
+        CheckedAssert((registerIndexMax & ~0x0F) == 0); // Invalid register
+
+        const bool isValidRange = check_memory_range<Policy>(state.i, registerIndexMax + 1, MemoryUsage::Write);
+        CheckedAssert(isValidRange);
+
+        if (!isValidRange)
+            return;
+
+        for (u8 index = 0; index <= registerIndexMax; index++)
+            write_memory(state, mask_address(state.i + index), state.vRegisters[index]);
+    }
+
+    // Read registers V0 through Vx from memory starting at location I.
+    // The interpreter reads values from memory starting at location I into registers V0 through Vx.
+    template <ExecutionPolicy Policy>
+    void execute_ldm(CPUState& state, u8 registerName)
+    {
+        const u8 registerIndexMax = registerName;
+
+        CheckedAssert((registerIndexMax & ~0x0F) == 0); // Invalid register
+
+        const bool isValidRange = check_memory_range<Policy>(state.i, registerIndexMax + 1, MemoryUsage::Read);
+        CheckedAssert(isValidRange);
+
+        if (!isValidRange)
+            return;
+
+        for (u8 index = 0; index <= registerIndexMax; index++)
+            state.vRegisters[index] = read_memory(state, mask_address(state.i + index));
+    }
+}
+
+#undef CheckedAssert
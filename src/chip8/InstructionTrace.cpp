@@ -0,0 +1,451 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "InstructionTrace.h"
+
+#include "DeltaCodec.h"
+#include "Serialization.h"
+
+#include "core/Assert.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chip8
+{
+    namespace
+    {
+        static const u32 RecordSizeInBytes = 34;
+        static const u32 HeaderSizeInBytes = 8;
+        static const u32 BlockHeaderSizeInBytes = 8;
+        static const u32 BlockSizeInBytes = InstructionTraceBlockRecordCount * RecordSizeInBytes;
+
+        // Records per region, handing a region over costs a thread wakeup so make it worth it.
+        static const u32 RegionRecordCount = 16 * 1024;
+
+        static_assert(BlockSizeInBytes < MaxDeltaBufferSizeInBytes, "blocks are too large for the delta codec");
+        static_assert(RegionRecordCount % InstructionTraceBlockRecordCount == 0, "regions must hold whole blocks");
+
+        void serialize_record(const InstructionTraceRecord& record, u8* output)
+        {
+            write_u64_little_endian(output + 0, record.instructionCount);
+            write_u16_little_endian(output + 8, record.pc);
+            write_u16_little_endian(output + 10, record.instruction);
+            write_u16_little_endian(output + 12, record.i);
+            output[14] = record.sp;
+            output[15] = record.delayTimer;
+            output[16] = record.soundTimer;
+            output[17] = record.isWaitingForKey ? 1 : 0;
+            std::memcpy(output + 18, record.vRegisters, VRegisterCount);
+        }
+
+        void deserialize_record(const u8* input, InstructionTraceRecord& record)
+        {
+            record.instructionCount = read_u64_little_endian(input + 0);
+            record.pc = read_u16_little_endian(input + 8);
+            record.instruction = read_u16_little_endian(input + 10);
+            record.i = read_u16_little_endian(input + 12);
+            record.sp = input[14];
+            record.delayTimer = input[15];
+            record.soundTimer = input[16];
+            record.isWaitingForKey = input[17] != 0;
+            std::memcpy(record.vRegisters, input + 18, VRegisterCount);
+        }
+    }
+
+    struct InstructionTraceWriter
+    {
+        std::ofstream file;
+        bool hasIOError; // Only touched by the encoding thread until it exits
+
+        // Filled by the emulation thread
+        std::vector<InstructionTraceRecord> regions[2];
+        u32 activeRegionIndex;
+        u32 activeRecordCount;
+
+        std::thread encodingThread;
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        // Protected by the mutex
+        bool hasPendingRegion;
+        u32 pendingRegionIndex;
+        u32 pendingRecordCount;
+        bool shouldExit;
+
+        // Encoding thread only
+        u8 previousRecordBytes[RecordSizeInBytes];
+        std::vector<u8> blockBytes;
+        std::vector<u8> encodedBlock;
+    };
+
+    struct InstructionTraceReader
+    {
+        std::ifstream file;
+        InstructionTraceError error;
+        bool hasReadHeader;
+
+        std::vector<u8> blockBytes;
+        std::vector<u8> encodedBlock;
+        u32 blockRecordCount;
+        u32 blockRecordIndex;
+        u8 previousRecordBytes[RecordSizeInBytes];
+    };
+
+    namespace
+    {
+        void write_block(InstructionTraceWriter& writer, const InstructionTraceRecord* records, u32 recordCount)
+        {
+            u8* blockBytes = writer.blockBytes.data();
+
+            // Each record becomes its XOR with the previous one, unchanged fields turn into zeroes.
+            for (u32 recordIndex = 0; recordIndex < recordCount; recordIndex++)
+            {
+                u8 recordBytes[RecordSizeInBytes];
+                serialize_record(records[recordIndex], recordBytes);
+
+                for (u32 byteIndex = 0; byteIndex < RecordSizeInBytes; byteIndex++)
+                    blockBytes[recordIndex * RecordSizeInBytes + byteIndex] = recordBytes[byteIndex] ^ writer.previousRecordBytes[byteIndex];
+
+                std::memcpy(writer.previousRecordBytes, recordBytes, RecordSizeInBytes);
+            }
+
+            const u32 encodedSize = encode_xor_delta(nullptr, blockBytes, recordCount * RecordSizeInBytes, writer.encodedBlock.data());
+
+            u8 blockHeader[BlockHeaderSizeInBytes];
+            write_u32_little_endian(blockHeader, recordCount);
+            write_u32_little_endian(blockHeader + 4, encodedSize);
+
+            writer.file.write(reinterpret_cast<const char*>(blockHeader), BlockHeaderSizeInBytes);
+            writer.file.write(reinterpret_cast<const char*>(writer.encodedBlock.data()), encodedSize);
+        }
+
+        void run_encoding_thread(InstructionTraceWriter* writer)
+        {
+            std::unique_lock<std::mutex> lock(writer->mutex);
+
+            while (true)
+            {
+                writer->condition.wait(lock, [writer] { return writer->hasPendingRegion || writer->shouldExit; });
+
+                if (!writer->hasPendingRegion)
+                    break; // Exiting with nothing left to write
+
+                const InstructionTraceRecord* records = writer->regions[writer->pendingRegionIndex].data();
+                const u32 recordCount = writer->pendingRecordCount;
+
+                // The emulation thread is busy with the other region meanwhile.
+                lock.unlock();
+
+                for (u32 firstRecordIndex = 0; firstRecordIndex < recordCount; firstRecordIndex += InstructionTraceBlockRecordCount)
+                {
+                    const u32 blockRecordCount = std::min(recordCount - firstRecordIndex, InstructionTraceBlockRecordCount);
+
+                    write_block(*writer, records + firstRecordIndex, blockRecordCount);
+                }
+
+                if (!writer->file)
+                    writer->hasIOError = true;
+
+                lock.lock();
+
+                writer->hasPendingRegion = false;
+                writer->condition.notify_all();
+            }
+        }
+
+        void submit_active_region(InstructionTraceWriter& writer)
+        {
+            std::unique_lock<std::mutex> lock(writer.mutex);
+
+            // Only blocks when the encoder falls behind.
+            writer.condition.wait(lock, [&writer] { return !writer.hasPendingRegion; });
+
+            writer.hasPendingRegion = true;
+            writer.pendingRegionIndex = writer.activeRegionIndex;
+            writer.pendingRecordCount = writer.activeRecordCount;
+
+            lock.unlock();
+            writer.condition.notify_all();
+
+            writer.activeRegionIndex ^= 1;
+            writer.activeRecordCount = 0;
+        }
+
+        bool read_block(InstructionTraceReader& reader)
+        {
+            u8 blockHeader[BlockHeaderSizeInBytes];
+
+            reader.file.read(reinterpret_cast<char*>(blockHeader), BlockHeaderSizeInBytes);
+
+            if (reader.file.gcount() == 0 && reader.file.eof())
+                return false; // Clean end of trace
+
+            if (reader.file.gcount() != BlockHeaderSizeInBytes)
+            {
+                reader.error = InstructionTraceError::Truncated;
+                return false;
+            }
+
+            const u32 recordCount = read_u32_little_endian(blockHeader);
+            const u32 encodedSize = read_u32_little_endian(blockHeader + 4);
+
+            if (recordCount == 0 || recordCount > InstructionTraceBlockRecordCount
+                || encodedSize > get_max_xor_delta_size(BlockSizeInBytes))
+            {
+                reader.error = InstructionTraceError::Truncated;
+                return false;
+            }
+
+            reader.file.read(reinterpret_cast<char*>(reader.encodedBlock.data()), encodedSize);
+
+            if (static_cast<u32>(reader.file.gcount()) != encodedSize)
+            {
+                reader.error = InstructionTraceError::Truncated;
+                return false;
+            }
+
+            decode_xor_delta(nullptr, reader.encodedBlock.data(), encodedSize, reader.blockBytes.data(),
+                             recordCount * RecordSizeInBytes);
+
+            reader.blockRecordCount = recordCount;
+            reader.blockRecordIndex = 0;
+
+            return true;
+        }
+
+        bool read_header(InstructionTraceReader& reader)
+        {
+            u8 header[HeaderSizeInBytes];
+
+            reader.file.read(reinterpret_cast<char*>(header), HeaderSizeInBytes);
+
+            if (reader.file.gcount() != HeaderSizeInBytes)
+                reader.error = InstructionTraceError::Truncated;
+            else if (read_u32_little_endian(header) != InstructionTraceMagic)
+                reader.error = InstructionTraceError::InvalidMagic;
+            else if (read_u16_little_endian(header + 4) != InstructionTraceVersion)
+                reader.error = InstructionTraceError::UnsupportedVersion;
+            else if (read_u16_little_endian(header + 6) != RecordSizeInBytes)
+                reader.error = InstructionTraceError::InvalidRecordSize;
+
+            reader.hasReadHeader = true;
+
+            return reader.error == InstructionTraceError::None;
+        }
+    }
+
+    const char* get_instruction_trace_error_string(InstructionTraceError error)
+    {
+        switch (error)
+        {
+            case InstructionTraceError::None:
+                return "no error";
+            case InstructionTraceError::IOError:
+                return "could not access file";
+            case InstructionTraceError::InvalidMagic:
+                return "not an instruction trace";
+            case InstructionTraceError::UnsupportedVersion:
+                return "unsupported version";
+            case InstructionTraceError::InvalidRecordSize:
+                return "unexpected record size";
+            case InstructionTraceError::Truncated:
+                return "truncated trace";
+        }
+
+        AssertUnreachable();
+        return "unknown error";
+    }
+
+    InstructionTraceWriter* createInstructionTraceWriter(const char* path)
+    {
+        Assert(path != nullptr);
+
+        InstructionTraceWriter* writer = new InstructionTraceWriter;
+
+        writer->file.open(path, std::ios::binary | std::ios::trunc);
+
+        if (!writer->file)
+        {
+            delete writer;
+            return nullptr;
+        }
+
+        u8 header[HeaderSizeInBytes] = {};
+        write_u32_little_endian(header, InstructionTraceMagic);
+        write_u16_little_endian(header + 4, InstructionTraceVersion);
+        write_u16_little_endian(header + 6, static_cast<u16>(RecordSizeInBytes));
+
+        writer->file.write(reinterpret_cast<const char*>(header), HeaderSizeInBytes);
+
+        writer->hasIOError = false;
+        writer->regions[0].resize(RegionRecordCount);
+        writer->regions[1].resize(RegionRecordCount);
+        writer->activeRegionIndex = 0;
+        writer->activeRecordCount = 0;
+        writer->hasPendingRegion = false;
+        writer->pendingRegionIndex = 0;
+        writer->pendingRecordCount = 0;
+        writer->shouldExit = false;
+
+        std::memset(writer->previousRecordBytes, 0, RecordSizeInBytes);
+        writer->blockBytes.resize(BlockSizeInBytes);
+        writer->encodedBlock.resize(get_max_xor_delta_size(BlockSizeInBytes));
+
+        writer->encodingThread = std::thread(&run_encoding_thread, writer);
+
+        return writer;
+    }
+
+    InstructionTraceError destroyInstructionTraceWriter(InstructionTraceWriter* writer)
+    {
+        Assert(writer != nullptr);
+
+        if (writer->activeRecordCount > 0)
+            submit_active_region(*writer);
+
+        {
+            std::lock_guard<std::mutex> lock(writer->mutex);
+            writer->shouldExit = true;
+        }
+
+        writer->condition.notify_all();
+        writer->encodingThread.join();
+
+        writer->file.close();
+
+        const bool hasIOError = writer->hasIOError || !writer->file;
+
+        delete writer;
+
+        return hasIOError ? InstructionTraceError::IOError : InstructionTraceError::None;
+    }
+
+    void record_instruction(InstructionTraceWriter& writer, const CPUState& state, u16 pc, u16 instruction)
+    {
+        InstructionTraceRecord& record = writer.regions[writer.activeRegionIndex][writer.activeRecordCount];
+
+        record.instructionCount = state.instructionCount;
+        record.pc = pc;
+        record.instruction = instruction;
+        record.i = state.i;
+        record.sp = state.sp;
+        record.delayTimer = state.delayTimer;
+        record.soundTimer = state.soundTimer;
+        record.isWaitingForKey = state.isWaitingForKey;
+        std::memcpy(record.vRegisters, state.vRegisters, VRegisterCount);
+
+        writer.activeRecordCount++;
+
+        if (writer.activeRecordCount == RegionRecordCount)
+            submit_active_region(writer);
+    }
+
+    InstructionTraceReader* createInstructionTraceReader(const char* path)
+    {
+        Assert(path != nullptr);
+
+        InstructionTraceReader* reader = new InstructionTraceReader;
+
+        reader->file.open(path, std::ios::binary);
+
+        if (!reader->file)
+        {
+            delete reader;
+            return nullptr;
+        }
+
+        reader->error = InstructionTraceError::None;
+        reader->hasReadHeader = false;
+        reader->blockBytes.resize(BlockSizeInBytes);
+        reader->encodedBlock.resize(get_max_xor_delta_size(BlockSizeInBytes));
+        reader->blockRecordCount = 0;
+        reader->blockRecordIndex = 0;
+
+        std::memset(reader->previousRecordBytes, 0, RecordSizeInBytes);
+
+        return reader;
+    }
+
+    void destroyInstructionTraceReader(InstructionTraceReader* reader)
+    {
+        Assert(reader != nullptr);
+
+        delete reader;
+    }
+
+    bool read_instruction_trace_record(InstructionTraceReader& reader, InstructionTraceRecord& record)
+    {
+        if (reader.error != InstructionTraceError::None)
+            return false;
+
+        if (!reader.hasReadHeader && !read_header(reader))
+            return false;
+
+        if (reader.blockRecordIndex == reader.blockRecordCount && !read_block(reader))
+            return false;
+
+        const u8* deltaBytes = &reader.blockBytes[reader.blockRecordIndex * RecordSizeInBytes];
+
+        for (u32 byteIndex = 0; byteIndex < RecordSizeInBytes; byteIndex++)
+            reader.previousRecordBytes[byteIndex] ^= deltaBytes[byteIndex];
+
+        deserialize_record(reader.previousRecordBytes, record);
+
+        reader.blockRecordIndex++;
+
+        return true;
+    }
+
+    InstructionTraceError get_instruction_trace_reader_error(const InstructionTraceReader& reader)
+    {
+        return reader.error;
+    }
+
+    bool are_instruction_trace_records_equal(const InstructionTraceRecord& lhs, const InstructionTraceRecord& rhs)
+    {
+        return lhs.instructionCount == rhs.instructionCount && lhs.pc == rhs.pc && lhs.instruction == rhs.instruction
+               && lhs.i == rhs.i && lhs.sp == rhs.sp && lhs.delayTimer == rhs.delayTimer
+               && lhs.soundTimer == rhs.soundTimer && lhs.isWaitingForKey == rhs.isWaitingForKey
+               && std::memcmp(lhs.vRegisters, rhs.vRegisters, VRegisterCount) == 0;
+    }
+
+    InstructionTraceError find_instruction_trace_divergence(InstructionTraceReader& lhs, InstructionTraceReader& rhs,
+                                                            InstructionTraceDivergence& divergence)
+    {
+        divergence = {};
+
+        while (true)
+        {
+            divergence.hasLHSRecord = read_instruction_trace_record(lhs, divergence.lhs);
+            divergence.hasRHSRecord = read_instruction_trace_record(rhs, divergence.rhs);
+
+            if (lhs.error != InstructionTraceError::None)
+                return lhs.error;
+
+            if (rhs.error != InstructionTraceError::None)
+                return rhs.error;
+
+            if (!divergence.hasLHSRecord && !divergence.hasRHSRecord)
+                return InstructionTraceError::None; // Identical traces
+
+            if (divergence.hasLHSRecord != divergence.hasRHSRecord
+                || !are_instruction_trace_records_equal(divergence.lhs, divergence.rhs))
+            {
+                divergence.hasDiverged = true;
+                return InstructionTraceError::None;
+            }
+
+            divergence.recordIndex++;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+
+namespace chip8
+{
+    // Full execution traces, one record per executed instruction, meant to be diffed
+    // against each other to find where two runs diverge.
+    //
+    // Records are written into one of two in-memory regions while a background thread
+    // encodes and writes the other one. Encoding XORs every record against the previous one
+    // and zero-run encodes the result (see DeltaCodec.h), most records shrink to a few bytes.
+    //
+    // File layout: header (magic, u16 version, u16 record size), then blocks of up to
+    // InstructionTraceBlockRecordCount records, each made of a u32 record count, a u32 encoded size
+    // and the encoded records. Records are 34 bytes, all values little-endian.
+    static const u32 InstructionTraceMagic = 0x54493843; // "C8IT"
+    static const u16 InstructionTraceVersion = 1;
+    static const u32 InstructionTraceBlockRecordCount = 256;
+
+    struct InstructionTraceRecord
+    {
+        u64 instructionCount; // Value of CPUState::instructionCount after execution
+        u16 pc;               // Address of the instruction
+        u16 instruction;
+
+        // State after execution
+        u16 i;
+        u8 sp;
+        u8 delayTimer;
+        u8 soundTimer;
+        bool isWaitingForKey;
+        u8 vRegisters[VRegisterCount];
+    };
+
+    enum class InstructionTraceError
+    {
+        None,
+        IOError,
+        InvalidMagic,
+        UnsupportedVersion,
+        InvalidRecordSize,
+        Truncated
+    };
+
+    CHIP8EMU_EMU_API const char* get_instruction_trace_error_string(InstructionTraceError error);
+
+    struct InstructionTraceWriter;
+
+    // Returns nullptr if the file can't be opened.
+    // Attach the writer through EmuConfig::instructionTrace to record every executed instruction.
+    // Not thread-safe: one writer per emulated state.
+    CHIP8EMU_EMU_API InstructionTraceWriter* createInstructionTraceWriter(const char* path);
+
+    // Flushes the remaining records, returns IOError if any write failed along the way.
+    CHIP8EMU_EMU_API InstructionTraceError destroyInstructionTraceWriter(InstructionTraceWriter* writer);
+
+    // Called by execute_step() right after executing the instruction that was at pc.
+    CHIP8EMU_EMU_API void record_instruction(InstructionTraceWriter& writer, const CPUState& state, u16 pc, u16 instruction);
+
+    struct InstructionTraceReader;
+
+    // Returns nullptr if the file can't be opened. The header is checked by the first read.
+    CHIP8EMU_EMU_API InstructionTraceReader* createInstructionTraceReader(const char* path);
+    CHIP8EMU_EMU_API void destroyInstructionTraceReader(InstructionTraceReader* reader);
+
+    // Returns false at the end of the trace, or on error.
+    CHIP8EMU_EMU_API bool read_instruction_trace_record(InstructionTraceReader& reader, InstructionTraceRecord& record);
+
+    // None once the whole trace was read successfully.
+    CHIP8EMU_EMU_API InstructionTraceError get_instruction_trace_reader_error(const InstructionTraceReader& reader);
+
+    CHIP8EMU_EMU_API bool are_instruction_trace_records_equal(const InstructionTraceRecord& lhs,
+                                                              const InstructionTraceRecord& rhs);
+
+    struct InstructionTraceDivergence
+    {
+        bool hasDiverged;
+        u64 recordIndex; // Index of the first record that differs, or the length of the shorter trace
+        bool hasLHSRecord;
+        bool hasRHSRecord;
+        InstructionTraceRecord lhs;
+        InstructionTraceRecord rhs;
+    };
+
+    // Streams both traces until the first record that differs, or until one of them ends early.
+    CHIP8EMU_EMU_API InstructionTraceError find_instruction_trace_divergence(InstructionTraceReader& lhs,
+                                                                             InstructionTraceReader& rhs,
+                                                                             InstructionTraceDivergence& divergence);
+}
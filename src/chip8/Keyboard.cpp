@@ -15,7 +15,7 @@ namespace chip8
     {
         Assert(key < KeyIDCount); // Invalid key
 
-        return state.keyState & (1 << key);
+        return key < KeyIDCount && (state.keyState & (1 << key));
     }
 
     // If multiple keys are pressed at the same time, only register one.
@@ -40,4 +40,9 @@ namespace chip8
         const u16 keyMask = (1 << key);
         state.keyState = (state.keyState & ~keyMask) | (pressedState ? keyMask : 0);
     }
+
+    void set_key_state(CPUState& state, u16 keyState)
+    {
+        state.keyState = keyState;
+    }
 }
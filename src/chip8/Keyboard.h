@@ -27,4 +27,7 @@ namespace chip8
     KeyID get_key_pressed(u16 keyState);
 
     CHIP8EMU_EMU_API void set_key_pressed(CPUState& state, KeyID key, bool pressedState);
+
+    // Sets the whole keypad at once, one bit per key.
+    CHIP8EMU_EMU_API void set_key_state(CPUState& state, u16 keyState);
 }
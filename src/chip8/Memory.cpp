@@ -8,11 +8,45 @@
 #include "Memory.h"
 
 #include "Cpu.h"
+#include "FreeList.h"
+#include "StateHash.h"
 
 #include "core/Assert.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace chip8
 {
+    namespace
+    {
+        // Copy-on-write: get exclusive ownership of the page before writing to it.
+        // Only the owner of a reference can add new ones, so seeing a count of one
+        // means nobody else can start sharing the page behind our back.
+        // Skip the copy when the whole page is about to be overwritten.
+        u8* get_writable_page(CPUState& state, u32 pageIndex, bool keepContents = true)
+        {
+            Assert(pageIndex < MemoryPageCount);
+
+            MemoryPage* page = state.memoryPages[pageIndex];
+
+            if (page->refCount.load(std::memory_order_acquire) != 1)
+            {
+                MemoryPage* pageCopy = allocate_memory_page(page->allocator);
+
+                if (keepContents)
+                    std::memcpy(pageCopy->bytes, page->bytes, MemoryPageSizeInBytes);
+
+                release_memory_page(page);
+
+                state.memoryPages[pageIndex] = pageCopy;
+                page = pageCopy;
+            }
+
+            return page->bytes;
+        }
+    }
+
     u16 load_u16_big_endian(const u8* rawMem)
     {
         Assert(rawMem != nullptr);
@@ -46,4 +80,141 @@ namespace chip8
                 return false;
         }
     }
+
+    void init_memory_page_allocator(MemoryPageAllocator& allocator, MemoryPage* pages, u32 pageCount)
+    {
+        Assert(pages != nullptr);
+        Assert(pageCount < InvalidFreeListIndex);
+
+        allocator.pages = pages;
+        allocator.pageCount = pageCount;
+
+        for (u32 pageIndex = 0; pageIndex < pageCount; pageIndex++)
+        {
+            const u32 nextIndex = (pageIndex + 1 < pageCount) ? (pageIndex + 1) : InvalidFreeListIndex;
+
+            pages[pageIndex].refCount.store(nextIndex, std::memory_order_relaxed);
+            pages[pageIndex].allocator = &allocator;
+        }
+
+        const u32 firstIndex = pageCount > 0 ? 0 : InvalidFreeListIndex;
+
+        allocator.freeListHead.store(pack_free_list_head(0, firstIndex), std::memory_order_release);
+    }
+
+    MemoryPage* allocate_memory_page(MemoryPageAllocator* allocator)
+    {
+        MemoryPage* page = nullptr;
+
+        if (allocator)
+        {
+            const u32 pageIndex = pop_free_list(allocator->freeListHead,
+                                                [allocator](u32 index) -> std::atomic<u32>& { return allocator->pages[index].refCount; });
+
+            if (pageIndex != InvalidFreeListIndex)
+                page = &allocator->pages[pageIndex];
+        }
+
+        if (!page)
+        {
+            page = new MemoryPage;
+            page->allocator = nullptr;
+        }
+
+        page->refCount.store(1, std::memory_order_relaxed);
+
+        return page;
+    }
+
+    void acquire_memory_page(MemoryPage* page)
+    {
+        Assert(page != nullptr);
+
+        page->refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release_memory_page(MemoryPage* page)
+    {
+        Assert(page != nullptr);
+
+        const u32 previousRefCount = page->refCount.fetch_sub(1, std::memory_order_acq_rel);
+
+        Assert(previousRefCount > 0); // Page was released too many times
+
+        if (previousRefCount != 1)
+            return;
+
+        MemoryPageAllocator* allocator = page->allocator;
+
+        if (allocator)
+        {
+            const u32 pageIndex = static_cast<u32>(page - allocator->pages);
+            push_free_list(allocator->freeListHead, pageIndex, page->refCount);
+        }
+        else
+            delete page;
+    }
+
+    void write_memory(CPUState& state, u16 address, u8 value)
+    {
+        u8* pageBytes = get_writable_page(state, address / MemoryPageSizeInBytes);
+        u8& byte = pageBytes[address % MemoryPageSizeInBytes];
+
+        state.memoryHash ^= get_memory_hash_key(address, byte) ^ get_memory_hash_key(address, value);
+        byte = value;
+    }
+
+    void read_memory_range(const CPUState& state, u16 address, u8* output, u16 sizeInBytes)
+    {
+        Assert(address + sizeInBytes <= MemorySizeInBytes);
+
+        u32 offset = 0;
+
+        while (offset < sizeInBytes)
+        {
+            const u32 currentAddress = address + offset;
+            const u32 pageOffset = currentAddress % MemoryPageSizeInBytes;
+            const u32 chunkSize = std::min<u32>(sizeInBytes - offset, MemoryPageSizeInBytes - pageOffset);
+
+            std::memcpy(&output[offset], get_memory_pointer(state, static_cast<u16>(currentAddress)), chunkSize);
+            offset += chunkSize;
+        }
+    }
+
+    void write_memory_range(CPUState& state, u16 address, const u8* input, u16 sizeInBytes)
+    {
+        Assert(address + sizeInBytes <= MemorySizeInBytes);
+
+        u32 offset = 0;
+
+        while (offset < sizeInBytes)
+        {
+            const u32 currentAddress = address + offset;
+            const u32 pageOffset = currentAddress % MemoryPageSizeInBytes;
+            const u32 chunkSize = std::min<u32>(sizeInBytes - offset, MemoryPageSizeInBytes - pageOffset);
+            const u8* previousBytes = get_memory_pointer(state, static_cast<u16>(currentAddress));
+
+            // Unchanged chunks are common when restoring states, don't even copy the page then.
+            if (std::memcmp(previousBytes, &input[offset], chunkSize) == 0)
+            {
+                offset += chunkSize;
+                continue;
+            }
+
+            for (u32 byteIndex = 0; byteIndex < chunkSize; byteIndex++)
+            {
+                const u16 byteAddress = static_cast<u16>(currentAddress + byteIndex);
+                const u8 previousValue = previousBytes[byteIndex];
+                const u8 value = input[offset + byteIndex];
+
+                if (previousValue != value)
+                    state.memoryHash ^= get_memory_hash_key(byteAddress, previousValue) ^ get_memory_hash_key(byteAddress, value);
+            }
+
+            u8* pageBytes = get_writable_page(state, currentAddress / MemoryPageSizeInBytes, chunkSize != MemoryPageSizeInBytes);
+
+            std::memcpy(&pageBytes[pageOffset], &input[offset], chunkSize);
+            offset += chunkSize;
+        }
+    }
 }
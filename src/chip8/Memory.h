@@ -7,8 +7,13 @@
 
 #pragma once
 
+#include "EmuExport.h"
+#include "Cpu.h"
+
 #include "core/Types.h"
 
+#include <atomic>
+
 namespace chip8
 {
     enum class MemoryUsage
@@ -20,4 +25,36 @@ namespace chip8
 
     u16 load_u16_big_endian(const u8* rawMem);
     bool is_valid_memory_range(u16 baseAddress, u16 sizeInBytes, MemoryUsage usage);
+
+    // Fixed set of pages living in caller-provided storage, recycled through a lock-free free list.
+    struct MemoryPageAllocator
+    {
+        MemoryPage* pages;
+        u32 pageCount;
+        std::atomic<u64> freeListHead;
+    };
+
+    CHIP8EMU_EMU_API void init_memory_page_allocator(MemoryPageAllocator& allocator, MemoryPage* pages, u32 pageCount);
+
+    // Returns a page with a reference count of one and uninitialized contents.
+    // Falls back to the heap if the allocator is null or exhausted.
+    CHIP8EMU_EMU_API MemoryPage* allocate_memory_page(MemoryPageAllocator* allocator);
+    CHIP8EMU_EMU_API void acquire_memory_page(MemoryPage* page);
+    CHIP8EMU_EMU_API void release_memory_page(MemoryPage* page);
+
+    // The pointer is only valid up to the end of the page containing the address.
+    inline const u8* get_memory_pointer(const CPUState& state, u16 address)
+    {
+        return &state.memoryPages[address / MemoryPageSizeInBytes]->bytes[address % MemoryPageSizeInBytes];
+    }
+
+    inline u8 read_memory(const CPUState& state, u16 address)
+    {
+        return *get_memory_pointer(state, address);
+    }
+
+    // Writes go through these so shared pages get copied first.
+    CHIP8EMU_EMU_API void write_memory(CPUState& state, u16 address, u8 value);
+    CHIP8EMU_EMU_API void read_memory_range(const CPUState& state, u16 address, u8* output, u16 sizeInBytes);
+    CHIP8EMU_EMU_API void write_memory_range(CPUState& state, u16 address, const u8* input, u16 sizeInBytes);
 }
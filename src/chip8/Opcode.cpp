@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Opcode.h"
+
+#include "core/Assert.h"
+
+#include <cstdio>
+
+namespace chip8
+{
+    namespace
+    {
+        // Indexed by OpcodeClass.
+        const OpcodeInfo OpcodeTable[] = {
+            {0xFFFF, 0x00E0, OpcodeFlow::Next, "CLS"},
+            {0xFFFF, 0x00EE, OpcodeFlow::Return, "RET"},
+            {0xF000, 0x0000, OpcodeFlow::Next, "SYS addr"},
+            {0xF000, 0x1000, OpcodeFlow::Jump, "JP addr"},
+            {0xF000, 0x2000, OpcodeFlow::Call, "CALL addr"},
+            {0xF000, 0x3000, OpcodeFlow::Skip, "SE Vx, byte"},
+            {0xF000, 0x4000, OpcodeFlow::Skip, "SNE Vx, byte"},
+            {0xF00F, 0x5000, OpcodeFlow::Skip, "SE Vx, Vy"},
+            {0xF000, 0x6000, OpcodeFlow::Next, "LD Vx, byte"},
+            {0xF000, 0x7000, OpcodeFlow::Next, "ADD Vx, byte"},
+            {0xF00F, 0x8000, OpcodeFlow::Next, "LD Vx, Vy"},
+            {0xF00F, 0x8001, OpcodeFlow::Next, "OR Vx, Vy"},
+            {0xF00F, 0x8002, OpcodeFlow::Next, "AND Vx, Vy"},
+            {0xF00F, 0x8003, OpcodeFlow::Next, "XOR Vx, Vy"},
+            {0xF00F, 0x8004, OpcodeFlow::Next, "ADD Vx, Vy"},
+            {0xF00F, 0x8005, OpcodeFlow::Next, "SUB Vx, Vy"},
+            {0xF00F, 0x8006, OpcodeFlow::Next, "SHR Vx {, Vy}"},
+            {0xF00F, 0x8007, OpcodeFlow::Next, "SUBN Vx, Vy"},
+            {0xF00F, 0x800E, OpcodeFlow::Next, "SHL Vx {, Vy}"},
+            {0xF00F, 0x9000, OpcodeFlow::Skip, "SNE Vx, Vy"},
+            {0xF000, 0xA000, OpcodeFlow::Next, "LD I, addr"},
+            {0xF000, 0xB000, OpcodeFlow::ComputedJump, "JP V0, addr"},
+            {0xF000, 0xC000, OpcodeFlow::Next, "RND Vx, byte"},
+            {0xF000, 0xD000, OpcodeFlow::Next, "DRW Vx, Vy, nibble"},
+            {0xF0FF, 0xE09E, OpcodeFlow::Skip, "SKP Vx"},
+            {0xF0FF, 0xE0A1, OpcodeFlow::Skip, "SKNP Vx"},
+            {0xF0FF, 0xF007, OpcodeFlow::Next, "LD Vx, DT"},
+            {0xF0FF, 0xF00A, OpcodeFlow::Next, "LD Vx, K"},
+            {0xF0FF, 0xF015, OpcodeFlow::Next, "LD DT, Vx"},
+            {0xF0FF, 0xF018, OpcodeFlow::Next, "LD ST, Vx"},
+            {0xF0FF, 0xF01E, OpcodeFlow::Next, "ADD I, Vx"},
+            {0xF0FF, 0xF029, OpcodeFlow::Next, "LD F, Vx"},
+            {0xF0FF, 0xF033, OpcodeFlow::Next, "LD B, Vx"},
+            {0xF0FF, 0xF055, OpcodeFlow::Next, "LD [I], Vx"},
+            {0xF0FF, 0xF065, OpcodeFlow::Next, "LD Vx, [I]"},
+            {0x0000, 0x0000, OpcodeFlow::Invalid, "invalid"},
+        };
+
+        static_assert(sizeof(OpcodeTable) / sizeof(OpcodeTable[0]) == OpcodeClassCount, "one entry per opcode class");
+    }
+
+    const OpcodeInfo& get_opcode_info(OpcodeClass opcodeClass)
+    {
+        const u32 classIndex = static_cast<u32>(opcodeClass);
+        Assert(classIndex < OpcodeClassCount);
+
+        return OpcodeTable[classIndex < OpcodeClassCount ? classIndex : static_cast<u32>(OpcodeClass::Invalid)];
+    }
+
+    const char* get_opcode_class_name(OpcodeClass opcodeClass)
+    {
+        return get_opcode_info(opcodeClass).name;
+    }
+
+    std::string disassemble_instruction(u16 instruction)
+    {
+        const u32 x = (instruction >> 8) & 0x000F;
+        const u32 y = (instruction >> 4) & 0x000F;
+        const u32 n = instruction & 0x000F;
+        const u32 kk = instruction & 0x00FF;
+        const u32 nnn = instruction & 0x0FFF;
+
+        char output[32];
+
+        switch (get_opcode_class(instruction))
+        {
+            case OpcodeClass::Cls:
+                return "CLS";
+            case OpcodeClass::Ret:
+                return "RET";
+            case OpcodeClass::Sys:
+                std::snprintf(output, sizeof(output), "SYS 0x%03X", nnn);
+                break;
+            case OpcodeClass::Jp:
+                std::snprintf(output, sizeof(output), "JP 0x%03X", nnn);
+                break;
+            case OpcodeClass::Call:
+                std::snprintf(output, sizeof(output), "CALL 0x%03X", nnn);
+                break;
+            case OpcodeClass::SeImm:
+                std::snprintf(output, sizeof(output), "SE V%X, 0x%02X", x, kk);
+                break;
+            case OpcodeClass::SneImm:
+                std::snprintf(output, sizeof(output), "SNE V%X, 0x%02X", x, kk);
+                break;
+            case OpcodeClass::SeReg:
+                std::snprintf(output, sizeof(output), "SE V%X, V%X", x, y);
+                break;
+            case OpcodeClass::LdImm:
+                std::snprintf(output, sizeof(output), "LD V%X, 0x%02X", x, kk);
+                break;
+            case OpcodeClass::AddImm:
+                std::snprintf(output, sizeof(output), "ADD V%X, 0x%02X", x, kk);
+                break;
+            case OpcodeClass::LdReg:
+                std::snprintf(output, sizeof(output), "LD V%X, V%X", x, y);
+                break;
+            case OpcodeClass::Or:
+                std::snprintf(output, sizeof(output), "OR V%X, V%X", x, y);
+                break;
+            case OpcodeClass::And:
+                std::snprintf(output, sizeof(output), "AND V%X, V%X", x, y);
+                break;
+            case OpcodeClass::Xor:
+                std::snprintf(output, sizeof(output), "XOR V%X, V%X", x, y);
+                break;
+            case OpcodeClass::AddReg:
+                std::snprintf(output, sizeof(output), "ADD V%X, V%X", x, y);
+                break;
+            case OpcodeClass::Sub:
+                std::snprintf(output, sizeof(output), "SUB V%X, V%X", x, y);
+                break;
+            case OpcodeClass::Shr:
+                std::snprintf(output, sizeof(output), "SHR V%X, V%X", x, y);
+                break;
+            case OpcodeClass::Subn:
+                std::snprintf(output, sizeof(output), "SUBN V%X, V%X", x, y);
+                break;
+            case OpcodeClass::Shl:
+                std::snprintf(output, sizeof(output), "SHL V%X, V%X", x, y);
+                break;
+            case OpcodeClass::SneReg:
+                std::snprintf(output, sizeof(output), "SNE V%X, V%X", x, y);
+                break;
+            case OpcodeClass::LdI:
+                std::snprintf(output, sizeof(output), "LD I, 0x%03X", nnn);
+                break;
+            case OpcodeClass::JpV0:
+                std::snprintf(output, sizeof(output), "JP V0, 0x%03X", nnn);
+                break;
+            case OpcodeClass::Rnd:
+                std::snprintf(output, sizeof(output), "RND V%X, 0x%02X", x, kk);
+                break;
+            case OpcodeClass::Drw:
+                std::snprintf(output, sizeof(output), "DRW V%X, V%X, %u", x, y, n);
+                break;
+            case OpcodeClass::Skp:
+                std::snprintf(output, sizeof(output), "SKP V%X", x);
+                break;
+            case OpcodeClass::Sknp:
+                std::snprintf(output, sizeof(output), "SKNP V%X", x);
+                break;
+            case OpcodeClass::LdVxDt:
+                std::snprintf(output, sizeof(output), "LD V%X, DT", x);
+                break;
+            case OpcodeClass::LdVxK:
+                std::snprintf(output, sizeof(output), "LD V%X, K", x);
+                break;
+            case OpcodeClass::LdDtVx:
+                std::snprintf(output, sizeof(output), "LD DT, V%X", x);
+                break;
+            case OpcodeClass::LdStVx:
+                std::snprintf(output, sizeof(output), "LD ST, V%X", x);
+                break;
+            case OpcodeClass::AddI:
+                std::snprintf(output, sizeof(output), "ADD I, V%X", x);
+                break;
+            case OpcodeClass::LdF:
+                std::snprintf(output, sizeof(output), "LD F, V%X", x);
+                break;
+            case OpcodeClass::LdB:
+                std::snprintf(output, sizeof(output), "LD B, V%X", x);
+                break;
+            case OpcodeClass::LdIVx:
+                std::snprintf(output, sizeof(output), "LD [I], V%X", x);
+                break;
+            case OpcodeClass::LdVxI:
+                std::snprintf(output, sizeof(output), "LD V%X, [I]", x);
+                break;
+            case OpcodeClass::Invalid:
+                std::snprintf(output, sizeof(output), "DW 0x%04X", static_cast<u32>(instruction));
+                break;
+            case OpcodeClass::Count:
+                AssertUnreachable();
+                return "unknown";
+        }
+
+        return output;
+    }
+}
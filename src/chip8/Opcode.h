@@ -0,0 +1,191 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+
+#include "core/Types.h"
+
+#include <string>
+
+namespace chip8
+{
+    // One entry per instruction form, operands left out.
+    enum class OpcodeClass : u8
+    {
+        Cls,     // 00E0 - CLS
+        Ret,     // 00EE - RET
+        Sys,     // 0nnn - SYS addr
+        Jp,      // 1nnn - JP addr
+        Call,    // 2nnn - CALL addr
+        SeImm,   // 3xkk - SE Vx, byte
+        SneImm,  // 4xkk - SNE Vx, byte
+        SeReg,   // 5xy0 - SE Vx, Vy
+        LdImm,   // 6xkk - LD Vx, byte
+        AddImm,  // 7xkk - ADD Vx, byte
+        LdReg,   // 8xy0 - LD Vx, Vy
+        Or,      // 8xy1 - OR Vx, Vy
+        And,     // 8xy2 - AND Vx, Vy
+        Xor,     // 8xy3 - XOR Vx, Vy
+        AddReg,  // 8xy4 - ADD Vx, Vy
+        Sub,     // 8xy5 - SUB Vx, Vy
+        Shr,     // 8xy6 - SHR Vx {, Vy}
+        Subn,    // 8xy7 - SUBN Vx, Vy
+        Shl,     // 8xyE - SHL Vx {, Vy}
+        SneReg,  // 9xy0 - SNE Vx, Vy
+        LdI,     // Annn - LD I, addr
+        JpV0,    // Bnnn - JP V0, addr
+        Rnd,     // Cxkk - RND Vx, byte
+        Drw,     // Dxyn - DRW Vx, Vy, nibble
+        Skp,     // Ex9E - SKP Vx
+        Sknp,    // ExA1 - SKNP Vx
+        LdVxDt,  // Fx07 - LD Vx, DT
+        LdVxK,   // Fx0A - LD Vx, K
+        LdDtVx,  // Fx15 - LD DT, Vx
+        LdStVx,  // Fx18 - LD ST, Vx
+        AddI,    // Fx1E - ADD I, Vx
+        LdF,     // Fx29 - LD F, Vx
+        LdB,     // Fx33 - LD B, Vx
+        LdIVx,   // Fx55 - LD [I], Vx
+        LdVxI,   // Fx65 - LD Vx, [I]
+        Invalid, // Anything execute_instruction() would reject
+        Count,
+    };
+
+    static const u32 OpcodeClassCount = static_cast<u32>(OpcodeClass::Count);
+
+    // Where the pc goes after an instruction form, as seen by the checked interpreter when nothing asserts.
+    enum class OpcodeFlow : u8
+    {
+        Next,         // pc + 2, LD Vx, K included once a key is down
+        Skip,         // pc + 2 or pc + 4
+        Jump,         // nnn
+        ComputedJump, // nnn + V0, or nnn + Vx with QuirkJumpVx
+        Call,         // nnn, then back to pc + 2 on RET
+        Return,       // Top of the stack + 2
+        Invalid,      // Asserts, then goes on to pc + 2
+    };
+
+    // The opcode table, one entry per class. Every instruction of a class matches its mask and pattern.
+    struct OpcodeInfo
+    {
+        u16 mask;         // Bits that identify the class, 0 for Invalid
+        u16 pattern;      // Their value
+        OpcodeFlow flow;
+        const char* name; // Mnemonic with operand placeholders, e.g. "LD Vx, byte"
+    };
+
+    CHIP8EMU_EMU_API const OpcodeInfo& get_opcode_info(OpcodeClass opcodeClass);
+
+    // The decoder of the interpreter, inlined in its dispatch.
+    inline OpcodeClass get_opcode_class(u16 instruction)
+    {
+        switch (instruction >> 12)
+        {
+            case 0x0:
+                if (instruction == 0x00E0)
+                    return OpcodeClass::Cls;
+                if (instruction == 0x00EE)
+                    return OpcodeClass::Ret;
+                return OpcodeClass::Sys;
+            case 0x1:
+                return OpcodeClass::Jp;
+            case 0x2:
+                return OpcodeClass::Call;
+            case 0x3:
+                return OpcodeClass::SeImm;
+            case 0x4:
+                return OpcodeClass::SneImm;
+            case 0x5:
+                return (instruction & 0x000F) == 0x0 ? OpcodeClass::SeReg : OpcodeClass::Invalid;
+            case 0x6:
+                return OpcodeClass::LdImm;
+            case 0x7:
+                return OpcodeClass::AddImm;
+            case 0x8:
+                switch (instruction & 0x000F)
+                {
+                    case 0x0:
+                        return OpcodeClass::LdReg;
+                    case 0x1:
+                        return OpcodeClass::Or;
+                    case 0x2:
+                        return OpcodeClass::And;
+                    case 0x3:
+                        return OpcodeClass::Xor;
+                    case 0x4:
+                        return OpcodeClass::AddReg;
+                    case 0x5:
+                        return OpcodeClass::Sub;
+                    case 0x6:
+                        return OpcodeClass::Shr;
+                    case 0x7:
+                        return OpcodeClass::Subn;
+                    case 0xE:
+                        return OpcodeClass::Shl;
+                    default:
+                        return OpcodeClass::Invalid;
+                }
+            case 0x9:
+                return (instruction & 0x000F) == 0x0 ? OpcodeClass::SneReg : OpcodeClass::Invalid;
+            case 0xA:
+                return OpcodeClass::LdI;
+            case 0xB:
+                return OpcodeClass::JpV0;
+            case 0xC:
+                return OpcodeClass::Rnd;
+            case 0xD:
+                return OpcodeClass::Drw;
+            case 0xE:
+                switch (instruction & 0x00FF)
+                {
+                    case 0x9E:
+                        return OpcodeClass::Skp;
+                    case 0xA1:
+                        return OpcodeClass::Sknp;
+                    default:
+                        return OpcodeClass::Invalid;
+                }
+            default:
+                switch (instruction & 0x00FF)
+                {
+                    case 0x07:
+                        return OpcodeClass::LdVxDt;
+                    case 0x0A:
+                        return OpcodeClass::LdVxK;
+                    case 0x15:
+                        return OpcodeClass::LdDtVx;
+                    case 0x18:
+                        return OpcodeClass::LdStVx;
+                    case 0x1E:
+                        return OpcodeClass::AddI;
+                    case 0x29:
+                        return OpcodeClass::LdF;
+                    case 0x33:
+                        return OpcodeClass::LdB;
+                    case 0x55:
+                        return OpcodeClass::LdIVx;
+                    case 0x65:
+                        return OpcodeClass::LdVxI;
+                    default:
+                        return OpcodeClass::Invalid;
+                }
+        }
+    }
+
+    inline OpcodeFlow get_opcode_flow(u16 instruction)
+    {
+        return get_opcode_info(get_opcode_class(instruction)).flow;
+    }
+
+    CHIP8EMU_EMU_API const char* get_opcode_class_name(OpcodeClass opcodeClass);
+
+    // Mnemonic with the operands filled in, e.g. "LD V3, 0x12".
+    // Invalid instructions come out as raw data: "DW 0x5121".
+    CHIP8EMU_EMU_API std::string disassemble_instruction(u16 instruction);
+}
@@ -0,0 +1,337 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "OpcodeStats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+#if defined(CHIP8EMU_OPCODE_STATS)
+#    include <atomic>
+#    include <mutex>
+#endif
+
+namespace chip8
+{
+    namespace
+    {
+        static const u32 FullOpcodeCount = 0x10000;
+        static const u32 ReportedFullOpcodeCount = 16;
+
+#if defined(CHIP8EMU_OPCODE_STATS)
+        struct ThreadOpcodeStats;
+
+        // Threads record into their own stats, the registry only gets touched when a thread
+        // starts, exits, or someone asks for a report.
+        struct OpcodeStatsRegistry
+        {
+            std::mutex mutex;
+            std::vector<ThreadOpcodeStats*> threads;
+            OpcodeStats exitedThreadStats;
+            std::vector<u64> exitedThreadOpcodeCounts;
+            std::atomic<bool> isFullOpcodeStatsEnabled;
+        };
+
+        OpcodeStatsRegistry& get_registry()
+        {
+            static OpcodeStatsRegistry registry = {};
+            return registry;
+        }
+
+        struct ThreadOpcodeClassStats
+        {
+            std::atomic<u64> executionCount;
+            std::atomic<u64> totalTicks;
+            std::atomic<u64> costHistogram[OpcodeCostBucketCount];
+        };
+
+        // Queries read the counters while the thread keeps incrementing them, so they are all atomics.
+        // Relaxed is enough, nothing else gets published through them.
+        struct ThreadOpcodeStats
+        {
+            ThreadOpcodeClassStats classes[OpcodeClassCount];
+            std::atomic<std::atomic<u64>*> opcodeCounts; // FullOpcodeCount counters, allocated on first use
+
+            ThreadOpcodeStats()
+                : classes()
+                , opcodeCounts(nullptr)
+            {
+                OpcodeStatsRegistry& registry = get_registry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+
+                registry.threads.push_back(this);
+            }
+
+            ~ThreadOpcodeStats()
+            {
+                OpcodeStatsRegistry& registry = get_registry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+
+                merge_thread_opcode_stats(registry.exitedThreadStats, *this);
+
+                if (const std::atomic<u64>* counts = opcodeCounts.load(std::memory_order_acquire))
+                {
+                    registry.exitedThreadOpcodeCounts.resize(FullOpcodeCount, 0);
+
+                    for (u32 opcode = 0; opcode < FullOpcodeCount; opcode++)
+                        registry.exitedThreadOpcodeCounts[opcode] += counts[opcode].load(std::memory_order_relaxed);
+                }
+
+                registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+
+                delete[] opcodeCounts.load(std::memory_order_relaxed);
+            }
+
+            static void merge_thread_opcode_stats(OpcodeStats& stats, const ThreadOpcodeStats& threadStats)
+            {
+                for (u32 classIndex = 0; classIndex < OpcodeClassCount; classIndex++)
+                {
+                    OpcodeClassStats& classStats = stats.classes[classIndex];
+                    const ThreadOpcodeClassStats& threadClassStats = threadStats.classes[classIndex];
+
+                    classStats.executionCount += threadClassStats.executionCount.load(std::memory_order_relaxed);
+                    classStats.totalTicks += threadClassStats.totalTicks.load(std::memory_order_relaxed);
+
+                    for (u32 bucketIndex = 0; bucketIndex < OpcodeCostBucketCount; bucketIndex++)
+                        classStats.costHistogram[bucketIndex] +=
+                            threadClassStats.costHistogram[bucketIndex].load(std::memory_order_relaxed);
+                }
+            }
+        };
+
+        thread_local ThreadOpcodeStats threadOpcodeStats;
+
+        u32 get_cost_bucket_index(u64 ticks)
+        {
+            u32 bucketIndex = 0;
+
+            while (ticks > 1 && bucketIndex + 1 < OpcodeCostBucketCount)
+            {
+                ticks >>= 1;
+                bucketIndex++;
+            }
+
+            return bucketIndex;
+        }
+
+        // One lock for the whole table, a report would otherwise take it once per opcode.
+        void get_full_opcode_counts(std::vector<u64>& opcodeCounts)
+        {
+            OpcodeStatsRegistry& registry = get_registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+
+            opcodeCounts = registry.exitedThreadOpcodeCounts;
+            opcodeCounts.resize(FullOpcodeCount, 0);
+
+            for (const ThreadOpcodeStats* threadStats : registry.threads)
+            {
+                if (const std::atomic<u64>* counts = threadStats->opcodeCounts.load(std::memory_order_acquire))
+                {
+                    for (u32 opcode = 0; opcode < FullOpcodeCount; opcode++)
+                        opcodeCounts[opcode] += counts[opcode].load(std::memory_order_relaxed);
+                }
+            }
+        }
+#else
+        void get_full_opcode_counts(std::vector<u64>& opcodeCounts)
+        {
+            opcodeCounts.assign(FullOpcodeCount, 0);
+        }
+#endif
+    }
+
+#if defined(CHIP8EMU_OPCODE_STATS)
+    void record_opcode_execution(u16 instruction, u64 ticks)
+    {
+        ThreadOpcodeStats& threadStats = threadOpcodeStats;
+        ThreadOpcodeClassStats& classStats = threadStats.classes[static_cast<u32>(get_opcode_class(instruction))];
+
+        classStats.executionCount.fetch_add(1, std::memory_order_relaxed);
+        classStats.totalTicks.fetch_add(ticks, std::memory_order_relaxed);
+        classStats.costHistogram[get_cost_bucket_index(ticks)].fetch_add(1, std::memory_order_relaxed);
+
+        if (get_registry().isFullOpcodeStatsEnabled.load(std::memory_order_relaxed))
+        {
+            std::atomic<u64>* counts = threadStats.opcodeCounts.load(std::memory_order_relaxed);
+
+            // Only this thread allocates its counters, queries pick them up with an acquire load.
+            if (counts == nullptr)
+            {
+                counts = new std::atomic<u64>[FullOpcodeCount]();
+                threadStats.opcodeCounts.store(counts, std::memory_order_release);
+            }
+
+            counts[instruction].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void set_full_opcode_stats_enabled(bool enabled)
+    {
+        get_registry().isFullOpcodeStatsEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void get_opcode_stats(OpcodeStats& stats)
+    {
+        OpcodeStatsRegistry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        stats = registry.exitedThreadStats;
+
+        for (const ThreadOpcodeStats* threadStats : registry.threads)
+            ThreadOpcodeStats::merge_thread_opcode_stats(stats, *threadStats);
+    }
+
+    u64 get_full_opcode_count(u16 instruction)
+    {
+        OpcodeStatsRegistry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        u64 count = registry.exitedThreadOpcodeCounts.empty() ? 0 : registry.exitedThreadOpcodeCounts[instruction];
+
+        for (const ThreadOpcodeStats* threadStats : registry.threads)
+        {
+            if (const std::atomic<u64>* counts = threadStats->opcodeCounts.load(std::memory_order_acquire))
+                count += counts[instruction].load(std::memory_order_relaxed);
+        }
+
+        return count;
+    }
+
+    void reset_opcode_stats()
+    {
+        OpcodeStatsRegistry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        registry.exitedThreadStats = {};
+        registry.exitedThreadOpcodeCounts.clear();
+
+        for (ThreadOpcodeStats* threadStats : registry.threads)
+        {
+            for (ThreadOpcodeClassStats& classStats : threadStats->classes)
+            {
+                classStats.executionCount.store(0, std::memory_order_relaxed);
+                classStats.totalTicks.store(0, std::memory_order_relaxed);
+
+                for (std::atomic<u64>& bucketCount : classStats.costHistogram)
+                    bucketCount.store(0, std::memory_order_relaxed);
+            }
+
+            if (std::atomic<u64>* counts = threadStats->opcodeCounts.load(std::memory_order_acquire))
+            {
+                for (u32 opcode = 0; opcode < FullOpcodeCount; opcode++)
+                    counts[opcode].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+#else
+    void set_full_opcode_stats_enabled(bool) {}
+
+    void get_opcode_stats(OpcodeStats& stats)
+    {
+        stats = {};
+    }
+
+    u64 get_full_opcode_count(u16)
+    {
+        return 0;
+    }
+
+    void reset_opcode_stats() {}
+#endif
+
+    void print_opcode_stats(std::ostream& output)
+    {
+        if (!areOpcodeStatsEnabled())
+        {
+            output << "opcode stats are disabled, configure with CHIP8EMU_ENABLE_OPCODE_STATS=ON" << std::endl;
+            return;
+        }
+
+        OpcodeStats stats;
+        get_opcode_stats(stats);
+
+        u64 totalExecutionCount = 0;
+
+        for (const OpcodeClassStats& classStats : stats.classes)
+            totalExecutionCount += classStats.executionCount;
+
+        // Most executed first, that's where the fast paths should go.
+        u32 classOrder[OpcodeClassCount];
+
+        for (u32 classIndex = 0; classIndex < OpcodeClassCount; classIndex++)
+            classOrder[classIndex] = classIndex;
+
+        std::stable_sort(classOrder, classOrder + OpcodeClassCount, [&stats](u32 lhs, u32 rhs) {
+            return stats.classes[lhs].executionCount > stats.classes[rhs].executionCount;
+        });
+
+        output << std::left << std::setw(24) << "opcode class" << std::right << std::setw(16) << "count" << std::setw(10)
+               << "share" << std::setw(14) << "avg ticks" << "  cost histogram (ticks: share)" << std::endl;
+
+        for (u32 classIndex : classOrder)
+        {
+            const OpcodeClassStats& classStats = stats.classes[classIndex];
+
+            if (classStats.executionCount == 0)
+                continue;
+
+            const f64 executionCount = static_cast<f64>(classStats.executionCount);
+
+            output << std::left << std::setw(24) << get_opcode_class_name(static_cast<OpcodeClass>(classIndex))
+                   << std::right << std::setw(16) << classStats.executionCount << std::fixed << std::setprecision(1)
+                   << std::setw(9) << 100.0 * executionCount / static_cast<f64>(totalExecutionCount) << '%'
+                   << std::setw(14) << static_cast<f64>(classStats.totalTicks) / executionCount << ' ';
+
+            for (u32 bucketIndex = 0; bucketIndex < OpcodeCostBucketCount; bucketIndex++)
+            {
+                const u64 bucketCount = classStats.costHistogram[bucketIndex];
+
+                if (bucketCount == 0)
+                    continue;
+
+                output << ' ' << (u64(1) << bucketIndex) << (bucketIndex + 1 < OpcodeCostBucketCount ? "" : "+") << ": "
+                       << std::setprecision(1) << 100.0 * static_cast<f64>(bucketCount) / executionCount << '%';
+            }
+
+            output << std::endl;
+        }
+
+        output << "total: " << totalExecutionCount << " instructions" << std::endl;
+
+        std::vector<u64> fullOpcodeCounts;
+        get_full_opcode_counts(fullOpcodeCounts);
+
+        std::vector<std::pair<u64, u16>> opcodeCounts;
+
+        for (u32 opcode = 0; opcode < FullOpcodeCount; opcode++)
+        {
+            if (fullOpcodeCounts[opcode] > 0)
+                opcodeCounts.emplace_back(fullOpcodeCounts[opcode], static_cast<u16>(opcode));
+        }
+
+        if (opcodeCounts.empty())
+            return;
+
+        const size_t reportedCount = std::min<size_t>(ReportedFullOpcodeCount, opcodeCounts.size());
+
+        std::partial_sort(opcodeCounts.begin(), opcodeCounts.begin() + static_cast<std::ptrdiff_t>(reportedCount),
+                          opcodeCounts.end(), [](const std::pair<u64, u16>& lhs, const std::pair<u64, u16>& rhs) {
+                              return lhs.first > rhs.first;
+                          });
+
+        output << "most executed opcodes:" << std::endl;
+
+        for (size_t index = 0; index < reportedCount; index++)
+        {
+            output << "  " << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << opcodeCounts[index].second
+                   << std::dec << std::nouppercase << std::setfill(' ') << std::setw(16) << opcodeCounts[index].first
+                   << "  " << get_opcode_class_name(get_opcode_class(opcodeCounts[index].second)) << std::endl;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Opcode.h"
+
+#include "core/Types.h"
+
+#include <iosfwd>
+
+// Instrumentation of execute_instruction(), configure with CHIP8EMU_ENABLE_OPCODE_STATS=ON to get it.
+// Without it the hooks compile to nothing and the queries below return empty stats.
+// Costs are read from the TSC on x86, other targets fall back to std::chrono::steady_clock.
+#if defined(CHIP8EMU_OPCODE_STATS)
+#    if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#        define CHIP8EMU_OPCODE_STATS_TSC
+#        if defined(_MSC_VER)
+#            include <intrin.h>
+#        else
+#            include <x86intrin.h>
+#        endif
+#    else
+#        include <chrono>
+#    endif
+#endif
+
+namespace chip8
+{
+    // Bucket n counts the executions that took [2^n, 2^(n+1)) ticks, the last one is open ended.
+    // Ticks are TSC ticks on x86 and steady_clock ticks elsewhere, usually nanoseconds.
+    // They include reading the counter itself, a few dozens TSC ticks on recent CPUs.
+    static const u32 OpcodeCostBucketCount = 16;
+
+    struct OpcodeClassStats
+    {
+        u64 executionCount;
+        u64 totalTicks;
+        u64 costHistogram[OpcodeCostBucketCount];
+    };
+
+    struct OpcodeStats
+    {
+        OpcodeClassStats classes[OpcodeClassCount];
+    };
+
+    constexpr bool areOpcodeStatsEnabled()
+    {
+#if defined(CHIP8EMU_OPCODE_STATS)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Counting every full opcode costs an extra 512 KiB per emulation thread, so it is opt-in.
+    CHIP8EMU_EMU_API void set_full_opcode_stats_enabled(bool enabled);
+
+    // Stats are kept per thread in relaxed atomics and merged here. Threads still emulating
+    // while this runs give approximate results.
+    CHIP8EMU_EMU_API void get_opcode_stats(OpcodeStats& stats);
+    CHIP8EMU_EMU_API u64 get_full_opcode_count(u16 instruction);
+    CHIP8EMU_EMU_API void reset_opcode_stats();
+
+    CHIP8EMU_EMU_API void print_opcode_stats(std::ostream& output);
+
+#if defined(CHIP8EMU_OPCODE_STATS)
+    CHIP8EMU_EMU_API void record_opcode_execution(u16 instruction, u64 ticks);
+
+    inline u64 read_opcode_stats_ticks()
+    {
+#    if defined(CHIP8EMU_OPCODE_STATS_TSC)
+        return __rdtsc();
+#    else
+        return static_cast<u64>(std::chrono::steady_clock::now().time_since_epoch().count());
+#    endif
+    }
+
+    struct OpcodeStatsScope
+    {
+        u16 instruction;
+        u64 startTicks;
+
+        explicit OpcodeStatsScope(u16 scopeInstruction)
+            : instruction(scopeInstruction)
+            , startTicks(read_opcode_stats_ticks())
+        {}
+
+        ~OpcodeStatsScope() { record_opcode_execution(instruction, read_opcode_stats_ticks() - startTicks); }
+    };
+
+#    define CHIP8EMU_OPCODE_STATS_SCOPE(instruction) chip8::OpcodeStatsScope opcodeStatsScope(instruction)
+#else
+#    define CHIP8EMU_OPCODE_STATS_SCOPE(instruction) static_cast<void>(0)
+#endif
+}
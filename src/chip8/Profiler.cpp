@@ -0,0 +1,279 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Profiler.h"
+
+#include "core/Assert.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+namespace chip8
+{
+    namespace
+    {
+        struct FunctionProfile
+        {
+            u16 functionAddress;
+            u64 selfCount;
+            u64 inclusiveCount;
+        };
+
+        u32 add_call_node(Profiler& profiler, u16 functionAddress, u32 parentIndex)
+        {
+            const u32 nodeIndex = static_cast<u32>(profiler.callNodes.size());
+
+            profiler.callNodes.push_back({functionAddress, parentIndex, InvalidCallNodeIndex, InvalidCallNodeIndex, 0});
+
+            if (parentIndex != InvalidCallNodeIndex)
+            {
+                ProfilerCallNode& parent = profiler.callNodes[parentIndex];
+
+                profiler.callNodes[nodeIndex].nextSiblingIndex = parent.firstChildIndex;
+                parent.firstChildIndex = nodeIndex;
+            }
+
+            return nodeIndex;
+        }
+
+        void enter_function(Profiler& profiler, u16 functionAddress)
+        {
+            // Unchecked stacks wrap around and can keep calling forever.
+            if (profiler.currentCallDepth >= StackSize)
+                return;
+
+            const u32 parentIndex = profiler.currentCallNodeIndex;
+
+            profiler.currentCallDepth++;
+
+            for (u32 childIndex = profiler.callNodes[parentIndex].firstChildIndex; childIndex != InvalidCallNodeIndex;
+                 childIndex = profiler.callNodes[childIndex].nextSiblingIndex)
+            {
+                if (profiler.callNodes[childIndex].functionAddress == functionAddress)
+                {
+                    profiler.currentCallNodeIndex = childIndex;
+                    return;
+                }
+            }
+
+            profiler.currentCallNodeIndex = add_call_node(profiler, functionAddress, parentIndex);
+        }
+
+        void leave_function(Profiler& profiler)
+        {
+            // Profiling may have started in the middle of a call.
+            if (profiler.currentCallDepth == 0)
+                return;
+
+            profiler.currentCallNodeIndex = profiler.callNodes[profiler.currentCallNodeIndex].parentIndex;
+            profiler.currentCallDepth--;
+        }
+
+        // Children always come after their parent, so a single backward pass is enough.
+        std::vector<u64> compute_subtree_counts(const Profiler& profiler)
+        {
+            std::vector<u64> subtreeCounts(profiler.callNodes.size(), 0);
+
+            for (size_t nodeIndex = profiler.callNodes.size(); nodeIndex-- > 0;)
+            {
+                const ProfilerCallNode& node = profiler.callNodes[nodeIndex];
+
+                subtreeCounts[nodeIndex] += node.selfCount;
+
+                if (node.parentIndex != InvalidCallNodeIndex)
+                    subtreeCounts[node.parentIndex] += subtreeCounts[nodeIndex];
+            }
+
+            return subtreeCounts;
+        }
+
+        bool has_ancestor_function(const Profiler& profiler, u32 nodeIndex, u16 functionAddress)
+        {
+            u32 ancestorIndex = profiler.callNodes[nodeIndex].parentIndex;
+
+            while (ancestorIndex != RootCallNodeIndex)
+            {
+                if (profiler.callNodes[ancestorIndex].functionAddress == functionAddress)
+                    return true;
+
+                ancestorIndex = profiler.callNodes[ancestorIndex].parentIndex;
+            }
+
+            return false;
+        }
+
+        u64 get_inclusive_count(const Profiler& profiler, const std::vector<u64>& subtreeCounts, u16 functionAddress)
+        {
+            u64 count = 0;
+
+            for (u32 nodeIndex = 1; nodeIndex < profiler.callNodes.size(); nodeIndex++)
+            {
+                if (profiler.callNodes[nodeIndex].functionAddress == functionAddress
+                    && !has_ancestor_function(profiler, nodeIndex, functionAddress))
+                {
+                    count += subtreeCounts[nodeIndex];
+                }
+            }
+
+            return count;
+        }
+
+        std::string get_call_path(const Profiler& profiler, u32 nodeIndex)
+        {
+            std::string path;
+
+            for (; nodeIndex != RootCallNodeIndex; nodeIndex = profiler.callNodes[nodeIndex].parentIndex)
+            {
+                static const char HexDigits[] = "0123456789abcdef";
+                const u16 address = profiler.callNodes[nodeIndex].functionAddress;
+                const char frame[] = {';',
+                                      '0',
+                                      'x',
+                                      HexDigits[(address >> 8) & 0xF],
+                                      HexDigits[(address >> 4) & 0xF],
+                                      HexDigits[address & 0xF]};
+
+                path.insert(0, frame, sizeof(frame));
+            }
+
+            return "main" + path;
+        }
+
+        f64 get_share(u64 count, u64 total)
+        {
+            return total > 0 ? 100.0 * static_cast<f64>(count) / static_cast<f64>(total) : 0.0;
+        }
+    }
+
+    Profiler* createProfiler()
+    {
+        Profiler* profiler = new Profiler;
+
+        reset_profiler(*profiler);
+
+        return profiler;
+    }
+
+    void destroyProfiler(Profiler* profiler)
+    {
+        Assert(profiler != nullptr);
+
+        delete profiler;
+    }
+
+    void reset_profiler(Profiler& profiler)
+    {
+        std::fill(profiler.pcCounts, profiler.pcCounts + MemorySizeInBytes, 0);
+
+        profiler.callNodes.clear();
+        profiler.currentCallNodeIndex = add_call_node(profiler, MinProgramAddress, InvalidCallNodeIndex);
+        profiler.currentCallDepth = 0;
+        profiler.instructionCount = 0;
+    }
+
+    void profile_instruction(Profiler& profiler, const CPUState& state, u16 pc, u8 previousSp)
+    {
+        profiler.pcCounts[pc & (MemorySizeInBytes - 1)]++;
+        profiler.callNodes[profiler.currentCallNodeIndex].selfCount++;
+        profiler.instructionCount++;
+
+        // The CALL itself is counted in the caller, the RET in the callee.
+        // Any other change of sp is an unchecked wrap around that we can't follow.
+        if (state.sp == static_cast<u8>(previousSp + 1))
+            enter_function(profiler, state.pc);
+        else if (state.sp == static_cast<u8>(previousSp - 1))
+            leave_function(profiler);
+    }
+
+    u64 get_inclusive_function_count(const Profiler& profiler, u16 functionAddress)
+    {
+        return get_inclusive_count(profiler, compute_subtree_counts(profiler), functionAddress);
+    }
+
+    void print_profiler_report(const Profiler& profiler, std::ostream& output, u32 maxEntryCount)
+    {
+        const u64 total = profiler.instructionCount;
+
+        std::vector<u16> addresses;
+
+        for (u32 address = 0; address < MemorySizeInBytes; address++)
+        {
+            if (profiler.pcCounts[address] > 0)
+                addresses.push_back(static_cast<u16>(address));
+        }
+
+        std::stable_sort(addresses.begin(), addresses.end(), [&profiler](u16 lhs, u16 rhs) {
+            return profiler.pcCounts[lhs] > profiler.pcCounts[rhs];
+        });
+
+        output << "hotspots (" << total << " instructions)" << std::endl;
+        output << std::setw(8) << "pc" << std::setw(16) << "count" << std::setw(10) << "share" << std::endl;
+
+        for (size_t index = 0; index < std::min<size_t>(addresses.size(), maxEntryCount); index++)
+        {
+            const u16 address = addresses[index];
+
+            output << std::setw(8) << std::hex << std::showbase << address << std::dec << std::noshowbase << std::setw(16)
+                   << profiler.pcCounts[address] << std::fixed << std::setprecision(1) << std::setw(9)
+                   << get_share(profiler.pcCounts[address], total) << '%' << std::endl;
+        }
+
+        // Aggregate the call paths per function.
+        const std::vector<u64> subtreeCounts = compute_subtree_counts(profiler);
+        std::vector<FunctionProfile> functions;
+
+        for (u32 nodeIndex = 1; nodeIndex < profiler.callNodes.size(); nodeIndex++)
+        {
+            const ProfilerCallNode& node = profiler.callNodes[nodeIndex];
+            const auto it = std::find_if(functions.begin(), functions.end(), [&node](const FunctionProfile& function) {
+                return function.functionAddress == node.functionAddress;
+            });
+
+            if (it != functions.end())
+                it->selfCount += node.selfCount;
+            else
+                functions.push_back({node.functionAddress, node.selfCount, 0});
+        }
+
+        for (FunctionProfile& function : functions)
+            function.inclusiveCount = get_inclusive_count(profiler, subtreeCounts, function.functionAddress);
+
+        std::stable_sort(functions.begin(), functions.end(), [](const FunctionProfile& lhs, const FunctionProfile& rhs) {
+            return lhs.inclusiveCount > rhs.inclusiveCount;
+        });
+
+        output << "functions" << std::endl << std::fixed << std::setprecision(1);
+        output << std::setw(8) << "address" << std::setw(16) << "self" << std::setw(10) << "share" << std::setw(16)
+               << "inclusive" << std::setw(10) << "share" << std::endl;
+        output << std::setw(8) << "main" << std::setw(16) << profiler.callNodes[RootCallNodeIndex].selfCount << std::setw(9)
+               << get_share(profiler.callNodes[RootCallNodeIndex].selfCount, total) << '%' << std::setw(16) << total
+               << std::setw(9) << get_share(total, total) << '%' << std::endl;
+
+        for (size_t index = 0; index < std::min<size_t>(functions.size(), maxEntryCount); index++)
+        {
+            const FunctionProfile& function = functions[index];
+
+            output << std::setw(8) << std::hex << std::showbase << function.functionAddress << std::dec
+                   << std::noshowbase << std::setw(16) << function.selfCount << std::setw(9)
+                   << get_share(function.selfCount, total) << '%' << std::setw(16) << function.inclusiveCount
+                   << std::setw(9) << get_share(function.inclusiveCount, total) << '%' << std::endl;
+        }
+    }
+
+    void write_folded_stacks(const Profiler& profiler, std::ostream& output)
+    {
+        for (u32 nodeIndex = 0; nodeIndex < profiler.callNodes.size(); nodeIndex++)
+        {
+            const u64 selfCount = profiler.callNodes[nodeIndex].selfCount;
+
+            if (selfCount > 0)
+                output << get_call_path(profiler, nodeIndex) << ' ' << selfCount << '\n';
+        }
+    }
+}
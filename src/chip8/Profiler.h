@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+
+#include <iosfwd>
+#include <vector>
+
+namespace chip8
+{
+    static const u32 InvalidCallNodeIndex = 0xFFFFFFFF;
+    static const u32 RootCallNodeIndex = 0;
+
+    // One node per distinct call path, a CALL that pushes on the stack opens a child of the current
+    // node and a RET that pops goes back to the parent. Paths are at most StackSize calls deep.
+    // The root node stands for the code running outside of any call.
+    struct ProfilerCallNode
+    {
+        u16 functionAddress;
+        u32 parentIndex;
+        u32 firstChildIndex;
+        u32 nextSiblingIndex;
+        u64 selfCount; // Instructions executed in this function, on this path
+    };
+
+    // Counts executed instructions by PC and by call path.
+    // Per instruction it costs two increments, so it can stay enabled for long runs.
+    // Not thread-safe: give every emulation thread its own profiler.
+    struct Profiler
+    {
+        u64 pcCounts[MemorySizeInBytes];
+        std::vector<ProfilerCallNode> callNodes;
+        u32 currentCallNodeIndex;
+        u32 currentCallDepth;
+        u64 instructionCount;
+    };
+
+    // Attach it through EmuConfig::profiler to start profiling.
+    CHIP8EMU_EMU_API Profiler* createProfiler();
+    CHIP8EMU_EMU_API void destroyProfiler(Profiler* profiler);
+
+    CHIP8EMU_EMU_API void reset_profiler(Profiler& profiler);
+
+    // Called by execute_step() right after executing the instruction at pc, with the stack pointer
+    // from before it. The call tree follows the stack, so failed calls and returns leave it alone.
+    CHIP8EMU_EMU_API void profile_instruction(Profiler& profiler, const CPUState& state, u16 pc, u8 previousSp);
+
+    // Includes the time spent in the callees. Recursive calls are only counted once.
+    CHIP8EMU_EMU_API u64 get_inclusive_function_count(const Profiler& profiler, u16 functionAddress);
+
+    // Top PCs by execution count, then functions by self and inclusive counts.
+    CHIP8EMU_EMU_API void print_profiler_report(const Profiler& profiler, std::ostream& output, u32 maxEntryCount);
+
+    // One "main;0x2a0;0x2f4 <count>" line per call path, the input format of flame graph tools.
+    CHIP8EMU_EMU_API void write_folded_stacks(const Profiler& profiler, std::ostream& output);
+}
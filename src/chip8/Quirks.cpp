@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Quirks.h"
+
+#include "core/Assert.h"
+
+#include <cstring>
+
+namespace chip8
+{
+    const char* get_quirk_profile_name(QuirkProfile profile)
+    {
+        switch (profile)
+        {
+            case QuirkProfile::Default:
+                return "default";
+            case QuirkProfile::Cosmac:
+                return "cosmac";
+            case QuirkProfile::SuperChip:
+                return "schip";
+            case QuirkProfile::XOChip:
+                return "xochip";
+            case QuirkProfile::Count:
+                break;
+        }
+
+        AssertUnreachable();
+        return "unknown";
+    }
+
+    bool find_quirk_profile(const char* name, QuirkProfile& profile)
+    {
+        Assert(name != nullptr);
+
+        for (u32 profileIndex = 0; profileIndex < QuirkProfileCount; profileIndex++)
+        {
+            if (std::strcmp(get_quirk_profile_name(static_cast<QuirkProfile>(profileIndex)), name) == 0)
+            {
+                profile = static_cast<QuirkProfile>(profileIndex);
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
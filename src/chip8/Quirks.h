@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+
+#include "core/Types.h"
+
+namespace chip8
+{
+    // Instructions whose behavior differs between interpreters, roms are written against one of them.
+    static const u32 QuirkShiftVy = 1 << 0;             // 8xy6/8xyE shift Vy into Vx instead of shifting Vx
+    static const u32 QuirkLoadStoreIncrementI = 1 << 1; // Fx55/Fx65 leave I pointing past the last register
+    static const u32 QuirkJumpVx = 1 << 2;              // Bxnn jumps to xnn + Vx instead of nnn + V0
+    static const u32 QuirkSpriteClip = 1 << 3;          // DRW clips sprites at the screen edges instead of wrapping
+    static const u32 QuirkLogicResetVF = 1 << 4;        // 8xy1/8xy2/8xy3 clear VF
+
+    // The profile is picked once when loading the rom, see EmuConfig::quirkProfile.
+    // execute_step() runs a separate instantiation of the interpreter per profile,
+    // so quirks cost nothing per instruction.
+    enum class QuirkProfile : u8
+    {
+        Default,   // What this emulator always did, no quirks
+        Cosmac,    // Original COSMAC VIP interpreter
+        SuperChip, // SUPER-CHIP 1.1
+        XOChip,    // XO-CHIP, also what most recent roms expect
+        Count,
+    };
+
+    static const u32 QuirkProfileCount = static_cast<u32>(QuirkProfile::Count);
+
+    constexpr u32 get_quirk_flags(QuirkProfile profile)
+    {
+        return profile == QuirkProfile::Cosmac
+                   ? QuirkShiftVy | QuirkLoadStoreIncrementI | QuirkSpriteClip | QuirkLogicResetVF
+                   : profile == QuirkProfile::SuperChip ? QuirkJumpVx | QuirkSpriteClip
+                   : profile == QuirkProfile::XOChip ? QuirkShiftVy | QuirkLoadStoreIncrementI
+                   : 0;
+    }
+
+    CHIP8EMU_EMU_API const char* get_quirk_profile_name(QuirkProfile profile);
+
+    // Returns false if no profile has that name.
+    CHIP8EMU_EMU_API bool find_quirk_profile(const char* name, QuirkProfile& profile);
+}
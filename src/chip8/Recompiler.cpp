@@ -0,0 +1,578 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Recompiler.h"
+
+#include "ControlFlow.h"
+#include "Execution.h"
+#include "Memory.h"
+#include "Opcode.h"
+#include "Verifier.h"
+
+#include "core/Assert.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace chip8
+{
+    namespace
+    {
+        // Straight-line run of compiled instructions, the unit the generated code jumps between.
+        struct CodeSegment
+        {
+            u16 address;
+            u16 instructionCount;
+            bool isCut; // Stops before an instruction left to the interpreter instead of at the end of its block
+        };
+
+        struct SegmentWriter
+        {
+            std::ostream* output;
+            const u8* program;
+            u32 quirkFlags;
+            const ProgramVerification* verification;
+            std::vector<u16> segmentAddresses; // Sorted
+            RecompilerStats stats;
+        };
+
+        u16 read_instruction(const u8* program, u16 address)
+        {
+            return load_u16_big_endian(program + (address - MinProgramAddress));
+        }
+
+        const char* get_quirk_profile_enumerator(QuirkProfile profile)
+        {
+            switch (profile)
+            {
+                case QuirkProfile::Default:
+                    return "Default";
+                case QuirkProfile::Cosmac:
+                    return "Cosmac";
+                case QuirkProfile::SuperChip:
+                    return "SuperChip";
+                case QuirkProfile::XOChip:
+                    return "XOChip";
+                case QuirkProfile::Count:
+                    break;
+            }
+
+            AssertUnreachable();
+            return "Default";
+        }
+
+        // Reads or writes memory and the screen, or the random generator. Those stay library calls.
+        bool is_inlinable_instruction(OpcodeClass opcodeClass)
+        {
+            switch (opcodeClass)
+            {
+                case OpcodeClass::Cls:
+                case OpcodeClass::Rnd:
+                case OpcodeClass::Drw:
+                case OpcodeClass::LdVxK:
+                case OpcodeClass::LdB:
+                case OpcodeClass::LdIVx:
+                case OpcodeClass::LdVxI:
+                case OpcodeClass::Invalid:
+                case OpcodeClass::Count:
+                    return false;
+                default:
+                    return true;
+            }
+        }
+
+        // The bytes of the instruction must be the ones of the rom whenever it runs.
+        // LD Vx, K waits across steps and reads the key state of the previous instruction, the interpreter
+        // keeps track of both.
+        bool is_compilable_instruction(const ProgramVerification& verification, const u8* program, u16 address)
+        {
+            const u8 slot = verification.slots[address >> 1];
+
+            return (slot & ProgramSlotCode) && !(slot & ProgramSlotOverwritten)
+                   && get_opcode_class(read_instruction(program, address)) != OpcodeClass::LdVxK;
+        }
+
+        bool is_segment_address(const SegmentWriter& writer, u32 address)
+        {
+            return std::binary_search(writer.segmentAddresses.begin(), writer.segmentAddresses.end(), address);
+        }
+
+        void write_address(std::ostream& output, u32 address)
+        {
+            output << "0x" << std::setw(3) << address;
+        }
+
+        void write_register(std::ostream& output, u32 registerIndex)
+        {
+            output << "state.vRegisters[0x" << registerIndex << "]";
+        }
+
+        // Ends a statement line by going to address, directly when a segment starts there.
+        void write_goto(SegmentWriter& writer, u32 address)
+        {
+            std::ostream& output = *writer.output;
+
+            if (is_segment_address(writer, address))
+            {
+                output << "goto block_" << std::setw(3) << address << ";\n";
+                return;
+            }
+
+            output << "{ state.pc = ";
+            write_address(output, address);
+            output << "; goto dispatch; }\n";
+        }
+
+        void write_skip_condition(std::ostream& output, OpcodeClass opcodeClass, u16 instruction)
+        {
+            const u32 x = (instruction >> 8) & 0x000F;
+            const u32 y = (instruction >> 4) & 0x000F;
+            const u32 value = instruction & 0x00FF;
+
+            switch (opcodeClass)
+            {
+                case OpcodeClass::SeImm:
+                case OpcodeClass::SneImm:
+                    write_register(output, x);
+                    output << (opcodeClass == OpcodeClass::SeImm ? " == " : " != ") << "0x" << std::setw(2) << value;
+                    break;
+                case OpcodeClass::SeReg:
+                case OpcodeClass::SneReg:
+                    write_register(output, x);
+                    output << (opcodeClass == OpcodeClass::SeReg ? " == " : " != ");
+                    write_register(output, y);
+                    break;
+                case OpcodeClass::Skp:
+                case OpcodeClass::Sknp:
+                    output << "(state.keyState & (1 << ";
+                    write_register(output, x);
+                    output << ")) " << (opcodeClass == OpcodeClass::Skp ? "!=" : "==") << " 0";
+                    break;
+                default:
+                    AssertUnreachable();
+                    break;
+            }
+        }
+
+        // Same operations as execute_specialized_instruction(), with the operands and quirks known.
+        void write_inlined_operation(SegmentWriter& writer, OpcodeClass opcodeClass, u16 instruction)
+        {
+            std::ostream& output = *writer.output;
+            const u32 x = (instruction >> 8) & 0x000F;
+            const u32 y = (instruction >> 4) & 0x000F;
+            const u32 value = instruction & 0x00FF;
+            const u32 address = instruction & 0x0FFF;
+            const char* indent = "        ";
+
+            output << indent;
+
+            switch (opcodeClass)
+            {
+                case OpcodeClass::Sys:
+                    output << "// Ignored\n";
+                    break;
+                case OpcodeClass::LdImm:
+                    write_register(output, x);
+                    output << " = 0x" << std::setw(2) << value << ";\n";
+                    break;
+                case OpcodeClass::AddImm:
+                    write_register(output, x);
+                    output << " = static_cast<u8>(";
+                    write_register(output, x);
+                    output << " + 0x" << std::setw(2) << value << ");\n";
+                    break;
+                case OpcodeClass::LdReg:
+                    write_register(output, x);
+                    output << " = ";
+                    write_register(output, y);
+                    output << ";\n";
+                    break;
+                case OpcodeClass::Or:
+                case OpcodeClass::And:
+                case OpcodeClass::Xor:
+                    write_register(output, x);
+                    output << (opcodeClass == OpcodeClass::Or ? " |= " : opcodeClass == OpcodeClass::And ? " &= " : " ^= ");
+                    write_register(output, y);
+                    output << ";\n";
+
+                    if (writer.quirkFlags & QuirkLogicResetVF)
+                        output << indent << "state.vRegisters[0xF] = 0;\n";
+                    break;
+                case OpcodeClass::AddReg:
+                case OpcodeClass::Sub:
+                case OpcodeClass::Subn:
+                {
+                    const char* result = opcodeClass == OpcodeClass::AddReg ? "lhs + rhs"
+                                         : opcodeClass == OpcodeClass::Sub ? "lhs - rhs"
+                                         : "rhs - lhs";
+                    const char* carry = opcodeClass == OpcodeClass::AddReg ? "result > lhs ? 0 : 1"
+                                        : opcodeClass == OpcodeClass::Sub ? "lhs > rhs ? 1 : 0"
+                                        : "rhs > lhs ? 1 : 0";
+
+                    output << "{\n";
+                    output << indent << "    const u8 lhs = ";
+                    write_register(output, x);
+                    output << ";\n";
+                    output << indent << "    const u8 rhs = ";
+                    write_register(output, y);
+                    output << ";\n";
+                    output << indent << "    const u8 result = static_cast<u8>(" << result << ");\n";
+                    output << indent << "    ";
+                    write_register(output, x);
+                    output << " = result;\n";
+                    output << indent << "    state.vRegisters[0xF] = " << carry << ";\n";
+                    output << indent << "}\n";
+                    break;
+                }
+                case OpcodeClass::Shr:
+                case OpcodeClass::Shl:
+                    output << "{\n";
+
+                    if (writer.quirkFlags & QuirkShiftVy)
+                    {
+                        output << indent << "    ";
+                        write_register(output, x);
+                        output << " = ";
+                        write_register(output, y);
+                        output << ";\n";
+                    }
+
+                    output << indent << "    const u8 lhs = ";
+                    write_register(output, x);
+                    output << ";\n";
+                    output << indent << "    ";
+                    write_register(output, x);
+                    output << (opcodeClass == OpcodeClass::Shr ? " = static_cast<u8>(lhs >> 1);\n"
+                                                                : " = static_cast<u8>(lhs << 1);\n");
+                    output << indent << "    state.vRegisters[0xF] = "
+                           << (opcodeClass == OpcodeClass::Shr ? "static_cast<u8>(lhs & 0x01);\n"
+                                                               : "(lhs & 0x80) ? 1 : 0;\n");
+                    output << indent << "}\n";
+                    break;
+                case OpcodeClass::LdI:
+                    output << "state.i = ";
+                    write_address(output, address);
+                    output << ";\n";
+                    break;
+                case OpcodeClass::LdVxDt:
+                    write_register(output, x);
+                    output << " = state.delayTimer;\n";
+                    break;
+                case OpcodeClass::LdDtVx:
+                    output << "state.delayTimer = ";
+                    write_register(output, x);
+                    output << ";\n";
+                    break;
+                case OpcodeClass::LdStVx:
+                    output << "state.soundTimer = ";
+                    write_register(output, x);
+                    output << ";\n";
+                    break;
+                case OpcodeClass::AddI:
+                    output << "state.i = static_cast<u16>(state.i + ";
+                    write_register(output, x);
+                    output << ");\n";
+                    break;
+                case OpcodeClass::LdF:
+                    output << "state.i = state.fontTableOffsets[";
+                    write_register(output, x);
+                    output << "];\n";
+                    break;
+                default:
+                    AssertUnreachable();
+                    break;
+            }
+        }
+
+        // Leaves the segment after its last instruction, flow included.
+        void write_inlined_terminator(SegmentWriter& writer, OpcodeClass opcodeClass, u16 pc, u16 instruction)
+        {
+            std::ostream& output = *writer.output;
+            const u32 target = instruction & 0x0FFF;
+            const u32 nextAddress = pc + 2u;
+            const char* indent = "        ";
+
+            // The interpreter moves on when an instruction leaves the pc where it was.
+            const u32 jumpTarget = target == pc ? nextAddress : target;
+
+            switch (opcodeClass)
+            {
+                case OpcodeClass::Jp:
+                    output << indent;
+                    write_goto(writer, jumpTarget);
+                    break;
+                case OpcodeClass::Call:
+                    output << indent << "state.sp++;\n";
+                    output << indent << "state.stack[state.sp] = ";
+                    write_address(output, pc);
+                    output << ";\n";
+                    output << indent;
+                    write_goto(writer, jumpTarget);
+                    break;
+                case OpcodeClass::Ret:
+                    output << indent << "state.pc = static_cast<u16>(state.stack[state.sp] + 2);\n";
+                    output << indent << "state.sp--;\n";
+                    output << indent << "if (state.pc == ";
+                    write_address(output, pc);
+                    output << ") state.pc = ";
+                    write_address(output, nextAddress);
+                    output << ";\n";
+                    output << indent << "goto dispatch;\n";
+                    break;
+                case OpcodeClass::JpV0:
+                    output << indent << "state.pc = static_cast<u16>(";
+                    write_address(output, target);
+                    output << " + ";
+                    write_register(output, (writer.quirkFlags & QuirkJumpVx) ? (target >> 8) : 0);
+                    output << ");\n";
+                    output << indent << "if (state.pc == ";
+                    write_address(output, pc);
+                    output << ") state.pc = ";
+                    write_address(output, nextAddress);
+                    output << ";\n";
+                    output << indent << "goto dispatch;\n";
+                    break;
+                case OpcodeClass::SeImm:
+                case OpcodeClass::SneImm:
+                case OpcodeClass::SeReg:
+                case OpcodeClass::SneReg:
+                case OpcodeClass::Skp:
+                case OpcodeClass::Sknp:
+                    output << indent << "if (";
+                    write_skip_condition(output, opcodeClass, instruction);
+                    output << ") ";
+                    write_goto(writer, pc + 4u);
+                    output << indent;
+                    write_goto(writer, nextAddress);
+                    break;
+                default:
+                    write_inlined_operation(writer, opcodeClass, instruction);
+                    output << indent;
+                    write_goto(writer, nextAddress);
+                    break;
+            }
+        }
+
+        void write_segment(SegmentWriter& writer, const CodeSegment& segment)
+        {
+            std::ostream& output = *writer.output;
+            const char* indent = "        ";
+
+            output << "\n    block_" << std::setw(3) << segment.address << ":\n";
+            output << indent << "if (budget < " << std::dec << segment.instructionCount << std::hex << ") { state.pc = ";
+            write_address(output, segment.address);
+            output << "; goto interpret; }\n";
+            output << indent << "budget -= " << std::dec << segment.instructionCount << std::hex << ";\n";
+
+            for (u32 instructionIndex = 0; instructionIndex < segment.instructionCount; instructionIndex++)
+            {
+                const u16 pc = static_cast<u16>(segment.address + instructionIndex * 2);
+                const u16 instruction = read_instruction(writer.program, pc);
+                const OpcodeClass opcodeClass = get_opcode_class(instruction);
+                const bool isLastInstruction = instructionIndex + 1 == segment.instructionCount;
+                const bool isInlined =
+                    is_inlinable_instruction(opcodeClass) && is_verified_instruction(*writer.verification, pc);
+
+                output << indent << "// ";
+                write_address(output, pc);
+                output << ": " << disassemble_instruction(instruction) << "\n";
+
+                if (isInlined)
+                {
+                    writer.stats.inlinedInstructionCount++;
+
+                    if (isLastInstruction && !segment.isCut)
+                        write_inlined_terminator(writer, opcodeClass, pc, instruction);
+                    else
+                        write_inlined_operation(writer, opcodeClass, instruction);
+                }
+                else
+                {
+                    writer.stats.fallbackInstructionCount++;
+
+                    output << indent << "state.pc = ";
+                    write_address(output, pc);
+                    output << ";\n";
+                    output << indent << "chip8::execute_instruction(config, state, 0x" << std::setw(4) << instruction
+                           << ");\n";
+
+                    if (isLastInstruction && !segment.isCut)
+                    {
+                        output << indent;
+
+                        if (get_opcode_flow(instruction) == OpcodeFlow::Next)
+                            write_goto(writer, pc + 2u);
+                        else
+                            output << "goto dispatch;\n";
+                    }
+                }
+            }
+
+            // The instruction right after is left to the interpreter.
+            if (segment.isCut)
+            {
+                output << indent << "state.pc = ";
+                write_address(output, segment.address + segment.instructionCount * 2u);
+                output << ";\n";
+                output << indent << "goto interpret;\n";
+            }
+        }
+
+        void build_code_segments(std::vector<CodeSegment>& segments, const ControlFlowGraph& graph,
+                                 const ProgramVerification& verification, const u8* program)
+        {
+            for (const BasicBlock& block : graph.blocks)
+            {
+                CodeSegment segment = {};
+
+                for (u32 instructionIndex = 0; instructionIndex < block.instructionCount; instructionIndex++)
+                {
+                    const u16 pc = static_cast<u16>(block.address + instructionIndex * 2);
+
+                    if (!is_compilable_instruction(verification, program, pc))
+                    {
+                        if (segment.instructionCount > 0)
+                        {
+                            segment.isCut = true;
+                            segments.push_back(segment);
+                        }
+
+                        segment.instructionCount = 0;
+                        continue;
+                    }
+
+                    if (segment.instructionCount == 0)
+                    {
+                        segment.address = pc;
+                        segment.isCut = false;
+                    }
+
+                    segment.instructionCount++;
+                }
+
+                if (segment.instructionCount > 0)
+                    segments.push_back(segment);
+            }
+        }
+    }
+
+    RecompilerStats write_recompiled_rom(std::ostream& output, const u8* program, u16 programSize,
+                                         QuirkProfile quirkProfile, const char* name)
+    {
+        Assert((programSize & 0x0001) == 0); // Unaligned size, see load_program()
+
+        ControlFlowGraph graph;
+        build_control_flow_graph(graph, program, programSize, quirkProfile);
+
+        // Verified the same way the generated code gets loaded.
+        ProgramVerification verification;
+        {
+            CPUState state = createCPUState();
+            const RecompiledRom rom = { name, quirkProfile, program, programSize, nullptr };
+
+            load_recompiled_rom(state, rom);
+            verify_program(state, quirkProfile, verification);
+            destroyCPUState(state);
+        }
+
+        std::vector<CodeSegment> segments;
+
+        // The analysis assumed the rom never changes, writes over code may land anywhere the moment it does.
+        if (!verification.isSelfModifying)
+            build_code_segments(segments, graph, verification, program);
+
+        SegmentWriter writer = {};
+        writer.output = &output;
+        writer.program = program;
+        writer.quirkFlags = get_quirk_flags(quirkProfile);
+        writer.verification = &verification;
+
+        for (const CodeSegment& segment : segments)
+            writer.segmentAddresses.push_back(segment.address);
+
+        writer.stats.blockCount = static_cast<u32>(segments.size());
+
+        const std::ios::fmtflags outputFlags = output.flags();
+        const char outputFill = output.fill();
+
+        output << std::hex << std::uppercase << std::setfill('0');
+
+        output << "// Generated by chip8emu_recompile from " << name << " (" << get_quirk_profile_name(quirkProfile)
+               << " quirks), do not edit.\n\n";
+        output << "#include \"chip8/Execution.h\"\n";
+        output << "#include \"chip8/Recompiler.h\"\n\n";
+        output << "namespace\n{\n";
+        output << "    const u8 Program[] = {";
+
+        for (u32 byteIndex = 0; byteIndex < programSize; byteIndex++)
+            output << (byteIndex % 16 == 0 ? "\n        " : " ") << "0x" << std::setw(2) << u32(program[byteIndex]) << ",";
+
+        output << "\n    };\n\n";
+        output << "    void run(const chip8::EmuConfig& config, chip8::CPUState& state, u32 instructionCount)\n    {\n";
+        output << "        u32 budget = instructionCount;\n\n";
+        output << "    dispatch:\n";
+        output << "        switch (state.pc)\n        {\n";
+
+        for (const CodeSegment& segment : segments)
+        {
+            output << "            case ";
+            write_address(output, segment.address);
+            output << ": goto block_" << std::setw(3) << segment.address << ";\n";
+        }
+
+        output << "            default: goto interpret;\n        }\n\n";
+        output << "    interpret:\n";
+        output << "        if (budget == 0) goto done;\n";
+        output << "        chip8::interpret_recompiled_instruction(config, state, budget == instructionCount);\n";
+        output << "        budget--;\n";
+        output << "        goto dispatch;\n";
+
+        for (const CodeSegment& segment : segments)
+            write_segment(writer, segment);
+
+        output << "\n    done:\n";
+        output << "        state.instructionCount += instructionCount;\n";
+        output << "        if (instructionCount > 0) state.keyStatePrev = state.keyState;\n";
+        output << "    }\n\n";
+        output << "    const chip8::RecompiledRom Rom = { \"" << name << "\", chip8::QuirkProfile::"
+               << get_quirk_profile_enumerator(quirkProfile) << ", Program, sizeof(Program), &run };\n";
+        output << "}\n\n";
+        output << "const chip8::RecompiledRom& chip8::get_recompiled_rom()\n{\n    return Rom;\n}\n";
+
+        output.flags(outputFlags);
+        output.fill(outputFill);
+
+        for (u32 slotIndex = MinProgramAddress / 2; slotIndex < ProgramVerificationSlotCount; slotIndex++)
+        {
+            if (verification.slots[slotIndex] & ProgramSlotCode)
+                writer.stats.interpretedInstructionCount++;
+        }
+
+        writer.stats.interpretedInstructionCount -=
+            writer.stats.inlinedInstructionCount + writer.stats.fallbackInstructionCount;
+
+        return writer.stats;
+    }
+
+    void load_recompiled_rom(CPUState& state, const RecompiledRom& rom)
+    {
+        const std::vector<u8> zeroes(MemorySizeInBytes - MinProgramAddress, 0);
+
+        write_memory_range(state, MinProgramAddress, zeroes.data(), static_cast<u16>(zeroes.size()));
+        load_program(state, rom.program, rom.programSize);
+    }
+
+    void interpret_recompiled_instruction(const EmuConfig& config, CPUState& state, bool isFirstInstruction)
+    {
+        // The interpreter loop saves the key state after every instruction, generated code only before LD Vx, K.
+        if (!isFirstInstruction)
+            state.keyStatePrev = state.keyState;
+
+        execute_instruction(config, state, load_next_instruction(state));
+    }
+}
@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Config.h"
+#include "Cpu.h"
+#include "Quirks.h"
+
+#include <ostream>
+
+namespace chip8
+{
+    // Ahead-of-time translation of a rom to C++, compiled into a binary made for that rom.
+    //
+    // Every basic block of the control flow graph becomes a label of one function, and the host compiler
+    // optimizes the rom's logic in place of the interpreter's dispatch. Instructions the verifier proved
+    // safe are inlined, the rest go through execute_instruction(). Computed jumps and returns land in a
+    // switch over the pc, and any pc without a block runs one instruction through the interpreter.
+    // LD Vx, K and code the rom may write over always run interpreted.
+    //
+    // Generated code runs exactly like the checked interpreter, instruction budget included, as long as the
+    // rom starts from load_recompiled_rom(). execute_step() picks it up through EmuConfig::recompiledRom.
+    using RecompiledRomFunction = void (*)(const EmuConfig& config, CPUState& state, u32 instructionCount);
+
+    struct RecompiledRom
+    {
+        const char* name;
+        QuirkProfile quirkProfile;
+        const u8* program; // The rom it was generated from
+        u16 programSize;
+        RecompiledRomFunction run;
+    };
+
+    struct RecompilerStats
+    {
+        u32 blockCount; // Entry points of the generated code
+        u32 inlinedInstructionCount;
+        u32 fallbackInstructionCount; // Compiled to an execute_instruction() call
+        u32 interpretedInstructionCount; // Reachable, but left to the interpreter
+    };
+
+    // name must be a valid C++ identifier.
+    CHIP8EMU_EMU_API RecompilerStats write_recompiled_rom(std::ostream& output, const u8* program, u16 programSize,
+                                                          QuirkProfile quirkProfile, const char* name);
+
+    // Power-on state for the generated code: memory past the rom cleared, then the rom loaded.
+    CHIP8EMU_EMU_API void load_recompiled_rom(CPUState& state, const RecompiledRom& rom);
+
+    // Fetches and runs the instruction at the pc like the checked interpreter loop, for generated code.
+    CHIP8EMU_EMU_API void interpret_recompiled_instruction(const EmuConfig& config, CPUState& state,
+                                                           bool isFirstInstruction);
+
+    // Defined by the generated code, one rom per binary.
+    const RecompiledRom& get_recompiled_rom();
+}
@@ -0,0 +1,249 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Rewind.h"
+
+#include "DeltaCodec.h"
+
+#include "core/Assert.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace chip8
+{
+    namespace
+    {
+        static const u64 InvalidSequence = ~static_cast<u64>(0);
+        static const u32 PayloadSizeInBytes = sizeof(SaveStatePayload);
+
+        RewindFrame& get_frame(const RewindBuffer& buffer, u32 index)
+        {
+            Assert(index < buffer.frameCount);
+
+            return buffer.frames[(buffer.firstFrameIndex + index) % buffer.frameCapacity];
+        }
+
+        const u8* get_payload_bytes(const SaveStatePayload* payload)
+        {
+            return reinterpret_cast<const u8*>(payload);
+        }
+
+        // Dropping a keyframe invalidates all the deltas that depend on it,
+        // so we always drop a whole group at once.
+        void evict_oldest_group(RewindBuffer& buffer)
+        {
+            Assert(buffer.frameCount > 0);
+
+            do
+            {
+                if (get_frame(buffer, 0).sequence == buffer.cachedKeyframeSequence)
+                    buffer.cachedKeyframeSequence = InvalidSequence;
+
+                buffer.firstFrameIndex = (buffer.firstFrameIndex + 1) % buffer.frameCapacity;
+                buffer.frameCount--;
+            } while (buffer.frameCount > 0 && get_frame(buffer, 0).keyframeDistance != 0);
+        }
+
+        // The data is used as a ring of variable-sized blocks. Blocks are never split,
+        // so the space left at the end gets skipped when it's too small.
+        u32 allocate_frame_data(RewindBuffer& buffer, u32 sizeInBytes)
+        {
+            while (buffer.frameCount > 0)
+            {
+                const RewindFrame& oldestFrame = get_frame(buffer, 0);
+                const RewindFrame& newestFrame = get_frame(buffer, buffer.frameCount - 1);
+
+                const u32 head = newestFrame.dataOffset + newestFrame.dataSizeInBytes;
+                const u32 tail = oldestFrame.dataOffset;
+                const bool isWrapped = newestFrame.dataOffset < oldestFrame.dataOffset;
+
+                if (isWrapped)
+                {
+                    if (tail - head >= sizeInBytes)
+                        return head;
+                }
+                else
+                {
+                    if (buffer.dataCapacityInBytes - head >= sizeInBytes)
+                        return head;
+                    if (tail >= sizeInBytes)
+                        return 0;
+                }
+
+                evict_oldest_group(buffer);
+            }
+
+            return 0;
+        }
+
+        const SaveStatePayload& decode_keyframe(RewindBuffer& buffer, u64 keyframeSequence)
+        {
+            if (buffer.cachedKeyframeSequence != keyframeSequence)
+            {
+                const u64 oldestSequence = get_frame(buffer, 0).sequence;
+
+                Assert(keyframeSequence >= oldestSequence); // Keyframe was evicted
+
+                const RewindFrame& keyframe = get_frame(buffer, static_cast<u32>(keyframeSequence - oldestSequence));
+
+                Assert(keyframe.keyframeDistance == 0);
+
+                decode_xor_delta(nullptr, &buffer.data[keyframe.dataOffset], keyframe.dataSizeInBytes,
+                                 reinterpret_cast<u8*>(buffer.cachedKeyframe), PayloadSizeInBytes);
+
+                buffer.cachedKeyframeSequence = keyframeSequence;
+            }
+
+            return *buffer.cachedKeyframe;
+        }
+    }
+
+    RewindBuffer* createRewindBuffer(u32 frameCapacity, u32 keyframeInterval, u32 dataCapacityInBytes)
+    {
+        Assert(frameCapacity > 0);
+        Assert(keyframeInterval > 0);
+        Assert(dataCapacityInBytes >= get_max_xor_delta_size(PayloadSizeInBytes)); // Can't even fit a keyframe
+
+        RewindBuffer* buffer = new RewindBuffer;
+
+        buffer->keyframeInterval = keyframeInterval;
+        buffer->frameCapacity = frameCapacity;
+        buffer->frames = new RewindFrame[frameCapacity];
+        buffer->dataCapacityInBytes = dataCapacityInBytes;
+        buffer->data = new u8[dataCapacityInBytes];
+        buffer->cachedKeyframe = new SaveStatePayload;
+        buffer->scratchPayload = new SaveStatePayload;
+        buffer->scratchDelta = new u8[get_max_xor_delta_size(PayloadSizeInBytes)];
+
+        clear_rewind_buffer(*buffer);
+
+        return buffer;
+    }
+
+    void destroyRewindBuffer(RewindBuffer* buffer)
+    {
+        Assert(buffer != nullptr);
+
+        delete[] buffer->scratchDelta;
+        delete buffer->scratchPayload;
+        delete buffer->cachedKeyframe;
+        delete[] buffer->data;
+        delete[] buffer->frames;
+        delete buffer;
+    }
+
+    void push_rewind_frame(RewindBuffer& buffer, const CPUState& state)
+    {
+        write_save_state_payload(state, *buffer.scratchPayload);
+
+        if (buffer.frameCount == buffer.frameCapacity)
+            evict_oldest_group(buffer);
+
+        const u8* currentPayload = get_payload_bytes(buffer.scratchPayload);
+        bool isKeyframe = true;
+        u32 keyframeDistance = 0;
+        u64 keyframeSequence = buffer.nextSequence;
+
+        if (buffer.frameCount > 0)
+        {
+            const RewindFrame& newestFrame = get_frame(buffer, buffer.frameCount - 1);
+
+            isKeyframe = (newestFrame.keyframeDistance + 1) >= buffer.keyframeInterval;
+            keyframeDistance = isKeyframe ? 0 : (newestFrame.keyframeDistance + 1);
+            keyframeSequence = isKeyframe ? buffer.nextSequence : (newestFrame.sequence - newestFrame.keyframeDistance);
+        }
+
+        const u8* reference = isKeyframe ? nullptr : get_payload_bytes(&decode_keyframe(buffer, keyframeSequence));
+        u32 deltaSizeInBytes = encode_xor_delta(reference, currentPayload, PayloadSizeInBytes, buffer.scratchDelta);
+        u32 dataOffset = allocate_frame_data(buffer, deltaSizeInBytes);
+
+        // Making room might have dropped the keyframe we encoded against, start a new group.
+        if (!isKeyframe && (buffer.frameCount == 0 || get_frame(buffer, 0).sequence > keyframeSequence))
+        {
+            isKeyframe = true;
+            keyframeDistance = 0;
+            deltaSizeInBytes = encode_xor_delta(nullptr, currentPayload, PayloadSizeInBytes, buffer.scratchDelta);
+            dataOffset = allocate_frame_data(buffer, deltaSizeInBytes);
+        }
+
+        std::memcpy(&buffer.data[dataOffset], buffer.scratchDelta, deltaSizeInBytes);
+
+        buffer.frameCount++;
+
+        RewindFrame& frame = get_frame(buffer, buffer.frameCount - 1);
+
+        frame.sequence = buffer.nextSequence++;
+        frame.dataOffset = dataOffset;
+        frame.dataSizeInBytes = deltaSizeInBytes;
+        frame.keyframeDistance = keyframeDistance;
+
+        // We already have the keyframe decoded, keep it around for the next deltas.
+        if (isKeyframe)
+        {
+            std::swap(buffer.cachedKeyframe, buffer.scratchPayload);
+            buffer.cachedKeyframeSequence = frame.sequence;
+        }
+    }
+
+    u32 rewind_frames(RewindBuffer& buffer, CPUState& state, u32 frameCount)
+    {
+        const u32 rewoundFrameCount = std::min(frameCount, buffer.frameCount);
+
+        if (rewoundFrameCount == 0)
+            return 0;
+
+        const RewindFrame targetFrame = get_frame(buffer, buffer.frameCount - rewoundFrameCount);
+        const SaveStatePayload& keyframe = decode_keyframe(buffer, targetFrame.sequence - targetFrame.keyframeDistance);
+
+        if (targetFrame.keyframeDistance == 0)
+            read_save_state_payload(state, keyframe);
+        else
+        {
+            decode_xor_delta(get_payload_bytes(&keyframe), &buffer.data[targetFrame.dataOffset],
+                             targetFrame.dataSizeInBytes, reinterpret_cast<u8*>(buffer.scratchPayload),
+                             PayloadSizeInBytes);
+
+            read_save_state_payload(state, *buffer.scratchPayload);
+        }
+
+        buffer.frameCount -= rewoundFrameCount;
+        buffer.nextSequence = targetFrame.sequence;
+
+        if (buffer.cachedKeyframeSequence != InvalidSequence && buffer.cachedKeyframeSequence >= targetFrame.sequence)
+            buffer.cachedKeyframeSequence = InvalidSequence;
+
+        return rewoundFrameCount;
+    }
+
+    void clear_rewind_buffer(RewindBuffer& buffer)
+    {
+        buffer.firstFrameIndex = 0;
+        buffer.frameCount = 0;
+        buffer.nextSequence = 0;
+        buffer.cachedKeyframeSequence = InvalidSequence;
+    }
+
+    u32 get_rewind_data_usage(const RewindBuffer& buffer)
+    {
+        u32 usageInBytes = 0;
+
+        for (u32 index = 0; index < buffer.frameCount; index++)
+            usageInBytes += get_frame(buffer, index).dataSizeInBytes;
+
+        return usageInBytes;
+    }
+
+    u64 get_rewind_memory_footprint(const RewindBuffer& buffer)
+    {
+        return sizeof(RewindBuffer)
+               + static_cast<u64>(buffer.frameCapacity) * sizeof(RewindFrame)
+               + buffer.dataCapacityInBytes
+               + 2 * sizeof(SaveStatePayload)
+               + get_max_xor_delta_size(PayloadSizeInBytes);
+    }
+}
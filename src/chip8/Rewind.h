@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+#include "SaveState.h"
+
+namespace chip8
+{
+    struct RewindFrame
+    {
+        u64 sequence;
+        u32 dataOffset;
+        u32 dataSizeInBytes;
+        u32 keyframeDistance; // 0 for keyframes
+    };
+
+    // Ring buffer of delta-compressed snapshots.
+    // Every frame is stored as an XOR/RLE delta against the most recent keyframe, and
+    // keyframes are themselves RLE-compressed. Both the frame count and the byte budget
+    // are fixed at creation, the oldest keyframe group gets dropped when either runs out.
+    struct RewindBuffer
+    {
+        u32 keyframeInterval;
+
+        u32 frameCapacity;
+        u32 firstFrameIndex;
+        u32 frameCount;
+        RewindFrame* frames;
+
+        u32 dataCapacityInBytes;
+        u8* data;
+
+        u64 nextSequence;
+
+        // Decoded keyframe, to avoid decoding it again for every delta.
+        u64 cachedKeyframeSequence;
+        SaveStatePayload* cachedKeyframe;
+
+        SaveStatePayload* scratchPayload;
+        u8* scratchDelta;
+    };
+
+    // Defaults that comfortably hold 60 seconds of history at 60 frames per second.
+    static const u32 DefaultRewindFrameCapacity = 60 * 60;
+    static const u32 DefaultRewindKeyframeInterval = 60;
+    static const u32 DefaultRewindDataCapacityInBytes = 1024 * 1024;
+
+    CHIP8EMU_EMU_API RewindBuffer* createRewindBuffer(u32 frameCapacity, u32 keyframeInterval, u32 dataCapacityInBytes);
+    CHIP8EMU_EMU_API void destroyRewindBuffer(RewindBuffer* buffer);
+
+    // Call this once per frame.
+    CHIP8EMU_EMU_API void push_rewind_frame(RewindBuffer& buffer, const CPUState& state);
+
+    // Drops the last frameCount - 1 frames and restores the state of the one before them,
+    // which is also removed from the buffer. Only that last frame gets decoded.
+    // Returns the number of frames actually rewound.
+    CHIP8EMU_EMU_API u32 rewind_frames(RewindBuffer& buffer, CPUState& state, u32 frameCount);
+
+    CHIP8EMU_EMU_API void clear_rewind_buffer(RewindBuffer& buffer);
+
+    // Bytes of compressed snapshot data currently held.
+    CHIP8EMU_EMU_API u32 get_rewind_data_usage(const RewindBuffer& buffer);
+
+    // Total memory footprint of the rewind buffer, this is fixed at creation.
+    CHIP8EMU_EMU_API u64 get_rewind_memory_footprint(const RewindBuffer& buffer);
+}
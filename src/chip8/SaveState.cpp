@@ -0,0 +1,286 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SaveState.h"
+
+#include "Memory.h"
+#include "Serialization.h"
+#include "StateHash.h"
+
+#include "core/Assert.h"
+#include "core/Platform.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace chip8
+{
+    namespace
+    {
+        // FNV-1a over the payload bytes, which are already in file byte order.
+        u64 compute_checksum(const SaveStatePayload& payload)
+        {
+            const u8* data = reinterpret_cast<const u8*>(&payload);
+            u64 hash = 0xcbf29ce484222325;
+
+            for (std::size_t offset = 0; offset < sizeof(SaveStatePayload); offset++)
+            {
+                hash ^= data[offset];
+                hash *= 0x100000001b3;
+            }
+
+            return hash;
+        }
+
+        // A matching checksum only means the file is intact, the state itself could still
+        // have been written by a buggy or malicious tool.
+        bool is_valid_payload(const SaveStatePayload& payload)
+        {
+            const u16 pc = swap_little_endian(payload.pc);
+
+            if (payload.sp >= StackSize || (pc & 1) != 0 || pc >= MaxProgramAddress)
+                return false;
+
+            for (u32 index = 0; index < FontTableGlyphCount; index++)
+            {
+                if (swap_little_endian(payload.fontTableOffsets[index]) + GlyphSizeInBytes > MemorySizeInBytes)
+                    return false;
+            }
+
+            return true;
+        }
+
+        SaveStateError validate_save_state(const void* data, std::size_t sizeInBytes)
+        {
+            if (sizeInBytes != sizeof(SaveState))
+                return SaveStateError::InvalidSize;
+
+            if (reinterpret_cast<std::uintptr_t>(data) % alignof(SaveState) != 0)
+                return SaveStateError::InvalidAlignment;
+
+            const SaveState& saveState = *static_cast<const SaveState*>(data);
+            const SaveStateHeader& header = saveState.header;
+
+            if (swap_little_endian(header.magic) != SaveStateMagic)
+                return SaveStateError::InvalidMagic;
+
+            if (swap_little_endian(header.version) != SaveStateVersion
+                || swap_little_endian(header.headerSizeInBytes) != sizeof(SaveStateHeader)
+                || swap_little_endian(header.payloadSizeInBytes) != sizeof(SaveStatePayload))
+                return SaveStateError::UnsupportedVersion;
+
+            const u64 checksum = compute_checksum(saveState.payload);
+
+            if (swap_little_endian(header.payloadChecksum) != checksum)
+                return SaveStateError::ChecksumMismatch;
+
+            if (!is_valid_payload(saveState.payload))
+                return SaveStateError::InvalidState;
+
+            return SaveStateError::None;
+        }
+    }
+
+    const char* get_save_state_error_string(SaveStateError error)
+    {
+        switch (error)
+        {
+            case SaveStateError::None:
+                return "no error";
+            case SaveStateError::IOError:
+                return "could not access file";
+            case SaveStateError::InvalidSize:
+                return "invalid size";
+            case SaveStateError::InvalidAlignment:
+                return "invalid alignment";
+            case SaveStateError::InvalidMagic:
+                return "not a save state";
+            case SaveStateError::UnsupportedVersion:
+                return "unsupported version";
+            case SaveStateError::ChecksumMismatch:
+                return "checksum mismatch";
+            case SaveStateError::InvalidState:
+                return "invalid cpu state";
+        }
+
+        AssertUnreachable();
+        return "unknown error";
+    }
+
+    void write_save_state_payload(const CPUState& state, SaveStatePayload& payload)
+    {
+        payload.instructionCount = swap_little_endian(state.instructionCount);
+        payload.randomState = swap_little_endian(state.randomState);
+        payload.pc = swap_little_endian(state.pc);
+        payload.i = swap_little_endian(state.i);
+
+        for (u32 index = 0; index < StackSize; index++)
+            payload.stack[index] = swap_little_endian(state.stack[index]);
+
+        payload.keyState = swap_little_endian(state.keyState);
+        payload.keyStatePrev = swap_little_endian(state.keyStatePrev);
+
+        for (u32 index = 0; index < FontTableGlyphCount; index++)
+            payload.fontTableOffsets[index] = swap_little_endian(state.fontTableOffsets[index]);
+
+        payload.delayTimerAccumulator = swap_little_endian(state.delayTimerAccumulator);
+        payload.executionTimerAccumulator = swap_little_endian(state.executionTimerAccumulator);
+
+        payload.sp = state.sp;
+        payload.delayTimer = state.delayTimer;
+        payload.soundTimer = state.soundTimer;
+        payload.isWaitingForKey = state.isWaitingForKey ? 1 : 0;
+
+        std::memcpy(payload.vRegisters, state.vRegisters, sizeof(payload.vRegisters));
+        std::memcpy(payload.screen, state.screen, sizeof(payload.screen));
+        read_memory_range(state, 0, payload.memory, sizeof(payload.memory));
+        std::memset(payload.reserved, 0, sizeof(payload.reserved));
+    }
+
+    void read_save_state_payload(CPUState& state, const SaveStatePayload& payload)
+    {
+        state.instructionCount = swap_little_endian(payload.instructionCount);
+        state.randomState = swap_little_endian(payload.randomState);
+        state.pc = swap_little_endian(payload.pc);
+        state.i = swap_little_endian(payload.i);
+
+        for (u32 index = 0; index < StackSize; index++)
+            state.stack[index] = swap_little_endian(payload.stack[index]);
+
+        state.keyState = swap_little_endian(payload.keyState);
+        state.keyStatePrev = swap_little_endian(payload.keyStatePrev);
+
+        for (u32 index = 0; index < FontTableGlyphCount; index++)
+            state.fontTableOffsets[index] = swap_little_endian(payload.fontTableOffsets[index]);
+
+        state.delayTimerAccumulator = swap_little_endian(payload.delayTimerAccumulator);
+        state.executionTimerAccumulator = swap_little_endian(payload.executionTimerAccumulator);
+
+        state.sp = payload.sp;
+        state.delayTimer = payload.delayTimer;
+        state.soundTimer = payload.soundTimer;
+        state.isWaitingForKey = payload.isWaitingForKey != 0;
+
+        std::memcpy(state.vRegisters, payload.vRegisters, sizeof(payload.vRegisters));
+        std::memcpy(state.screen, payload.screen, sizeof(payload.screen));
+        state.screenHash = compute_screen_hash(state);
+
+        // Keeps the memory hash up to date.
+        write_memory_range(state, 0, payload.memory, sizeof(payload.memory));
+    }
+
+    void save_state(const CPUState& state, SaveState& saveState)
+    {
+        write_save_state_payload(state, saveState.payload);
+
+        const u64 checksum = compute_checksum(saveState.payload);
+
+        saveState.header.magic = swap_little_endian(SaveStateMagic);
+        saveState.header.version = swap_little_endian(SaveStateVersion);
+        saveState.header.headerSizeInBytes = swap_little_endian(static_cast<u16>(sizeof(SaveStateHeader)));
+        saveState.header.payloadSizeInBytes = swap_little_endian(static_cast<u32>(sizeof(SaveStatePayload)));
+        saveState.header.reserved = 0;
+        saveState.header.payloadChecksum = swap_little_endian(checksum);
+    }
+
+    SaveStateError load_state(CPUState& state, const void* data, std::size_t sizeInBytes)
+    {
+        Assert(data != nullptr);
+
+        const SaveStateError error = validate_save_state(data, sizeInBytes);
+
+        if (error != SaveStateError::None)
+            return error;
+
+        read_save_state_payload(state, static_cast<const SaveState*>(data)->payload);
+
+        return SaveStateError::None;
+    }
+
+    SaveStateError save_state_to_file(const CPUState& state, const char* path)
+    {
+        Assert(path != nullptr);
+
+        SaveState saveState;
+        save_state(state, saveState);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&saveState), sizeof(SaveState));
+
+        return file.good() ? SaveStateError::None : SaveStateError::IOError;
+    }
+
+    SaveStateError load_state_from_file(CPUState& state, const char* path)
+    {
+        Assert(path != nullptr);
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+        const int fd = open(path, O_RDONLY);
+
+        if (fd == -1)
+            return SaveStateError::IOError;
+
+        struct stat fileStat;
+
+        if (fstat(fd, &fileStat) != 0)
+        {
+            close(fd);
+            return SaveStateError::IOError;
+        }
+
+        const std::size_t fileSizeInBytes = static_cast<std::size_t>(fileStat.st_size);
+
+        if (fileSizeInBytes != sizeof(SaveState))
+        {
+            close(fd);
+            return SaveStateError::InvalidSize;
+        }
+
+        void* mapping = mmap(nullptr, fileSizeInBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (mapping == MAP_FAILED)
+            return SaveStateError::IOError;
+
+        const SaveStateError error = load_state(state, mapping, fileSizeInBytes);
+
+        munmap(mapping, fileSizeInBytes);
+
+        return error;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+        if (!file.good())
+            return SaveStateError::IOError;
+
+        const std::size_t fileSizeInBytes = static_cast<std::size_t>(file.tellg());
+
+        if (fileSizeInBytes != sizeof(SaveState))
+            return SaveStateError::InvalidSize;
+
+        // Heap allocation gives us the alignment we need.
+        std::vector<u64> buffer(sizeof(SaveState) / sizeof(u64) + 1);
+
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char*>(buffer.data()), sizeof(SaveState));
+
+        if (!file.good())
+            return SaveStateError::IOError;
+
+        return load_state(state, buffer.data(), fileSizeInBytes);
+#endif
+    }
+}
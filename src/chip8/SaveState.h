@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+
+#include <cstddef>
+
+namespace chip8
+{
+    // Save states have a fixed layout, stored little-endian on disk.
+    // Every field is naturally aligned so that on little-endian hosts a file can be
+    // mapped in memory and restored directly from the mapping.
+    static const u32 SaveStateMagic = 0x53533843; // "C8SS"
+    static const u16 SaveStateVersion = 1;
+
+    struct SaveStateHeader
+    {
+        u32 magic;
+        u16 version;
+        u16 headerSizeInBytes;
+        u32 payloadSizeInBytes;
+        u32 reserved;
+        u64 payloadChecksum;
+    };
+
+    struct SaveStatePayload
+    {
+        u64 instructionCount;
+        u64 randomState;
+
+        u16 pc;
+        u16 i;
+        u16 stack[StackSize];
+        u16 keyState;
+        u16 keyStatePrev;
+        u16 fontTableOffsets[FontTableGlyphCount];
+
+        u32 delayTimerAccumulator;
+        u32 executionTimerAccumulator;
+
+        u8 sp;
+        u8 delayTimer;
+        u8 soundTimer;
+        u8 isWaitingForKey;
+        u8 vRegisters[VRegisterCount];
+
+        u8 screen[ScreenHeight][ScreenLineSizeInBytes];
+        u8 memory[MemorySizeInBytes];
+
+        u8 reserved[4]; // Keeps the size a multiple of 8 bytes
+    };
+
+    struct SaveState
+    {
+        SaveStateHeader header;
+        SaveStatePayload payload;
+    };
+
+    static_assert(sizeof(SaveStateHeader) == 24, "save state header layout changed");
+    static_assert(sizeof(SaveStatePayload) == 4472, "save state payload layout changed");
+    static_assert(sizeof(SaveState) == sizeof(SaveStateHeader) + sizeof(SaveStatePayload), "save state has padding");
+
+    enum class SaveStateError
+    {
+        None,
+        IOError,
+        InvalidSize,
+        InvalidAlignment,
+        InvalidMagic,
+        UnsupportedVersion,
+        ChecksumMismatch,
+        InvalidState
+    };
+
+    CHIP8EMU_EMU_API const char* get_save_state_error_string(SaveStateError error);
+
+    // Raw payload conversion, without header or checksum.
+    // Useful when you want to keep a lot of states around in memory.
+    CHIP8EMU_EMU_API void write_save_state_payload(const CPUState& state, SaveStatePayload& payload);
+    CHIP8EMU_EMU_API void read_save_state_payload(CPUState& state, const SaveStatePayload& payload);
+
+    CHIP8EMU_EMU_API void save_state(const CPUState& state, SaveState& saveState);
+
+    // The data has to be aligned on an 8 byte boundary, which mmap() and new[] always give you.
+    // The state is left untouched if the save state fails validation.
+    CHIP8EMU_EMU_API SaveStateError load_state(CPUState& state, const void* data, std::size_t sizeInBytes);
+
+    CHIP8EMU_EMU_API SaveStateError save_state_to_file(const CPUState& state, const char* path);
+    CHIP8EMU_EMU_API SaveStateError load_state_from_file(CPUState& state, const char* path);
+}
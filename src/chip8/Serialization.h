@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "core/Types.h"
+
+namespace chip8
+{
+    // File formats are little-endian whatever the host is.
+    // Byte buffers go through the read/write helpers, byte by byte. Structs written as a whole
+    // swap their fields with swap_little_endian(), which is a no-op on little-endian hosts.
+    inline void write_u16_little_endian(u8* output, u16 value)
+    {
+        output[0] = static_cast<u8>(value);
+        output[1] = static_cast<u8>(value >> 8);
+    }
+
+    inline void write_u32_little_endian(u8* output, u32 value)
+    {
+        write_u16_little_endian(output, static_cast<u16>(value));
+        write_u16_little_endian(output + 2, static_cast<u16>(value >> 16));
+    }
+
+    inline void write_u64_little_endian(u8* output, u64 value)
+    {
+        write_u32_little_endian(output, static_cast<u32>(value));
+        write_u32_little_endian(output + 4, static_cast<u32>(value >> 32));
+    }
+
+    inline u16 read_u16_little_endian(const u8* input)
+    {
+        return static_cast<u16>(input[0] | (input[1] << 8));
+    }
+
+    inline u32 read_u32_little_endian(const u8* input)
+    {
+        return read_u16_little_endian(input) | (static_cast<u32>(read_u16_little_endian(input + 2)) << 16);
+    }
+
+    inline u64 read_u64_little_endian(const u8* input)
+    {
+        return read_u32_little_endian(input) | (static_cast<u64>(read_u32_little_endian(input + 4)) << 32);
+    }
+
+    constexpr bool is_host_little_endian()
+    {
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+        return __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__;
+#else
+        return true; // MSVC only targets little-endian platforms
+#endif
+    }
+
+    // Swapping is symmetric, so these convert both to and from the file byte order.
+    inline u16 swap_little_endian(u16 value)
+    {
+        if (is_host_little_endian())
+            return value;
+        return static_cast<u16>((value >> 8) | (value << 8));
+    }
+
+    inline u32 swap_little_endian(u32 value)
+    {
+        if (is_host_little_endian())
+            return value;
+        return (value >> 24) | ((value >> 8) & 0x0000FF00) | ((value << 8) & 0x00FF0000) | (value << 24);
+    }
+
+    inline u64 swap_little_endian(u64 value)
+    {
+        if (is_host_little_endian())
+            return value;
+        return (static_cast<u64>(swap_little_endian(static_cast<u32>(value))) << 32)
+               | swap_little_endian(static_cast<u32>(value >> 32));
+    }
+}
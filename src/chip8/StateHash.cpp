@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "StateHash.h"
+
+#include "Memory.h"
+
+#include <cstring>
+
+namespace chip8
+{
+    namespace
+    {
+        u64 combine_hash(u64 hash, u64 value)
+        {
+            return mix_hash_key(hash ^ value) + 0x9E3779B97F4A7C15;
+        }
+
+        u64 combine_hash_words(u64 hash, const void* data, u32 sizeInBytes)
+        {
+            const u8* bytes = static_cast<const u8*>(data);
+
+            for (u32 offset = 0; offset < sizeInBytes; offset += sizeof(u64))
+            {
+                u64 word;
+                std::memcpy(&word, bytes + offset, sizeof(u64));
+
+                hash = combine_hash(hash, word);
+            }
+
+            return hash;
+        }
+    }
+
+    u64 compute_memory_hash(const CPUState& state)
+    {
+        u64 hash = 0;
+
+        for (u32 address = 0; address < MemorySizeInBytes; address++)
+            hash ^= get_memory_hash_key(static_cast<u16>(address), read_memory(state, static_cast<u16>(address)));
+
+        return hash;
+    }
+
+    u64 compute_screen_hash(const CPUState& state)
+    {
+        u64 hash = 0;
+
+        for (u32 y = 0; y < ScreenHeight; y++)
+        {
+            for (u32 byteIndex = 0; byteIndex < ScreenLineSizeInBytes; byteIndex++)
+            {
+                const u8 screenByteValue = state.screen[y][byteIndex];
+
+                // Mostly blank screens are the common case.
+                if (screenByteValue == 0)
+                    continue;
+
+                for (u32 bitIndex = 0; bitIndex < 8; bitIndex++)
+                {
+                    if ((screenByteValue >> bitIndex) & 0x1)
+                        hash ^= get_screen_hash_key(byteIndex * 8 + bitIndex, y);
+                }
+            }
+        }
+
+        return hash;
+    }
+
+    void recompute_state_hash(CPUState& state)
+    {
+        state.memoryHash = compute_memory_hash(state);
+        state.screenHash = compute_screen_hash(state);
+    }
+
+    u64 get_state_hash(const CPUState& state)
+    {
+        u64 hash = combine_hash(state.memoryHash, state.screenHash);
+
+        hash = combine_hash(hash, static_cast<u64>(state.pc) | (static_cast<u64>(state.i) << 16)
+                                      | (static_cast<u64>(state.sp) << 32) | (static_cast<u64>(state.delayTimer) << 40)
+                                      | (static_cast<u64>(state.soundTimer) << 48)
+                                      | (static_cast<u64>(state.isWaitingForKey) << 56));
+        hash = combine_hash(hash, static_cast<u64>(state.keyState) | (static_cast<u64>(state.keyStatePrev) << 16)
+                                      | (static_cast<u64>(state.delayTimerAccumulator) << 32));
+        hash = combine_hash(hash, static_cast<u64>(state.executionTimerAccumulator));
+        hash = combine_hash(hash, state.randomState);
+        static_assert(sizeof(state.vRegisters) % sizeof(u64) == 0, "registers must be made of whole words");
+
+        hash = combine_hash_words(hash, state.vRegisters, sizeof(state.vRegisters));
+
+        // Entries above sp are stale return addresses, states that only differ there behave the same.
+        // stack[0] is only written when an unchecked CALL wraps sp around, so it stays in.
+        for (u32 stackIndex = 0; stackIndex <= state.sp; stackIndex++)
+            hash = combine_hash(hash, state.stack[stackIndex]);
+
+        return hash;
+    }
+}
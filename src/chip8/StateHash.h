@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+
+namespace chip8
+{
+    // Zobrist-style hashing of machine states.
+    // Memory and screen hashes are the XOR of one key per non-zero byte/lit pixel, and are kept
+    // up to date by every write, so the cost of a write is a couple of key lookups at most.
+    // Keys are derived on the fly from the position instead of living in a big table.
+    inline u64 mix_hash_key(u64 value)
+    {
+        // splitmix64 finalizer
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+        return value ^ (value >> 31);
+    }
+
+    // Zero bytes don't contribute, so that zeroed memory hashes to zero.
+    inline u64 get_memory_hash_key(u16 address, u8 value)
+    {
+        return value ? mix_hash_key((static_cast<u64>(address) << 8) | value) : 0;
+    }
+
+    inline u64 get_screen_hash_key(u32 x, u32 y)
+    {
+        static const u64 ScreenKeyDomain = 0x100000;
+
+        return mix_hash_key(ScreenKeyDomain + y * ScreenWidth + x);
+    }
+
+    // From-scratch versions, for when memory or screen got written to directly.
+    CHIP8EMU_EMU_API u64 compute_memory_hash(const CPUState& state);
+    CHIP8EMU_EMU_API u64 compute_screen_hash(const CPUState& state);
+    CHIP8EMU_EMU_API void recompute_state_hash(CPUState& state);
+
+    // Constant time. Registers are mixed in on each call since there are only a few of them.
+    // The instruction count is left out, machines that reached the same state in a different
+    // number of steps are considered the same.
+    CHIP8EMU_EMU_API u64 get_state_hash(const CPUState& state);
+}
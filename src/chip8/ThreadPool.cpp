@@ -0,0 +1,177 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+#include "Trace.h"
+
+#include "core/Assert.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chip8
+{
+    struct ThreadPool
+    {
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable workCondition;
+        std::condition_variable doneCondition;
+
+        // Protected by the mutex
+        u64 generation;
+        u32 activeWorkerCount;
+        bool shouldExit;
+
+        // Current job, only written while no worker is active.
+        ParallelForFunction function;
+        void* userData;
+        u32 count;
+        std::atomic<u32> nextIndex;
+    };
+
+    namespace
+    {
+        void run_job(ThreadPool& pool)
+        {
+            CHIP8EMU_TRACE_SCOPE("parallel_for_job");
+
+            while (true)
+            {
+                const u32 index = pool.nextIndex.fetch_add(1, std::memory_order_relaxed);
+
+                if (index >= pool.count)
+                    return;
+
+                pool.function(index, pool.userData);
+            }
+        }
+
+        void run_worker(ThreadPool* pool)
+        {
+            u64 lastGeneration = 0;
+
+            set_trace_thread_name("thread pool worker");
+
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(pool->mutex);
+
+                    pool->workCondition.wait(lock, [&] { return pool->shouldExit || pool->generation != lastGeneration; });
+
+                    if (pool->shouldExit)
+                        return;
+
+                    lastGeneration = pool->generation;
+                }
+
+                run_job(*pool);
+
+                {
+                    std::lock_guard<std::mutex> lock(pool->mutex);
+
+                    pool->activeWorkerCount--;
+                }
+
+                pool->doneCondition.notify_one();
+            }
+        }
+    }
+
+    ThreadPool* createThreadPool(u32 workerCount)
+    {
+        if (workerCount == 0)
+        {
+            const u32 hardwareThreadCount = std::thread::hardware_concurrency();
+            workerCount = hardwareThreadCount > 1 ? hardwareThreadCount - 1 : 0;
+        }
+
+        ThreadPool* pool = new ThreadPool;
+
+        pool->generation = 0;
+        pool->activeWorkerCount = 0;
+        pool->shouldExit = false;
+        pool->function = nullptr;
+        pool->userData = nullptr;
+        pool->count = 0;
+        pool->nextIndex.store(0, std::memory_order_relaxed);
+
+        pool->workers.reserve(workerCount);
+
+        for (u32 workerIndex = 0; workerIndex < workerCount; workerIndex++)
+            pool->workers.emplace_back(&run_worker, pool);
+
+        return pool;
+    }
+
+    void destroyThreadPool(ThreadPool* pool)
+    {
+        Assert(pool != nullptr);
+
+        {
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            pool->shouldExit = true;
+        }
+
+        pool->workCondition.notify_all();
+
+        for (std::thread& worker : pool->workers)
+            worker.join();
+
+        delete pool;
+    }
+
+    u32 get_thread_pool_worker_count(const ThreadPool& pool)
+    {
+        return static_cast<u32>(pool.workers.size());
+    }
+
+    void parallel_for(ThreadPool& pool, u32 count, ParallelForFunction function, void* userData)
+    {
+        Assert(function != nullptr);
+
+        if (count == 0)
+            return;
+
+        // Not worth waking anyone up.
+        if (count == 1 || pool.workers.empty())
+        {
+            for (u32 index = 0; index < count; index++)
+                function(index, userData);
+
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+
+            Assert(pool.activeWorkerCount == 0); // Called concurrently
+
+            pool.function = function;
+            pool.userData = userData;
+            pool.count = count;
+            pool.nextIndex.store(0, std::memory_order_relaxed);
+            pool.activeWorkerCount = static_cast<u32>(pool.workers.size());
+            pool.generation++;
+        }
+
+        pool.workCondition.notify_all();
+
+        // Help out instead of just waiting.
+        run_job(pool);
+
+        std::unique_lock<std::mutex> lock(pool.mutex);
+
+        pool.doneCondition.wait(lock, [&] { return pool.activeWorkerCount == 0; });
+    }
+}
@@ -0,0 +1,31 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+
+#include "core/Types.h"
+
+namespace chip8
+{
+    struct ThreadPool;
+
+    using ParallelForFunction = void (*)(u32 index, void* userData);
+
+    // Pass 0 to get one worker per hardware thread, minus the calling thread.
+    CHIP8EMU_EMU_API ThreadPool* createThreadPool(u32 workerCount);
+    CHIP8EMU_EMU_API void destroyThreadPool(ThreadPool* pool);
+
+    CHIP8EMU_EMU_API u32 get_thread_pool_worker_count(const ThreadPool& pool);
+
+    // Calls the function for every index in [0, count), spread over the workers and the calling thread.
+    // Blocks until every call returned. Waking the workers costs a few microseconds, so give
+    // each call enough work to pay for it.
+    // Not reentrant, only one thread at a time can submit work to a given pool.
+    CHIP8EMU_EMU_API void parallel_for(ThreadPool& pool, u32 count, ParallelForFunction function, void* userData);
+}
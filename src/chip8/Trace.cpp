@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Trace.h"
+
+#include "core/Assert.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace chip8
+{
+    namespace
+    {
+        static_assert((TraceRingCapacity & (TraceRingCapacity - 1)) == 0, "ring capacity must be a power of two");
+
+        struct TraceEvent
+        {
+            const char* name;
+            u64 startTimestampNs;
+            u64 durationNs;
+        };
+
+        // Single producer: only the owning thread writes, readers only look at the
+        // events published by writeCount.
+        struct TraceRing
+        {
+            std::vector<TraceEvent> events; // Allocated on the first event
+            std::atomic<u64> writeCount;
+            u32 threadIndex;
+            std::string threadName;
+        };
+
+        // Rings outlive their thread so that the events of finished workers still get saved.
+        struct TraceRegistry
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<TraceRing>> rings;
+            std::chrono::steady_clock::time_point epoch;
+
+            TraceRegistry()
+                : epoch(std::chrono::steady_clock::now())
+            {}
+        };
+
+        TraceRegistry& get_registry()
+        {
+            static TraceRegistry registry;
+            return registry;
+        }
+
+        thread_local TraceRing* threadRing = nullptr;
+
+        TraceRing& get_thread_ring()
+        {
+            if (threadRing)
+                return *threadRing;
+
+            TraceRegistry& registry = get_registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+
+            std::unique_ptr<TraceRing> ring(new TraceRing);
+
+            ring->writeCount.store(0, std::memory_order_relaxed);
+            ring->threadIndex = static_cast<u32>(registry.rings.size());
+
+            threadRing = ring.get();
+            registry.rings.push_back(std::move(ring));
+
+            return *threadRing;
+        }
+
+        void write_json_string(std::ostream& output, const char* string)
+        {
+            output << '"';
+
+            for (const char* c = string; *c != '\0'; c++)
+            {
+                if (*c == '"' || *c == '\\')
+                    output << '\\' << *c;
+                else if (static_cast<u8>(*c) >= 0x20)
+                    output << *c;
+            }
+
+            output << '"';
+        }
+
+        // Trace timestamps are in microseconds.
+        void write_microseconds(std::ostream& output, u64 ns)
+        {
+            const u64 fraction = ns % 1000;
+
+            output << ns / 1000 << '.' << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + fraction / 10 % 10)
+                   << static_cast<char>('0' + fraction % 10);
+        }
+    }
+
+    std::atomic<bool> isTracingEnabled(false);
+
+    void start_tracing()
+    {
+        TraceRegistry& registry = get_registry();
+
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+
+            for (std::unique_ptr<TraceRing>& ring : registry.rings)
+                ring->writeCount.store(0, std::memory_order_relaxed);
+        }
+
+        isTracingEnabled.store(true, std::memory_order_relaxed);
+    }
+
+    void stop_tracing()
+    {
+        isTracingEnabled.store(false, std::memory_order_relaxed);
+    }
+
+    void set_trace_thread_name(const char* name)
+    {
+        Assert(name != nullptr);
+
+        TraceRing& ring = get_thread_ring();
+        std::lock_guard<std::mutex> lock(get_registry().mutex);
+
+        ring.threadName = name;
+    }
+
+    u64 get_trace_timestamp_ns()
+    {
+        const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - get_registry().epoch;
+
+        return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    void record_trace_event(const char* name, u64 startTimestampNs, u64 endTimestampNs)
+    {
+        TraceRing& ring = get_thread_ring();
+        const u64 writeCount = ring.writeCount.load(std::memory_order_relaxed);
+
+        if (ring.events.empty())
+        {
+            std::lock_guard<std::mutex> lock(get_registry().mutex);
+            ring.events.resize(TraceRingCapacity);
+        }
+
+        ring.events[writeCount & (TraceRingCapacity - 1)] = {name, startTimestampNs, endTimestampNs - startTimestampNs};
+        ring.writeCount.store(writeCount + 1, std::memory_order_release);
+    }
+
+    bool save_trace_to_file(const char* path)
+    {
+        TraceRegistry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        std::ofstream file(path, std::ios::binary);
+
+        if (!file)
+            return false;
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool isFirstEvent = true;
+
+        for (const std::unique_ptr<TraceRing>& ring : registry.rings)
+        {
+            const u64 writeCount = ring->writeCount.load(std::memory_order_acquire);
+            const u64 firstEventIndex = writeCount > TraceRingCapacity ? writeCount - TraceRingCapacity : 0;
+
+            if (!ring->threadName.empty())
+            {
+                file << (isFirstEvent ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                     << ring->threadIndex << ",\"args\":{\"name\":";
+                write_json_string(file, ring->threadName.c_str());
+                file << "}}";
+                isFirstEvent = false;
+            }
+
+            for (u64 eventIndex = firstEventIndex; eventIndex < writeCount; eventIndex++)
+            {
+                const TraceEvent& event = ring->events[eventIndex & (TraceRingCapacity - 1)];
+
+                file << (isFirstEvent ? "" : ",") << "\n{\"name\":";
+                write_json_string(file, event.name);
+                file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadIndex << ",\"ts\":";
+                write_microseconds(file, event.startTimestampNs);
+                file << ",\"dur\":";
+                write_microseconds(file, event.durationNs);
+                file << "}";
+                isFirstEvent = false;
+            }
+        }
+
+        file << "\n]}\n";
+
+        return static_cast<bool>(file);
+    }
+}
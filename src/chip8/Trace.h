@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+
+#include "core/Types.h"
+
+#include <atomic>
+
+namespace chip8
+{
+    // Timeline of scoped events, saved in the Chrome trace event format (chrome://tracing, Perfetto).
+    //
+    // Every thread records into its own ring of TraceRingCapacity events, the oldest events
+    // get overwritten when it wraps. While tracing is off a scope costs one relaxed atomic load.
+    static const u32 TraceRingCapacity = 1 << 16;
+
+    // Flipped by start_tracing() and stop_tracing(), only read it.
+    // It lives at namespace scope so that scopes can load it inline.
+    extern CHIP8EMU_EMU_API std::atomic<bool> isTracingEnabled;
+
+    inline bool is_tracing_enabled()
+    {
+        return isTracingEnabled.load(std::memory_order_relaxed);
+    }
+
+    // Starting discards the events of the previous session, do it while no other thread is recording.
+    CHIP8EMU_EMU_API void start_tracing();
+    CHIP8EMU_EMU_API void stop_tracing();
+
+    // Shows up in the viewer instead of the thread number. The string is copied.
+    CHIP8EMU_EMU_API void set_trace_thread_name(const char* name);
+
+    CHIP8EMU_EMU_API u64 get_trace_timestamp_ns();
+
+    // The name has to outlive the trace, string literals are the way to go.
+    CHIP8EMU_EMU_API void record_trace_event(const char* name, u64 startTimestampNs, u64 endTimestampNs);
+
+    // Call this once the traced threads are done, after stop_tracing().
+    // Returns false if the file could not be written.
+    CHIP8EMU_EMU_API bool save_trace_to_file(const char* path);
+
+    struct TraceScope
+    {
+        const char* name;
+        bool isActive;
+        u64 startTimestampNs;
+
+        explicit TraceScope(const char* scopeName)
+            : name(scopeName)
+            , isActive(is_tracing_enabled())
+            , startTimestampNs(isActive ? get_trace_timestamp_ns() : 0)
+        {}
+
+        ~TraceScope()
+        {
+            if (isActive)
+                record_trace_event(name, startTimestampNs, get_trace_timestamp_ns());
+        }
+    };
+}
+
+#define CHIP8EMU_TRACE_CONCAT_IMPL(lhs, rhs) lhs##rhs
+#define CHIP8EMU_TRACE_CONCAT(lhs, rhs) CHIP8EMU_TRACE_CONCAT_IMPL(lhs, rhs)
+
+#define CHIP8EMU_TRACE_SCOPE(name) chip8::TraceScope CHIP8EMU_TRACE_CONCAT(traceScope, __LINE__)(name)
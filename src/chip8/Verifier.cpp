@@ -0,0 +1,813 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Verifier.h"
+
+#include "Keyboard.h"
+#include "Memory.h"
+#include "Opcode.h"
+
+#include "core/Assert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace chip8
+{
+    namespace
+    {
+        static const u32 RegisterValueMax = 0xFF;
+        static const u32 IndexValueMax = 0xFFFF;
+
+        // Joins before a range that keeps growing gets widened to every value, so that loops converge.
+        static const u32 WideningJoinCount = 8;
+
+        // Every value a register can hold at some point of the program, bounds included.
+        struct ValueRange
+        {
+            u32 min;
+            u32 max;
+        };
+
+        struct AbstractState
+        {
+            ValueRange v[VRegisterCount];
+            ValueRange i;
+        };
+
+        struct SlotAnalysis
+        {
+            AbstractState entry; // Join of every state the instruction can start from
+            u32 joinCount;
+            bool isReached;
+            bool isQueued;
+            bool hasFallthrough; // CALL that may overflow the stack or RET that may underflow it, both do nothing
+        };
+
+        // Calls and returns are matched context-insensitively: every RET may return to every return site.
+        struct Analysis
+        {
+            const CPUState* state;
+            u32 quirkFlags;
+            std::vector<SlotAnalysis> slots;
+            std::vector<u16> worklist;
+            std::vector<u16> returnSites;
+            AbstractState returnState; // Join of the states of every RET
+            bool hasReturned;
+            bool hasInvalidReturnSite; // A CALL at the very end of memory, returning there does nothing
+        };
+
+        ValueRange make_range(u32 min, u32 max)
+        {
+            const ValueRange range = {min, max};
+            return range;
+        }
+
+        ValueRange join_ranges(ValueRange lhs, ValueRange rhs)
+        {
+            return make_range(std::min(lhs.min, rhs.min), std::max(lhs.max, rhs.max));
+        }
+
+        bool is_same_range(ValueRange lhs, ValueRange rhs)
+        {
+            return lhs.min == rhs.min && lhs.max == rhs.max;
+        }
+
+        // Values wrap around past valueMax, like the registers do.
+        ValueRange add_ranges(ValueRange lhs, ValueRange rhs, u32 valueMax)
+        {
+            const u32 min = lhs.min + rhs.min;
+            const u32 max = lhs.max + rhs.max;
+
+            if (max <= valueMax)
+                return make_range(min, max);
+            if (min > valueMax)
+                return make_range(min - (valueMax + 1), max - (valueMax + 1));
+
+            return make_range(0, valueMax);
+        }
+
+        // Smallest all-ones value covering the value, the bound of OR and XOR.
+        u32 get_covering_mask(u32 value)
+        {
+            u32 mask = 0;
+
+            while (mask < value)
+                mask = (mask << 1) | 1;
+
+            return mask;
+        }
+
+        AbstractState get_unknown_state()
+        {
+            AbstractState state;
+
+            for (u32 registerIndex = 0; registerIndex < VRegisterCount; registerIndex++)
+                state.v[registerIndex] = make_range(0, RegisterValueMax);
+
+            state.i = make_range(0, IndexValueMax);
+
+            return state;
+        }
+
+        bool join_range(ValueRange& target, ValueRange source, bool widen, u32 valueMax)
+        {
+            const ValueRange joined = join_ranges(target, source);
+
+            if (is_same_range(joined, target))
+                return false;
+
+            target = widen ? make_range(0, valueMax) : joined;
+            return true;
+        }
+
+        bool join_state(AbstractState& target, const AbstractState& source, bool widen)
+        {
+            bool changed = false;
+
+            for (u32 registerIndex = 0; registerIndex < VRegisterCount; registerIndex++)
+                changed |= join_range(target.v[registerIndex], source.v[registerIndex], widen, RegisterValueMax);
+
+            changed |= join_range(target.i, source.i, widen, IndexValueMax);
+
+            return changed;
+        }
+
+        u16 read_instruction(const CPUState& state, u16 address)
+        {
+            return load_u16_big_endian(get_memory_pointer(state, address));
+        }
+
+        // Same checks as the interpreter, see Instruction.inl
+        bool is_valid_jump_target(u32 address)
+        {
+            return (address & 0x0001) == 0 && address >= MinProgramAddress && address + 1 <= MaxProgramAddress;
+        }
+
+        bool can_skip(u16 address)
+        {
+            return address >= MinProgramAddress && address + 5u <= MaxProgramAddress;
+        }
+
+        bool is_valid_memory_access(ValueRange i, u32 sizeInBytes, MemoryUsage usage)
+        {
+            const u32 minAddress = usage == MemoryUsage::Read ? 0 : MinProgramAddress;
+
+            return sizeInBytes > 0 && i.min >= minAddress && i.max + sizeInBytes - 1 <= MaxProgramAddress;
+        }
+
+        // The interpreter steps over any instruction that leaves the pc unchanged, jumps to their own address included.
+        u16 get_jump_successor(u16 address, u16 target)
+        {
+            return target == address ? static_cast<u16>(address + 2) : target;
+        }
+
+        bool is_return_instruction(const CPUState& state, u16 address)
+        {
+            return is_valid_jump_target(address) && get_opcode_class(read_instruction(state, address)) == OpcodeClass::Ret;
+        }
+
+        ValueRange get_jump_offset(const Analysis& analysis, u16 instruction, const AbstractState& state)
+        {
+            const u32 registerName = (analysis.quirkFlags & QuirkJumpVx) ? (instruction >> 8) & 0x000F : V0;
+
+            return state.v[registerName];
+        }
+
+        // The state after the instruction, for every successor.
+        void execute_abstract_instruction(const Analysis& analysis, u16 instruction, AbstractState& state)
+        {
+            const u32 x = (instruction >> 8) & 0x000F;
+            const u32 y = (instruction >> 4) & 0x000F;
+            const u32 kk = instruction & 0x00FF;
+            const ValueRange flag = make_range(0, 1);
+            const ValueRange unknownRegister = make_range(0, RegisterValueMax);
+
+            switch (get_opcode_class(instruction))
+            {
+                case OpcodeClass::LdImm:
+                    state.v[x] = make_range(kk, kk);
+                    break;
+                case OpcodeClass::AddImm:
+                    state.v[x] = add_ranges(state.v[x], make_range(kk, kk), RegisterValueMax);
+                    break;
+                case OpcodeClass::LdReg:
+                    state.v[x] = state.v[y];
+                    break;
+                case OpcodeClass::Or:
+                case OpcodeClass::Xor:
+                    state.v[x] = make_range(0, get_covering_mask(std::max(state.v[x].max, state.v[y].max)));
+                    if (analysis.quirkFlags & QuirkLogicResetVF)
+                        state.v[VF] = make_range(0, 0);
+                    break;
+                case OpcodeClass::And:
+                    state.v[x] = make_range(0, std::min(state.v[x].max, state.v[y].max));
+                    if (analysis.quirkFlags & QuirkLogicResetVF)
+                        state.v[VF] = make_range(0, 0);
+                    break;
+                case OpcodeClass::AddReg:
+                    state.v[x] = add_ranges(state.v[x], state.v[y], RegisterValueMax);
+                    state.v[VF] = flag;
+                    break;
+                case OpcodeClass::Sub:
+                case OpcodeClass::Subn:
+                {
+                    const ValueRange lhs = get_opcode_class(instruction) == OpcodeClass::Sub ? state.v[x] : state.v[y];
+                    const ValueRange rhs = get_opcode_class(instruction) == OpcodeClass::Sub ? state.v[y] : state.v[x];
+
+                    state.v[x] = lhs.min >= rhs.max ? make_range(lhs.min - rhs.max, lhs.max - rhs.min) : unknownRegister;
+                    state.v[VF] = flag;
+                    break;
+                }
+                case OpcodeClass::Shr:
+                {
+                    const ValueRange value = (analysis.quirkFlags & QuirkShiftVy) ? state.v[y] : state.v[x];
+
+                    state.v[x] = make_range(value.min >> 1, value.max >> 1);
+                    state.v[VF] = flag;
+                    break;
+                }
+                case OpcodeClass::Shl:
+                {
+                    const ValueRange value = (analysis.quirkFlags & QuirkShiftVy) ? state.v[y] : state.v[x];
+
+                    state.v[x] = value.max * 2 <= RegisterValueMax ? make_range(value.min * 2, value.max * 2)
+                                                                   : unknownRegister;
+                    state.v[VF] = flag;
+                    break;
+                }
+                case OpcodeClass::LdI:
+                    state.i = make_range(instruction & 0x0FFF, instruction & 0x0FFF);
+                    break;
+                case OpcodeClass::Rnd:
+                    state.v[x] = make_range(0, kk);
+                    break;
+                case OpcodeClass::Drw:
+                    // Invalid sprites leave VF alone
+                    state.v[VF] = join_ranges(state.v[VF], flag);
+                    break;
+                case OpcodeClass::LdVxDt:
+                    state.v[x] = unknownRegister;
+                    break;
+                case OpcodeClass::LdVxK:
+                    state.v[x] = make_range(0, FontTableGlyphCount - 1);
+                    break;
+                case OpcodeClass::AddI:
+                    state.i = add_ranges(state.i, state.v[x], IndexValueMax);
+                    break;
+                case OpcodeClass::LdF:
+                {
+                    // Invalid glyphs leave I alone
+                    const ValueRange glyphs = state.v[x];
+                    ValueRange i = glyphs.max < FontTableGlyphCount ? make_range(IndexValueMax, 0) : state.i;
+
+                    for (u32 glyph = glyphs.min; glyph <= std::min<u32>(glyphs.max, FontTableGlyphCount - 1); glyph++)
+                        i = join_ranges(i, make_range(analysis.state->fontTableOffsets[glyph],
+                                                      analysis.state->fontTableOffsets[glyph]));
+
+                    state.i = i;
+                    break;
+                }
+                case OpcodeClass::LdIVx:
+                    if (analysis.quirkFlags & QuirkLoadStoreIncrementI)
+                        state.i = add_ranges(state.i, make_range(x + 1, x + 1), IndexValueMax);
+                    break;
+                case OpcodeClass::LdVxI:
+                    for (u32 registerIndex = 0; registerIndex <= x; registerIndex++)
+                        state.v[registerIndex] = unknownRegister;
+                    if (analysis.quirkFlags & QuirkLoadStoreIncrementI)
+                        state.i = add_ranges(state.i, make_range(x + 1, x + 1), IndexValueMax);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Where the pc can go next without leaving the current subroutine: calls are assumed to return,
+        // and RET goes nowhere.
+        void get_local_successors(const Analysis& analysis, u16 address, u16 instruction, const AbstractState& state,
+                                  std::vector<u16>& successors)
+        {
+            const u16 nextAddress = static_cast<u16>(address + 2);
+
+            successors.clear();
+
+            switch (get_opcode_class(instruction))
+            {
+                case OpcodeClass::Ret:
+                    break;
+                case OpcodeClass::Call:
+                    successors.push_back(nextAddress);
+
+                    // A RET right at the return site returns to itself, and gets stepped over
+                    if (is_return_instruction(*analysis.state, nextAddress))
+                        successors.push_back(static_cast<u16>(nextAddress + 2));
+                    break;
+                case OpcodeClass::Jp:
+                    successors.push_back(is_valid_jump_target(instruction & 0x0FFF)
+                                             ? get_jump_successor(address, instruction & 0x0FFF)
+                                             : nextAddress);
+                    break;
+                case OpcodeClass::SeImm:
+                case OpcodeClass::SneImm:
+                case OpcodeClass::SeReg:
+                case OpcodeClass::SneReg:
+                case OpcodeClass::Skp:
+                case OpcodeClass::Sknp:
+                    successors.push_back(nextAddress);
+                    if (can_skip(address))
+                        successors.push_back(static_cast<u16>(address + 4));
+                    break;
+                case OpcodeClass::JpV0:
+                {
+                    const ValueRange offset = get_jump_offset(analysis, instruction, state);
+                    bool hasInvalidTarget = false;
+
+                    for (u32 target = (instruction & 0x0FFF) + offset.min; target <= (instruction & 0x0FFF) + offset.max;
+                         target++)
+                    {
+                        if (is_valid_jump_target(target))
+                            successors.push_back(get_jump_successor(address, static_cast<u16>(target)));
+                        else
+                            hasInvalidTarget = true;
+                    }
+
+                    // Invalid jumps do nothing
+                    if (hasInvalidTarget)
+                        successors.push_back(nextAddress);
+                    break;
+                }
+                default:
+                    successors.push_back(nextAddress);
+                    break;
+            }
+        }
+
+        void queue_slot(Analysis& analysis, u16 address)
+        {
+            SlotAnalysis& slot = analysis.slots[address >> 1];
+
+            if (!slot.isQueued)
+            {
+                slot.isQueued = true;
+                analysis.worklist.push_back(address);
+            }
+        }
+
+        void propagate_state(Analysis& analysis, u16 address, const AbstractState& state)
+        {
+            // An odd pc never reaches an instruction again, and past the end of memory it wraps around
+            // to address 0 after a long run of ignored fetches.
+            if ((address & 0x0001) != 0)
+                return;
+
+            if (address >= MaxProgramAddress)
+                address = 0;
+
+            SlotAnalysis& slot = analysis.slots[address >> 1];
+
+            if (!slot.isReached)
+            {
+                slot.entry = state;
+                slot.isReached = true;
+            }
+            else if (join_state(slot.entry, state, slot.joinCount >= WideningJoinCount))
+                slot.joinCount++;
+            else
+                return;
+
+            queue_slot(analysis, address);
+        }
+
+        void queue_return_instructions(Analysis& analysis)
+        {
+            for (u32 slotIndex = 0; slotIndex < ProgramVerificationSlotCount; slotIndex++)
+            {
+                const u16 address = static_cast<u16>(slotIndex * 2);
+
+                if (analysis.slots[slotIndex].isReached
+                    && get_opcode_class(read_instruction(*analysis.state, address)) == OpcodeClass::Ret)
+                    queue_slot(analysis, address);
+            }
+        }
+
+        void analyze_instruction(Analysis& analysis, u16 address, std::vector<u16>& successors)
+        {
+            const SlotAnalysis& slot = analysis.slots[address >> 1];
+            const AbstractState entry = slot.entry;
+            const u16 instruction = read_instruction(*analysis.state, address);
+            const u16 nextAddress = static_cast<u16>(address + 2);
+
+            switch (get_opcode_class(instruction))
+            {
+                case OpcodeClass::Call:
+                {
+                    const u16 target = instruction & 0x0FFF;
+
+                    if (!is_valid_jump_target(target) || slot.hasFallthrough)
+                        propagate_state(analysis, nextAddress, entry);
+
+                    if (!is_valid_jump_target(target))
+                        break;
+
+                    propagate_state(analysis, get_jump_successor(address, target), entry);
+
+                    if (std::find(analysis.returnSites.begin(), analysis.returnSites.end(), nextAddress)
+                        != analysis.returnSites.end())
+                        break;
+
+                    if (!is_valid_jump_target(nextAddress))
+                    {
+                        // Returning there does nothing, from now on every RET may fall through.
+                        if (!analysis.hasInvalidReturnSite)
+                            queue_return_instructions(analysis);
+
+                        analysis.hasInvalidReturnSite = true;
+                        break;
+                    }
+
+                    analysis.returnSites.push_back(nextAddress);
+
+                    if (!analysis.hasReturned)
+                        break;
+
+                    propagate_state(analysis, nextAddress, analysis.returnState);
+
+                    if (is_return_instruction(*analysis.state, nextAddress))
+                        propagate_state(analysis, static_cast<u16>(nextAddress + 2), analysis.returnState);
+                    break;
+                }
+                case OpcodeClass::Ret:
+                {
+                    if (slot.hasFallthrough || analysis.hasInvalidReturnSite)
+                        propagate_state(analysis, nextAddress, entry);
+
+                    const bool hasNewReturnState =
+                        !analysis.hasReturned || join_state(analysis.returnState, entry, false);
+
+                    if (!analysis.hasReturned)
+                        analysis.returnState = entry;
+
+                    analysis.hasReturned = true;
+
+                    for (u16 returnSite : analysis.returnSites)
+                    {
+                        if (returnSite == address)
+                            propagate_state(analysis, nextAddress, analysis.returnState);
+                        else if (hasNewReturnState)
+                            propagate_state(analysis, returnSite, analysis.returnState);
+                    }
+                    break;
+                }
+                default:
+                {
+                    AbstractState exit = entry;
+                    execute_abstract_instruction(analysis, instruction, exit);
+
+                    get_local_successors(analysis, address, instruction, entry, successors);
+
+                    for (u16 successor : successors)
+                        propagate_state(analysis, successor, exit);
+                    break;
+                }
+            }
+        }
+
+        void run_analysis(Analysis& analysis)
+        {
+            std::vector<u16> successors;
+
+            while (!analysis.worklist.empty())
+            {
+                const u16 address = analysis.worklist.back();
+                analysis.worklist.pop_back();
+
+                analysis.slots[address >> 1].isQueued = false;
+
+                analyze_instruction(analysis, address, successors);
+            }
+        }
+
+        // Slots reachable from the entry of a subroutine without returning from it, the main program included.
+        void find_subroutine_body(const Analysis& analysis, u16 entryAddress, bool isMainProgram,
+                                  std::vector<bool>& body)
+        {
+            std::vector<u16> stack(1, entryAddress);
+            std::vector<u16> successors;
+
+            body.assign(ProgramVerificationSlotCount, false);
+            body[entryAddress >> 1] = true;
+
+            while (!stack.empty())
+            {
+                const u16 address = stack.back();
+                stack.pop_back();
+
+                const u16 instruction = read_instruction(*analysis.state, address);
+
+                get_local_successors(analysis, address, instruction, analysis.slots[address >> 1].entry, successors);
+
+                // Returning from the main program does nothing
+                if (get_opcode_class(instruction) == OpcodeClass::Ret
+                    && (isMainProgram || analysis.hasInvalidReturnSite))
+                    successors.push_back(static_cast<u16>(address + 2));
+
+                for (u16 successor : successors)
+                {
+                    if ((successor & 0x0001) != 0)
+                        continue;
+
+                    if (successor >= MaxProgramAddress)
+                        successor = 0;
+
+                    // Edges the analysis didn't follow yet, it runs again once they are added.
+                    if (body[successor >> 1] || !analysis.slots[successor >> 1].isReached)
+                        continue;
+
+                    body[successor >> 1] = true;
+                    stack.push_back(successor);
+                }
+            }
+        }
+
+        // Stack depth of every slot, from the subroutines it belongs to, -1 when unknown.
+        // Depths saturate at StackSize, where calls start failing.
+        void compute_call_depths(const Analysis& analysis, std::vector<int>& slotDepths,
+                                 std::vector<bool>& mainProgramBody, u32& maxCallDepth)
+        {
+            std::vector<u16> entries(1, MinProgramAddress);
+
+            for (u32 slotIndex = 0; slotIndex < ProgramVerificationSlotCount; slotIndex++)
+            {
+                if (!analysis.slots[slotIndex].isReached)
+                    continue;
+
+                const u16 address = static_cast<u16>(slotIndex * 2);
+                const u16 instruction = read_instruction(*analysis.state, address);
+                const u16 entry = get_jump_successor(address, instruction & 0x0FFF);
+
+                if (get_opcode_class(instruction) == OpcodeClass::Call && is_valid_jump_target(instruction & 0x0FFF)
+                    && std::find(entries.begin(), entries.end(), entry) == entries.end())
+                    entries.push_back(entry);
+            }
+
+            std::vector<std::vector<bool>> bodies(entries.size());
+
+            for (u32 entryIndex = 0; entryIndex < entries.size(); entryIndex++)
+                find_subroutine_body(analysis, entries[entryIndex], entryIndex == 0, bodies[entryIndex]);
+
+            std::vector<int> entryDepths(entries.size(), -1);
+            entryDepths[0] = 0;
+
+            for (bool changed = true; changed;)
+            {
+                changed = false;
+
+                for (u32 entryIndex = 0; entryIndex < entries.size(); entryIndex++)
+                {
+                    if (entryDepths[entryIndex] < 0)
+                        continue;
+
+                    const int calleeDepth = std::min<int>(entryDepths[entryIndex] + 1, StackSize);
+
+                    for (u32 slotIndex = 0; slotIndex < ProgramVerificationSlotCount; slotIndex++)
+                    {
+                        if (!bodies[entryIndex][slotIndex])
+                            continue;
+
+                        const u16 address = static_cast<u16>(slotIndex * 2);
+                        const u16 instruction = read_instruction(*analysis.state, address);
+
+                        if (get_opcode_class(instruction) != OpcodeClass::Call
+                            || !is_valid_jump_target(instruction & 0x0FFF))
+                            continue;
+
+                        const u16 entry = get_jump_successor(address, instruction & 0x0FFF);
+                        const size_t calleeIndex = std::find(entries.begin(), entries.end(), entry) - entries.begin();
+
+                        if (calleeDepth > entryDepths[calleeIndex])
+                        {
+                            entryDepths[calleeIndex] = calleeDepth;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+
+            slotDepths.assign(ProgramVerificationSlotCount, -1);
+            maxCallDepth = 0;
+
+            for (u32 entryIndex = 0; entryIndex < entries.size(); entryIndex++)
+            {
+                if (entryDepths[entryIndex] < 0)
+                    continue;
+
+                maxCallDepth = std::max(maxCallDepth, static_cast<u32>(entryDepths[entryIndex]));
+
+                for (u32 slotIndex = 0; slotIndex < ProgramVerificationSlotCount; slotIndex++)
+                {
+                    if (bodies[entryIndex][slotIndex])
+                        slotDepths[slotIndex] = std::max(slotDepths[slotIndex], entryDepths[entryIndex]);
+                }
+            }
+
+            mainProgramBody.swap(bodies[0]);
+        }
+
+        // True when none of the runtime checks of the instruction can fail from the entry state,
+        // running it unchecked then does exactly the same.
+        bool is_safe_instruction(const Analysis& analysis, u16 address, u16 instruction, const AbstractState& state,
+                                 int stackDepth, bool isInMainProgram)
+        {
+            const u32 x = (instruction >> 8) & 0x000F;
+
+            // The unchecked interpreter would wrap the next pc around instead of failing the next fetch
+            if (address + 2u >= MemorySizeInBytes)
+                return false;
+
+            switch (get_opcode_class(instruction))
+            {
+                case OpcodeClass::Ret:
+                    return stackDepth > 0 && !isInMainProgram && !analysis.hasInvalidReturnSite;
+                case OpcodeClass::Jp:
+                    return is_valid_jump_target(instruction & 0x0FFF);
+                case OpcodeClass::Call:
+                    return is_valid_jump_target(instruction & 0x0FFF) && stackDepth >= 0
+                           && stackDepth + 1 < static_cast<int>(StackSize);
+                case OpcodeClass::SeImm:
+                case OpcodeClass::SneImm:
+                case OpcodeClass::SeReg:
+                case OpcodeClass::SneReg:
+                    return can_skip(address);
+                case OpcodeClass::Skp:
+                case OpcodeClass::Sknp:
+                    return can_skip(address) && state.v[x].max < KeyIDCount;
+                case OpcodeClass::JpV0:
+                {
+                    const ValueRange offset = get_jump_offset(analysis, instruction, state);
+                    const u32 baseAddress = instruction & 0x0FFF;
+
+                    // Every target must be valid, so a single one
+                    return offset.min == offset.max && is_valid_jump_target(baseAddress + offset.min);
+                }
+                case OpcodeClass::Drw:
+                    return is_valid_memory_access(state.i, instruction & 0x000F, MemoryUsage::Read);
+                case OpcodeClass::LdVxK:
+                    return false; // Pressing key 0 alone trips an Assert
+                case OpcodeClass::AddI:
+                    return state.i.max + state.v[x].max <= IndexValueMax;
+                case OpcodeClass::LdF:
+                    return state.v[x].max < FontTableGlyphCount;
+                case OpcodeClass::LdB:
+                    return is_valid_memory_access(state.i, 3, MemoryUsage::Write);
+                case OpcodeClass::LdIVx:
+                    return is_valid_memory_access(state.i, x + 1, MemoryUsage::Write);
+                case OpcodeClass::LdVxI:
+                    return is_valid_memory_access(state.i, x + 1, MemoryUsage::Read);
+                case OpcodeClass::Invalid:
+                    return false;
+                default:
+                    return true;
+            }
+        }
+
+        // Bytes LD B and LD [I] may write, the interpreter skips writes that don't fit.
+        bool get_written_range(u16 instruction, const AbstractState& state, u32& firstAddress, u32& lastAddress)
+        {
+            const OpcodeClass opcodeClass = get_opcode_class(instruction);
+
+            if (opcodeClass != OpcodeClass::LdB && opcodeClass != OpcodeClass::LdIVx)
+                return false;
+
+            const u32 sizeInBytes = opcodeClass == OpcodeClass::LdB ? 3 : ((instruction >> 8) & 0x000F) + 1;
+            const u32 minAddress = std::max<u32>(state.i.min, MinProgramAddress);
+            const u32 maxAddress = std::min<u32>(state.i.max, MaxProgramAddress + 1 - sizeInBytes);
+
+            if (minAddress > maxAddress)
+                return false;
+
+            firstAddress = minAddress;
+            lastAddress = maxAddress + sizeInBytes - 1;
+
+            return true;
+        }
+    }
+
+    void verify_program(const CPUState& state, QuirkProfile quirkProfile, ProgramVerification& verification)
+    {
+        Assert(quirkProfile < QuirkProfile::Count);
+
+        Analysis analysis;
+        analysis.state = &state;
+        analysis.quirkFlags = get_quirk_flags(quirkProfile);
+        analysis.slots.assign(ProgramVerificationSlotCount, SlotAnalysis());
+        analysis.returnState = get_unknown_state();
+        analysis.hasReturned = false;
+        analysis.hasInvalidReturnSite = false;
+
+        // Registers are not cleared at power-on, nothing is assumed about them.
+        propagate_state(analysis, MinProgramAddress, get_unknown_state());
+
+        std::vector<int> slotDepths;
+        std::vector<bool> mainProgramBody;
+        u32 maxCallDepth = 0;
+
+        // Calls and returns that may fail fall through to the next instruction, these new edges can in turn
+        // change the depths. Edges only ever get added, so this converges.
+        for (bool hasNewEdges = true; hasNewEdges;)
+        {
+            run_analysis(analysis);
+            compute_call_depths(analysis, slotDepths, mainProgramBody, maxCallDepth);
+
+            hasNewEdges = false;
+
+            for (u32 slotIndex = 0; slotIndex < ProgramVerificationSlotCount; slotIndex++)
+            {
+                SlotAnalysis& slot = analysis.slots[slotIndex];
+
+                if (!slot.isReached || slot.hasFallthrough)
+                    continue;
+
+                const u16 address = static_cast<u16>(slotIndex * 2);
+                const OpcodeClass opcodeClass = get_opcode_class(read_instruction(state, address));
+                const bool mayOverflow = slotDepths[slotIndex] < 0 || slotDepths[slotIndex] + 1 >= static_cast<int>(StackSize);
+
+                if ((opcodeClass == OpcodeClass::Call && mayOverflow)
+                    || (opcodeClass == OpcodeClass::Ret && (mainProgramBody[slotIndex] || analysis.hasInvalidReturnSite)))
+                {
+                    slot.hasFallthrough = true;
+                    queue_slot(analysis, address);
+                    hasNewEdges = true;
+                }
+            }
+        }
+
+        verification.quirkProfile = quirkProfile;
+        verification.isSelfModifying = false;
+        verification.codeInstructionCount = 0;
+        verification.verifiedInstructionCount = 0;
+        verification.maxCallDepth = maxCallDepth;
+        std::memset(verification.slots, 0, sizeof(verification.slots));
+
+        std::vector<bool> isCodeByte(MemorySizeInBytes, false);
+
+        for (u32 slotIndex = 0; slotIndex < ProgramVerificationSlotCount; slotIndex++)
+        {
+            const SlotAnalysis& slot = analysis.slots[slotIndex];
+
+            if (!slot.isReached)
+                continue;
+
+            const u16 address = static_cast<u16>(slotIndex * 2);
+            const u16 instruction = read_instruction(state, address);
+            u8 flags = ProgramSlotCode;
+
+            if (get_opcode_class(instruction) == OpcodeClass::JpV0)
+                flags |= ProgramSlotComputedJump;
+
+            if (is_safe_instruction(analysis, address, instruction, slot.entry, slotDepths[slotIndex],
+                                    mainProgramBody[slotIndex]))
+                flags |= ProgramSlotVerified;
+
+            verification.slots[slotIndex] = flags;
+            isCodeByte[address] = true;
+            isCodeByte[address + 1] = true;
+        }
+
+        // Code that may change under the analysis can't be trusted, neither can anything it leads to.
+        for (u32 slotIndex = 0; slotIndex < ProgramVerificationSlotCount; slotIndex++)
+        {
+            u32 firstAddress = 0;
+            u32 lastAddress = 0;
+
+            if (!analysis.slots[slotIndex].isReached
+                || !get_written_range(read_instruction(state, static_cast<u16>(slotIndex * 2)),
+                                      analysis.slots[slotIndex].entry, firstAddress, lastAddress))
+                continue;
+
+            for (u32 address = firstAddress; address <= lastAddress; address++)
+            {
+                if (!isCodeByte[address])
+                    continue;
+
+                verification.slots[slotIndex] |= ProgramSlotCodeWrite;
+                verification.slots[address >> 1] |= ProgramSlotOverwritten;
+                verification.isSelfModifying = true;
+            }
+        }
+
+        for (u32 slotIndex = 0; slotIndex < ProgramVerificationSlotCount; slotIndex++)
+        {
+            if (verification.isSelfModifying)
+                verification.slots[slotIndex] &= ~ProgramSlotVerified;
+
+            verification.codeInstructionCount += (verification.slots[slotIndex] & ProgramSlotCode) ? 1 : 0;
+            verification.verifiedInstructionCount += (verification.slots[slotIndex] & ProgramSlotVerified) ? 1 : 0;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+#include "Quirks.h"
+
+namespace chip8
+{
+    // Load-time verification of a rom, meant to run right after load_program().
+    //
+    // Follows jumps, calls, returns and skips from MinProgramAddress to find the reachable code, and tracks the
+    // range of values V0-VF and I can hold before each instruction. An instruction is verified when none of
+    // its runtime checks can fail for any of these values. With EmuConfig::verification set, execute_step()
+    // runs verified instructions unchecked and everything else through the checked interpreter, so the rom
+    // behaves exactly as it would fully checked.
+    //
+    // Computed jumps (Bnnn) are followed to every target the register range allows. A write through I that
+    // may land on reachable code makes the rom self-modifying, and then nothing gets verified.
+    //
+    // The result holds for states running the rom from power-on with the quirk profile it was verified for.
+    // Writing to the memory of the state from outside the interpreter invalidates it.
+    static const u32 ProgramVerificationSlotCount = MemorySizeInBytes / 2;
+
+    static const u8 ProgramSlotCode = 1 << 0;         // Reachable from the entry point
+    static const u8 ProgramSlotVerified = 1 << 1;     // Runs without runtime checks
+    static const u8 ProgramSlotComputedJump = 1 << 2; // Bnnn
+    static const u8 ProgramSlotCodeWrite = 1 << 3;    // LD B or LD [I] that may write over reachable code
+    static const u8 ProgramSlotOverwritten = 1 << 4;  // Reachable code that one of those may write over
+
+    struct ProgramVerification
+    {
+        QuirkProfile quirkProfile;
+        bool isSelfModifying;
+        u32 codeInstructionCount;
+        u32 verifiedInstructionCount;
+        u32 maxCallDepth; // StackSize when unbounded, e.g. with recursion
+        u8 slots[ProgramVerificationSlotCount]; // Indexed by pc / 2
+    };
+
+    // The rom is read from the memory of the state.
+    CHIP8EMU_EMU_API void verify_program(const CPUState& state, QuirkProfile quirkProfile,
+                                         ProgramVerification& verification);
+
+    inline bool is_verified_instruction(const ProgramVerification& verification, u16 pc)
+    {
+        return (pc & 0x0001) == 0 && pc < MemorySizeInBytes && (verification.slots[pc >> 1] & ProgramSlotVerified);
+    }
+}
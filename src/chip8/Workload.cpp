@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Workload.h"
+
+#include "Execution.h"
+
+#include "core/Assert.h"
+
+#include <cstring>
+
+namespace chip8
+{
+    namespace
+    {
+        // Instructions run by the loop counter, per iteration.
+        static const u32 LoopCounterInstructionCount = 5;
+
+        static const u16 MemoryStreamAddress = 0x400;
+
+        const u8 StormSprite[] = {0xFF, 0x81, 0xBD, 0xA5, 0xA5, 0xBD, 0x81, 0xFF};
+
+        u16 get_next_address(const std::vector<u8>& program)
+        {
+            return static_cast<u16>(MinProgramAddress + program.size());
+        }
+
+        void emit(std::vector<u8>& program, u16 instruction)
+        {
+            program.push_back(static_cast<u8>(instruction >> 8));
+            program.push_back(static_cast<u8>(instruction));
+        }
+
+        void patch(std::vector<u8>& program, u16 address, u16 instruction)
+        {
+            const u32 offset = address - MinProgramAddress;
+
+            program[offset + 0] = static_cast<u8>(instruction >> 8);
+            program[offset + 1] = static_cast<u8>(instruction);
+        }
+
+        // Runs the ALU kernel the way the spec describes it, VF is left to the last instruction.
+        void compute_alu_loop_state(u32 iterationCount, u8* v)
+        {
+            for (u32 iteration = 0; iteration < iterationCount; iteration++)
+            {
+                v[V0] = static_cast<u8>(v[V0] + 1);
+                v[V1] = static_cast<u8>(v[V1] + 7);
+                v[V2] = static_cast<u8>(v[V2] ^ v[V1]);
+                v[V3] = static_cast<u8>(v[V3] + v[V2]);
+                v[V4] = static_cast<u8>(v[V4] | v[V2]);
+                v[VF] = v[V5] > v[V0] ? 1 : 0;
+                v[V5] = static_cast<u8>(v[V5] - v[V0]);
+            }
+        }
+
+        // Every iteration stores V0-VB, then loads V0-VA shifted by one byte and bumps VB.
+        void compute_memory_stream_state(u32 iterationCount, u8* v)
+        {
+            for (u32 iteration = 0; iteration < iterationCount; iteration++)
+            {
+                std::memmove(v + V0, v + V1, VB - V0);
+                v[VB] = static_cast<u8>(v[VB] + 1);
+            }
+        }
+    }
+
+    const char* get_workload_kind_name(WorkloadKind kind)
+    {
+        switch (kind)
+        {
+            case WorkloadKind::ALULoop:
+                return "alu_loop";
+            case WorkloadKind::SpriteStorm:
+                return "sprite_storm";
+            case WorkloadKind::DeepCalls:
+                return "deep_calls";
+            case WorkloadKind::MemoryStream:
+                return "memory_stream";
+            case WorkloadKind::TimerPoll:
+                return "timer_poll";
+            case WorkloadKind::Count:
+                break;
+        }
+
+        AssertUnreachable();
+        return "unknown";
+    }
+
+    void generate_workload(WorkloadKind kind, u32 iterationCount, Workload& workload)
+    {
+        Assert(iterationCount > 0 && iterationCount <= 0xFFFF);
+
+        std::vector<u8>& program = workload.program;
+
+        workload.kind = kind;
+        workload.iterationCount = iterationCount;
+        workload.i = 0;
+        std::memset(workload.vRegisters, 0, VRegisterCount);
+        program.clear();
+
+        u32 prologueInstructionCount = 0;
+        u32 kernelInstructionCount = 0;
+        u16 dataReferenceAddress = 0; // Instruction to patch once the data after the halt is placed
+
+        // Prologue
+        if (kind == WorkloadKind::SpriteStorm)
+        {
+            dataReferenceAddress = get_next_address(program);
+            emit(program, 0xA000); // LD I, sprite
+            prologueInstructionCount = 1;
+        }
+        else if (kind == WorkloadKind::TimerPoll)
+        {
+            emit(program, 0x6802); // LD V8, 2
+            prologueInstructionCount = 1;
+        }
+
+        // VE holds the low byte of the remaining iterations, VD the high byte.
+        emit(program, static_cast<u16>(0x6E00 | (iterationCount & 0xFF))); // LD VE, low
+        emit(program, static_cast<u16>(0x6D00 | (iterationCount >> 8)));   // LD VD, high
+
+        const u16 loopAddress = get_next_address(program);
+
+        switch (kind)
+        {
+            case WorkloadKind::ALULoop:
+                emit(program, 0x7001); // ADD V0, 1
+                emit(program, 0x7107); // ADD V1, 7
+                emit(program, 0x8213); // XOR V2, V1
+                emit(program, 0x8324); // ADD V3, V2
+                emit(program, 0x8421); // OR V4, V2
+                emit(program, 0x8505); // SUB V5, V0
+                kernelInstructionCount = 6;
+                break;
+            case WorkloadKind::SpriteStorm:
+                emit(program, 0xD018); // DRW V0, V1, 8
+                emit(program, 0xD018); // DRW V0, V1, 8
+                emit(program, 0x7005); // ADD V0, 5
+                emit(program, 0x7103); // ADD V1, 3
+                kernelInstructionCount = 4;
+                break;
+            case WorkloadKind::DeepCalls:
+                dataReferenceAddress = get_next_address(program);
+                emit(program, 0x2000); // CALL first function
+                kernelInstructionCount = 2 * WorkloadCallDepth + 1;
+                break;
+            case WorkloadKind::MemoryStream:
+                emit(program, static_cast<u16>(0xA000 | MemoryStreamAddress));       // LD I, buffer
+                emit(program, 0xFB55);                                                // LD [I], VB
+                emit(program, static_cast<u16>(0xA000 | (MemoryStreamAddress + 1))); // LD I, buffer + 1
+                emit(program, 0xFA65);                                                // LD VA, [I]
+                emit(program, 0x7B01);                                                // ADD VB, 1
+                kernelInstructionCount = 5;
+                break;
+            case WorkloadKind::TimerPoll:
+            {
+                emit(program, 0xF815); // LD DT, V8
+
+                const u16 pollAddress = get_next_address(program);
+
+                emit(program, 0xF907);                                 // LD V9, DT
+                emit(program, 0x3900);                                 // SE V9, 0
+                emit(program, static_cast<u16>(0x1000 | pollAddress)); // JP poll
+                break;
+            }
+            case WorkloadKind::Count:
+                AssertUnreachable();
+                break;
+        }
+
+        // Decrement the counter, the borrow path takes as many instructions as the other one.
+        {
+            emit(program, 0x7EFF); // ADD VE, 0xFF
+            emit(program, 0x3EFF); // SE VE, 0xFF
+
+            const u16 checkAddress = static_cast<u16>(get_next_address(program) + 4);
+
+            emit(program, static_cast<u16>(0x1000 | checkAddress)); // JP check
+            emit(program, 0x7DFF);                                  // ADD VD, 0xFF
+            emit(program, 0x3E00);                                  // check: SE VE, 0
+            emit(program, static_cast<u16>(0x1000 | loopAddress));  // JP loop
+            emit(program, 0x3D00);                                  // SE VD, 0
+            emit(program, static_cast<u16>(0x1000 | loopAddress));  // JP loop
+        }
+
+        // A JP to itself would be stepped over by execute_instruction(), spin between two instead.
+        workload.haltAddress = get_next_address(program);
+        emit(program, static_cast<u16>(0x1000 | (workload.haltAddress + 2))); // halt: JP halt + 2
+        emit(program, static_cast<u16>(0x1000 | workload.haltAddress));       // JP halt
+
+        // Data and functions
+        switch (kind)
+        {
+            case WorkloadKind::ALULoop:
+                compute_alu_loop_state(iterationCount, workload.vRegisters);
+                break;
+            case WorkloadKind::SpriteStorm:
+                workload.i = get_next_address(program);
+                patch(program, dataReferenceAddress, static_cast<u16>(0xA000 | workload.i));
+                program.insert(program.end(), StormSprite, StormSprite + sizeof(StormSprite));
+
+                workload.vRegisters[V0] = static_cast<u8>(iterationCount * 5);
+                workload.vRegisters[V1] = static_cast<u8>(iterationCount * 3);
+                workload.vRegisters[VF] = 1; // The second draw always erases the first one
+                break;
+            case WorkloadKind::DeepCalls:
+                patch(program, dataReferenceAddress, static_cast<u16>(0x2000 | get_next_address(program)));
+
+                // Every function calls the next one, the last one does the actual work.
+                for (u32 depth = 1; depth < WorkloadCallDepth; depth++)
+                {
+                    emit(program, static_cast<u16>(0x2000 | (get_next_address(program) + 4))); // CALL next
+                    emit(program, 0x00EE);                                                    // RET
+                }
+
+                emit(program, 0x7001); // ADD V0, 1
+                emit(program, 0x00EE); // RET
+
+                workload.vRegisters[V0] = static_cast<u8>(iterationCount);
+                break;
+            case WorkloadKind::MemoryStream:
+                compute_memory_stream_state(iterationCount, workload.vRegisters);
+                workload.i = MemoryStreamAddress + 1;
+                break;
+            case WorkloadKind::TimerPoll:
+                workload.vRegisters[V8] = 2;
+                break;
+            case WorkloadKind::Count:
+                break;
+        }
+
+        Assert(get_next_address(program) <= MemoryStreamAddress);
+
+        workload.instructionCount = 0;
+
+        if (kind != WorkloadKind::TimerPoll)
+        {
+            // The loop counter takes one more instruction every time the low byte runs out.
+            workload.instructionCount = prologueInstructionCount + 2
+                                        + iterationCount * (kernelInstructionCount + LoopCounterInstructionCount)
+                                        + (iterationCount - 1) / 256;
+        }
+    }
+
+    void load_workload(CPUState& state, const Workload& workload)
+    {
+        initCPUState(state);
+        load_program(state, workload.program.data(), static_cast<u16>(workload.program.size()));
+    }
+
+    bool has_workload_halted(const CPUState& state, const Workload& workload)
+    {
+        return state.pc == workload.haltAddress || state.pc == workload.haltAddress + 2;
+    }
+
+    bool is_workload_final_state(const CPUState& state, const Workload& workload)
+    {
+        static const u8 BlankScreen[ScreenHeight][ScreenLineSizeInBytes] = {};
+
+        return has_workload_halted(state, workload) && state.sp == 0 && state.i == workload.i
+               && state.delayTimer == 0 && std::memcmp(state.vRegisters, workload.vRegisters, VRegisterCount) == 0
+               && std::memcmp(state.screen, BlankScreen, sizeof(BlankScreen)) == 0;
+    }
+}
@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EmuExport.h"
+#include "Cpu.h"
+
+#include <vector>
+
+namespace chip8
+{
+    // Synthetic programs that stress one part of the interpreter at a time, so that
+    // benchmarks and perf tests don't depend on whatever roms are lying around.
+    //
+    // Every workload runs a kernel iterationCount times then spins in a pair of JP at haltAddress.
+    // Starting from a freshly initialized state, the final state is known in advance.
+    // VD and VE hold the loop counter, kernels never touch them.
+    enum class WorkloadKind
+    {
+        ALULoop,      // 8xyN arithmetic on a handful of registers
+        SpriteStorm,  // Pairs of DRW that cancel out, the screen ends up blank
+        DeepCalls,    // Chain of CALLs WorkloadCallDepth levels deep
+        MemoryStream, // Fx55/Fx65 on most of the registers
+        TimerPoll,    // Sets DT and spins on Fx07 until it reaches 0
+        Count
+    };
+
+    static const u32 WorkloadKindCount = static_cast<u32>(WorkloadKind::Count);
+    static const u32 WorkloadCallDepth = 12;
+
+    struct Workload
+    {
+        WorkloadKind kind;
+        u32 iterationCount;
+        std::vector<u8> program;
+        u16 haltAddress;
+
+        // Instructions executed before first reaching haltAddress.
+        // TimerPoll depends on how fast the timers tick compared to instructions, it is 0 for that one.
+        u64 instructionCount;
+
+        // Final state, the screen is always blank and the stack empty.
+        u8 vRegisters[VRegisterCount];
+        u16 i;
+    };
+
+    CHIP8EMU_EMU_API const char* get_workload_kind_name(WorkloadKind kind);
+
+    // iterationCount must be in [1, 65535].
+    CHIP8EMU_EMU_API void generate_workload(WorkloadKind kind, u32 iterationCount, Workload& workload);
+
+    // Resets the state and loads the program.
+    CHIP8EMU_EMU_API void load_workload(CPUState& state, const Workload& workload);
+
+    CHIP8EMU_EMU_API bool has_workload_halted(const CPUState& state, const Workload& workload);
+
+    // True if the state has halted with the expected registers, stack and screen.
+    CHIP8EMU_EMU_API bool is_workload_final_state(const CPUState& state, const Workload& workload);
+}
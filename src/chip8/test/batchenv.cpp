@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/BatchEnv.h"
+
+#include "core/Platform.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+    // Draws the glyph of key 5 and stops as soon as key 5 is pressed.
+    const u8 TestProgram[] = {
+        0x00, 0xE0, // CLS
+        0x61, 0x05, // LD V1, 5
+        0xE1, 0x9E, // SKP V1
+        0x12, 0x00, // JP 0x200
+        0x72, 0x01, // ADD V2, 1
+        0xF1, 0x29, // LD F, V1
+        0xD0, 0x05, // DRW V0, V0, 5
+        0x12, 0x0E, // JP 0x20E
+    };
+
+    // Draws and erases the same glyph on alternate frames.
+    const u8 FlickerProgram[] = {
+        0xF0, 0x29, // LD F, V0
+        0xD1, 0x15, // DRW V1, V1, 5
+        0x62, 0x00, // LD V2, 0
+        0x62, 0x00, // LD V2, 0
+        0x62, 0x00, // LD V2, 0
+        0x62, 0x00, // LD V2, 0
+        0x62, 0x00, // LD V2, 0
+        0x62, 0x00, // LD V2, 0
+        0x12, 0x02, // JP 0x202
+    };
+
+    const u16 Key5Mask = 1 << 5;
+
+    f32 compute_test_reward(const chip8::CPUState& state, u32, void*)
+    {
+        return state.vRegisters[chip8::V2];
+    }
+
+    bool is_test_done(const chip8::CPUState& state, u32, void*)
+    {
+        return state.vRegisters[chip8::V2] > 0;
+    }
+
+    bool is_observation_blank(const u8* observation)
+    {
+        for (u32 i = 0; i < chip8::ObservationSizeInBytes; i++)
+        {
+            if (observation[i] != 0)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+TEST_CASE("Batch environment")
+{
+    const chip8::EmuConfig config = {};
+    const u32 envCount = 3;
+
+    chip8::BatchEnv* env = chip8::createBatchEnv(envCount, config, TestProgram, sizeof(TestProgram));
+    chip8::set_batch_env_hooks(*env, {&compute_test_reward, &is_test_done, nullptr});
+
+    SUBCASE("Step")
+    {
+        std::vector<u16> actions(envCount, 0);
+        std::vector<u8> observations(envCount * chip8::ObservationSizeInBytes);
+        std::vector<f32> rewards(envCount);
+        std::vector<u8> dones(envCount);
+
+        chip8::bind_batch_env_buffers(*env, {actions.data(), observations.data(), rewards.data(), dones.data()});
+        chip8::reset_batch_env(*env);
+
+        actions[1] = Key5Mask;
+        chip8::step_batch_env(*env);
+
+        CHECK(is_observation_blank(&observations[0 * chip8::ObservationSizeInBytes]));
+        CHECK_FALSE(is_observation_blank(&observations[1 * chip8::ObservationSizeInBytes]));
+        CHECK_EQ(rewards[0], 0.f);
+        CHECK_EQ(rewards[1], 1.f);
+        CHECK_EQ(dones[0], 0);
+        CHECK_EQ(dones[1], 1);
+
+        // The finished environment starts over.
+        actions[1] = 0;
+        chip8::step_batch_env(*env);
+
+        CHECK(is_observation_blank(&observations[1 * chip8::ObservationSizeInBytes]));
+        CHECK_EQ(rewards[1], 0.f);
+        CHECK_EQ(dones[1], 0);
+    }
+
+#if defined(CHIP8EMU_PLATFORM_LINUX) || defined(CHIP8EMU_PLATFORM_MACOSX)
+    SUBCASE("Shared memory")
+    {
+        const char* name = "/chip8emu_test_batch_env";
+
+        // Creation refuses existing segments, a crashed run may have left one behind.
+        shm_unlink(name);
+
+        REQUIRE(chip8::create_batch_env_shared_buffers(*env, name));
+
+        // Map the segment the way a consumer process would.
+        const int fd = shm_open(name, O_RDWR, 0600);
+        REQUIRE(fd != -1);
+
+        void* mapping = mmap(nullptr, env->sharedSizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+
+        REQUIRE(mapping != MAP_FAILED);
+
+        u8* base = static_cast<u8*>(mapping);
+        const chip8::BatchEnvSharedHeader& header = *static_cast<const chip8::BatchEnvSharedHeader*>(mapping);
+
+        CHECK_EQ(header.magic, chip8::BatchEnvSharedMagic);
+        CHECK_EQ(header.envCount, envCount);
+
+        // The name is taken, another environment can't grab the segment.
+        chip8::BatchEnv* otherEnv = chip8::createBatchEnv(1, config, TestProgram, sizeof(TestProgram));
+
+        CHECK_FALSE(chip8::create_batch_env_shared_buffers(*otherEnv, name));
+        CHECK_EQ(header.envCount, envCount);
+
+        // Moving to a taken name fails as well, and the current segment stays bound.
+        const char* otherName = "/chip8emu_test_batch_env_other";
+        shm_unlink(otherName);
+
+        REQUIRE(chip8::create_batch_env_shared_buffers(*otherEnv, otherName));
+        CHECK_FALSE(chip8::create_batch_env_shared_buffers(*env, otherName));
+        REQUIRE(env->sharedHeader != nullptr);
+        CHECK_EQ(std::strcmp(env->sharedName, name), 0);
+
+        chip8::destroyBatchEnv(otherEnv);
+
+        chip8::reset_batch_env(*env);
+
+        u16* actions = reinterpret_cast<u16*>(base + header.actionsOffset);
+        actions[2] = Key5Mask;
+
+        chip8::step_batch_env(*env);
+
+        CHECK_EQ(chip8::load_batch_env_step_count(header), 2u);
+        CHECK_EQ(base[header.donesOffset + 2], 1);
+        CHECK_FALSE(is_observation_blank(base + header.observationsOffset + 2 * chip8::ObservationSizeInBytes));
+
+        munmap(mapping, env->sharedSizeInBytes);
+    }
+#endif
+
+    chip8::destroyBatchEnv(env);
+}
+
+TEST_CASE("Frame skip")
+{
+    const chip8::EmuConfig config = {};
+    chip8::CPUState state = chip8::createCPUState();
+    u8 screen[chip8::ObservationSizeInBytes];
+
+    chip8::load_program(state, FlickerProgram, sizeof(FlickerProgram));
+
+    SUBCASE("Last frame")
+    {
+        chip8::execute_frames(config, state, 0, 2, chip8::BatchEnvFrameTimeMs, chip8::ScreenPooling::LastFrame, screen);
+
+        CHECK(is_observation_blank(screen));
+        CHECK_EQ(state.instructionCount, 16u);
+    }
+
+    SUBCASE("Or")
+    {
+        chip8::execute_frames(config, state, 0, 2, chip8::BatchEnvFrameTimeMs, chip8::ScreenPooling::Or, screen);
+
+        CHECK_FALSE(is_observation_blank(screen));
+        CHECK(is_observation_blank(&state.screen[0][0]));
+    }
+
+    chip8::destroyCPUState(state);
+}
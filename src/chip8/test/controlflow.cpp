@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/ControlFlow.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+    const u8 TestProgram[] = {
+        0x22, 0x0C, // 0x200: CALL 0x20C
+        0x30, 0x01, // 0x202: SE V0, 0x01
+        0x12, 0x00, // 0x204: JP 0x200
+        0xB2, 0x10, // 0x206: JP V0, 0x210
+        0xF0, 0x90, // 0x208: sprite
+        0x90, 0xF0, // 0x20A: sprite
+        0x70, 0x01, // 0x20C: ADD V0, 0x01
+        0x00, 0xEE, // 0x20E: RET
+        0x12, 0x00, // 0x210: JP 0x200, jump table
+        0x12, 0x02, // 0x212: JP 0x202, jump table
+        0x00, 0xE0, // 0x214: CLS, never reached
+    };
+
+    const chip8::BasicBlock& get_block(const chip8::ControlFlowGraph& graph, u16 address)
+    {
+        const u32 blockIndex = chip8::find_basic_block(graph, address);
+        REQUIRE_NE(blockIndex, chip8::InvalidBasicBlockIndex);
+
+        return graph.blocks[blockIndex];
+    }
+}
+
+TEST_CASE("Control flow")
+{
+    chip8::ControlFlowGraph graph;
+
+    SUBCASE("Basic blocks")
+    {
+        chip8::build_control_flow_graph(graph, TestProgram, sizeof(TestProgram), chip8::QuirkProfile::Default);
+
+        REQUIRE_EQ(graph.blocks.size(), 7u);
+
+        const chip8::BasicBlock& callBlock = get_block(graph, 0x200);
+        REQUIRE_EQ(callBlock.successors.size(), 1u);
+        CHECK_EQ(callBlock.successors[0].address, 0x202);
+        CHECK_EQ(callBlock.successors[0].kind, chip8::ControlFlowEdgeKind::CallReturn);
+
+        const chip8::BasicBlock& skipBlock = get_block(graph, 0x202);
+        REQUIRE_EQ(skipBlock.successors.size(), 2u);
+        CHECK_EQ(skipBlock.successors[0].address, 0x204);
+        CHECK_EQ(skipBlock.successors[1].address, 0x206);
+        CHECK_EQ(skipBlock.successors[1].kind, chip8::ControlFlowEdgeKind::Skip);
+
+        const chip8::BasicBlock& subroutineBlock = get_block(graph, 0x20E);
+        CHECK_EQ(subroutineBlock.address, 0x20C);
+        CHECK_EQ(subroutineBlock.instructionCount, 2u);
+        CHECK(subroutineBlock.successors.empty());
+
+        CHECK_EQ(chip8::find_basic_block(graph, 0x208), chip8::InvalidBasicBlockIndex);
+        CHECK_EQ(chip8::find_basic_block(graph, 0x214), chip8::InvalidBasicBlockIndex);
+    }
+
+    SUBCASE("Call graph")
+    {
+        chip8::build_control_flow_graph(graph, TestProgram, sizeof(TestProgram), chip8::QuirkProfile::Default);
+
+        REQUIRE_EQ(graph.subroutines.size(), 2u);
+
+        const chip8::Subroutine& mainProgram = graph.subroutines[0];
+        CHECK_EQ(mainProgram.address, chip8::MinProgramAddress);
+        CHECK_EQ(mainProgram.blockIndices.size(), 6u);
+        REQUIRE_EQ(mainProgram.callees.size(), 1u);
+        CHECK_EQ(mainProgram.callees[0], 0x20C);
+
+        const chip8::Subroutine& subroutine = graph.subroutines[1];
+        CHECK_EQ(subroutine.address, 0x20C);
+        REQUIRE_EQ(subroutine.blockIndices.size(), 1u);
+        CHECK_EQ(graph.blocks[subroutine.blockIndices[0]].address, 0x20C);
+        CHECK(subroutine.callees.empty());
+    }
+
+    SUBCASE("Computed jumps")
+    {
+        chip8::build_control_flow_graph(graph, TestProgram, sizeof(TestProgram), chip8::QuirkProfile::Default);
+
+        const chip8::BasicBlock& tableBlock = get_block(graph, 0x206);
+
+        REQUIRE_EQ(tableBlock.successors.size(), 2u);
+        CHECK_EQ(tableBlock.successors[0].address, 0x210);
+        CHECK_EQ(tableBlock.successors[1].address, 0x212);
+        CHECK_EQ(tableBlock.successors[1].kind, chip8::ControlFlowEdgeKind::ComputedJump);
+
+        const u8 program[] = {
+            0x60, 0x04, // 0x200: LD V0, 0x04
+            0xB2, 0x00, // 0x202: JP V0, 0x200
+            0xB3, 0x00, // 0x204: JP V0, 0x300, nothing there
+        };
+
+        chip8::build_control_flow_graph(graph, program, sizeof(program), chip8::QuirkProfile::Default);
+
+        const chip8::BasicBlock& constantBlock = get_block(graph, 0x200);
+        REQUIRE_EQ(constantBlock.successors.size(), 1u);
+        CHECK_EQ(constantBlock.successors[0].address, 0x204);
+
+        CHECK_EQ(get_block(graph, 0x204).flags, chip8::BasicBlockUnresolvedJump);
+    }
+
+    SUBCASE("Invalid code")
+    {
+        const u8 program[] = {
+            0x30, 0x00, // 0x200: SE V0, 0x00
+            0x51, 0x21, // 0x202: invalid
+            0x12, 0x01, // 0x204: JP 0x201
+            0x30, 0x00, // 0x206: SE V0, 0x00, may skip past the end of the rom
+        };
+
+        chip8::build_control_flow_graph(graph, program, sizeof(program), chip8::QuirkProfile::Default);
+
+        CHECK_EQ(get_block(graph, 0x202).flags, chip8::BasicBlockInvalid);
+        CHECK_EQ(get_block(graph, 0x204).flags, chip8::BasicBlockInvalid);
+        CHECK_EQ(chip8::find_basic_block(graph, 0x206), chip8::InvalidBasicBlockIndex);
+
+        const u8 tailProgram[] = {
+            0x30, 0x00, // 0x200: SE V0, 0x00
+        };
+
+        chip8::build_control_flow_graph(graph, tailProgram, sizeof(tailProgram), chip8::QuirkProfile::Default);
+
+        CHECK_EQ(get_block(graph, 0x200).flags, chip8::BasicBlockLeavesRom);
+    }
+
+    SUBCASE("Output")
+    {
+        chip8::build_control_flow_graph(graph, TestProgram, sizeof(TestProgram), chip8::QuirkProfile::Default);
+
+        std::ostringstream listing;
+        chip8::write_control_flow_listing(listing, graph, TestProgram, sizeof(TestProgram));
+
+        const std::string listingText = listing.str();
+        CHECK_NE(listingText.find("; sub_200 calls sub_20C\n"), std::string::npos);
+        CHECK_NE(listingText.find("sub_20C:\n    0x20C  7001  ADD V0, 0x01\n"), std::string::npos);
+        CHECK_NE(listingText.find("    ; -> loc_204 loc_206\n"), std::string::npos);
+        CHECK_NE(listingText.find("    0x208  F090  DW 0xF090\n"), std::string::npos);
+
+        std::ostringstream dot;
+        chip8::write_control_flow_dot(dot, graph, TestProgram, sizeof(TestProgram));
+
+        const std::string dotText = dot.str();
+        CHECK_EQ(dotText.find("digraph"), 0u);
+        CHECK_NE(dotText.find("subgraph cluster_sub_20C"), std::string::npos);
+        CHECK_NE(dotText.find("b_200 -> b_20C [style=dotted];"), std::string::npos);
+        CHECK_NE(dotText.find("b_202 -> b_206 [style=dashed];"), std::string::npos);
+    }
+}
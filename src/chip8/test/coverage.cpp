@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Coverage.h"
+#include "chip8/Execution.h"
+#include "chip8/Keyboard.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    const u8 TestProgram[] = {
+        0x70, 0x01, // 0x200: ADD V0, 1
+        0x30, 0x03, // 0x202: SE V0, 0x03
+        0x12, 0x00, // 0x204: JP 0x200
+        0x41, 0x00, // 0x206: SNE V1, 0x00
+        0x12, 0x06, // 0x208: JP 0x206
+        0x00, 0xE0, // 0x20A: CLS, never reached
+    };
+
+    const char* CoveragePath = "chip8emu_test.c8cv";
+
+    u8 get_slot(const chip8::CodeCoverage& coverage, u16 address)
+    {
+        return coverage.slots[address / 2];
+    }
+}
+
+TEST_CASE("Coverage")
+{
+    chip8::CodeCoverage coverage;
+    chip8::clear_code_coverage(coverage);
+
+    chip8::EmuConfig config = {};
+    config.coverage = &coverage;
+
+    chip8::CPUState state = chip8::createCPUState();
+    chip8::load_program(state, TestProgram, sizeof(TestProgram));
+
+    for (u32 instructionIndex = 0; instructionIndex < 20; instructionIndex++)
+        chip8::execute_step(config, state, chip8::InstructionExecutionPeriodMs);
+
+    chip8::destroyCPUState(state);
+
+    SUBCASE("Record")
+    {
+        CHECK_EQ(get_slot(coverage, 0x200), chip8::CodeCoverageNext);
+        CHECK_EQ(get_slot(coverage, 0x202), chip8::CodeCoverageNext | chip8::CodeCoverageSkip);
+        CHECK_EQ(get_slot(coverage, 0x204), chip8::CodeCoverageJump);
+        CHECK_EQ(get_slot(coverage, 0x206), chip8::CodeCoverageNext);
+        CHECK_EQ(get_slot(coverage, 0x208), chip8::CodeCoverageJump);
+        CHECK_EQ(get_slot(coverage, 0x20A), 0u);
+
+        const chip8::CodeCoverageSummary summary =
+            chip8::get_code_coverage_summary(coverage, TestProgram, sizeof(TestProgram));
+
+        CHECK_EQ(summary.instructionCount, 6u);
+        CHECK_EQ(summary.executedInstructionCount, 5u);
+        CHECK_EQ(summary.skipOutcomeCount, 4u);
+        CHECK_EQ(summary.coveredSkipOutcomeCount, 3u);
+    }
+
+    SUBCASE("Merge")
+    {
+        chip8::CodeCoverage otherCoverage;
+        chip8::clear_code_coverage(otherCoverage);
+        chip8::record_code_coverage(otherCoverage, 0x206, 0x20A);
+        chip8::record_code_coverage(otherCoverage, 0x20A, 0x20C);
+
+        chip8::merge_code_coverage(coverage, otherCoverage);
+
+        CHECK_EQ(get_slot(coverage, 0x202), chip8::CodeCoverageNext | chip8::CodeCoverageSkip);
+        CHECK_EQ(get_slot(coverage, 0x206), chip8::CodeCoverageNext | chip8::CodeCoverageSkip);
+        CHECK_EQ(get_slot(coverage, 0x20A), chip8::CodeCoverageNext);
+    }
+
+    SUBCASE("Key wait")
+    {
+        const u8 program[] = {
+            0xF0, 0x0A, // 0x200: LD V0, K
+            0x12, 0x02, // 0x202: JP 0x202
+        };
+
+        chip8::clear_code_coverage(coverage);
+
+        chip8::CPUState waitingState = chip8::createCPUState();
+        chip8::load_program(waitingState, program, sizeof(program));
+
+        for (u32 instructionIndex = 0; instructionIndex < 4; instructionIndex++)
+            chip8::execute_step(config, waitingState, chip8::InstructionExecutionPeriodMs);
+
+        // Waiting is neither a jump nor done yet.
+        CHECK_EQ(get_slot(coverage, 0x200), chip8::CodeCoverageWait);
+
+        chip8::set_key_pressed(waitingState, 0x5, true);
+
+        for (u32 instructionIndex = 0; instructionIndex < 4; instructionIndex++)
+            chip8::execute_step(config, waitingState, chip8::InstructionExecutionPeriodMs);
+
+        CHECK_EQ(get_slot(coverage, 0x200), chip8::CodeCoverageWait | chip8::CodeCoverageNext);
+
+        chip8::destroyCPUState(waitingState);
+    }
+
+    SUBCASE("File")
+    {
+        REQUIRE_EQ(chip8::save_code_coverage_to_file(coverage, CoveragePath), chip8::CodeCoverageError::None);
+
+        chip8::CodeCoverage loadedCoverage;
+        CHECK_EQ(chip8::load_code_coverage_from_file(loadedCoverage, CoveragePath), chip8::CodeCoverageError::None);
+
+        for (u32 slotIndex = 0; slotIndex < chip8::CodeCoverageSlotCount; slotIndex++)
+            CHECK_EQ(loadedCoverage.slots[slotIndex], coverage.slots[slotIndex]);
+
+        {
+            std::ofstream file(CoveragePath, std::ios::binary | std::ios::trunc);
+            file << "not coverage";
+        }
+
+        CHECK_EQ(chip8::load_code_coverage_from_file(loadedCoverage, CoveragePath),
+                 chip8::CodeCoverageError::InvalidMagic);
+
+        std::remove(CoveragePath);
+
+        CHECK_EQ(chip8::load_code_coverage_from_file(loadedCoverage, CoveragePath), chip8::CodeCoverageError::IOError);
+    }
+
+    SUBCASE("Report")
+    {
+        std::ostringstream report;
+        chip8::write_code_coverage_report(report, coverage, TestProgram, sizeof(TestProgram));
+
+        const std::string text = report.str();
+
+        CHECK(text.find("; instructions executed: 5/6 (83.3%)") != std::string::npos);
+        CHECK(text.find("; skip outcomes covered: 3/4 (75.0%)") != std::string::npos);
+        CHECK(text.find("+ 0x200  7001  ADD V0, 0x01\n") != std::string::npos);
+        CHECK(text.find("+ 0x202  3003  SE V0, 0x03") != std::string::npos);
+        CHECK(text.find("; both ways\n") != std::string::npos);
+        CHECK(text.find("; never skips\n") != std::string::npos);
+        CHECK(text.find("- 0x20A  00E0  CLS\n") != std::string::npos);
+    }
+}
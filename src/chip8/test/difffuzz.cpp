@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/DiffFuzz.h"
+#include "chip8/Execution.h"
+#include "chip8/ThreadPool.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+    // Forgets to clear VF when ADD Vx, Vy does not carry.
+    void execute_instruction_broken(const chip8::EmuConfig& config, chip8::CPUState& state, u16 instruction)
+    {
+        const u8 flag = state.vRegisters[chip8::VF];
+
+        chip8::execute_instruction(config, state, instruction);
+
+        if ((instruction & 0xF00F) == 0x8004 && ((instruction >> 8) & 0x0F) != chip8::VF
+            && state.vRegisters[chip8::VF] == 0)
+        {
+            state.vRegisters[chip8::VF] = flag;
+        }
+    }
+
+    const chip8::ExecutionEngine BrokenEngine = {"broken", &execute_instruction_broken};
+
+    // Called by the generated regressions.
+    void check_diff_fuzz_regression(const char* referenceName, const char* candidateName, u64 stateSeed,
+                                    const chip8::DiffFuzzStep* steps, u32 stepCount)
+    {
+        const chip8::EmuConfig config = {};
+        const chip8::ExecutionEngine* reference = chip8::find_execution_engine(referenceName);
+        const chip8::ExecutionEngine* candidate = chip8::find_execution_engine(candidateName);
+
+        REQUIRE(reference != nullptr);
+        REQUIRE(candidate != nullptr);
+
+        const chip8::DiffFuzzCase fuzzCase = {stateSeed, std::vector<chip8::DiffFuzzStep>(steps, steps + stepCount)};
+        chip8::DiffFuzzDivergence divergence;
+
+        CHECK_EQ(chip8::run_diff_fuzz_case(config, *reference, *candidate, fuzzCase, divergence),
+                 chip8::DiffFuzzResult::Match);
+    }
+}
+
+TEST_CASE("Differential fuzzing")
+{
+    const chip8::EmuConfig config = {};
+    const chip8::ExecutionEngine* reference = chip8::find_execution_engine("reference");
+
+    REQUIRE(reference != nullptr);
+    CHECK_EQ(reference, &chip8::get_execution_engine(0));
+    CHECK(chip8::find_execution_engine("missing") == nullptr);
+
+    chip8::ThreadPool* pool = chip8::createThreadPool(2);
+    chip8::DiffFuzzReport report;
+
+    SUBCASE("Generated steps are valid")
+    {
+        chip8::CPUState state = chip8::createCPUState();
+        u64 rngState = 1;
+        u32 invalidStepCount = 0;
+
+        for (u64 stateSeed = 0; stateSeed < 16; stateSeed++)
+        {
+            chip8::generate_diff_fuzz_state(state, stateSeed);
+
+            for (u32 stepIndex = 0; stepIndex < 2000; stepIndex++)
+            {
+                const chip8::DiffFuzzStep step = chip8::generate_diff_fuzz_step(state, rngState);
+
+                if (!chip8::is_diff_fuzz_step_valid(state, step))
+                    invalidStepCount++;
+
+                state.keyState = step.keyState;
+                chip8::execute_instruction(config, state, step.instruction);
+            }
+        }
+
+        CHECK_EQ(invalidStepCount, 0u);
+
+        chip8::destroyCPUState(state);
+    }
+
+    SUBCASE("Reference against itself")
+    {
+        chip8::run_diff_fuzzer(*pool, config, *reference, *reference, 42, 64, 500, report);
+
+        CHECK_EQ(report.caseCount, 64u);
+        CHECK_EQ(report.stepCount, 64u * 500u);
+        CHECK(report.findings.empty());
+
+        const chip8::DiffFuzzStep steps[] = {{0x8014, 0x0000}, {0xF00A, 0x0000}, {0xF30A, 0x0004}};
+
+        check_diff_fuzz_regression("reference", "reference", 7, steps, sizeof(steps) / sizeof(steps[0]));
+    }
+
+    SUBCASE("Unchecked against reference")
+    {
+        const chip8::ExecutionEngine* unchecked = chip8::find_execution_engine("unchecked");
+
+        REQUIRE(unchecked != nullptr);
+
+        chip8::run_diff_fuzzer(*pool, config, *reference, *unchecked, 42, 64, 500, report);
+
+        CHECK(report.findings.empty());
+    }
+
+    SUBCASE("Divergence is found and minimized")
+    {
+        chip8::run_diff_fuzzer(*pool, config, *reference, BrokenEngine, 42, 16, 2000, report);
+
+        REQUIRE_FALSE(report.findings.empty());
+
+        for (const chip8::DiffFuzzFinding& finding : report.findings)
+        {
+            const chip8::DiffFuzzStep& lastStep = finding.fuzzCase.steps.back();
+
+            CHECK_EQ(finding.divergence.stepIndex + 1, finding.fuzzCase.steps.size());
+            CHECK_EQ(std::string(finding.divergence.fieldName), "vRegisters");
+            CHECK_EQ(lastStep.instruction & 0xF00Fu, 0x8004u);
+
+            // The random initial state usually has VF set already, a single ADD is enough.
+            CHECK(finding.fuzzCase.steps.size() <= 8);
+
+            chip8::DiffFuzzDivergence divergence;
+
+            CHECK_EQ(chip8::run_diff_fuzz_case(config, *reference, BrokenEngine, finding.fuzzCase, divergence),
+                     chip8::DiffFuzzResult::Diverged);
+        }
+
+        std::ostringstream regression;
+        chip8::write_diff_fuzz_regression(regression, report.findings[0], *reference, BrokenEngine);
+
+        CHECK_NE(regression.str().find("TEST_CASE(\"Differential regression reference vs broken"), std::string::npos);
+        CHECK_NE(regression.str().find("check_diff_fuzz_regression(\"reference\", \"broken\""), std::string::npos);
+    }
+
+    chip8::destroyThreadPool(pool);
+}
+
+// Appended by chip8emu_difffuzz --save, every case diverged at some point and must match now.
+#include "difffuzz_regressions.inc"
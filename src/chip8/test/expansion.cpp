@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/Expansion.h"
+#include "chip8/Memory.h"
+#include "chip8/SaveState.h"
+#include "chip8/StateHash.h"
+#include "chip8/ThreadPool.h"
+
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    // Scans every key and accumulates the ID + 1 of the pressed ones in V2, stored at 0x300.
+    const u8 TestProgram[] = {
+        0x61, 0x00, // LD V1, 0
+        0xE1, 0xA1, // SKNP V1
+        0x82, 0x14, // ADD V2, V1
+        0xE1, 0xA1, // SKNP V1
+        0x72, 0x01, // ADD V2, 1
+        0x71, 0x01, // ADD V1, 1
+        0x63, 0x0F, // LD V3, 0x0F
+        0x81, 0x32, // AND V1, V3
+        0xA3, 0x00, // LD I, 0x300
+        0xF2, 0x55, // LD [I], V2
+        0x12, 0x02, // JP 0x202
+    };
+
+    // Long enough to scan every key at least once.
+    const unsigned int FrameTimeMs = 400;
+}
+
+TEST_CASE("Expansion")
+{
+    const chip8::EmuConfig config = {};
+    const u32 parentCount = 3;
+
+    std::vector<chip8::CPUState> parents(parentCount);
+
+    for (u32 parentIndex = 0; parentIndex < parentCount; parentIndex++)
+    {
+        parents[parentIndex] = chip8::createCPUState();
+        chip8::load_program(parents[parentIndex], TestProgram, sizeof(TestProgram));
+
+        for (u32 frame = 0; frame < parentIndex; frame++)
+        {
+            chip8::set_key_state(parents[parentIndex], static_cast<u16>(1 << frame));
+            chip8::execute_step(config, parents[parentIndex], FrameTimeMs);
+        }
+    }
+
+    u16 actions[chip8::SingleKeyActionCount];
+
+    for (u32 actionIndex = 0; actionIndex < chip8::SingleKeyActionCount; actionIndex++)
+        actions[actionIndex] = chip8::get_single_key_action(actionIndex);
+
+    const u32 childCount = parentCount * chip8::SingleKeyActionCount;
+
+    std::vector<chip8::CPUState> children(childCount);
+    std::vector<u64> childHashes(childCount);
+
+    SUBCASE("Matches serial stepping")
+    {
+        chip8::ThreadPool* pool = chip8::createThreadPool(3);
+
+        chip8::expand_states(pool, config, parents.data(), parentCount, actions, chip8::SingleKeyActionCount, FrameTimeMs,
+                             children.data(), childHashes.data());
+
+        for (u32 childIndex = 0; childIndex < childCount; childIndex++)
+        {
+            const u32 parentIndex = childIndex / chip8::SingleKeyActionCount;
+            const u32 actionIndex = childIndex % chip8::SingleKeyActionCount;
+
+            chip8::CPUState expected = chip8::forkCPUState(parents[parentIndex]);
+
+            chip8::set_key_state(expected, actions[actionIndex]);
+            chip8::execute_step(config, expected, FrameTimeMs);
+
+            chip8::SaveState expectedSaveState;
+            chip8::SaveState childSaveState;
+
+            chip8::save_state(expected, expectedSaveState);
+            chip8::save_state(children[childIndex], childSaveState);
+
+            CHECK_EQ(childHashes[childIndex], chip8::get_state_hash(expected));
+            CHECK(std::memcmp(&childSaveState, &expectedSaveState, sizeof(chip8::SaveState)) == 0);
+
+            chip8::destroyCPUState(expected);
+        }
+
+        chip8::destroyThreadPool(pool);
+    }
+
+    SUBCASE("Serial fallback")
+    {
+        std::vector<u64> parallelHashes(childCount);
+        std::vector<chip8::CPUState> parallelChildren(childCount);
+
+        chip8::ThreadPool* pool = chip8::createThreadPool(2);
+
+        chip8::expand_states(pool, config, parents.data(), parentCount, actions, chip8::SingleKeyActionCount, FrameTimeMs,
+                             parallelChildren.data(), parallelHashes.data());
+        chip8::expand_states(nullptr, config, parents.data(), parentCount, actions, chip8::SingleKeyActionCount, FrameTimeMs,
+                             children.data(), childHashes.data());
+
+        CHECK(parallelHashes == childHashes);
+
+        for (chip8::CPUState& child : parallelChildren)
+            chip8::destroyCPUState(child);
+
+        chip8::destroyThreadPool(pool);
+    }
+
+    SUBCASE("Branches")
+    {
+        chip8::expand_states(nullptr, config, parents.data(), parentCount, actions, chip8::SingleKeyActionCount, FrameTimeMs,
+                             children.data(), childHashes.data());
+
+        // Every key leads to a different state.
+        for (u32 parentIndex = 0; parentIndex < parentCount; parentIndex++)
+        {
+            const u64* hashes = &childHashes[parentIndex * chip8::SingleKeyActionCount];
+            const std::unordered_set<u64> uniqueHashes(hashes, hashes + chip8::SingleKeyActionCount);
+
+            CHECK_EQ(uniqueHashes.size(), chip8::SingleKeyActionCount);
+        }
+
+        // Only the page holding the output got copied.
+        const u32 programPageIndex = chip8::MinProgramAddress / chip8::MemoryPageSizeInBytes;
+        const u32 outputPageIndex = 0x300 / chip8::MemoryPageSizeInBytes;
+
+        for (u32 childIndex = 0; childIndex < childCount; childIndex++)
+        {
+            const chip8::CPUState& parent = parents[childIndex / chip8::SingleKeyActionCount];
+
+            CHECK_EQ(children[childIndex].memoryPages[programPageIndex], parent.memoryPages[programPageIndex]);
+            CHECK_NE(children[childIndex].memoryPages[outputPageIndex], parent.memoryPages[outputPageIndex]);
+        }
+    }
+
+    for (chip8::CPUState& child : children)
+        chip8::destroyCPUState(child);
+
+    for (chip8::CPUState& parent : parents)
+        chip8::destroyCPUState(parent);
+}
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/InputFuzz.h"
+
+#include "core/Assert.h"
+
+#include <string>
+
+namespace
+{
+    // Only recurses forever once key 5 is pressed.
+    const u8 KeyLockedProgram[] = {
+        0xF0, 0x0A, // 0x200: LD V0, K
+        0x30, 0x05, // 0x202: SE V0, 5
+        0x12, 0x00, // 0x204: JP 0x200
+        0x22, 0x08, // 0x206: CALL 0x208
+        0x22, 0x06, // 0x208: CALL 0x206
+    };
+
+    void count_assert(const char* /*file*/, const char* /*func*/, int /*line*/, const std::string& /*message*/,
+                      void* userData)
+    {
+        (*static_cast<u32*>(userData))++;
+    }
+}
+
+TEST_CASE("Input fuzzer")
+{
+    const chip8::InputFuzzConfig config = {120, 16, 0, 1};
+    chip8::InputFuzzer* fuzzer = chip8::createInputFuzzer(KeyLockedProgram, sizeof(KeyLockedProgram), config);
+
+    // Idle runs just wait for a key.
+    CHECK(chip8::get_input_fuzzer_failures(*fuzzer).empty());
+
+    chip8::run_input_fuzzer(*fuzzer, 2000);
+
+    const chip8::InputFuzzStats stats = chip8::get_input_fuzzer_stats(*fuzzer);
+
+    CHECK_EQ(stats.runCount, 2001u);
+    CHECK(stats.instructionCount > 0);
+    CHECK(stats.corpusSize > 1);
+    CHECK(stats.coveredEdgeCount >= 4);
+
+    const chip8::InputFuzzFailure* stackOverflow = nullptr;
+
+    for (const chip8::InputFuzzFailure& failure : chip8::get_input_fuzzer_failures(*fuzzer))
+    {
+        if (failure.kind == chip8::InputFuzzFailureKind::StackOverflow)
+            stackOverflow = &failure;
+    }
+
+    REQUIRE(stackOverflow != nullptr);
+    CHECK_EQ(stackOverflow->pc, 0x208);
+    CHECK_EQ(stackOverflow->instruction, 0x2206);
+    CHECK_EQ(stackOverflow->keySchedule.size(), stackOverflow->frameIndex + 1);
+    CHECK_NE(std::string(stackOverflow->file).find("Instruction.inl"), std::string::npos);
+    CHECK_EQ(std::string(chip8::get_input_fuzz_failure_kind_name(stackOverflow->kind)), "stack_overflow");
+
+    SUBCASE("Replay")
+    {
+        chip8::InputLog log;
+
+        REQUIRE(chip8::record_input_fuzz_failure(*fuzzer, *stackOverflow, log));
+        CHECK_EQ(log.frameCount, stackOverflow->frameIndex + 1);
+
+        // Same power-on state as the fuzzer
+        chip8::CPUState state = chip8::createCPUState();
+        chip8::seed_random_generator(state, log.randomSeed);
+        chip8::load_program(state, KeyLockedProgram, sizeof(KeyLockedProgram));
+
+        u32 assertCount = 0;
+        setAssertHandler(&count_assert, &assertCount);
+
+        const chip8::EmuConfig emuConfig = {};
+        CHECK_EQ(chip8::replay_input_log(emuConfig, state, log), chip8::InputLogError::None);
+
+        setAssertHandler(nullptr, nullptr);
+
+        CHECK(assertCount > 0);
+        CHECK_EQ(state.sp, chip8::StackSize - 1);
+
+        chip8::destroyCPUState(state);
+    }
+
+    chip8::destroyInputFuzzer(fuzzer);
+}
+
+TEST_CASE("Failed asserts")
+{
+    const chip8::EmuConfig config = {};
+    chip8::CPUState state = chip8::createCPUState();
+    u32 assertCount = 0;
+
+    setAssertHandler(&count_assert, &assertCount);
+
+    SUBCASE("Stack overflow")
+    {
+        state.sp = chip8::StackSize - 1;
+        state.vRegisters[chip8::V0] = 0x42;
+
+        chip8::execute_instruction(config, state, 0x2300);
+
+        CHECK_EQ(assertCount, 1u);
+        CHECK_EQ(state.sp, chip8::StackSize - 1);
+        CHECK_EQ(state.pc, chip8::MinProgramAddress + 2);
+        CHECK_EQ(state.vRegisters[chip8::V0], 0x42);
+    }
+
+    SUBCASE("Stack underflow")
+    {
+        chip8::execute_instruction(config, state, 0x00EE);
+
+        CHECK_EQ(assertCount, 1u);
+        CHECK_EQ(state.sp, 0);
+        CHECK_EQ(state.pc, chip8::MinProgramAddress + 2);
+    }
+
+    SUBCASE("Invalid jump")
+    {
+        chip8::execute_instruction(config, state, 0x1301);
+
+        CHECK_EQ(assertCount, 1u);
+        CHECK_EQ(state.pc, chip8::MinProgramAddress + 2);
+    }
+
+    SUBCASE("Memory past the end")
+    {
+        state.i = chip8::MaxProgramAddress;
+        state.screen[0][0] = 0xAA;
+
+        chip8::execute_instruction(config, state, 0xD00F); // DRW V0, V0, 15
+        chip8::execute_instruction(config, state, 0xF033); // LD B, V0
+        chip8::execute_instruction(config, state, 0xFF55); // LD [I], VF
+        chip8::execute_instruction(config, state, 0xFF65); // LD VF, [I]
+
+        CHECK_EQ(assertCount, 4u);
+        CHECK_EQ(state.screen[0][0], 0xAA);
+    }
+
+    SUBCASE("Program counter past the end")
+    {
+        state.pc = chip8::MaxProgramAddress - 1;
+
+        chip8::execute_instruction(config, state, 0x0000); // SYS
+        chip8::load_next_instruction(state);
+
+        CHECK_EQ(assertCount, 1u);
+    }
+
+    setAssertHandler(nullptr, nullptr);
+
+    chip8::destroyCPUState(state);
+}
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/InputLog.h"
+#include "chip8/Keyboard.h"
+#include "chip8/SaveState.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    // Waits for a key, then counts frames while it is held down.
+    const u8 TestProgram[] = {
+        0xF0, 0x0A, // LD V0, K
+        0x71, 0x01, // ADD V1, 1
+        0xE0, 0x9E, // SKP V0
+        0x12, 0x00, // JP 0x200
+        0x72, 0x01, // ADD V2, 1
+        0x12, 0x04, // JP 0x204
+    };
+}
+
+TEST_CASE("Input log")
+{
+    const chip8::EmuConfig config = {};
+    const u32 frameCount = 200;
+
+    chip8::CPUState state = chip8::createCPUState();
+    chip8::load_program(state, TestProgram, sizeof(TestProgram));
+    chip8::InputLog log = {};
+
+    // Uneven time steps and a few key presses, like a real session would have.
+    for (u32 frame = 0; frame < frameCount; frame++)
+    {
+        const unsigned int deltaTimeMs = 14 + (frame * 7) % 5;
+
+        chip8::set_key_pressed(state, 0x5, (frame / 30) % 2 == 1);
+        chip8::set_key_pressed(state, 0xA, frame > 150 && frame < 160);
+
+        chip8::record_input_frame(log, state, deltaTimeMs);
+        chip8::execute_step(config, state, deltaTimeMs);
+    }
+
+    chip8::SaveStatePayload expected;
+    chip8::write_save_state_payload(state, expected);
+
+    chip8::CPUState replayState = chip8::createCPUState();
+    chip8::load_program(replayState, TestProgram, sizeof(TestProgram));
+
+    SUBCASE("Replay")
+    {
+        CHECK_EQ(log.frameCount, frameCount);
+        CHECK_LT(log.data.size(), 2 * frameCount);
+
+        CHECK_EQ(chip8::replay_input_log(config, replayState, log), chip8::InputLogError::None);
+
+        chip8::SaveStatePayload replayed;
+        chip8::write_save_state_payload(replayState, replayed);
+
+        CHECK_GT(replayState.vRegisters[chip8::V2], 0);
+        CHECK_EQ(std::memcmp(&replayed, &expected, sizeof(expected)), 0);
+    }
+
+    SUBCASE("File")
+    {
+        const char* path = "chip8emu_test_input.log";
+        chip8::InputLog loadedLog = {};
+
+        REQUIRE_EQ(chip8::save_input_log_to_file(log, path), chip8::InputLogError::None);
+        REQUIRE_EQ(chip8::load_input_log_from_file(loadedLog, path), chip8::InputLogError::None);
+
+        CHECK_EQ(loadedLog.frameCount, log.frameCount);
+        CHECK_EQ(loadedLog.lastKeyState, log.lastKeyState);
+        CHECK_EQ(loadedLog.lastKeyChangeInstructionCount, log.lastKeyChangeInstructionCount);
+        CHECK(loadedLog.data == log.data);
+
+        // A data size that doesn't match the file is rejected before anything gets allocated.
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            const char dataSizeInBytes[4] = { '\xFF', '\xFF', '\xFF', '\x7F' };
+
+            file.seekp(12);
+            file.write(dataSizeInBytes, sizeof(dataSizeInBytes));
+        }
+
+        CHECK_EQ(chip8::load_input_log_from_file(loadedLog, path), chip8::InputLogError::Truncated);
+
+        std::remove(path);
+    }
+
+    SUBCASE("Desync")
+    {
+        // Starting from a state that already ran will miss the first key change.
+        chip8::execute_step(config, replayState, 100);
+
+        CHECK_EQ(chip8::replay_input_log(config, replayState, log), chip8::InputLogError::Desync);
+    }
+
+    chip8::destroyCPUState(replayState);
+    chip8::destroyCPUState(state);
+}
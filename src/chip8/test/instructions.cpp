@@ -9,6 +9,20 @@
 
 #include "chip8/Execution.h"
 #include "chip8/Keyboard.h"
+#include "chip8/Memory.h"
+
+#include "core/Assert.h"
+
+#include <string>
+
+namespace
+{
+    void count_assert(const char* /*file*/, const char* /*func*/, int /*line*/, const std::string& /*message*/,
+                      void* userData)
+    {
+        (*static_cast<u32*>(userData))++;
+    }
+}
 
 TEST_CASE("Instructions")
 {
@@ -294,6 +308,37 @@ TEST_CASE("Instructions")
         CHECK_EQ(state.vRegisters[chip8::V1] & ~0xF0, 0);
     }
 
+    SUBCASE("RND seed")
+    {
+        chip8::CPUState otherState = chip8::createCPUState();
+        bool isSameSequence = true;
+        bool isDifferentSequence = false;
+
+        for (u32 i = 0; i < 16; i++)
+        {
+            chip8::execute_instruction(config, state, 0xC1FF);
+            chip8::execute_instruction(config, otherState, 0xC1FF);
+
+            isSameSequence &= state.vRegisters[chip8::V1] == otherState.vRegisters[chip8::V1];
+        }
+
+        CHECK(isSameSequence);
+
+        chip8::seed_random_generator(otherState, 1);
+
+        for (u32 i = 0; i < 16; i++)
+        {
+            chip8::execute_instruction(config, state, 0xC1FF);
+            chip8::execute_instruction(config, otherState, 0xC1FF);
+
+            isDifferentSequence |= state.vRegisters[chip8::V1] != otherState.vRegisters[chip8::V1];
+        }
+
+        CHECK(isDifferentSequence);
+
+        chip8::destroyCPUState(otherState);
+    }
+
     SUBCASE("DRW")
     {
         // TODO
@@ -415,26 +460,26 @@ TEST_CASE("Instructions")
 
         chip8::execute_instruction(config, state, 0xF733);
 
-        CHECK_EQ(state.memory[state.i + 0], 1);
-        CHECK_EQ(state.memory[state.i + 1], 0);
-        CHECK_EQ(state.memory[state.i + 2], 9);
+        CHECK_EQ(chip8::read_memory(state, state.i + 0), 1);
+        CHECK_EQ(chip8::read_memory(state, state.i + 1), 0);
+        CHECK_EQ(chip8::read_memory(state, state.i + 2), 9);
 
         state.vRegisters[chip8::V7] = 255;
 
         chip8::execute_instruction(config, state, 0xF733);
 
-        CHECK_EQ(state.memory[state.i + 0], 2);
-        CHECK_EQ(state.memory[state.i + 1], 5);
-        CHECK_EQ(state.memory[state.i + 2], 5);
+        CHECK_EQ(chip8::read_memory(state, state.i + 0), 2);
+        CHECK_EQ(chip8::read_memory(state, state.i + 1), 5);
+        CHECK_EQ(chip8::read_memory(state, state.i + 2), 5);
     }
 
     SUBCASE("LDAI")
     {
         state.i = chip8::MinProgramAddress;
-        state.memory[state.i + 0] = 0xF4;
-        state.memory[state.i + 1] = 0x33;
-        state.memory[state.i + 2] = 0x82;
-        state.memory[state.i + 3] = 0x73;
+        chip8::write_memory(state, state.i + 0, 0xF4);
+        chip8::write_memory(state, state.i + 1, 0x33);
+        chip8::write_memory(state, state.i + 2, 0x82);
+        chip8::write_memory(state, state.i + 3, 0x73);
 
         state.vRegisters[chip8::V0] = 0xE4;
         state.vRegisters[chip8::V1] = 0x23;
@@ -442,10 +487,10 @@ TEST_CASE("Instructions")
 
         chip8::execute_instruction(config, state, 0xF155);
 
-        CHECK_EQ(state.memory[state.i + 0], 0xE4);
-        CHECK_EQ(state.memory[state.i + 1], 0x23);
-        CHECK_EQ(state.memory[state.i + 2], 0x82);
-        CHECK_EQ(state.memory[state.i + 3], 0x73);
+        CHECK_EQ(chip8::read_memory(state, state.i + 0), 0xE4);
+        CHECK_EQ(chip8::read_memory(state, state.i + 1), 0x23);
+        CHECK_EQ(chip8::read_memory(state, state.i + 2), 0x82);
+        CHECK_EQ(chip8::read_memory(state, state.i + 3), 0x73);
     }
 
     SUBCASE("LDM")
@@ -456,9 +501,9 @@ TEST_CASE("Instructions")
         state.vRegisters[chip8::V2] = 0x82;
         state.vRegisters[chip8::V3] = 0x73;
 
-        state.memory[state.i + 0] = 0xE4;
-        state.memory[state.i + 1] = 0x23;
-        state.memory[state.i + 2] = 0x00;
+        chip8::write_memory(state, state.i + 0, 0xE4);
+        chip8::write_memory(state, state.i + 1, 0x23);
+        chip8::write_memory(state, state.i + 2, 0x00);
 
         chip8::execute_instruction(config, state, 0xF165);
 
@@ -470,3 +515,170 @@ TEST_CASE("Instructions")
 
     chip8::destroyCPUState(state);
 }
+
+// A failed Assert reports the instruction, which then does nothing instead of going through with it.
+TEST_CASE("Invalid instructions")
+{
+    const chip8::EmuConfig config = {};
+    chip8::CPUState state = chip8::createCPUState();
+
+    u32 assertCount = 0;
+    setAssertHandler(&count_assert, &assertCount);
+
+    SUBCASE("Fetch")
+    {
+        state.pc = chip8::MinProgramAddress + 1;
+
+        CHECK_EQ(chip8::load_next_instruction(state), 0x0000);
+        CHECK_EQ(assertCount, 1u);
+    }
+
+    SUBCASE("Jumps")
+    {
+        chip8::execute_instruction(config, state, 0x1201); // JP 0x201
+
+        CHECK_EQ(state.pc, chip8::MinProgramAddress + 2);
+
+        state.vRegisters[chip8::V0] = 0xFF;
+        chip8::execute_instruction(config, state, 0xBFFE); // JP V0, 0xFFE
+
+        CHECK_EQ(state.pc, chip8::MinProgramAddress + 4);
+        CHECK_EQ(assertCount, 2u);
+    }
+
+    SUBCASE("Stack")
+    {
+        chip8::execute_instruction(config, state, 0x00EE); // RET
+
+        CHECK_EQ(state.sp, 0);
+        CHECK_EQ(state.pc, chip8::MinProgramAddress + 2);
+
+        state.sp = chip8::StackSize - 1;
+        chip8::execute_instruction(config, state, 0x2300); // CALL 0x300
+
+        CHECK_EQ(state.sp, chip8::StackSize - 1);
+        CHECK_EQ(state.pc, chip8::MinProgramAddress + 4);
+        CHECK_EQ(assertCount, 2u);
+    }
+
+    SUBCASE("Skips")
+    {
+        // Skipping would leave memory.
+        state.pc = 0x0FFC;
+        chip8::execute_instruction(config, state, 0x5000); // SE V0, V0
+
+        CHECK_EQ(state.pc, 0x0FFE);
+
+        state.pc = chip8::MinProgramAddress;
+        state.keyState = 0xFFFF;
+        state.vRegisters[chip8::V0] = 0x10;
+        chip8::execute_instruction(config, state, 0xE09E); // SKP V0
+
+        CHECK_EQ(state.pc, chip8::MinProgramAddress + 2);
+        CHECK_GE(assertCount, 2u);
+    }
+
+    SUBCASE("Memory")
+    {
+        state.i = 0x0123;
+        state.vRegisters[chip8::V0] = 0x10;
+        chip8::execute_instruction(config, state, 0xF029); // LD F, V0
+
+        CHECK_EQ(state.i, 0x0123);
+
+        state.i = 0x0FFE;
+        chip8::write_memory(state, 0x0FFE, 0xAB);
+        chip8::execute_instruction(config, state, 0xF355); // LD [I], V3
+
+        CHECK_EQ(chip8::read_memory(state, 0x0FFE), 0xAB);
+
+        chip8::execute_instruction(config, state, 0xF033); // LD B, V0
+
+        CHECK_EQ(chip8::read_memory(state, 0x0FFE), 0xAB);
+        CHECK_EQ(assertCount, 3u);
+    }
+
+    setAssertHandler(nullptr, nullptr);
+    chip8::destroyCPUState(state);
+}
+
+TEST_CASE("Unchecked instructions")
+{
+    chip8::EmuConfig config = {};
+    config.executionPolicy = chip8::ExecutionPolicy::Unchecked;
+
+    chip8::CPUState state = chip8::createCPUState();
+    u32 assertCount = 0;
+
+    setAssertHandler(&count_assert, &assertCount);
+
+    SUBCASE("Stack wraps around")
+    {
+        state.sp = chip8::StackSize - 1;
+        chip8::execute_instruction(config, state, 0x2300);
+
+        CHECK_EQ(state.sp, 0);
+        CHECK_EQ(state.pc, 0x0300);
+
+        chip8::execute_instruction(config, state, 0x00EE);
+        chip8::execute_instruction(config, state, 0x00EE);
+
+        CHECK_EQ(state.sp, chip8::StackSize - 2);
+    }
+
+    SUBCASE("Addresses wrap around")
+    {
+        state.i = 0x0FFE;
+        state.vRegisters[chip8::V0] = 0x11;
+        state.vRegisters[chip8::V1] = 0x22;
+        state.vRegisters[chip8::V2] = 0x33;
+
+        chip8::execute_instruction(config, state, 0xF255); // LD [I], V2
+
+        CHECK_EQ(chip8::read_memory(state, 0x0FFE), 0x11);
+        CHECK_EQ(chip8::read_memory(state, 0x0FFF), 0x22);
+        CHECK_EQ(chip8::read_memory(state, 0x0000), 0x33);
+
+        state.vRegisters[chip8::V0] = 0xFF;
+        chip8::execute_instruction(config, state, 0xBF01); // JP V0, 0xF01
+
+        CHECK_EQ(state.pc, 0x0000);
+
+        state.pc = 0x0FFE;
+        chip8::execute_instruction(config, state, 0x3000); // SE V0, 0x00
+
+        CHECK_EQ(state.pc, 0x0000);
+
+        state.vRegisters[chip8::V0] = 0x42;
+        chip8::execute_instruction(config, state, 0xF029); // LD F, V0
+
+        CHECK_EQ(state.i, state.fontTableOffsets[0x2]);
+    }
+
+    SUBCASE("Step")
+    {
+        // Runs off the end of memory and wraps around to address 0.
+        const u8 program[] = {
+            0x70, 0x01, // 0x200: ADD V0, 1
+            0x1F, 0xFE, // 0x202: JP 0xFFE
+        };
+
+        chip8::load_program(state, program, sizeof(program));
+        chip8::write_memory(state, 0x0FFE, 0x00);
+        chip8::write_memory(state, 0x0FFF, 0x00);
+
+        chip8::execute_step(config, state, 2 * chip8::InstructionExecutionPeriodMs);
+
+        CHECK_EQ(state.pc, 0x0FFE);
+
+        chip8::execute_step(config, state, chip8::InstructionExecutionPeriodMs);
+
+        CHECK_EQ(state.pc, 0x0000);
+    }
+
+    CHECK_EQ(assertCount, 0u);
+
+    setAssertHandler(nullptr, nullptr);
+
+    chip8::destroyCPUState(state);
+}
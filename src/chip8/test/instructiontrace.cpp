@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/InstructionTrace.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    const u8 TestProgram[] = {
+        0x70, 0x01, // 0x200: ADD V0, 1
+        0xC1, 0xFF, // 0x202: RND V1, 0xFF
+        0xA3, 0x00, // 0x204: LD I, 0x300
+        0x82, 0x14, // 0x206: ADD V2, V1
+        0xF0, 0x18, // 0x208: LD ST, V0
+        0x12, 0x00, // 0x20A: JP 0x200
+    };
+
+    const char* LHSTracePath = "chip8emu_test_lhs.trace";
+    const char* RHSTracePath = "chip8emu_test_rhs.trace";
+
+    // Spans several blocks and both in-memory regions of the writer.
+    const u32 InstructionCount = 40000;
+
+    // Also outputs the records the reader is expected to give back.
+    void record_test_trace(const char* path, u64 randomSeed, std::vector<chip8::InstructionTraceRecord>& records)
+    {
+        chip8::InstructionTraceWriter* writer = chip8::createInstructionTraceWriter(path);
+        REQUIRE(writer != nullptr);
+
+        chip8::EmuConfig config = {};
+        config.instructionTrace = writer;
+
+        chip8::CPUState state = chip8::createCPUState();
+        chip8::seed_random_generator(state, randomSeed);
+        chip8::load_program(state, TestProgram, sizeof(TestProgram));
+
+        records.clear();
+
+        for (u32 instructionIndex = 0; instructionIndex < InstructionCount; instructionIndex++)
+        {
+            chip8::InstructionTraceRecord record = {};
+            record.pc = state.pc;
+            record.instruction = chip8::load_next_instruction(state);
+
+            chip8::execute_step(config, state, chip8::InstructionExecutionPeriodMs);
+
+            record.instructionCount = state.instructionCount;
+            record.i = state.i;
+            record.sp = state.sp;
+            record.delayTimer = state.delayTimer;
+            record.soundTimer = state.soundTimer;
+            record.isWaitingForKey = state.isWaitingForKey;
+            std::memcpy(record.vRegisters, state.vRegisters, chip8::VRegisterCount);
+
+            records.push_back(record);
+        }
+
+        CHECK_EQ(chip8::destroyInstructionTraceWriter(writer), chip8::InstructionTraceError::None);
+
+        chip8::destroyCPUState(state);
+    }
+}
+
+TEST_CASE("Instruction trace")
+{
+    std::vector<chip8::InstructionTraceRecord> lhsRecords;
+    std::vector<chip8::InstructionTraceRecord> rhsRecords;
+
+    record_test_trace(LHSTracePath, 1, lhsRecords);
+
+    SUBCASE("Round trip")
+    {
+        chip8::InstructionTraceReader* reader = chip8::createInstructionTraceReader(LHSTracePath);
+        REQUIRE(reader != nullptr);
+
+        chip8::InstructionTraceRecord record;
+        u32 recordIndex = 0;
+        u32 mismatchCount = 0;
+
+        while (chip8::read_instruction_trace_record(*reader, record))
+        {
+            REQUIRE_LT(recordIndex, lhsRecords.size());
+
+            if (!chip8::are_instruction_trace_records_equal(record, lhsRecords[recordIndex]))
+                mismatchCount++;
+
+            recordIndex++;
+        }
+
+        CHECK_EQ(mismatchCount, 0u);
+
+        CHECK_EQ(chip8::get_instruction_trace_reader_error(*reader), chip8::InstructionTraceError::None);
+        CHECK_EQ(recordIndex, InstructionCount);
+
+        chip8::destroyInstructionTraceReader(reader);
+
+        // Most records only differ by a couple of bytes from the previous one.
+        std::ifstream file(LHSTracePath, std::ios::binary | std::ios::ate);
+        CHECK_LT(static_cast<u64>(file.tellg()), InstructionCount * sizeof(chip8::InstructionTraceRecord) / 2);
+    }
+
+    SUBCASE("Divergence")
+    {
+        record_test_trace(RHSTracePath, 2, rhsRecords);
+
+        chip8::InstructionTraceReader* lhsReader = chip8::createInstructionTraceReader(LHSTracePath);
+        chip8::InstructionTraceReader* rhsReader = chip8::createInstructionTraceReader(RHSTracePath);
+        REQUIRE(lhsReader != nullptr);
+        REQUIRE(rhsReader != nullptr);
+
+        chip8::InstructionTraceDivergence divergence;
+
+        REQUIRE_EQ(chip8::find_instruction_trace_divergence(*lhsReader, *rhsReader, divergence),
+                   chip8::InstructionTraceError::None);
+
+        // The first RND is where the seeds make a difference.
+        CHECK(divergence.hasDiverged);
+        CHECK_EQ(divergence.recordIndex, 1u);
+        CHECK_EQ(divergence.lhs.pc, 0x202);
+        CHECK_EQ(divergence.lhs.instruction, divergence.rhs.instruction);
+
+        chip8::destroyInstructionTraceReader(lhsReader);
+        chip8::destroyInstructionTraceReader(rhsReader);
+
+        std::remove(RHSTracePath);
+    }
+
+    SUBCASE("Identical traces")
+    {
+        record_test_trace(RHSTracePath, 1, rhsRecords);
+
+        chip8::InstructionTraceReader* lhsReader = chip8::createInstructionTraceReader(LHSTracePath);
+        chip8::InstructionTraceReader* rhsReader = chip8::createInstructionTraceReader(RHSTracePath);
+        REQUIRE(lhsReader != nullptr);
+        REQUIRE(rhsReader != nullptr);
+
+        chip8::InstructionTraceDivergence divergence;
+
+        REQUIRE_EQ(chip8::find_instruction_trace_divergence(*lhsReader, *rhsReader, divergence),
+                   chip8::InstructionTraceError::None);
+
+        CHECK_FALSE(divergence.hasDiverged);
+        CHECK_EQ(divergence.recordIndex, InstructionCount);
+
+        chip8::destroyInstructionTraceReader(lhsReader);
+        chip8::destroyInstructionTraceReader(rhsReader);
+
+        std::remove(RHSTracePath);
+    }
+
+    SUBCASE("Invalid file")
+    {
+        {
+            std::ofstream file(RHSTracePath, std::ios::binary);
+            file << "not a trace";
+        }
+
+        chip8::InstructionTraceReader* reader = chip8::createInstructionTraceReader(RHSTracePath);
+        REQUIRE(reader != nullptr);
+
+        chip8::InstructionTraceRecord record;
+
+        CHECK_FALSE(chip8::read_instruction_trace_record(*reader, record));
+        CHECK_EQ(chip8::get_instruction_trace_reader_error(*reader), chip8::InstructionTraceError::InvalidMagic);
+
+        chip8::destroyInstructionTraceReader(reader);
+
+        std::remove(RHSTracePath);
+    }
+
+    SUBCASE("Record size mismatch")
+    {
+        // Valid magic and version, but records one byte larger than ours.
+        {
+            std::ifstream lhsFile(LHSTracePath, std::ios::binary);
+            std::ofstream file(RHSTracePath, std::ios::binary);
+            char header[8];
+
+            lhsFile.read(header, sizeof(header));
+            header[6]++;
+            file.write(header, sizeof(header));
+            file << lhsFile.rdbuf();
+        }
+
+        chip8::InstructionTraceReader* reader = chip8::createInstructionTraceReader(RHSTracePath);
+        REQUIRE(reader != nullptr);
+
+        chip8::InstructionTraceRecord record;
+
+        CHECK_FALSE(chip8::read_instruction_trace_record(*reader, record));
+        CHECK_EQ(chip8::get_instruction_trace_reader_error(*reader), chip8::InstructionTraceError::InvalidRecordSize);
+
+        chip8::destroyInstructionTraceReader(reader);
+
+        std::remove(RHSTracePath);
+    }
+
+    std::remove(LHSTracePath);
+}
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/CpuPool.h"
+#include "chip8/Execution.h"
+#include "chip8/Memory.h"
+
+TEST_CASE("Memory")
+{
+    const chip8::EmuConfig config = {};
+    chip8::CPUState state = chip8::createCPUState();
+
+    state.i = chip8::MinProgramAddress;
+    state.vRegisters[chip8::V0] = 0x42;
+
+    chip8::execute_instruction(config, state, 0xF055); // LD [I], V0
+
+    SUBCASE("Fork")
+    {
+        chip8::CPUState child = chip8::forkCPUState(state);
+
+        for (u32 pageIndex = 0; pageIndex < chip8::MemoryPageCount; pageIndex++)
+            CHECK_EQ(child.memoryPages[pageIndex], state.memoryPages[pageIndex]);
+
+        CHECK_EQ(chip8::read_memory(child, chip8::MinProgramAddress), 0x42);
+
+        child.vRegisters[chip8::V0] = 0x24;
+        chip8::execute_instruction(config, child, 0xF055);
+
+        const u32 writtenPageIndex = chip8::MinProgramAddress / chip8::MemoryPageSizeInBytes;
+
+        // Only the page that was written to got copied.
+        CHECK_NE(child.memoryPages[writtenPageIndex], state.memoryPages[writtenPageIndex]);
+        CHECK_EQ(child.memoryPages[0], state.memoryPages[0]);
+
+        CHECK_EQ(chip8::read_memory(child, chip8::MinProgramAddress), 0x24);
+        CHECK_EQ(chip8::read_memory(state, chip8::MinProgramAddress), 0x42);
+
+        chip8::destroyCPUState(child);
+
+        CHECK_EQ(state.memoryPages[0]->refCount.load(), 1u);
+    }
+
+    SUBCASE("Range")
+    {
+        // Straddles two pages.
+        const u16 address = 0x2FE;
+        const u8 input[4] = {0x01, 0x02, 0x03, 0x04};
+        u8 output[4] = {};
+
+        chip8::CPUState child = chip8::forkCPUState(state);
+
+        chip8::write_memory_range(child, address, input, sizeof(input));
+        chip8::read_memory_range(child, address, output, sizeof(output));
+
+        CHECK_EQ(output[0], 0x01);
+        CHECK_EQ(output[3], 0x04);
+        CHECK_NE(chip8::read_memory(state, address + 3), 0x04);
+
+        chip8::destroyCPUState(child);
+    }
+
+    SUBCASE("Fetch")
+    {
+        // The last instruction ends on the last byte of the last page.
+        const u8 input[2] = {0x12, 0x34};
+        chip8::write_memory_range(state, 0x0FFE, input, sizeof(input));
+
+        state.pc = 0x0FFE;
+        CHECK_EQ(chip8::load_next_instruction(state), 0x1234);
+    }
+
+    SUBCASE("Pool")
+    {
+        const u8 program[2] = {0x12, 0x00}; // JP 0x200
+
+        chip8::CPUStatePool* pool = chip8::createCPUStatePool(2, false);
+
+        chip8::load_pool_program(*pool, program, sizeof(program));
+
+        chip8::CPUState* first = chip8::acquire_cpu_state(*pool);
+        chip8::CPUState* second = chip8::acquire_cpu_state(*pool);
+
+        CHECK_EQ(first->memoryPages[2], second->memoryPages[2]);
+        CHECK_EQ(chip8::read_memory(*first, chip8::MinProgramAddress), 0x12);
+
+        chip8::write_memory(*first, chip8::MinProgramAddress, 0x13);
+
+        CHECK_EQ(chip8::read_memory(*second, chip8::MinProgramAddress), 0x12);
+
+        chip8::release_cpu_state(*pool, first);
+        chip8::release_cpu_state(*pool, second);
+        chip8::destroyCPUStatePool(pool);
+    }
+
+    chip8::destroyCPUState(state);
+}
@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/Opcode.h"
+#include "chip8/OpcodeStats.h"
+
+#include <cstring>
+#include <sstream>
+
+TEST_CASE("Opcode")
+{
+    SUBCASE("Classes")
+    {
+        CHECK_EQ(chip8::get_opcode_class(0x00E0), chip8::OpcodeClass::Cls);
+        CHECK_EQ(chip8::get_opcode_class(0x00EE), chip8::OpcodeClass::Ret);
+        CHECK_EQ(chip8::get_opcode_class(0x0123), chip8::OpcodeClass::Sys);
+        CHECK_EQ(chip8::get_opcode_class(0x1234), chip8::OpcodeClass::Jp);
+        CHECK_EQ(chip8::get_opcode_class(0x5120), chip8::OpcodeClass::SeReg);
+        CHECK_EQ(chip8::get_opcode_class(0x5121), chip8::OpcodeClass::Invalid);
+        CHECK_EQ(chip8::get_opcode_class(0x812E), chip8::OpcodeClass::Shl);
+        CHECK_EQ(chip8::get_opcode_class(0x8128), chip8::OpcodeClass::Invalid);
+        CHECK_EQ(chip8::get_opcode_class(0xD125), chip8::OpcodeClass::Drw);
+        CHECK_EQ(chip8::get_opcode_class(0xE19E), chip8::OpcodeClass::Skp);
+        CHECK_EQ(chip8::get_opcode_class(0xE1A1), chip8::OpcodeClass::Sknp);
+        CHECK_EQ(chip8::get_opcode_class(0xE1A2), chip8::OpcodeClass::Invalid);
+        CHECK_EQ(chip8::get_opcode_class(0xF165), chip8::OpcodeClass::LdVxI);
+        CHECK_EQ(chip8::get_opcode_class(0xF166), chip8::OpcodeClass::Invalid);
+
+        CHECK(std::strcmp(chip8::get_opcode_class_name(chip8::OpcodeClass::LdImm), "LD Vx, byte") == 0);
+    }
+
+    SUBCASE("Table")
+    {
+        // The decoder and the table agree on every instruction.
+        for (u32 instruction = 0; instruction <= 0xFFFF; instruction++)
+        {
+            const chip8::OpcodeClass opcodeClass = chip8::get_opcode_class(static_cast<u16>(instruction));
+            const chip8::OpcodeInfo& info = chip8::get_opcode_info(opcodeClass);
+
+            if ((instruction & info.mask) != info.pattern)
+                FAIL_CHECK(chip8::disassemble_instruction(static_cast<u16>(instruction)));
+        }
+
+        CHECK_EQ(chip8::get_opcode_flow(0x3100), chip8::OpcodeFlow::Skip);
+        CHECK_EQ(chip8::get_opcode_flow(0xB300), chip8::OpcodeFlow::ComputedJump);
+        CHECK_EQ(chip8::get_opcode_flow(0x00EE), chip8::OpcodeFlow::Return);
+        CHECK_EQ(chip8::get_opcode_flow(0xF10A), chip8::OpcodeFlow::Next);
+        CHECK_EQ(chip8::get_opcode_flow(0x8128), chip8::OpcodeFlow::Invalid);
+    }
+
+    SUBCASE("Disassembly")
+    {
+        CHECK_EQ(chip8::disassemble_instruction(0x00E0), "CLS");
+        CHECK_EQ(chip8::disassemble_instruction(0x1234), "JP 0x234");
+        CHECK_EQ(chip8::disassemble_instruction(0x63A2), "LD V3, 0xA2");
+        CHECK_EQ(chip8::disassemble_instruction(0x8AB4), "ADD VA, VB");
+        CHECK_EQ(chip8::disassemble_instruction(0xB300), "JP V0, 0x300");
+        CHECK_EQ(chip8::disassemble_instruction(0xD125), "DRW V1, V2, 5");
+        CHECK_EQ(chip8::disassemble_instruction(0xF065), "LD V0, [I]");
+        CHECK_EQ(chip8::disassemble_instruction(0x5121), "DW 0x5121");
+    }
+
+    SUBCASE("Stats")
+    {
+        const chip8::EmuConfig config = {};
+        chip8::CPUState state = chip8::createCPUState();
+
+        chip8::set_full_opcode_stats_enabled(true);
+        chip8::reset_opcode_stats();
+
+        for (u32 index = 0; index < 10; index++)
+            chip8::execute_instruction(config, state, 0x6142); // LD V1, 0x42
+
+        chip8::execute_instruction(config, state, 0x7101); // ADD V1, 1
+
+        chip8::OpcodeStats stats;
+        chip8::get_opcode_stats(stats);
+
+        const chip8::OpcodeClassStats& ldStats = stats.classes[static_cast<u32>(chip8::OpcodeClass::LdImm)];
+        const chip8::OpcodeClassStats& addStats = stats.classes[static_cast<u32>(chip8::OpcodeClass::AddImm)];
+
+        if (chip8::areOpcodeStatsEnabled())
+        {
+            CHECK_EQ(ldStats.executionCount, 10u);
+            CHECK_EQ(addStats.executionCount, 1u);
+            CHECK_EQ(chip8::get_full_opcode_count(0x6142), 10u);
+
+            u64 histogramCount = 0;
+
+            for (u64 bucketCount : ldStats.costHistogram)
+                histogramCount += bucketCount;
+
+            CHECK_EQ(histogramCount, ldStats.executionCount);
+        }
+        else
+        {
+            CHECK_EQ(ldStats.executionCount, 0u);
+            CHECK_EQ(chip8::get_full_opcode_count(0x6142), 0u);
+        }
+
+        std::ostringstream report;
+        chip8::print_opcode_stats(report);
+
+        CHECK_FALSE(report.str().empty());
+
+        chip8::set_full_opcode_stats_enabled(false);
+        chip8::reset_opcode_stats();
+        chip8::destroyCPUState(state);
+    }
+}
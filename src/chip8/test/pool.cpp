@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/CpuPool.h"
+#include "chip8/Execution.h"
+#include "chip8/Memory.h"
+
+TEST_CASE("CPUStatePool")
+{
+    const chip8::EmuConfig config = {};
+    const u32 capacity = 4;
+
+    chip8::CPUStatePool* pool = chip8::createCPUStatePool(capacity, false);
+
+    SUBCASE("Exhaustion")
+    {
+        chip8::CPUState* states[capacity] = {};
+
+        for (u32 i = 0; i < capacity; i++)
+        {
+            states[i] = chip8::acquire_cpu_state(*pool);
+            CHECK(states[i] != nullptr);
+        }
+
+        CHECK(chip8::acquire_cpu_state(*pool) == nullptr);
+
+        chip8::release_cpu_state(*pool, states[2]);
+
+        CHECK_EQ(chip8::acquire_cpu_state(*pool), states[2]);
+    }
+
+    SUBCASE("Reset")
+    {
+        chip8::CPUState* state = chip8::acquire_cpu_state(*pool);
+        chip8::CPUState reference = chip8::createCPUState();
+
+        CHECK_EQ(state->pc, chip8::MinProgramAddress);
+        CHECK_EQ(state->fontTableOffsets[0xF], reference.fontTableOffsets[0xF]);
+        CHECK_EQ(chip8::read_memory(*state, state->fontTableOffsets[0xF]), chip8::read_memory(reference, reference.fontTableOffsets[0xF]));
+
+        state->i = chip8::MinProgramAddress;
+        state->vRegisters[chip8::V0] = 0x42;
+
+        chip8::execute_instruction(config, *state, 0xF055);
+        chip8::release_cpu_state(*pool, state);
+
+        // LIFO free list, we get the same slot back.
+        chip8::CPUState* recycledState = chip8::acquire_cpu_state(*pool);
+
+        CHECK_EQ(recycledState, state);
+        CHECK_EQ(recycledState->pc, chip8::MinProgramAddress);
+        CHECK_EQ(recycledState->i, 0);
+        CHECK_EQ(recycledState->vRegisters[chip8::V0], 0);
+        CHECK_EQ(chip8::read_memory(*recycledState, chip8::MinProgramAddress), 0);
+
+        chip8::destroyCPUState(reference);
+    }
+
+    chip8::destroyCPUStatePool(pool);
+}
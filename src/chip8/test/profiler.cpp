@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/Profiler.h"
+
+#include "core/Assert.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+    // Main loop calling an outer function, which calls an inner one twice.
+    const u8 TestProgram[] = {
+        0x22, 0x06, // 0x200: CALL 0x206
+        0x70, 0x01, // 0x202: ADD V0, 1
+        0x12, 0x00, // 0x204: JP 0x200
+        0x22, 0x0E, // 0x206: CALL 0x20E
+        0x22, 0x0E, // 0x208: CALL 0x20E
+        0x71, 0x01, // 0x20A: ADD V1, 1
+        0x00, 0xEE, // 0x20C: RET
+        0x72, 0x01, // 0x20E: ADD V2, 1
+        0x00, 0xEE, // 0x210: RET
+    };
+
+    // Calls itself without ever returning until the stack is full.
+    const u8 StackOverflowProgram[] = {
+        0x22, 0x04, // 0x200: CALL 0x204
+        0x12, 0x00, // 0x202: JP 0x200
+        0x12, 0x00, // 0x204: JP 0x200
+    };
+
+    void count_assert(const char* /*file*/, const char* /*func*/, int /*line*/, const std::string& /*message*/,
+                      void* userData)
+    {
+        (*static_cast<u32*>(userData))++;
+    }
+}
+
+TEST_CASE("Profiler")
+{
+    chip8::Profiler* profiler = chip8::createProfiler();
+    chip8::EmuConfig config = {};
+    config.profiler = profiler;
+
+    chip8::CPUState state = chip8::createCPUState();
+    chip8::load_program(state, TestProgram, sizeof(TestProgram));
+
+    // 11 instructions per iteration of the main loop.
+    const u64 iterationCount = 100;
+
+    for (u64 instruction = 0; instruction < iterationCount * 11; instruction++)
+        chip8::execute_step(config, state, chip8::InstructionExecutionPeriodMs);
+
+    REQUIRE_EQ(state.vRegisters[chip8::V0], iterationCount);
+
+    SUBCASE("Counts")
+    {
+        CHECK_EQ(profiler->instructionCount, iterationCount * 11);
+        CHECK_EQ(profiler->pcCounts[0x200], iterationCount);
+        CHECK_EQ(profiler->pcCounts[0x20E], iterationCount * 2);
+        CHECK_EQ(profiler->pcCounts[0x300], 0u);
+
+        // main, 0x206 and 0x206 -> 0x20E
+        CHECK_EQ(profiler->callNodes.size(), 3u);
+        CHECK_EQ(profiler->currentCallNodeIndex, chip8::RootCallNodeIndex);
+
+        CHECK_EQ(chip8::get_inclusive_function_count(*profiler, 0x206), iterationCount * 8);
+        CHECK_EQ(chip8::get_inclusive_function_count(*profiler, 0x20E), iterationCount * 4);
+    }
+
+    SUBCASE("Reports")
+    {
+        std::ostringstream foldedStacks;
+        chip8::write_folded_stacks(*profiler, foldedStacks);
+
+        CHECK_EQ(foldedStacks.str(), "main 300\nmain;0x206 400\nmain;0x206;0x20e 400\n");
+
+        std::ostringstream report;
+        chip8::print_profiler_report(*profiler, report, 8);
+
+        CHECK_NE(report.str().find("0x20e"), std::string::npos);
+    }
+
+    SUBCASE("Reset")
+    {
+        chip8::reset_profiler(*profiler);
+
+        CHECK_EQ(profiler->instructionCount, 0u);
+        CHECK_EQ(profiler->pcCounts[0x200], 0u);
+        CHECK_EQ(profiler->callNodes.size(), 1u);
+    }
+
+    chip8::destroyCPUState(state);
+    chip8::destroyProfiler(profiler);
+}
+
+TEST_CASE("Profiler stack overflow")
+{
+    chip8::Profiler* profiler = chip8::createProfiler();
+    chip8::EmuConfig config = {};
+    config.profiler = profiler;
+
+    chip8::CPUState state = chip8::createCPUState();
+    chip8::load_program(state, StackOverflowProgram, sizeof(StackOverflowProgram));
+
+    u32 assertCount = 0;
+    setAssertHandler(&count_assert, &assertCount);
+
+    SUBCASE("Checked")
+    {
+        for (u32 instruction = 0; instruction < 1000; instruction++)
+            chip8::execute_step(config, state, chip8::InstructionExecutionPeriodMs);
+
+        // Calls that overflow don't push anything, the tree stops where the stack does.
+        CHECK_GT(assertCount, 0u);
+        CHECK_EQ(profiler->callNodes.size(), chip8::StackSize);
+        CHECK_EQ(profiler->currentCallDepth, chip8::StackSize - 1);
+    }
+
+    SUBCASE("Unchecked")
+    {
+        config.executionPolicy = chip8::ExecutionPolicy::Unchecked;
+
+        for (u32 instruction = 0; instruction < 1000; instruction++)
+            chip8::execute_step(config, state, chip8::InstructionExecutionPeriodMs);
+
+        CHECK_LE(profiler->callNodes.size(), chip8::StackSize + 1);
+        CHECK_LE(profiler->currentCallDepth, chip8::StackSize);
+    }
+
+    setAssertHandler(nullptr, nullptr);
+
+    chip8::destroyCPUState(state);
+    chip8::destroyProfiler(profiler);
+}
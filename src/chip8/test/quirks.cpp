@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/Memory.h"
+#include "chip8/Quirks.h"
+
+#include <cstring>
+
+TEST_CASE("Quirks")
+{
+    chip8::EmuConfig config = {};
+    chip8::EmuConfig quirkConfig = {};
+    chip8::CPUState state = chip8::createCPUState();
+
+    SUBCASE("Profiles")
+    {
+        CHECK_EQ(config.quirkProfile, chip8::QuirkProfile::Default);
+        CHECK_EQ(chip8::get_quirk_flags(chip8::QuirkProfile::Default), 0u);
+
+        for (u32 profileIndex = 0; profileIndex < chip8::QuirkProfileCount; profileIndex++)
+        {
+            const chip8::QuirkProfile profile = static_cast<chip8::QuirkProfile>(profileIndex);
+            chip8::QuirkProfile foundProfile = chip8::QuirkProfile::Count;
+
+            CHECK(chip8::find_quirk_profile(chip8::get_quirk_profile_name(profile), foundProfile));
+            CHECK_EQ(foundProfile, profile);
+        }
+
+        chip8::QuirkProfile profile = chip8::QuirkProfile::Default;
+        CHECK(chip8::find_quirk_profile("schip", profile));
+        CHECK_EQ(profile, chip8::QuirkProfile::SuperChip);
+        CHECK_FALSE(chip8::find_quirk_profile("chip48", profile));
+    }
+
+    SUBCASE("SHR/SHL")
+    {
+        quirkConfig.quirkProfile = chip8::QuirkProfile::Cosmac;
+
+        state.vRegisters[0x1] = 0x03;
+        state.vRegisters[0x2] = 0x81;
+        chip8::execute_instruction(config, state, 0x8126);
+
+        CHECK_EQ(state.vRegisters[0x1], 0x01);
+        CHECK_EQ(state.vRegisters[0xF], 1);
+
+        state.vRegisters[0x1] = 0x03;
+        chip8::execute_instruction(quirkConfig, state, 0x8126);
+
+        CHECK_EQ(state.vRegisters[0x1], 0x40);
+        CHECK_EQ(state.vRegisters[0x2], 0x81);
+        CHECK_EQ(state.vRegisters[0xF], 1);
+
+        state.vRegisters[0x1] = 0x03;
+        chip8::execute_instruction(quirkConfig, state, 0x812E);
+
+        CHECK_EQ(state.vRegisters[0x1], 0x02);
+        CHECK_EQ(state.vRegisters[0xF], 1);
+    }
+
+    SUBCASE("LD [I], Vx/LD Vx, [I]")
+    {
+        quirkConfig.quirkProfile = chip8::QuirkProfile::XOChip;
+
+        state.i = 0x300;
+        chip8::execute_instruction(config, state, 0xF255);
+
+        CHECK_EQ(state.i, 0x300);
+
+        chip8::execute_instruction(quirkConfig, state, 0xF255);
+
+        CHECK_EQ(state.i, 0x303);
+
+        chip8::execute_instruction(quirkConfig, state, 0xF065);
+
+        CHECK_EQ(state.i, 0x304);
+    }
+
+    SUBCASE("JP V0, addr")
+    {
+        quirkConfig.quirkProfile = chip8::QuirkProfile::SuperChip;
+
+        state.vRegisters[0x0] = 0x20;
+        state.vRegisters[0x2] = 0x10;
+        chip8::execute_instruction(config, state, 0xB240);
+
+        CHECK_EQ(state.pc, 0x0260);
+
+        chip8::execute_instruction(quirkConfig, state, 0xB240);
+
+        CHECK_EQ(state.pc, 0x0250);
+    }
+
+    SUBCASE("DRW")
+    {
+        quirkConfig.quirkProfile = chip8::QuirkProfile::SuperChip;
+
+        chip8::write_memory(state, 0x300, 0xFF);
+        state.i = 0x300;
+        state.vRegisters[0x0] = 60;
+        state.vRegisters[0x1] = 31;
+
+        // Wraps around to the left edge
+        chip8::execute_instruction(config, state, 0xD011);
+
+        CHECK_EQ(state.screen[31][7], 0xF0);
+        CHECK_EQ(state.screen[31][0], 0x0F);
+
+        std::memset(state.screen, 0, sizeof(state.screen));
+
+        // Cut at the right edge, rows past the bottom are dropped
+        chip8::write_memory(state, 0x301, 0xFF);
+        chip8::execute_instruction(quirkConfig, state, 0xD012);
+
+        CHECK_EQ(state.screen[31][7], 0xF0);
+        CHECK_EQ(state.screen[31][0], 0x00);
+        CHECK_EQ(state.screen[0][7], 0x00);
+        CHECK_EQ(state.vRegisters[0xF], 0);
+
+        // The start position still wraps around
+        state.vRegisters[0x0] = 64 + 8;
+        state.vRegisters[0x1] = 32;
+        chip8::execute_instruction(quirkConfig, state, 0xD011);
+
+        CHECK_EQ(state.screen[0][1], 0xFF);
+    }
+
+    SUBCASE("OR/AND/XOR")
+    {
+        quirkConfig.quirkProfile = chip8::QuirkProfile::Cosmac;
+
+        state.vRegisters[0xF] = 1;
+        chip8::execute_instruction(config, state, 0x8121);
+
+        CHECK_EQ(state.vRegisters[0xF], 1);
+
+        chip8::execute_instruction(quirkConfig, state, 0x8121);
+
+        CHECK_EQ(state.vRegisters[0xF], 0);
+
+        state.vRegisters[0xF] = 1;
+        chip8::execute_instruction(quirkConfig, state, 0x8122);
+
+        CHECK_EQ(state.vRegisters[0xF], 0);
+
+        state.vRegisters[0xF] = 1;
+        chip8::execute_instruction(quirkConfig, state, 0x8123);
+
+        CHECK_EQ(state.vRegisters[0xF], 0);
+    }
+
+    SUBCASE("Step")
+    {
+        const u8 program[] = {
+            0x62, 0x81, // 0x200: LD V2, 0x81
+            0x81, 0x26, // 0x202: SHR V1, V2
+            0x12, 0x04, // 0x204: JP 0x204
+        };
+
+        quirkConfig.quirkProfile = chip8::QuirkProfile::Cosmac;
+
+        chip8::load_program(state, program, sizeof(program));
+        chip8::execute_step(quirkConfig, state, 2 * chip8::InstructionExecutionPeriodMs);
+
+        CHECK_EQ(state.pc, 0x0204);
+        CHECK_EQ(state.vRegisters[0x1], 0x40);
+    }
+
+    chip8::destroyCPUState(state);
+}
@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/Memory.h"
+#include "chip8/Recompiler.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+    const u8 TestProgram[] = {
+        0x60, 0x00, // 0x200: LD V0, 0x00
+        0x70, 0x01, // 0x202: ADD V0, 0x01
+        0x30, 0x10, // 0x204: SE V0, 0x10
+        0x12, 0x02, // 0x206: JP 0x202
+        0xF1, 0x0A, // 0x208: LD V1, K
+        0x22, 0x10, // 0x20A: CALL 0x210
+        0x12, 0x00, // 0x20C: JP 0x200
+        0x00, 0x00, // 0x20E: padding
+        0x00, 0xE0, // 0x210: CLS
+        0x00, 0xEE, // 0x212: RET
+    };
+
+    // Stands in for generated code.
+    void run_marker(const chip8::EmuConfig& /*config*/, chip8::CPUState& state, u32 instructionCount)
+    {
+        state.vRegisters[0xA] = 0x42;
+        state.instructionCount += instructionCount;
+    }
+}
+
+TEST_CASE("Recompiler")
+{
+    SUBCASE("Generated code")
+    {
+        std::ostringstream output;
+        const chip8::RecompilerStats stats = chip8::write_recompiled_rom(output, TestProgram, sizeof(TestProgram),
+                                                                         chip8::QuirkProfile::Default, "test");
+
+        CHECK_EQ(stats.blockCount, 6u);
+        CHECK_EQ(stats.inlinedInstructionCount, 7u);
+        CHECK_EQ(stats.fallbackInstructionCount, 1u);
+        CHECK_EQ(stats.interpretedInstructionCount, 1u);
+
+        const std::string code = output.str();
+        CHECK_NE(code.find("case 0x200: goto block_200;"), std::string::npos);
+        CHECK_NE(code.find("case 0x20A: goto block_20A;"), std::string::npos);
+        CHECK_EQ(code.find("case 0x208:"), std::string::npos);
+        CHECK_NE(code.find("state.vRegisters[0x0] = static_cast<u8>(state.vRegisters[0x0] + 0x01);"),
+                 std::string::npos);
+        CHECK_NE(code.find("if (state.vRegisters[0x0] == 0x10) { state.pc = 0x208; goto dispatch; }"),
+                 std::string::npos);
+        CHECK_NE(code.find("state.stack[state.sp] = 0x20A;\n        goto block_210;"), std::string::npos);
+        CHECK_NE(code.find("chip8::execute_instruction(config, state, 0x00E0);"), std::string::npos);
+        CHECK_NE(code.find("chip8::QuirkProfile::Default, Program, sizeof(Program), &run };"), std::string::npos);
+    }
+
+    SUBCASE("Self-modifying code")
+    {
+        const u8 program[] = {
+            0xA2, 0x00, // 0x200: LD I, 0x200
+            0xF0, 0x55, // 0x202: LD [I], V0
+            0x12, 0x00, // 0x204: JP 0x200
+        };
+
+        std::ostringstream output;
+        const chip8::RecompilerStats stats =
+            chip8::write_recompiled_rom(output, program, sizeof(program), chip8::QuirkProfile::Default, "test");
+
+        CHECK_EQ(stats.blockCount, 0u);
+        CHECK_EQ(stats.interpretedInstructionCount, 3u);
+        CHECK_EQ(output.str().find("block_"), std::string::npos);
+    }
+
+    SUBCASE("Runtime")
+    {
+        const chip8::RecompiledRom rom = { "test", chip8::QuirkProfile::Default, TestProgram, sizeof(TestProgram),
+                                           nullptr };
+        const chip8::EmuConfig config = {};
+
+        chip8::CPUState state = chip8::createCPUState();
+        chip8::load_recompiled_rom(state, rom);
+
+        CHECK_EQ(chip8::read_memory(state, 0x208), 0xF1);
+        CHECK_EQ(chip8::read_memory(state, 0x300), 0x00);
+
+        // LD V1, K sees the key state from before the step only on its first instruction.
+        state.pc = 0x208;
+        state.isWaitingForKey = true;
+        state.keyState = 1 << 3;
+        state.keyStatePrev = 0;
+
+        chip8::interpret_recompiled_instruction(config, state, false);
+        CHECK_EQ(state.pc, 0x208);
+        CHECK(state.isWaitingForKey);
+
+        state.keyStatePrev = 0;
+
+        chip8::interpret_recompiled_instruction(config, state, true);
+        CHECK_EQ(state.pc, 0x20A);
+        CHECK_EQ(state.vRegisters[1], 3);
+        CHECK_FALSE(state.isWaitingForKey);
+
+        chip8::destroyCPUState(state);
+    }
+
+    SUBCASE("Execution")
+    {
+        const chip8::RecompiledRom rom = { "test", chip8::QuirkProfile::Default, TestProgram, sizeof(TestProgram),
+                                           &run_marker };
+        chip8::EmuConfig config = {};
+        config.recompiledRom = &rom;
+
+        chip8::CPUState state = chip8::createCPUState();
+        chip8::load_recompiled_rom(state, rom);
+        state.vRegisters[0xA] = 0;
+
+        chip8::execute_step(config, state, 16);
+        CHECK_EQ(state.vRegisters[0xA], 0x42);
+        CHECK_GT(state.instructionCount, 0u);
+
+        // Unchecked execution has no generated counterpart.
+        state.vRegisters[0xA] = 0;
+        config.executionPolicy = chip8::ExecutionPolicy::Unchecked;
+
+        chip8::execute_step(config, state, 16);
+        CHECK_EQ(state.vRegisters[0xA], 0);
+
+        chip8::destroyCPUState(state);
+    }
+}
@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/Rewind.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Counts in V0, writes its BCD value to memory and draws a glyph every iteration.
+    const u8 TestProgram[] = {
+        0x60, 0x00, // LD V0, 0
+        0x61, 0x00, // LD V1, 0
+        0x70, 0x01, // ADD V0, 1
+        0xA3, 0x00, // LD I, 0x300
+        0xF0, 0x33, // LD B, V0
+        0xA0, 0x00, // LD I, 0x000
+        0xD1, 0x15, // DRW V1, V1, 5
+        0x71, 0x01, // ADD V1, 1
+        0x12, 0x04, // JP 0x204
+        0x00, 0x00,
+    };
+
+    bool is_same_state(const chip8::CPUState& state, const chip8::SaveStatePayload& expected)
+    {
+        chip8::SaveStatePayload payload;
+        chip8::write_save_state_payload(state, payload);
+
+        return std::memcmp(&payload, &expected, sizeof(payload)) == 0;
+    }
+}
+
+TEST_CASE("Rewind")
+{
+    const chip8::EmuConfig config = {};
+    const u32 frameCount = 100;
+    chip8::CPUState state = chip8::createCPUState();
+
+    chip8::load_program(state, TestProgram, sizeof(TestProgram));
+
+    std::vector<chip8::SaveStatePayload> history(frameCount);
+
+    SUBCASE("Restore")
+    {
+        chip8::RewindBuffer* buffer = chip8::createRewindBuffer(frameCount, 16, 64 * 1024);
+
+        for (u32 frame = 0; frame < frameCount; frame++)
+        {
+            chip8::execute_step(config, state, chip8::DelayTimerPeriodMs);
+            chip8::write_save_state_payload(state, history[frame]);
+            chip8::push_rewind_frame(*buffer, state);
+        }
+
+        CHECK_EQ(buffer->frameCount, frameCount);
+        CHECK_LT(chip8::get_rewind_data_usage(*buffer), frameCount * sizeof(chip8::SaveStatePayload) / 10);
+
+        CHECK_EQ(chip8::rewind_frames(*buffer, state, 1), 1);
+        CHECK(is_same_state(state, history[99]));
+
+        CHECK_EQ(chip8::rewind_frames(*buffer, state, 30), 30);
+        CHECK(is_same_state(state, history[69]));
+
+        // Resume from there
+        chip8::push_rewind_frame(*buffer, state);
+        chip8::execute_step(config, state, chip8::DelayTimerPeriodMs);
+        chip8::push_rewind_frame(*buffer, state);
+
+        CHECK(is_same_state(state, history[70]));
+        CHECK_EQ(chip8::rewind_frames(*buffer, state, 2), 2);
+        CHECK(is_same_state(state, history[69]));
+
+        CHECK_EQ(chip8::rewind_frames(*buffer, state, 1000), 69);
+        CHECK(is_same_state(state, history[0]));
+        CHECK_EQ(chip8::rewind_frames(*buffer, state, 1), 0);
+
+        chip8::destroyRewindBuffer(buffer);
+    }
+
+    SUBCASE("Bounded")
+    {
+        // Not enough room for the whole history
+        chip8::RewindBuffer* buffer = chip8::createRewindBuffer(frameCount, 8, 6 * 1024);
+
+        for (u32 frame = 0; frame < frameCount; frame++)
+        {
+            chip8::execute_step(config, state, chip8::DelayTimerPeriodMs);
+            chip8::write_save_state_payload(state, history[frame]);
+            chip8::push_rewind_frame(*buffer, state);
+
+            CHECK_LE(chip8::get_rewind_data_usage(*buffer), buffer->dataCapacityInBytes);
+        }
+
+        const u32 keptFrameCount = buffer->frameCount;
+
+        CHECK_LT(keptFrameCount, frameCount);
+        CHECK_EQ(chip8::rewind_frames(*buffer, state, keptFrameCount), keptFrameCount);
+        CHECK(is_same_state(state, history[frameCount - keptFrameCount]));
+
+        chip8::destroyRewindBuffer(buffer);
+    }
+
+    chip8::destroyCPUState(state);
+}
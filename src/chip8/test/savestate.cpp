@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/Memory.h"
+#include "chip8/SaveState.h"
+
+#include <cstring>
+
+TEST_CASE("Save states")
+{
+    const chip8::EmuConfig config = {};
+    chip8::CPUState state = chip8::createCPUState();
+    chip8::CPUState restoredState = chip8::createCPUState();
+    chip8::SaveState saveState;
+
+    state.vRegisters[chip8::V3] = 0x33;
+    state.vRegisters[chip8::V0] = 0x02;
+    state.i = chip8::MinProgramAddress + 0x10;
+
+    chip8::execute_instruction(config, state, 0x2300); // CALL
+    chip8::execute_instruction(config, state, 0xF315); // LD DT, V3
+    chip8::execute_instruction(config, state, 0xF355); // LD [I], V3
+    chip8::execute_instruction(config, state, 0xF029); // LD F, V0
+    chip8::execute_instruction(config, state, 0xC4FF); // RND V4, 0xFF
+    chip8::execute_instruction(config, state, 0xD005); // DRW V0, V0, 5
+
+    chip8::save_state(state, saveState);
+
+    SUBCASE("Round trip")
+    {
+        CHECK_EQ(chip8::load_state(restoredState, &saveState, sizeof(saveState)), chip8::SaveStateError::None);
+
+        CHECK_EQ(restoredState.pc, state.pc);
+        CHECK_EQ(restoredState.sp, state.sp);
+        CHECK_EQ(restoredState.stack[1], state.stack[1]);
+        CHECK_EQ(restoredState.i, state.i);
+        CHECK_EQ(restoredState.randomState, state.randomState);
+        CHECK_EQ(restoredState.delayTimer, 0x33);
+        CHECK_EQ(std::memcmp(restoredState.vRegisters, state.vRegisters, sizeof(state.vRegisters)), 0);
+        CHECK_EQ(std::memcmp(restoredState.screen, state.screen, sizeof(state.screen)), 0);
+
+        u8 restoredMemory[chip8::MemorySizeInBytes];
+        u8 memory[chip8::MemorySizeInBytes];
+
+        chip8::read_memory_range(restoredState, 0, restoredMemory, sizeof(restoredMemory));
+        chip8::read_memory_range(state, 0, memory, sizeof(memory));
+
+        CHECK_EQ(std::memcmp(restoredMemory, memory, sizeof(memory)), 0);
+    }
+
+    SUBCASE("Corruption")
+    {
+        saveState.payload.memory[chip8::MinProgramAddress] ^= 0x01;
+
+        CHECK_EQ(chip8::load_state(restoredState, &saveState, sizeof(saveState)), chip8::SaveStateError::ChecksumMismatch);
+        CHECK_EQ(restoredState.pc, chip8::MinProgramAddress);
+    }
+
+    SUBCASE("Two bit flips")
+    {
+        // Top bit of instructionCount and randomState, these cancelled out when hashing whole words.
+        u8* payload = reinterpret_cast<u8*>(&saveState.payload);
+
+        payload[7] ^= 0x80;
+        payload[15] ^= 0x80;
+
+        CHECK_EQ(chip8::load_state(restoredState, &saveState, sizeof(saveState)), chip8::SaveStateError::ChecksumMismatch);
+    }
+
+    SUBCASE("Invalid state")
+    {
+        chip8::CPUState invalidState = chip8::createCPUState();
+
+        invalidState.sp = chip8::StackSize;
+        chip8::save_state(invalidState, saveState);
+        CHECK_EQ(chip8::load_state(restoredState, &saveState, sizeof(saveState)), chip8::SaveStateError::InvalidState);
+
+        invalidState.sp = 0;
+        invalidState.pc = chip8::MinProgramAddress + 1;
+        chip8::save_state(invalidState, saveState);
+        CHECK_EQ(chip8::load_state(restoredState, &saveState, sizeof(saveState)), chip8::SaveStateError::InvalidState);
+
+        invalidState.pc = chip8::MinProgramAddress;
+        invalidState.fontTableOffsets[0xF] = chip8::MemorySizeInBytes - 1;
+        chip8::save_state(invalidState, saveState);
+        CHECK_EQ(chip8::load_state(restoredState, &saveState, sizeof(saveState)), chip8::SaveStateError::InvalidState);
+
+        CHECK_EQ(restoredState.pc, chip8::MinProgramAddress);
+
+        chip8::destroyCPUState(invalidState);
+    }
+
+    SUBCASE("Invalid header")
+    {
+        CHECK_EQ(chip8::load_state(restoredState, &saveState, sizeof(saveState) - 8), chip8::SaveStateError::InvalidSize);
+
+        saveState.header.magic = 0;
+
+        CHECK_EQ(chip8::load_state(restoredState, &saveState, sizeof(saveState)), chip8::SaveStateError::InvalidMagic);
+    }
+
+    chip8::destroyCPUState(restoredState);
+    chip8::destroyCPUState(state);
+}
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Display.h"
+#include "chip8/Execution.h"
+#include "chip8/Memory.h"
+#include "chip8/SaveState.h"
+#include "chip8/StateHash.h"
+
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    // Counts in V0, writes its BCD value to memory and draws a glyph every iteration.
+    const u8 TestProgram[] = {
+        0x60, 0x00, // LD V0, 0
+        0x61, 0x00, // LD V1, 0
+        0x70, 0x01, // ADD V0, 1
+        0xA3, 0x00, // LD I, 0x300
+        0xF0, 0x33, // LD B, V0
+        0xA0, 0x00, // LD I, 0x000
+        0xD1, 0x15, // DRW V1, V1, 5
+        0x71, 0x01, // ADD V1, 1
+        0x00, 0xE0, // CLS
+        0x12, 0x04, // JP 0x204
+    };
+}
+
+TEST_CASE("State hash")
+{
+    const chip8::EmuConfig config = {};
+    chip8::CPUState state = chip8::createCPUState();
+
+    chip8::load_program(state, TestProgram, sizeof(TestProgram));
+
+    SUBCASE("Power-on")
+    {
+        chip8::CPUState otherState = chip8::createCPUState();
+        chip8::load_program(otherState, TestProgram, sizeof(TestProgram));
+
+        CHECK_EQ(chip8::get_state_hash(otherState), chip8::get_state_hash(state));
+
+        chip8::destroyCPUState(otherState);
+    }
+
+    SUBCASE("Returned calls")
+    {
+        // Popped return addresses stay in the stack array, they must not leak into the hash.
+        chip8::CPUState otherState = chip8::createCPUState();
+        chip8::load_program(otherState, TestProgram, sizeof(TestProgram));
+
+        chip8::execute_instruction(config, state, 0x2204); // CALL 0x204
+        chip8::execute_instruction(config, state, 0x00EE); // RET
+        chip8::execute_instruction(config, otherState, 0x6000); // LD V0, 0
+
+        REQUIRE_EQ(otherState.pc, state.pc);
+        CHECK_EQ(chip8::get_state_hash(otherState), chip8::get_state_hash(state));
+
+        chip8::destroyCPUState(otherState);
+    }
+
+    SUBCASE("Incremental")
+    {
+        for (u32 frame = 0; frame < 100; frame++)
+        {
+            chip8::execute_step(config, state, 7);
+
+            CHECK_EQ(state.memoryHash, chip8::compute_memory_hash(state));
+            CHECK_EQ(state.screenHash, chip8::compute_screen_hash(state));
+        }
+
+        chip8::CPUState child = chip8::forkCPUState(state);
+
+        CHECK_EQ(chip8::get_state_hash(child), chip8::get_state_hash(state));
+
+        chip8::write_memory(child, 0x400, 0x01);
+
+        CHECK_NE(chip8::get_state_hash(child), chip8::get_state_hash(state));
+
+        chip8::write_memory(child, 0x400, chip8::read_memory(state, 0x400));
+
+        CHECK_EQ(chip8::get_state_hash(child), chip8::get_state_hash(state));
+
+        chip8::destroyCPUState(child);
+    }
+
+    SUBCASE("Save state")
+    {
+        chip8::execute_step(config, state, 100);
+
+        chip8::SaveState saveState;
+        chip8::CPUState restoredState = chip8::createCPUState();
+
+        chip8::save_state(state, saveState);
+        REQUIRE_EQ(chip8::load_state(restoredState, &saveState, sizeof(saveState)), chip8::SaveStateError::None);
+
+        CHECK_EQ(chip8::get_state_hash(restoredState), chip8::get_state_hash(state));
+
+        chip8::destroyCPUState(restoredState);
+    }
+
+    SUBCASE("Collisions")
+    {
+        // Neighbouring states, each one write away from the base state.
+        // Any collision among these would make a transposition table useless.
+        std::unordered_set<u64> hashes;
+        u32 stateCount = 0;
+
+        for (u32 address = chip8::MinProgramAddress + 0x100; address < chip8::MinProgramAddress + 0x200; address++)
+        {
+            for (u32 value = 0; value < 256; value++)
+            {
+                if (value == chip8::read_memory(state, static_cast<u16>(address)))
+                    continue;
+
+                chip8::CPUState child = chip8::forkCPUState(state);
+                chip8::write_memory(child, static_cast<u16>(address), static_cast<u8>(value));
+
+                hashes.insert(chip8::get_state_hash(child));
+                stateCount++;
+
+                chip8::destroyCPUState(child);
+            }
+        }
+
+        for (u32 y = 0; y < chip8::ScreenHeight; y++)
+        {
+            for (u32 x = 0; x < chip8::ScreenWidth; x++)
+            {
+                chip8::CPUState child = chip8::forkCPUState(state);
+                chip8::write_screen_pixel(child, x, y, chip8::read_screen_pixel(child, x, y) ^ 1);
+
+                hashes.insert(chip8::get_state_hash(child));
+                stateCount++;
+
+                chip8::destroyCPUState(child);
+            }
+        }
+
+        for (u32 registerIndex = 0; registerIndex < chip8::VRegisterCount; registerIndex++)
+        {
+            for (u32 value = 1; value < 256; value++)
+            {
+                chip8::CPUState child = chip8::forkCPUState(state);
+                child.vRegisters[registerIndex] ^= static_cast<u8>(value);
+
+                hashes.insert(chip8::get_state_hash(child));
+                stateCount++;
+
+                chip8::destroyCPUState(child);
+            }
+        }
+
+        hashes.insert(chip8::get_state_hash(state));
+        stateCount++;
+
+        CHECK_EQ(hashes.size(), stateCount);
+    }
+
+    chip8::destroyCPUState(state);
+}
@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/Trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+    const char* TestTracePath = "chip8emu_test_trace.json";
+
+    std::string load_trace()
+    {
+        std::ifstream file(TestTracePath);
+        std::stringstream content;
+
+        content << file.rdbuf();
+
+        return content.str();
+    }
+
+    u32 count_occurrences(const std::string& string, const std::string& pattern)
+    {
+        u32 count = 0;
+
+        for (size_t position = string.find(pattern); position != std::string::npos; position = string.find(pattern, position + 1))
+            count++;
+
+        return count;
+    }
+}
+
+TEST_CASE("Trace")
+{
+    SUBCASE("Events")
+    {
+        const chip8::EmuConfig config = {};
+        chip8::CPUState state = chip8::createCPUState();
+
+        chip8::execute_step(config, state, 0); // Not traced
+
+        chip8::start_tracing();
+        CHECK(chip8::is_tracing_enabled());
+
+        chip8::execute_step(config, state, 0);
+        chip8::execute_step(config, state, 0);
+
+        std::thread worker([] {
+            chip8::set_trace_thread_name("test \"worker\"");
+            CHIP8EMU_TRACE_SCOPE("worker_scope");
+        });
+        worker.join();
+
+        chip8::stop_tracing();
+        chip8::execute_step(config, state, 0); // Not traced either
+
+        REQUIRE(chip8::save_trace_to_file(TestTracePath));
+
+        const std::string trace = load_trace();
+
+        CHECK_EQ(trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), 0u);
+        CHECK_EQ(trace.substr(trace.size() - 4), "\n]}\n");
+        CHECK_EQ(count_occurrences(trace, "\"name\":\"execute_step\",\"ph\":\"X\""), 2u);
+        CHECK_EQ(count_occurrences(trace, "\"name\":\"worker_scope\",\"ph\":\"X\""), 1u);
+        CHECK_EQ(count_occurrences(trace, "\"args\":{\"name\":\"test \\\"worker\\\"\"}"), 1u);
+
+        chip8::destroyCPUState(state);
+    }
+
+    SUBCASE("Ring")
+    {
+        chip8::start_tracing();
+
+        for (u32 eventIndex = 0; eventIndex < chip8::TraceRingCapacity + 10; eventIndex++)
+        {
+            CHIP8EMU_TRACE_SCOPE("ring_scope");
+        }
+
+        chip8::stop_tracing();
+
+        REQUIRE(chip8::save_trace_to_file(TestTracePath));
+
+        // Only the most recent events are kept, and the previous session is gone.
+        const std::string trace = load_trace();
+
+        CHECK_EQ(count_occurrences(trace, "\"name\":\"ring_scope\""), chip8::TraceRingCapacity);
+        CHECK_EQ(count_occurrences(trace, "\"name\":\"execute_step\""), 0u);
+    }
+
+    std::remove(TestTracePath);
+}
@@ -0,0 +1,284 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/DiffFuzz.h"
+#include "chip8/Execution.h"
+#include "chip8/Keyboard.h"
+#include "chip8/Verifier.h"
+
+#include "core/Assert.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    u8 get_slot(const chip8::ProgramVerification& verification, u16 address)
+    {
+        return verification.slots[address / 2];
+    }
+
+    void verify(const u8* program, u16 programSize, chip8::ProgramVerification& verification)
+    {
+        chip8::CPUState state = chip8::createCPUState();
+        chip8::load_program(state, program, programSize);
+        chip8::verify_program(state, chip8::QuirkProfile::Default, verification);
+        chip8::destroyCPUState(state);
+    }
+
+    void count_assert(const char* /*file*/, const char* /*func*/, int /*line*/, const std::string& /*message*/,
+                      void* userData)
+    {
+        (*static_cast<u32*>(userData))++;
+    }
+}
+
+TEST_CASE("Verifier")
+{
+    const u8 CodeVerified = chip8::ProgramSlotCode | chip8::ProgramSlotVerified;
+    chip8::ProgramVerification verification;
+
+    SUBCASE("Loop")
+    {
+        const u8 program[] = {
+            0xA2, 0x0A, // 0x200: LD I, 0x20A
+            0x60, 0x05, // 0x202: LD V0, 0x05
+            0xD0, 0x05, // 0x204: DRW V0, V0, 5
+            0x70, 0x01, // 0x206: ADD V0, 0x01
+            0x12, 0x04, // 0x208: JP 0x204
+            0xF0, 0x90, 0x90, 0x90, 0xF0, 0x00, // 0x20A: sprite
+        };
+
+        verify(program, sizeof(program), verification);
+
+        CHECK_FALSE(verification.isSelfModifying);
+        CHECK_EQ(verification.codeInstructionCount, 5u);
+        CHECK_EQ(verification.verifiedInstructionCount, 5u);
+        CHECK_EQ(verification.maxCallDepth, 0u);
+
+        for (u16 address = 0x200; address < 0x20A; address += 2)
+            CHECK_EQ(get_slot(verification, address), CodeVerified);
+
+        CHECK_EQ(get_slot(verification, 0x20A), 0u);
+    }
+
+    SUBCASE("Subroutines")
+    {
+        const u8 program[] = {
+            0x22, 0x06, // 0x200: CALL 0x206
+            0x22, 0x06, // 0x202: CALL 0x206
+            0x12, 0x00, // 0x204: JP 0x200
+            0x61, 0x01, // 0x206: LD V1, 0x01
+            0x00, 0xEE, // 0x208: RET
+        };
+
+        verify(program, sizeof(program), verification);
+
+        CHECK_EQ(verification.codeInstructionCount, 5u);
+        CHECK_EQ(verification.verifiedInstructionCount, 5u);
+        CHECK_EQ(verification.maxCallDepth, 1u);
+    }
+
+    SUBCASE("Recursion")
+    {
+        const u8 program[] = {
+            0x22, 0x04, // 0x200: CALL 0x204
+            0x12, 0x00, // 0x202: JP 0x200
+            0x70, 0x01, // 0x204: ADD V0, 0x01
+            0x22, 0x04, // 0x206: CALL 0x204, overflows the stack
+            0x71, 0x01, // 0x208: ADD V1, 0x01
+            0x00, 0xEE, // 0x20A: RET
+        };
+
+        verify(program, sizeof(program), verification);
+
+        CHECK_EQ(verification.maxCallDepth, chip8::StackSize);
+        CHECK_EQ(get_slot(verification, 0x200), CodeVerified);
+        CHECK_EQ(get_slot(verification, 0x206), chip8::ProgramSlotCode);
+        CHECK_EQ(get_slot(verification, 0x20A), CodeVerified);
+    }
+
+    SUBCASE("Calls to their own address")
+    {
+        // The pc doesn't change, so the interpreter steps over the CALL after pushing it.
+        // Same for the RET, that returns to its own address.
+        const u8 program[] = {
+            0x22, 0x04, // 0x200: CALL 0x204
+            0x12, 0x00, // 0x202: JP 0x200
+            0x22, 0x04, // 0x204: CALL 0x204
+            0x00, 0xEE, // 0x206: RET
+            0x00, 0xEE, // 0x208: RET
+        };
+
+        verify(program, sizeof(program), verification);
+
+        CHECK_EQ(verification.maxCallDepth, 2u);
+        CHECK_EQ(verification.codeInstructionCount, 5u);
+        CHECK_EQ(verification.verifiedInstructionCount, 5u);
+    }
+
+    SUBCASE("Return from the main program")
+    {
+        const u8 program[] = {
+            0x00, 0xEE, // 0x200: RET, underflows the stack
+            0x12, 0x00, // 0x202: JP 0x200
+        };
+
+        verify(program, sizeof(program), verification);
+
+        CHECK_EQ(get_slot(verification, 0x200), chip8::ProgramSlotCode);
+        CHECK_EQ(get_slot(verification, 0x202), CodeVerified);
+    }
+
+    SUBCASE("Computed jumps")
+    {
+        const u8 program[] = {
+            0x60, 0x04, // 0x200: LD V0, 0x04
+            0xB2, 0x06, // 0x202: JP V0, 0x206
+            0xC0, 0x06, // 0x204: RND V0, 0x06
+            0xB2, 0x0A, // 0x206: JP V0, 0x20A
+            0x12, 0x00, // 0x208: JP 0x200
+            0x12, 0x04, // 0x20A: JP 0x204
+            0x12, 0x00, // 0x20C: JP 0x200
+            0x12, 0x00, // 0x20E: JP 0x200
+            0x12, 0x00, // 0x210: JP 0x200
+            0x00, 0xE0, // 0x212: CLS
+        };
+
+        verify(program, sizeof(program), verification);
+
+        // A single target
+        CHECK_EQ(get_slot(verification, 0x202), CodeVerified | chip8::ProgramSlotComputedJump);
+        CHECK_EQ(get_slot(verification, 0x20A), CodeVerified);
+
+        // Odd targets do nothing and fall through
+        CHECK_EQ(get_slot(verification, 0x206), chip8::ProgramSlotCode | chip8::ProgramSlotComputedJump);
+        CHECK_EQ(get_slot(verification, 0x208), CodeVerified);
+        CHECK_EQ(get_slot(verification, 0x210), CodeVerified);
+        CHECK_EQ(get_slot(verification, 0x212), 0u);
+    }
+
+    SUBCASE("Register ranges")
+    {
+        const u8 program[] = {
+            0x61, 0x05, // 0x200: LD V1, 0x05
+            0xF1, 0x29, // 0x202: LD F, V1
+            0xD1, 0x15, // 0x204: DRW V1, V1, 5
+            0xF0, 0x07, // 0x206: LD V0, DT
+            0xF0, 0x29, // 0x208: LD F, V0
+            0xF0, 0x1E, // 0x20A: ADD I, V0
+            0xD1, 0x15, // 0x20C: DRW V1, V1, 5
+            0xE1, 0xA1, // 0x20E: SKNP V1
+            0xE0, 0x9E, // 0x210: SKP V0
+            0x12, 0x00, // 0x212: JP 0x200
+            0x12, 0x00, // 0x214: JP 0x200
+        };
+
+        verify(program, sizeof(program), verification);
+
+        CHECK_EQ(get_slot(verification, 0x202), CodeVerified);
+        CHECK_EQ(get_slot(verification, 0x204), CodeVerified);
+        CHECK_EQ(get_slot(verification, 0x208), chip8::ProgramSlotCode); // V0 may not be a digit
+        CHECK_EQ(get_slot(verification, 0x20A), CodeVerified);
+        CHECK_EQ(get_slot(verification, 0x20C), CodeVerified); // I is still far from the end of memory
+        CHECK_EQ(get_slot(verification, 0x20E), CodeVerified);
+        CHECK_EQ(get_slot(verification, 0x210), chip8::ProgramSlotCode); // V0 may not be a key
+    }
+
+    SUBCASE("Self-modifying code")
+    {
+        const u8 program[] = {
+            0xA3, 0x00, // 0x200: LD I, 0x300
+            0xF2, 0x33, // 0x202: LD B, V2
+            0xA2, 0x00, // 0x204: LD I, 0x200
+            0xF0, 0x55, // 0x206: LD [I], V0
+            0x12, 0x00, // 0x208: JP 0x200
+        };
+
+        verify(program, sizeof(program), verification);
+
+        CHECK(verification.isSelfModifying);
+        CHECK_EQ(verification.verifiedInstructionCount, 0u);
+        CHECK_EQ(get_slot(verification, 0x200), chip8::ProgramSlotCode | chip8::ProgramSlotOverwritten);
+        CHECK_EQ(get_slot(verification, 0x202), chip8::ProgramSlotCode);
+        CHECK_EQ(get_slot(verification, 0x206), chip8::ProgramSlotCode | chip8::ProgramSlotCodeWrite);
+    }
+
+    SUBCASE("Runs like the checked interpreter")
+    {
+        // Random programs with jumps and I kept in the rom, so that a good part of them gets verified.
+        // Both runs must end in the same state, having tripped the same number of Asserts.
+        static const u16 ProgramSize = 0x80;
+        u64 rngState = 0x9E3779B97F4A7C15;
+        u32 verifiedInstructionCount = 0;
+        u32 divergentProgramCount = 0;
+
+        for (u32 programIndex = 0; programIndex < 256; programIndex++)
+        {
+            u8 program[ProgramSize];
+
+            for (u16 offset = 0; offset < ProgramSize; offset += 2)
+            {
+                u16 instruction = static_cast<u16>(chip8::next_splitmix64(rngState));
+                const u16 offsetInProgram = static_cast<u16>(chip8::next_splitmix64(rngState) % ProgramSize);
+                const u16 address = static_cast<u16>(chip8::MinProgramAddress + offsetInProgram);
+
+                if ((instruction >> 12) == 0x1 || (instruction >> 12) == 0x2 || (instruction >> 12) == 0xA)
+                    instruction = static_cast<u16>((instruction & 0xF000) | (address & ~0x0001));
+
+                program[offset] = static_cast<u8>(instruction >> 8);
+                program[offset + 1] = static_cast<u8>(instruction);
+            }
+
+            chip8::EmuConfig config = {};
+            config.quirkProfile = static_cast<chip8::QuirkProfile>(programIndex % chip8::QuirkProfileCount);
+
+            chip8::CPUState checkedState = chip8::createCPUState();
+            chip8::load_program(checkedState, program, ProgramSize);
+
+            chip8::CPUState verifiedState = chip8::forkCPUState(checkedState);
+
+            chip8::verify_program(verifiedState, config.quirkProfile, verification);
+            verifiedInstructionCount += verification.verifiedInstructionCount;
+
+            u32 checkedAssertCount = 0;
+            u32 verifiedAssertCount = 0;
+
+            for (u32 stepIndex = 0; stepIndex < 32; stepIndex++)
+            {
+                const u16 keyState = static_cast<u16>(chip8::next_splitmix64(rngState));
+
+                chip8::set_key_state(checkedState, keyState);
+                chip8::set_key_state(verifiedState, keyState);
+
+                setAssertHandler(&count_assert, &checkedAssertCount);
+                chip8::execute_step(config, checkedState, 16);
+
+                config.verification = &verification;
+
+                setAssertHandler(&count_assert, &verifiedAssertCount);
+                chip8::execute_step(config, verifiedState, 16);
+
+                config.verification = nullptr;
+            }
+
+            setAssertHandler(nullptr, nullptr);
+
+            if (chip8::find_cpu_state_difference(checkedState, verifiedState) != nullptr
+                || checkedAssertCount != verifiedAssertCount)
+                divergentProgramCount++;
+
+            chip8::destroyCPUState(verifiedState);
+            chip8::destroyCPUState(checkedState);
+        }
+
+        CHECK_EQ(divergentProgramCount, 0u);
+        CHECK_GT(verifiedInstructionCount, 1000u);
+    }
+}
@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest/doctest.h>
+
+#include "chip8/Execution.h"
+#include "chip8/Workload.h"
+
+#include <string>
+
+namespace
+{
+    // Runs one instruction at a time, returns the number executed before halting.
+    u64 run_until_halt(chip8::CPUState& state, const chip8::Workload& workload, u64 maxInstructionCount)
+    {
+        const chip8::EmuConfig config = {};
+
+        while (!chip8::has_workload_halted(state, workload) && state.instructionCount < maxInstructionCount)
+            chip8::execute_step(config, state, chip8::InstructionExecutionPeriodMs);
+
+        return state.instructionCount;
+    }
+}
+
+TEST_CASE("Workload")
+{
+    chip8::CPUState state = chip8::createCPUState();
+    chip8::Workload workload;
+
+    // Crosses the low byte of the loop counter a few times.
+    const u32 IterationCounts[] = {1, 255, 256, 257, 1000};
+
+    for (u32 kindIndex = 0; kindIndex < chip8::WorkloadKindCount; kindIndex++)
+    {
+        const chip8::WorkloadKind kind = static_cast<chip8::WorkloadKind>(kindIndex);
+
+        for (u32 iterationCount : IterationCounts)
+        {
+            chip8::generate_workload(kind, iterationCount, workload);
+            chip8::load_workload(state, workload);
+
+            const u64 instructionCount = run_until_halt(state, workload, 1000000);
+
+            CHECK(chip8::is_workload_final_state(state, workload));
+
+            if (kind != chip8::WorkloadKind::TimerPoll)
+                CHECK_EQ(instructionCount, workload.instructionCount);
+        }
+    }
+
+    SUBCASE("Frame steps")
+    {
+        const chip8::EmuConfig config = {};
+
+        // Several instructions per step, the halt loop must hold the final state.
+        chip8::generate_workload(chip8::WorkloadKind::DeepCalls, 300, workload);
+        chip8::load_workload(state, workload);
+
+        for (u32 step = 0; step < 2000; step++)
+            chip8::execute_step(config, state, 16);
+
+        CHECK(chip8::is_workload_final_state(state, workload));
+    }
+
+    SUBCASE("Names")
+    {
+        CHECK_EQ(std::string(chip8::get_workload_kind_name(chip8::WorkloadKind::SpriteStorm)), "sprite_storm");
+    }
+
+    chip8::destroyCPUState(state);
+}
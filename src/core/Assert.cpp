@@ -30,10 +30,29 @@ inline void breakpoint()
 #endif
 }
 
+namespace
+{
+    thread_local AssertHandler CurrentHandler = nullptr;
+    thread_local void* CurrentHandlerUserData = nullptr;
+}
+
+void setAssertHandler(AssertHandler handler, void* userData)
+{
+    CurrentHandler = handler;
+    CurrentHandlerUserData = userData;
+}
+
 void AssertImpl(const char* file, const char* func, int line, bool condition, const std::string& message)
 {
     if (condition)
         return;
+
+    if (CurrentHandler != nullptr)
+    {
+        CurrentHandler(file, func, line, message, CurrentHandlerUserData);
+        return;
+    }
+
     std::cerr << std::dec << "ASSERT FAILED " << file << ':' << line << ": in '" << func << "'" << std::endl;
     if (isInDebugger())
         breakpoint();
@@ -14,5 +14,12 @@
 CHIP8EMU_CORE_API void AssertImpl(const char* file, const char* func, int line, bool condition,
                                   const std::string& message = std::string());
 
+// Replaces the default report (message, stack trace and debugger break) on the calling thread,
+// e.g. to collect failures while fuzzing. Pass nullptr to restore the default one.
+// Execution carries on after the handler returns, like it does after the default report.
+using AssertHandler = void (*)(const char* file, const char* func, int line, const std::string& message, void* userData);
+
+CHIP8EMU_CORE_API void setAssertHandler(AssertHandler handler, void* userData);
+
 #define Assert(...) AssertImpl(__FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
 #define AssertUnreachable() AssertImpl(__FILE__, __FUNCTION__, __LINE__, false, "unreachable")
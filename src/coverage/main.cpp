@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/Types.h"
+
+#include "chip8/Coverage.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Usage: chip8emu_coverage [--output <path>] [--min <percent>] <rom> <coverage>...
+// Merges coverage files (chip8emu --coverage) and prints them over a disassembly of the rom.
+// --output saves the merged coverage, --min fails when fewer instructions than that ran.
+// Exits with 0 on success, 1 if the coverage is below --min and 2 on error.
+namespace
+{
+    bool load_rom(const char* path, std::vector<u8>& rom)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file)
+            return false;
+
+        rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        return !rom.empty() && rom.size() <= chip8::MemorySizeInBytes - chip8::MinProgramAddress;
+    }
+}
+
+int main(int ac, char** av)
+{
+    const char* outputPath = nullptr;
+    const char* programPath = nullptr;
+    std::vector<const char*> coveragePaths;
+    f64 minPercentage = 0.0;
+
+    for (int argIndex = 1; argIndex < ac; argIndex++)
+    {
+        if (std::strcmp(av[argIndex], "--output") == 0 && argIndex + 1 < ac)
+            outputPath = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--min") == 0 && argIndex + 1 < ac)
+            minPercentage = std::strtod(av[++argIndex], nullptr);
+        else if (programPath == nullptr)
+            programPath = av[argIndex];
+        else
+            coveragePaths.push_back(av[argIndex]);
+    }
+
+    if (programPath == nullptr || coveragePaths.empty())
+    {
+        std::cerr << "usage: " << av[0] << " [--output <path>] [--min <percent>] <rom> <coverage>..." << std::endl;
+        return 2;
+    }
+
+    std::vector<u8> rom;
+
+    if (!load_rom(programPath, rom))
+    {
+        std::cerr << "error: could not load " << programPath << std::endl;
+        return 2;
+    }
+
+    chip8::CodeCoverage coverage;
+    chip8::clear_code_coverage(coverage);
+
+    for (const char* coveragePath : coveragePaths)
+    {
+        chip8::CodeCoverage runCoverage;
+        const chip8::CodeCoverageError error = chip8::load_code_coverage_from_file(runCoverage, coveragePath);
+
+        if (error != chip8::CodeCoverageError::None)
+        {
+            std::cerr << "error: could not load " << coveragePath << ": " << chip8::get_code_coverage_error_string(error)
+                      << std::endl;
+            return 2;
+        }
+
+        chip8::merge_code_coverage(coverage, runCoverage);
+    }
+
+    const u16 programSize = static_cast<u16>(rom.size());
+
+    chip8::write_code_coverage_report(std::cout, coverage, rom.data(), programSize);
+
+    if (outputPath != nullptr)
+    {
+        const chip8::CodeCoverageError error = chip8::save_code_coverage_to_file(coverage, outputPath);
+
+        if (error != chip8::CodeCoverageError::None)
+        {
+            std::cerr << "error: could not save " << outputPath << ": " << chip8::get_code_coverage_error_string(error)
+                      << std::endl;
+            return 2;
+        }
+    }
+
+    const chip8::CodeCoverageSummary summary = chip8::get_code_coverage_summary(coverage, rom.data(), programSize);
+
+    if (static_cast<f64>(summary.executedInstructionCount) * 100.0 < minPercentage * summary.instructionCount)
+    {
+        std::cerr << "error: instruction coverage below " << minPercentage << "%" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/Types.h"
+
+#include "chip8/DiffFuzz.h"
+#include "chip8/ThreadPool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Usage: chip8emu_difffuzz [--candidate <engine>] [--reference <engine>] [--seed <n>] [--cases <n>]
+//                          [--steps <n>] [--threads <n>] [--save <path>] [--list]
+// Runs random instruction streams through both engines and compares their states after every step.
+// Divergent cases are minimized, printed as doctest regressions and appended to the --save file,
+// usually src/chip8/test/difffuzz_regressions.inc
+// --threads is the number of workers besides the main thread, 0 picks one per hardware thread.
+// Exits with 0 if the engines agree, 1 if they diverge and 2 on error.
+namespace
+{
+    static const u32 DefaultCaseCount = 1024;
+    static const u32 DefaultStepCount = 1000;
+
+    void print_engines()
+    {
+        for (u32 engineIndex = 0; engineIndex < chip8::get_execution_engine_count(); engineIndex++)
+            std::cout << chip8::get_execution_engine(engineIndex).name << std::endl;
+    }
+}
+
+int main(int ac, char** av)
+{
+    const char* referenceName = chip8::get_execution_engine(0).name;
+    const char* candidateName = chip8::get_execution_engine(chip8::get_execution_engine_count() - 1).name;
+    const char* savePath = nullptr;
+    u64 seed = 0;
+    u32 caseCount = DefaultCaseCount;
+    u32 stepCount = DefaultStepCount;
+    u32 threadCount = 0;
+
+    for (int argIndex = 1; argIndex < ac; argIndex++)
+    {
+        if (std::strcmp(av[argIndex], "--candidate") == 0 && argIndex + 1 < ac)
+            candidateName = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--reference") == 0 && argIndex + 1 < ac)
+            referenceName = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--seed") == 0 && argIndex + 1 < ac)
+            seed = std::strtoull(av[++argIndex], nullptr, 0);
+        else if (std::strcmp(av[argIndex], "--cases") == 0 && argIndex + 1 < ac)
+            caseCount = static_cast<u32>(std::strtoul(av[++argIndex], nullptr, 0));
+        else if (std::strcmp(av[argIndex], "--steps") == 0 && argIndex + 1 < ac)
+            stepCount = static_cast<u32>(std::strtoul(av[++argIndex], nullptr, 0));
+        else if (std::strcmp(av[argIndex], "--threads") == 0 && argIndex + 1 < ac)
+            threadCount = static_cast<u32>(std::strtoul(av[++argIndex], nullptr, 0));
+        else if (std::strcmp(av[argIndex], "--save") == 0 && argIndex + 1 < ac)
+            savePath = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--list") == 0)
+        {
+            print_engines();
+            return 0;
+        }
+        else
+        {
+            std::cerr << "error: unknown argument '" << av[argIndex] << "'" << std::endl;
+            return 2;
+        }
+    }
+
+    const chip8::ExecutionEngine* reference = chip8::find_execution_engine(referenceName);
+    const chip8::ExecutionEngine* candidate = chip8::find_execution_engine(candidateName);
+
+    if (reference == nullptr || candidate == nullptr)
+    {
+        std::cerr << "error: unknown engine '" << (reference == nullptr ? referenceName : candidateName)
+                  << "', available engines:" << std::endl;
+        print_engines();
+        return 2;
+    }
+
+    if (reference == candidate)
+        std::cout << "warning: comparing " << reference->name << " against itself" << std::endl;
+
+    const chip8::EmuConfig config = {};
+    chip8::ThreadPool* pool = chip8::createThreadPool(threadCount);
+    chip8::DiffFuzzReport report;
+
+    chip8::run_diff_fuzzer(*pool, config, *reference, *candidate, seed, caseCount, stepCount, report);
+
+    chip8::destroyThreadPool(pool);
+
+    std::cout << reference->name << " vs " << candidate->name << ": " << report.caseCount << " cases, "
+              << report.stepCount << " steps, " << report.findings.size() << " divergent" << std::endl;
+
+    if (report.findings.empty())
+        return 0;
+
+    for (const chip8::DiffFuzzFinding& finding : report.findings)
+    {
+        std::cout << std::endl;
+        chip8::write_diff_fuzz_regression(std::cout, finding, *reference, *candidate);
+    }
+
+    if (savePath != nullptr)
+    {
+        std::ofstream file(savePath, std::ios::app);
+
+        for (const chip8::DiffFuzzFinding& finding : report.findings)
+        {
+            file << "\n";
+            chip8::write_diff_fuzz_regression(file, finding, *reference, *candidate);
+        }
+
+        if (!file)
+        {
+            std::cerr << "error: could not write " << savePath << std::endl;
+            return 2;
+        }
+
+        std::cout << std::endl << report.findings.size() << " regression(s) appended to " << savePath << std::endl;
+    }
+
+    return 1;
+}
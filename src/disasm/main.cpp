@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/Types.h"
+
+#include "chip8/ControlFlow.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Usage: chip8emu_disasm [--quirks <profile>] [--dot] <rom>
+// Disassembles the rom along its control flow graph: basic blocks, subroutines and what they call.
+// --quirks picks how Bnnn reads its register, like chip8emu --quirks.
+// --dot prints the graph for Graphviz instead, e.g. chip8emu_disasm --dot game.ch8 | dot -Tsvg > game.svg
+// Exits with 0 on success and 2 on error.
+namespace
+{
+    bool load_rom(const char* path, std::vector<u8>& rom)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file)
+            return false;
+
+        rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        return !rom.empty() && rom.size() <= chip8::MemorySizeInBytes - chip8::MinProgramAddress;
+    }
+}
+
+int main(int ac, char** av)
+{
+    const char* programPath = nullptr;
+    const char* quirkProfileName = nullptr;
+    bool writeDot = false;
+
+    for (int argIndex = 1; argIndex < ac; argIndex++)
+    {
+        if (std::strcmp(av[argIndex], "--quirks") == 0 && argIndex + 1 < ac)
+            quirkProfileName = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--dot") == 0)
+            writeDot = true;
+        else if (programPath == nullptr)
+            programPath = av[argIndex];
+    }
+
+    if (programPath == nullptr)
+    {
+        std::cerr << "usage: " << av[0] << " [--quirks <profile>] [--dot] <rom>" << std::endl;
+        return 2;
+    }
+
+    chip8::QuirkProfile quirkProfile = chip8::QuirkProfile::Default;
+
+    if (quirkProfileName != nullptr && !chip8::find_quirk_profile(quirkProfileName, quirkProfile))
+    {
+        std::cerr << "error: unknown quirk profile '" << quirkProfileName << "'" << std::endl;
+        return 2;
+    }
+
+    std::vector<u8> rom;
+
+    if (!load_rom(programPath, rom))
+    {
+        std::cerr << "error: could not load " << programPath << std::endl;
+        return 2;
+    }
+
+    const u16 programSize = static_cast<u16>(rom.size());
+
+    chip8::ControlFlowGraph graph;
+    chip8::build_control_flow_graph(graph, rom.data(), programSize, quirkProfile);
+
+    if (writeDot)
+        chip8::write_control_flow_dot(std::cout, graph, rom.data(), programSize);
+    else
+        chip8::write_control_flow_listing(std::cout, graph, rom.data(), programSize);
+
+    return 0;
+}
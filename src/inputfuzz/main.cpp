@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/Types.h"
+
+#include "chip8/InputFuzz.h"
+#include "chip8/Opcode.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Usage: chip8emu_inputfuzz [--runs <n>] [--frames <n>] [--seed <n>] [--mutation-seed <n>] [--output <dir>] <rom>
+// Looks for keypad inputs that make the rom trip an Assert: stack over/underflows, jumps or memory accesses
+// outside of the program, invalid opcodes...
+// Every distinct failure gets printed, and saved as <dir>/<kind>_<pc>.c8il with --output, replay it with
+// chip8emu --replay. --seed is the RND seed the rom runs with, like chip8emu --seed.
+// Exits with 0 if nothing was found, 1 if the rom failed and 2 on error.
+namespace
+{
+    static const u32 DefaultRunCount = 100000;
+    static const u32 DefaultFrameCount = 60 * 60;
+    static const unsigned int FrameTimeMs = 16;
+
+    // Progress gets printed between batches.
+    static const u32 RunBatchSize = 10000;
+
+    bool load_rom(const char* path, std::vector<u8>& rom)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file)
+            return false;
+
+        rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        // Programs are loaded in whole instructions.
+        if (rom.size() % 2 != 0)
+            rom.push_back(0);
+
+        return !rom.empty() && rom.size() <= chip8::MemorySizeInBytes - chip8::MinProgramAddress;
+    }
+
+    void print_stats(const chip8::InputFuzzStats& stats, f64 elapsedSeconds)
+    {
+        std::cout << stats.runCount << " runs, " << stats.instructionCount << " instructions ("
+                  << std::fixed << std::setprecision(1) << static_cast<f64>(stats.instructionCount) / elapsedSeconds / 1e6
+                  << "M/s), corpus " << stats.corpusSize << ", " << stats.coveredEdgeCount << " edges" << std::endl;
+    }
+
+    void print_failure(const chip8::InputFuzzFailure& failure)
+    {
+        std::cout << "failure: " << chip8::get_input_fuzz_failure_kind_name(failure.kind) << " pc 0x" << std::hex
+                  << std::setfill('0') << std::setw(3) << failure.pc << " instruction 0x" << std::setw(4)
+                  << failure.instruction << std::dec << std::setfill(' ');
+
+        if (failure.instruction != 0)
+            std::cout << " (" << chip8::get_opcode_class_name(chip8::get_opcode_class(failure.instruction)) << ")";
+
+        std::cout << " frame " << failure.frameIndex << " instruction count " << failure.instructionCount
+                  << " assert " << failure.file << ':' << failure.line << std::endl;
+    }
+}
+
+int main(int ac, char** av)
+{
+    const char* programPath = nullptr;
+    const char* outputPath = nullptr;
+    chip8::InputFuzzConfig config = {DefaultFrameCount, FrameTimeMs, 0, 0};
+    u32 runCount = DefaultRunCount;
+
+    for (int argIndex = 1; argIndex < ac; argIndex++)
+    {
+        if (std::strcmp(av[argIndex], "--runs") == 0 && argIndex + 1 < ac)
+            runCount = static_cast<u32>(std::strtoul(av[++argIndex], nullptr, 0));
+        else if (std::strcmp(av[argIndex], "--frames") == 0 && argIndex + 1 < ac)
+            config.frameCount = static_cast<u32>(std::strtoul(av[++argIndex], nullptr, 0));
+        else if (std::strcmp(av[argIndex], "--seed") == 0 && argIndex + 1 < ac)
+            config.randomSeed = std::strtoull(av[++argIndex], nullptr, 0);
+        else if (std::strcmp(av[argIndex], "--mutation-seed") == 0 && argIndex + 1 < ac)
+            config.mutationSeed = std::strtoull(av[++argIndex], nullptr, 0);
+        else if (std::strcmp(av[argIndex], "--output") == 0 && argIndex + 1 < ac)
+            outputPath = av[++argIndex];
+        else
+            programPath = av[argIndex];
+    }
+
+    if (programPath == nullptr || config.frameCount == 0)
+    {
+        std::cerr << "usage: " << av[0]
+                  << " [--runs <n>] [--frames <n>] [--seed <n>] [--mutation-seed <n>] [--output <dir>] <rom>"
+                  << std::endl;
+        return 2;
+    }
+
+    std::vector<u8> rom;
+
+    if (!load_rom(programPath, rom))
+    {
+        std::cerr << "error: could not load " << programPath << std::endl;
+        return 2;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    chip8::InputFuzzer* fuzzer = chip8::createInputFuzzer(rom.data(), static_cast<u16>(rom.size()), config);
+
+    for (u32 runIndex = 0; runIndex < runCount; runIndex += RunBatchSize)
+    {
+        chip8::run_input_fuzzer(*fuzzer, std::min(RunBatchSize, runCount - runIndex));
+
+        const std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - start;
+        print_stats(chip8::get_input_fuzzer_stats(*fuzzer), elapsed.count());
+    }
+
+    const std::vector<chip8::InputFuzzFailure>& failures = chip8::get_input_fuzzer_failures(*fuzzer);
+    int result = failures.empty() ? 0 : 1;
+
+    for (const chip8::InputFuzzFailure& failure : failures)
+    {
+        print_failure(failure);
+
+        if (outputPath == nullptr)
+            continue;
+
+        std::ostringstream logPath;
+        logPath << outputPath << '/' << chip8::get_input_fuzz_failure_kind_name(failure.kind) << "_" << std::hex
+                << failure.pc << ".c8il";
+
+        chip8::InputLog log;
+
+        if (!chip8::record_input_fuzz_failure(*fuzzer, failure, log))
+        {
+            std::cerr << "warning: " << logPath.str() << " does not reproduce" << std::endl;
+            continue;
+        }
+
+        const chip8::InputLogError error = chip8::save_input_log_to_file(log, logPath.str().c_str());
+
+        if (error != chip8::InputLogError::None)
+        {
+            std::cerr << "error: could not save " << logPath.str() << ": " << chip8::get_input_log_error_string(error)
+                      << std::endl;
+            result = 2;
+        }
+    }
+
+    chip8::destroyInputFuzzer(fuzzer);
+
+    return result;
+}
@@ -5,40 +5,161 @@
 /// This file is distributed under the MIT License
 ////////////////////////////////////////////////////////////////////////////////
 
-#include "core/Assert.h"
 #include "core/Types.h"
 
 #include "chip8/Config.h"
+#include "chip8/Coverage.h"
 #include "chip8/Cpu.h"
 #include "chip8/Execution.h"
+#include "chip8/InputLog.h"
+#include "chip8/InstructionTrace.h"
+#include "chip8/OpcodeStats.h"
+#include "chip8/Profiler.h"
+#include "chip8/Quirks.h"
+#include "chip8/SaveState.h"
+#include "chip8/Trace.h"
+#include "chip8/Verifier.h"
 
 #include "sdl2/SDL2Backend.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <vector>
 
+// Usage: chip8emu [--seed <n>] [--quirks <profile>] [--unchecked | --verify] [--record <input log> | --replay <input log>] [--opcode-stats] [--profile <folded stacks>] [--trace <json>]
+//                [--instruction-trace <path>] [--coverage <path>] <rom>
+// Replays run headless and print a checksum of the final state, handy for regression runs.
+// They use the seed stored in the log.
+// --quirks picks the interpreter the rom was written for: default, cosmac, schip or xochip.
+// Logs don't store it, replay with the profile used for recording.
+// --unchecked drops the runtime checks of the interpreter, only use it for roms known to behave.
+// --verify analyzes the rom when loading it, instructions proven safe then run without runtime checks.
+// --opcode-stats prints what the rom spent its time on at exit, it needs an instrumented build.
+// --profile prints the rom's hotspots at exit and writes its call stacks for flame graph tools.
+// --trace writes a timeline of the frame phases, open it in chrome://tracing or Perfetto.
+// --instruction-trace records every executed instruction, compare two runs with chip8emu_tracediff.
+// --coverage merges the code coverage of the run into the file, print it with chip8emu_coverage.
 int main(int ac, char** av)
 {
-    if (ac != 2)
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    const char* programPath = nullptr;
+    u64 randomSeed = 0;
+    const char* quirkProfileName = nullptr;
+    const char* profilePath = nullptr;
+    const char* tracePath = nullptr;
+    const char* instructionTracePath = nullptr;
+    const char* coveragePath = nullptr;
+    bool printOpcodeStats = false;
+    bool unchecked = false;
+    bool verifyProgram = false;
+
+    for (int argIndex = 1; argIndex < ac; argIndex++)
+    {
+        if (std::strcmp(av[argIndex], "--record") == 0 && argIndex + 1 < ac)
+            recordPath = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--replay") == 0 && argIndex + 1 < ac)
+            replayPath = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--seed") == 0 && argIndex + 1 < ac)
+            randomSeed = std::strtoull(av[++argIndex], nullptr, 0);
+        else if (std::strcmp(av[argIndex], "--quirks") == 0 && argIndex + 1 < ac)
+            quirkProfileName = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--unchecked") == 0)
+            unchecked = true;
+        else if (std::strcmp(av[argIndex], "--verify") == 0)
+            verifyProgram = true;
+        else if (std::strcmp(av[argIndex], "--opcode-stats") == 0)
+            printOpcodeStats = true;
+        else if (std::strcmp(av[argIndex], "--profile") == 0 && argIndex + 1 < ac)
+            profilePath = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--trace") == 0 && argIndex + 1 < ac)
+            tracePath = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--instruction-trace") == 0 && argIndex + 1 < ac)
+            instructionTracePath = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--coverage") == 0 && argIndex + 1 < ac)
+            coveragePath = av[++argIndex];
+        else
+            programPath = av[argIndex];
+    }
+
+    if (programPath == nullptr)
     {
         std::cerr << "error: missing rom file" << std::endl;
         return 1;
     }
 
+    if (recordPath != nullptr && replayPath != nullptr)
+    {
+        std::cerr << "error: can't record and replay at the same time" << std::endl;
+        return 1;
+    }
+
+    if (unchecked && verifyProgram)
+    {
+        std::cerr << "error: can't run unchecked and verify at the same time" << std::endl;
+        return 1;
+    }
+
+    if (printOpcodeStats)
+        chip8::set_full_opcode_stats_enabled(true);
+
+    if (tracePath != nullptr)
+        chip8::start_tracing();
+
     chip8::EmuConfig config = {};
     config.debugMode = true;
     config.palette.primary = { 1.f, 1.f, 1.f };
     config.palette.secondary = { 0.14f, 0.14f, 0.14f };
     config.screenScale = 8;
+    config.randomSeed = randomSeed;
+    config.quirkProfile = chip8::QuirkProfile::Default;
+    config.executionPolicy = unchecked ? chip8::ExecutionPolicy::Unchecked : chip8::ExecutionPolicy::Checked;
+
+    if (quirkProfileName != nullptr && !chip8::find_quirk_profile(quirkProfileName, config.quirkProfile))
+    {
+        std::cerr << "error: unknown quirk profile '" << quirkProfileName << "'" << std::endl;
+        return 1;
+    }
+
+    config.instructionTrace = nullptr;
+
+    if (instructionTracePath != nullptr)
+    {
+        config.instructionTrace = chip8::createInstructionTraceWriter(instructionTracePath);
+
+        if (config.instructionTrace == nullptr)
+        {
+            std::cerr << "error: could not open " << instructionTracePath << std::endl;
+            return 1;
+        }
+    }
+
+    config.profiler = profilePath != nullptr ? chip8::createProfiler() : nullptr;
+
+    chip8::CodeCoverage coverage;
+    chip8::clear_code_coverage(coverage);
+    config.coverage = coveragePath != nullptr ? &coverage : nullptr;
+
+    if (coveragePath != nullptr)
+    {
+        // Accumulate over runs, a missing file just starts empty.
+        const chip8::CodeCoverageError error = chip8::load_code_coverage_from_file(coverage, coveragePath);
+
+        if (error != chip8::CodeCoverageError::None && error != chip8::CodeCoverageError::IOError)
+        {
+            std::cerr << "error: could not load " << coveragePath << ": "
+                      << chip8::get_code_coverage_error_string(error) << std::endl;
+            return 1;
+        }
+    }
 
     chip8::CPUState state = chip8::createCPUState();
+    chip8::seed_random_generator(state, config.randomSeed);
 
     // Load program in chip8 memory
     {
-        const char* programPath = av[1];
-        Assert(programPath != nullptr);
-
         std::cout << "[INFO] loading program: " << programPath << std::endl;
 
         std::ifstream programFile(programPath, std::ios::binary | std::ios::ate);
@@ -56,9 +177,122 @@ int main(int ac, char** av)
         chip8::load_program(state, reinterpret_cast<const u8*>(programContent.data()), programSizeInBytes);
     }
 
-    sdl2::execute_main_loop(state, config);
+    chip8::ProgramVerification verification;
+    config.verification = nullptr;
+
+    if (verifyProgram)
+    {
+        chip8::verify_program(state, config.quirkProfile, verification);
+        config.verification = &verification;
+
+        std::cout << "[INFO] verified " << verification.verifiedInstructionCount << "/"
+                  << verification.codeInstructionCount << " reachable instructions" << std::endl;
+
+        if (verification.isSelfModifying)
+            std::cout << "[INFO] the rom may write over its own code, it runs fully checked" << std::endl;
+    }
+
+    int result = 0;
+
+    if (replayPath != nullptr)
+    {
+        chip8::InputLog inputLog = {};
+        chip8::InputLogError error = chip8::load_input_log_from_file(inputLog, replayPath);
+
+        if (error == chip8::InputLogError::None)
+        {
+            chip8::seed_random_generator(state, inputLog.randomSeed);
+            error = chip8::replay_input_log(config, state, inputLog);
+        }
+
+        if (error == chip8::InputLogError::None)
+        {
+            chip8::SaveState saveState;
+            chip8::save_state(state, saveState);
+
+            std::cout << "[INFO] replayed " << inputLog.frameCount << " frames, " << state.instructionCount
+                      << " instructions" << std::endl;
+            std::cout << "[INFO] final state checksum: 0x" << std::hex << saveState.header.payloadChecksum << std::dec
+                      << std::endl;
+        }
+        else
+        {
+            std::cerr << "error: replay failed: " << chip8::get_input_log_error_string(error) << std::endl;
+            result = 1;
+        }
+    }
+    else if (recordPath != nullptr)
+    {
+        chip8::InputLog inputLog = {};
+        inputLog.randomSeed = config.randomSeed;
+
+        sdl2::execute_main_loop(state, config, &inputLog);
+
+        const chip8::InputLogError error = chip8::save_input_log_to_file(inputLog, recordPath);
+
+        if (error != chip8::InputLogError::None)
+        {
+            std::cerr << "error: could not save input log: " << chip8::get_input_log_error_string(error) << std::endl;
+            result = 1;
+        }
+    }
+    else
+        sdl2::execute_main_loop(state, config);
 
     chip8::destroyCPUState(state);
 
-    return 0;
+    if (config.instructionTrace != nullptr)
+    {
+        const chip8::InstructionTraceError error = chip8::destroyInstructionTraceWriter(config.instructionTrace);
+
+        if (error != chip8::InstructionTraceError::None)
+        {
+            std::cerr << "error: could not write instruction trace: " << chip8::get_instruction_trace_error_string(error)
+                      << std::endl;
+            result = 1;
+        }
+    }
+
+    if (coveragePath != nullptr)
+    {
+        const chip8::CodeCoverageError error = chip8::save_code_coverage_to_file(coverage, coveragePath);
+
+        if (error != chip8::CodeCoverageError::None)
+        {
+            std::cerr << "error: could not save coverage: " << chip8::get_code_coverage_error_string(error) << std::endl;
+            result = 1;
+        }
+    }
+
+    if (tracePath != nullptr)
+    {
+        chip8::stop_tracing();
+
+        if (!chip8::save_trace_to_file(tracePath))
+        {
+            std::cerr << "error: could not write trace to " << tracePath << std::endl;
+            result = 1;
+        }
+    }
+
+    if (printOpcodeStats)
+        chip8::print_opcode_stats(std::cout);
+
+    if (config.profiler != nullptr)
+    {
+        chip8::print_profiler_report(*config.profiler, std::cout, 16);
+
+        std::ofstream profileFile(profilePath);
+        chip8::write_folded_stacks(*config.profiler, profileFile);
+
+        if (!profileFile)
+        {
+            std::cerr << "error: could not write profile to " << profilePath << std::endl;
+            result = 1;
+        }
+
+        chip8::destroyProfiler(config.profiler);
+    }
+
+    return result;
 }
@@ -0,0 +1,293 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/Types.h"
+
+#include "chip8/Config.h"
+#include "chip8/Display.h"
+#include "chip8/Execution.h"
+#include "chip8/Workload.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Usage: chip8emu_perftests --baseline <path> [--tolerance <percent>] [--update-baseline]
+// Runs the synthetic workloads and the frame conversion, then compares the medians against the baseline.
+// Exits with 1 on regression, and with SkipExitCode when the baseline does not exist yet.
+// --update-baseline writes the current measurements instead, run it on an idle machine.
+//
+// Baseline format, one metric per line: <name> <value> [tolerance percent], '#' starts a comment.
+namespace
+{
+    // ctest reports the test as skipped, see SKIP_RETURN_CODE.
+    static const int SkipExitCode = 77;
+
+    static const f64 DefaultTolerancePercent = 15.0;
+
+    static const u32 WarmupRunCount = 2;
+    static const u32 MeasuredRunCount = 9;
+
+    // Long enough for the timer resolution not to matter.
+    static const f64 MinRunDurationSeconds = 0.05;
+
+    static const u32 WorkloadIterationCount = 4096;
+    static const unsigned int StepTimeMs = 16;
+    static const unsigned int FrameConversionScale = 8;
+
+    struct Metric
+    {
+        std::string name;
+        f64 value;
+        bool isHigherBetter;
+    };
+
+    struct BaselineEntry
+    {
+        std::string name;
+        f64 value;
+        f64 tolerancePercent;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // Median of several runs, each one repeating the function until it lasts long enough.
+    // Returns the median time per call in seconds.
+    template <typename Function>
+    f64 measure_median_seconds(Function&& function)
+    {
+        for (u32 run = 0; run < WarmupRunCount; run++)
+            function();
+
+        std::vector<f64> samples;
+
+        for (u32 run = 0; run < MeasuredRunCount; run++)
+        {
+            u64 callCount = 0;
+            const Clock::time_point start = Clock::now();
+            std::chrono::duration<f64> elapsed(0.0);
+
+            while (elapsed.count() < MinRunDurationSeconds)
+            {
+                function();
+                callCount++;
+                elapsed = Clock::now() - start;
+            }
+
+            samples.push_back(elapsed.count() / static_cast<f64>(callCount));
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        return samples[samples.size() / 2];
+    }
+
+    void measure_workloads(std::vector<Metric>& metrics)
+    {
+        const chip8::EmuConfig config = {};
+        chip8::CPUState state = chip8::createCPUState();
+        chip8::Workload workload;
+
+        for (u32 kindIndex = 0; kindIndex < chip8::WorkloadKindCount; kindIndex++)
+        {
+            const chip8::WorkloadKind kind = static_cast<chip8::WorkloadKind>(kindIndex);
+
+            chip8::generate_workload(kind, WorkloadIterationCount, workload);
+
+            const auto runWorkload = [&] {
+                chip8::load_workload(state, workload);
+
+                while (!chip8::has_workload_halted(state, workload))
+                    chip8::execute_step(config, state, StepTimeMs);
+            };
+
+            // Runs are deterministic, count the instructions once.
+            runWorkload();
+
+            if (!chip8::is_workload_final_state(state, workload))
+                std::cerr << "warning: " << chip8::get_workload_kind_name(kind) << " ended in the wrong state" << std::endl;
+
+            const u64 instructionsPerRun = state.instructionCount;
+            const f64 secondsPerRun = measure_median_seconds(runWorkload);
+
+            metrics.push_back({std::string(chip8::get_workload_kind_name(kind)) + "_instructions_per_second",
+                               static_cast<f64>(instructionsPerRun) / secondsPerRun, true});
+        }
+
+        chip8::destroyCPUState(state);
+    }
+
+    void measure_frame_conversion(std::vector<Metric>& metrics)
+    {
+        chip8::CPUState state = chip8::createCPUState();
+        const chip8::Palette palette = {{1.f, 1.f, 1.f}, {0.14f, 0.14f, 0.14f}};
+
+        // Checkerboard, so that both colors get written.
+        for (u32 y = 0; y < chip8::ScreenHeight; y++)
+        {
+            for (u32 x = 0; x < chip8::ScreenWidth; x++)
+                chip8::write_screen_pixel(state, x, y, static_cast<u8>((x + y) & 1));
+        }
+
+        std::vector<u8> image(chip8::ScreenWidth * chip8::ScreenHeight * FrameConversionScale * FrameConversionScale * 4);
+
+        const f64 secondsPerFrame = measure_median_seconds(
+            [&] { chip8::fill_image_buffer(image.data(), state, palette, FrameConversionScale); });
+
+        metrics.push_back({"fill_image_buffer_x8_ns", secondsPerFrame * 1e9, false});
+
+        chip8::destroyCPUState(state);
+    }
+
+    bool load_baseline(const char* path, f64 defaultTolerancePercent, std::vector<BaselineEntry>& entries)
+    {
+        std::ifstream file(path);
+
+        if (!file)
+            return false;
+
+        std::string line;
+
+        while (std::getline(file, line))
+        {
+            line = line.substr(0, line.find('#'));
+
+            std::istringstream lineStream(line);
+            BaselineEntry entry = {"", 0.0, defaultTolerancePercent};
+
+            if (lineStream >> entry.name >> entry.value)
+            {
+                lineStream >> entry.tolerancePercent;
+                entries.push_back(entry);
+            }
+        }
+
+        return true;
+    }
+
+    bool save_baseline(const char* path, const std::vector<Metric>& metrics)
+    {
+        std::ofstream file(path);
+
+        file << "# chip8emu_perftests baseline, regenerate with --update-baseline\n";
+        file << "# <name> <value> [tolerance percent]\n";
+        file << std::setprecision(6) << std::scientific;
+
+        for (const Metric& metric : metrics)
+            file << metric.name << ' ' << metric.value << '\n';
+
+        return static_cast<bool>(file);
+    }
+
+    // Returns the number of regressions.
+    u32 compare_with_baseline(const std::vector<Metric>& metrics, const std::vector<BaselineEntry>& baseline)
+    {
+        u32 regressionCount = 0;
+
+        std::cout << std::left << std::setw(40) << "metric" << std::right << std::setw(16) << "baseline" << std::setw(16)
+                  << "current" << std::setw(10) << "delta" << std::setw(10) << "allowed" << "  status" << std::endl;
+
+        for (const Metric& metric : metrics)
+        {
+            const auto it = std::find_if(baseline.begin(), baseline.end(),
+                                         [&metric](const BaselineEntry& entry) { return entry.name == metric.name; });
+
+            std::cout << std::left << std::setw(40) << metric.name << std::right << std::fixed << std::setprecision(1);
+
+            if (it == baseline.end())
+            {
+                std::cout << std::setw(16) << "-" << std::setw(16) << metric.value << std::setw(10) << "-"
+                          << std::setw(10) << "-" << "  no baseline" << std::endl;
+                continue;
+            }
+
+            // Positive deltas are always improvements.
+            const f64 deltaPercent = 100.0 * (metric.value - it->value) / it->value * (metric.isHigherBetter ? 1.0 : -1.0);
+            const bool hasRegressed = deltaPercent < -it->tolerancePercent;
+
+            std::cout << std::setw(16) << it->value << std::setw(16) << metric.value << std::showpos << std::setw(9)
+                      << deltaPercent << '%' << std::noshowpos << std::setw(8) << "-" << it->tolerancePercent << '%'
+                      << (hasRegressed ? "  REGRESSED" : "  ok") << std::endl;
+
+            if (hasRegressed)
+                regressionCount++;
+        }
+
+        return regressionCount;
+    }
+}
+
+int main(int ac, char** av)
+{
+    const char* baselinePath = nullptr;
+    f64 tolerancePercent = DefaultTolerancePercent;
+    bool shouldUpdateBaseline = false;
+
+    for (int argIndex = 1; argIndex < ac; argIndex++)
+    {
+        if (std::strcmp(av[argIndex], "--baseline") == 0 && argIndex + 1 < ac)
+            baselinePath = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--tolerance") == 0 && argIndex + 1 < ac)
+            tolerancePercent = std::strtod(av[++argIndex], nullptr);
+        else if (std::strcmp(av[argIndex], "--update-baseline") == 0)
+            shouldUpdateBaseline = true;
+        else
+        {
+            std::cerr << "error: unknown argument '" << av[argIndex] << "'" << std::endl;
+            return 2;
+        }
+    }
+
+    if (baselinePath == nullptr)
+    {
+        std::cerr << "error: missing --baseline" << std::endl;
+        return 2;
+    }
+
+    std::vector<BaselineEntry> baseline;
+    const bool hasBaseline = load_baseline(baselinePath, tolerancePercent, baseline);
+
+    if (!hasBaseline && !shouldUpdateBaseline)
+    {
+        std::cout << "no baseline at " << baselinePath << ", create it with --update-baseline" << std::endl;
+        return SkipExitCode;
+    }
+
+    std::vector<Metric> metrics;
+
+    measure_workloads(metrics);
+    measure_frame_conversion(metrics);
+
+    if (shouldUpdateBaseline)
+    {
+        if (!save_baseline(baselinePath, metrics))
+        {
+            std::cerr << "error: could not write " << baselinePath << std::endl;
+            return 2;
+        }
+
+        std::cout << "baseline written to " << baselinePath << std::endl;
+        return 0;
+    }
+
+    const u32 regressionCount = compare_with_baseline(metrics, baseline);
+
+    if (regressionCount > 0)
+    {
+        std::cout << regressionCount << " metric(s) regressed beyond their tolerance" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/Types.h"
+
+#include "chip8/Recompiler.h"
+#include "chip8/Workload.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Usage: chip8emu_recompile [--quirks <profile>] [--name <identifier>] <rom> | --workload <kind> <output.cpp>
+// Translates the rom to C++, to be compiled along with runner.cpp into a binary that only runs that rom.
+// The build does it for every entry of CHIP8EMU_RECOMPILED_ROMS and CHIP8EMU_RECOMPILED_WORKLOADS,
+// see CMakeLists.txt.
+// --quirks must be the profile the rom runs with, like chip8emu --quirks.
+// --name is a C++ identifier for the rom, "rom" by default.
+// --workload generates the rom instead, see chip8/Workload.h for the kinds.
+// Exits with 0 on success and 2 on error.
+namespace
+{
+    // Short enough for the runner tests to reach the halt loop, so that every block gets executed.
+    static const u32 WorkloadIterationCount = 64;
+
+    bool generate_workload_rom(const char* kindName, std::vector<u8>& rom)
+    {
+        for (u32 kindIndex = 0; kindIndex < chip8::WorkloadKindCount; kindIndex++)
+        {
+            const chip8::WorkloadKind kind = static_cast<chip8::WorkloadKind>(kindIndex);
+
+            if (std::strcmp(chip8::get_workload_kind_name(kind), kindName) == 0)
+            {
+                chip8::Workload workload;
+                chip8::generate_workload(kind, WorkloadIterationCount, workload);
+
+                rom = workload.program;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool load_rom(const char* path, std::vector<u8>& rom)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file)
+            return false;
+
+        rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        // load_program() takes whole instructions.
+        if (rom.size() & 1)
+            rom.push_back(0x00);
+
+        return !rom.empty() && rom.size() <= chip8::MemorySizeInBytes - chip8::MinProgramAddress;
+    }
+}
+
+int main(int ac, char** av)
+{
+    const char* programPath = nullptr;
+    const char* outputPath = nullptr;
+    const char* quirkProfileName = nullptr;
+    const char* workloadKindName = nullptr;
+    const char* name = "rom";
+
+    for (int argIndex = 1; argIndex < ac; argIndex++)
+    {
+        if (std::strcmp(av[argIndex], "--quirks") == 0 && argIndex + 1 < ac)
+            quirkProfileName = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--name") == 0 && argIndex + 1 < ac)
+            name = av[++argIndex];
+        else if (std::strcmp(av[argIndex], "--workload") == 0 && argIndex + 1 < ac)
+            workloadKindName = av[++argIndex];
+        else if (programPath == nullptr && workloadKindName == nullptr)
+            programPath = av[argIndex];
+        else if (outputPath == nullptr)
+            outputPath = av[argIndex];
+    }
+
+    if ((programPath == nullptr) == (workloadKindName == nullptr) || outputPath == nullptr)
+    {
+        std::cerr << "usage: " << av[0]
+                  << " [--quirks <profile>] [--name <identifier>] <rom> | --workload <kind> <output.cpp>" << std::endl;
+        return 2;
+    }
+
+    chip8::QuirkProfile quirkProfile = chip8::QuirkProfile::Default;
+
+    if (quirkProfileName != nullptr && !chip8::find_quirk_profile(quirkProfileName, quirkProfile))
+    {
+        std::cerr << "error: unknown quirk profile '" << quirkProfileName << "'" << std::endl;
+        return 2;
+    }
+
+    std::vector<u8> rom;
+
+    if (workloadKindName != nullptr)
+    {
+        if (!generate_workload_rom(workloadKindName, rom))
+        {
+            std::cerr << "error: unknown workload '" << workloadKindName << "'" << std::endl;
+            return 2;
+        }
+
+        programPath = workloadKindName;
+    }
+    else if (!load_rom(programPath, rom))
+    {
+        std::cerr << "error: could not load " << programPath << std::endl;
+        return 2;
+    }
+
+    std::ofstream output(outputPath);
+
+    if (!output)
+    {
+        std::cerr << "error: could not open " << outputPath << std::endl;
+        return 2;
+    }
+
+    const chip8::RecompilerStats stats =
+        chip8::write_recompiled_rom(output, rom.data(), static_cast<u16>(rom.size()), quirkProfile, name);
+
+    output.close();
+
+    if (!output)
+    {
+        std::cerr << "error: could not write " << outputPath << std::endl;
+        return 2;
+    }
+
+    std::cout << programPath << ": " << stats.blockCount << " blocks, " << stats.inlinedInstructionCount
+              << " instructions inlined, " << stats.fallbackInstructionCount << " through the interpreter, "
+              << stats.interpretedInstructionCount << " left to it" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/Types.h"
+
+#include "chip8/DiffFuzz.h"
+#include "chip8/Execution.h"
+#include "chip8/Keyboard.h"
+#include "chip8/Recompiler.h"
+#include "chip8/StateHash.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Usage: chip8emu_rom_<name> [--frames <n>] [--seed <n>] [--interpret] [--check]
+// Headless simulation of the rom this binary was generated for, see chip8emu_recompile.
+// Runs n frames of 16 ms (3600 by default) with random keys held for 10 frames each, seeded by --seed
+// along with RND, then prints the throughput and the state hash.
+// --interpret runs the interpreter instead, to compare throughput.
+// --check runs the interpreter alongside and stops at the first frame where the states differ.
+// Exits with 0 on success, 1 if the states differ and 2 on error.
+namespace
+{
+    static const u32 DefaultFrameCount = 3600;
+    static const u32 FrameTimeMs = 16;
+    static const u32 KeyHoldFrameCount = 10;
+
+    // No key half of the time, otherwise a single one.
+    u16 generate_key_state(u64& rngState)
+    {
+        const u64 value = chip8::next_splitmix64(rngState);
+
+        return (value & 1) ? static_cast<u16>(1 << ((value >> 1) % chip8::KeyIDCount)) : 0;
+    }
+}
+
+int main(int ac, char** av)
+{
+    const chip8::RecompiledRom& rom = chip8::get_recompiled_rom();
+    u32 frameCount = DefaultFrameCount;
+    u64 seed = 0;
+    bool interpret = false;
+    bool check = false;
+
+    for (int argIndex = 1; argIndex < ac; argIndex++)
+    {
+        if (std::strcmp(av[argIndex], "--frames") == 0 && argIndex + 1 < ac)
+            frameCount = static_cast<u32>(std::strtoul(av[++argIndex], nullptr, 0));
+        else if (std::strcmp(av[argIndex], "--seed") == 0 && argIndex + 1 < ac)
+            seed = std::strtoull(av[++argIndex], nullptr, 0);
+        else if (std::strcmp(av[argIndex], "--interpret") == 0)
+            interpret = true;
+        else if (std::strcmp(av[argIndex], "--check") == 0)
+            check = true;
+        else
+        {
+            std::cerr << "usage: " << av[0] << " [--frames <n>] [--seed <n>] [--interpret] [--check]" << std::endl;
+            return 2;
+        }
+    }
+
+    chip8::EmuConfig interpreterConfig = {};
+    interpreterConfig.randomSeed = seed;
+    interpreterConfig.quirkProfile = rom.quirkProfile;
+    interpreterConfig.executionPolicy = chip8::ExecutionPolicy::Checked;
+
+    chip8::EmuConfig config = interpreterConfig;
+    config.recompiledRom = interpret ? nullptr : &rom;
+
+    chip8::CPUState state = chip8::createCPUState();
+    chip8::seed_random_generator(state, config.randomSeed);
+    chip8::load_recompiled_rom(state, rom);
+
+    chip8::CPUState interpreterState = check ? chip8::forkCPUState(state) : chip8::CPUState();
+
+    u64 rngState = seed;
+    u16 keyState = 0;
+    int result = 0;
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+
+    for (u32 frameIndex = 0; frameIndex < frameCount; frameIndex++)
+    {
+        if (frameIndex % KeyHoldFrameCount == 0)
+            keyState = generate_key_state(rngState);
+
+        chip8::set_key_state(state, keyState);
+        chip8::execute_step(config, state, FrameTimeMs);
+
+        if (!check)
+            continue;
+
+        chip8::set_key_state(interpreterState, keyState);
+        chip8::execute_step(interpreterConfig, interpreterState, FrameTimeMs);
+
+        const char* difference = chip8::find_cpu_state_difference(interpreterState, state);
+
+        if (difference != nullptr)
+        {
+            std::cerr << rom.name << ": " << difference << " differs from the interpreter at frame " << frameIndex
+                      << std::endl;
+            result = 1;
+            break;
+        }
+    }
+
+    const std::chrono::duration<f64> elapsed = Clock::now() - start;
+
+    std::cout << rom.name << ": " << state.instructionCount << " instructions in " << elapsed.count() << " s";
+
+    if (!check && elapsed.count() > 0.0)
+        std::cout << ", " << static_cast<f64>(state.instructionCount) / elapsed.count() / 1e6 << " M/s";
+
+    std::cout << ", state hash " << std::hex << chip8::get_state_hash(state) << std::dec << std::endl;
+
+    if (check)
+        chip8::destroyCPUState(interpreterState);
+
+    chip8::destroyCPUState(state);
+
+    return result;
+}
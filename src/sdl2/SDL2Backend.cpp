@@ -10,8 +10,10 @@
 #include "chip8/Config.h"
 #include "chip8/Cpu.h"
 #include "chip8/Display.h"
+#include "chip8/InputLog.h"
 #include "chip8/Keyboard.h"
 #include "chip8/Execution.h"
+#include "chip8/Trace.h"
 
 #include "core/Assert.h"
 
@@ -20,55 +22,9 @@
 #include <vector>
 #include <iostream>
 
-namespace
-{
-    void fill_image_buffer(u8* imageOutput, const chip8::CPUState& state, const chip8::Palette& palette, unsigned int scale)
-    {
-        static constexpr u32 pixelFormatBGRASizeInBytes = 4;
-
-        const u8 primaryColorBGRA[4] = {
-            static_cast<u8>(palette.primary.b * 255.f),
-            static_cast<u8>(palette.primary.g * 255.f),
-            static_cast<u8>(palette.primary.r * 255.f),
-            255
-        };
-        const u8 secondaryColorBGRA[4] = {
-            static_cast<u8>(palette.secondary.b * 255.f),
-            static_cast<u8>(palette.secondary.g * 255.f),
-            static_cast<u8>(palette.secondary.r * 255.f),
-            255
-        };
-
-        for (unsigned int j = 0; j < chip8::ScreenHeight * scale; j++)
-        {
-            for (unsigned int i = 0; i < chip8::ScreenWidth * scale; i++)
-            {
-                const unsigned int pixelIndexFlatDst = j * chip8::ScreenWidth * scale + i;
-                const unsigned int pixelOutputOffsetInBytes = pixelIndexFlatDst * pixelFormatBGRASizeInBytes;
-                const u8 pixelValue = read_screen_pixel(state, i / scale, j / scale);
-
-                if (pixelValue)
-                {
-                    imageOutput[pixelOutputOffsetInBytes + 0] = primaryColorBGRA[0];
-                    imageOutput[pixelOutputOffsetInBytes + 1] = primaryColorBGRA[1];
-                    imageOutput[pixelOutputOffsetInBytes + 2] = primaryColorBGRA[2];
-                    imageOutput[pixelOutputOffsetInBytes + 3] = primaryColorBGRA[3];
-                }
-                else
-                {
-                    imageOutput[pixelOutputOffsetInBytes + 0] = secondaryColorBGRA[0];
-                    imageOutput[pixelOutputOffsetInBytes + 1] = secondaryColorBGRA[1];
-                    imageOutput[pixelOutputOffsetInBytes + 2] = secondaryColorBGRA[2];
-                    imageOutput[pixelOutputOffsetInBytes + 3] = secondaryColorBGRA[3];
-                }
-            }
-        }
-    }
-}
-
 namespace sdl2
 {
-    int execute_main_loop(chip8::CPUState& state, const chip8::EmuConfig& config)
+    int execute_main_loop(chip8::CPUState& state, const chip8::EmuConfig& config, chip8::InputLog* inputLog)
     {
         static constexpr u32 pixelFormatBGRASizeInBytes = 4;
         const unsigned int scale = config.screenScale;
@@ -110,8 +66,12 @@ namespace sdl2
         unsigned int previousTimeMs = SDL_GetTicks();
         bool shouldExit = false;
 
+        chip8::set_trace_thread_name("main");
+
         while (!shouldExit)
         {
+            CHIP8EMU_TRACE_SCOPE("frame");
+
             // Poll events
             SDL_Event sdlEvent;
             while (SDL_PollEvent(&sdlEvent))
@@ -150,19 +110,36 @@ namespace sdl2
             unsigned int currentTimeMs = SDL_GetTicks();
             unsigned int deltaTimeMs = currentTimeMs - previousTimeMs;
 
+            if (inputLog)
+                chip8::record_input_frame(*inputLog, state, deltaTimeMs);
+
             chip8::execute_step(config, state, deltaTimeMs);
 
-            fill_image_buffer(image.data(), state, config.palette, scale);
+            {
+                CHIP8EMU_TRACE_SCOPE("fill_image_buffer");
+                chip8::fill_image_buffer(image.data(), state, config.palette, scale);
+            }
 
             // Draw
-            SDL_Texture* tex = SDL_CreateTextureFromSurface(ren, surf);
-            Assert(tex != nullptr, SDL_GetError());
+            SDL_Texture* tex = nullptr;
 
-            SDL_RenderClear(ren);
-            SDL_RenderCopy(ren, tex, nullptr, nullptr);
+            {
+                CHIP8EMU_TRACE_SCOPE("create_texture");
+                tex = SDL_CreateTextureFromSurface(ren, surf);
+                Assert(tex != nullptr, SDL_GetError());
+            }
+
+            {
+                CHIP8EMU_TRACE_SCOPE("render_copy");
+                SDL_RenderClear(ren);
+                SDL_RenderCopy(ren, tex, nullptr, nullptr);
+            }
 
             // Present
-            SDL_RenderPresent(ren);
+            {
+                CHIP8EMU_TRACE_SCOPE("present");
+                SDL_RenderPresent(ren);
+            }
 
             SDL_DestroyTexture(tex);
 
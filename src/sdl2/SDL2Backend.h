@@ -13,9 +13,12 @@ namespace chip8
 {
     struct CPUState;
     struct EmuConfig;
+    struct InputLog;
 }
 
 namespace sdl2
 {
-    CHIP8EMU_SDL2_API int execute_main_loop(chip8::CPUState& state, const chip8::EmuConfig& config);
+    // Every frame gets appended to the input log if one is given.
+    CHIP8EMU_SDL2_API int execute_main_loop(chip8::CPUState& state, const chip8::EmuConfig& config,
+                                            chip8::InputLog* inputLog = nullptr);
 }
@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////
+/// chip8-emu
+///
+/// Copyright (c) 2018 Thibault Schueller
+/// This file is distributed under the MIT License
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/Types.h"
+
+#include "chip8/InstructionTrace.h"
+#include "chip8/Opcode.h"
+
+#include <iomanip>
+#include <iostream>
+
+// Usage: chip8emu_tracediff <lhs trace> <rhs trace>
+// Finds the first step where two instruction traces (chip8emu --instruction-trace) differ.
+// Exits with 0 if the traces are identical, 1 if they diverge and 2 on error.
+namespace
+{
+    void print_record(const char* label, const chip8::InstructionTraceRecord& record)
+    {
+        std::cout << label << ": #" << record.instructionCount << std::hex << std::setfill('0') << " pc 0x"
+                  << std::setw(3) << record.pc << " 0x" << std::setw(4) << record.instruction << " ("
+                  << chip8::get_opcode_class_name(chip8::get_opcode_class(record.instruction)) << ") i 0x"
+                  << std::setw(3) << record.i << " sp " << std::dec << static_cast<u32>(record.sp) << " dt "
+                  << static_cast<u32>(record.delayTimer) << " st " << static_cast<u32>(record.soundTimer)
+                  << (record.isWaitingForKey ? " waiting for key" : "") << std::hex;
+
+        for (u32 registerIndex = 0; registerIndex < chip8::VRegisterCount; registerIndex++)
+            std::cout << " v" << registerIndex << ' ' << std::setw(2) << static_cast<u32>(record.vRegisters[registerIndex]);
+
+        std::cout << std::dec << std::setfill(' ') << std::endl;
+    }
+
+    void print_field_differences(const chip8::InstructionTraceRecord& lhs, const chip8::InstructionTraceRecord& rhs)
+    {
+        std::cout << "differs in:";
+
+        if (lhs.instructionCount != rhs.instructionCount)
+            std::cout << " instruction count";
+        if (lhs.pc != rhs.pc)
+            std::cout << " pc";
+        if (lhs.instruction != rhs.instruction)
+            std::cout << " instruction";
+        if (lhs.i != rhs.i)
+            std::cout << " i";
+        if (lhs.sp != rhs.sp)
+            std::cout << " sp";
+        if (lhs.delayTimer != rhs.delayTimer)
+            std::cout << " dt";
+        if (lhs.soundTimer != rhs.soundTimer)
+            std::cout << " st";
+        if (lhs.isWaitingForKey != rhs.isWaitingForKey)
+            std::cout << " key wait";
+
+        for (u32 registerIndex = 0; registerIndex < chip8::VRegisterCount; registerIndex++)
+        {
+            if (lhs.vRegisters[registerIndex] != rhs.vRegisters[registerIndex])
+                std::cout << " v" << std::hex << registerIndex << std::dec;
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+int main(int ac, char** av)
+{
+    if (ac != 3)
+    {
+        std::cerr << "usage: " << av[0] << " <lhs trace> <rhs trace>" << std::endl;
+        return 2;
+    }
+
+    chip8::InstructionTraceReader* lhsReader = chip8::createInstructionTraceReader(av[1]);
+    chip8::InstructionTraceReader* rhsReader = chip8::createInstructionTraceReader(av[2]);
+
+    int result = 2;
+
+    if (lhsReader == nullptr || rhsReader == nullptr)
+        std::cerr << "error: could not open " << (lhsReader == nullptr ? av[1] : av[2]) << std::endl;
+    else
+    {
+        chip8::InstructionTraceDivergence divergence;
+        const chip8::InstructionTraceError error =
+            chip8::find_instruction_trace_divergence(*lhsReader, *rhsReader, divergence);
+
+        if (error != chip8::InstructionTraceError::None)
+            std::cerr << "error: " << chip8::get_instruction_trace_error_string(error) << std::endl;
+        else if (!divergence.hasDiverged)
+        {
+            std::cout << "traces are identical (" << divergence.recordIndex << " steps)" << std::endl;
+            result = 0;
+        }
+        else
+        {
+            std::cout << "traces diverge at step " << divergence.recordIndex << std::endl;
+
+            if (divergence.hasLHSRecord)
+                print_record("lhs", divergence.lhs);
+            else
+                std::cout << "lhs: end of trace" << std::endl;
+
+            if (divergence.hasRHSRecord)
+                print_record("rhs", divergence.rhs);
+            else
+                std::cout << "rhs: end of trace" << std::endl;
+
+            if (divergence.hasLHSRecord && divergence.hasRHSRecord)
+                print_field_differences(divergence.lhs, divergence.rhs);
+
+            result = 1;
+        }
+    }
+
+    if (lhsReader != nullptr)
+        chip8::destroyInstructionTraceReader(lhsReader);
+
+    if (rhsReader != nullptr)
+        chip8::destroyInstructionTraceReader(rhsReader);
+
+    return result;
+}